@@ -0,0 +1,273 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "async_texture_loader.h"
+
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <GL/glew.h>
+
+#include <glog/logging.h>
+
+#include "texture_format.h"
+
+namespace wvu {
+namespace {
+// Creates a 2x2 gray checkerboard used while the textures are loading.
+GLuint CreatePlaceholderTexture() {
+  static const unsigned char kCheckerboard[] = {
+    96, 96, 96, 255,   160, 160, 160, 255,
+    160, 160, 160, 255,   96, 96, 96, 255
+  };
+  GLuint texture_id;
+  glGenTextures(1, &texture_id);
+  glBindTexture(GL_TEXTURE_2D, texture_id);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+               kCheckerboard);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  return texture_id;
+}
+
+}  // namespace
+
+AsyncTextureLoader::AsyncTextureLoader(const Options& options) :
+    options_(options),
+    staging_buffer_pool_(options.max_pooled_staging_bytes),
+    placeholder_texture_id_(CreatePlaceholderTexture()),
+    num_pending_textures_(0),
+    stop_(false) {
+  const int num_decode_threads = std::max(1, options_.num_decode_threads);
+  for (int i = 0; i < num_decode_threads; ++i) {
+    workers_.emplace_back(&AsyncTextureLoader::DecodeLoop, this);
+  }
+}
+
+AsyncTextureLoader::~AsyncTextureLoader() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  decode_condition_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+  for (const TextureEntry& texture : textures_) {
+    if (texture.texture_id != 0) {
+      glDeleteTextures(1, &texture.texture_id);
+    }
+  }
+  glDeleteTextures(1, &placeholder_texture_id_);
+}
+
+TextureHandle AsyncTextureLoader::Load(const std::string& texture_filepath) {
+  const TextureHandle handle = textures_.size();
+  TextureEntry texture;
+  texture.texture_filepath = texture_filepath;
+  texture.state = TEXTURE_PENDING;
+  texture.texture_id = 0;
+  textures_.push_back(texture);
+  ++num_pending_textures_;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    DecodeRequest request;
+    request.handle = handle;
+    request.texture_filepath = texture_filepath;
+    decode_queue_.push_back(request);
+  }
+  decode_condition_.notify_one();
+  return handle;
+}
+
+void AsyncTextureLoader::DecodeLoop() {
+  while (true) {
+    DecodeRequest request;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      decode_condition_.wait(lock, [this]() {
+        return stop_ || !decode_queue_.empty();
+      });
+      if (stop_) {
+        return;
+      }
+      request = decode_queue_.front();
+      decode_queue_.pop_front();
+    }
+    // Decode outside of the lock. This is where the file I/O, the decoding,
+    // the conversion to RGBA8 and the computation of the mip chain happen.
+    DecodedTexture decoded;
+    decoded.handle = request.handle;
+    decoded.num_uploaded_levels = 0;
+    decoded.num_uploaded_rows = 0;
+    if (options_.texture_cache != nullptr) {
+      decoded.success = options_.texture_cache->FindOrCook(
+          request.texture_filepath, options_.cooking_options,
+          &staging_buffer_pool_, &decoded.cooked);
+    } else {
+      decoded.success = CookTexture(request.texture_filepath,
+                                    options_.cooking_options,
+                                    &staging_buffer_pool_, &decoded.cooked);
+    }
+    if (!decoded.success) {
+      LOG(ERROR) << "Could not load the texture " << request.texture_filepath;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    decoded_queue_.push_back(std::move(decoded));
+  }
+}
+
+int AsyncTextureLoader::ProcessUploads() {
+  // Move the decoded textures to the queue that only this thread uses.
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (!decoded_queue_.empty()) {
+      upload_queue_.push_back(std::move(decoded_queue_.front()));
+      decoded_queue_.pop_front();
+    }
+  }
+  int num_ready_textures = 0;
+  size_t budget_bytes = options_.upload_budget_bytes;
+  while (!upload_queue_.empty() && budget_bytes > 0) {
+    DecodedTexture& decoded = upload_queue_.front();
+    TextureEntry& texture = textures_[decoded.handle];
+    if (!decoded.success) {
+      texture.state = TEXTURE_FAILED;
+      --num_pending_textures_;
+      upload_queue_.pop_front();
+      continue;
+    }
+    budget_bytes -= UploadRows(budget_bytes, &decoded);
+    if (decoded.num_uploaded_levels < decoded.cooked.num_levels()) {
+      // The budget is spent; the next call continues with this texture.
+      break;
+    }
+    texture.state = TEXTURE_READY;
+    --num_pending_textures_;
+    ++num_ready_textures;
+    staging_buffer_pool_.Release(decoded.cooked.Release());
+    upload_queue_.pop_front();
+  }
+  return num_ready_textures;
+}
+
+size_t AsyncTextureLoader::UploadRows(const size_t budget_bytes,
+                                      DecodedTexture* decoded) {
+  TextureEntry& texture = textures_[decoded->handle];
+  const CookedTexture& cooked = decoded->cooked;
+  if (texture.texture_id == 0) {
+    // Allocate the storage of every level; the rows are transferred below.
+    glGenTextures(1, &texture.texture_id);
+    glBindTexture(GL_TEXTURE_2D, texture.texture_id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                    ComputeMinFilter(cooked.num_levels()));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+                    cooked.num_levels() - 1);
+    AllocateCookedTextureStorage(cooked.internal_format(), cooked.format(),
+                                 cooked.type(), cooked.levels(), 0);
+  } else {
+    glBindTexture(GL_TEXTURE_2D, texture.texture_id);
+  }
+  // Transfer at least one row so that every texture makes progress.
+  size_t num_uploaded_bytes = 0;
+  do {
+    const int level = decoded->num_uploaded_levels;
+    const CookedTexture::Level& level_info = cooked.level(level);
+    // Rows of blocks for compressed textures, and rows of texels otherwise.
+    const int block_height = cooked.block_height();
+    const int num_level_rows =
+        (level_info.height + block_height - 1) / block_height;
+    const size_t row_size_in_bytes = level_info.size_in_bytes / num_level_rows;
+    const int num_remaining_rows = num_level_rows - decoded->num_uploaded_rows;
+    const int num_rows = std::min<size_t>(
+        num_remaining_rows,
+        std::max<size_t>(1, (budget_bytes - num_uploaded_bytes) /
+                         row_size_in_bytes));
+    const unsigned char* rows = cooked.level_data(level) +
+        decoded->num_uploaded_rows * row_size_in_bytes;
+    const int y = decoded->num_uploaded_rows * block_height;
+    const int height = std::min(num_rows * block_height, level_info.height - y);
+    if (options_.texture_uploader != nullptr && cooked.compressed()) {
+      options_.texture_uploader->UploadCompressed(
+          GL_TEXTURE_2D, level, 0, y, level_info.width, height,
+          cooked.internal_format(), block_height, row_size_in_bytes, rows);
+    } else if (options_.texture_uploader != nullptr) {
+      options_.texture_uploader->Upload(GL_TEXTURE_2D, level, 0, y,
+                                        level_info.width, height,
+                                        cooked.format(), cooked.type(),
+                                        row_size_in_bytes, rows);
+    } else if (cooked.compressed()) {
+      glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, y, level_info.width,
+                                height, cooked.internal_format(),
+                                num_rows * row_size_in_bytes, rows);
+    } else {
+      glTexSubImage2D(GL_TEXTURE_2D, level, 0, y, level_info.width, height,
+                      cooked.format(), cooked.type(), rows);
+    }
+    num_uploaded_bytes += num_rows * row_size_in_bytes;
+    decoded->num_uploaded_rows += num_rows;
+    if (decoded->num_uploaded_rows == num_level_rows) {
+      ++decoded->num_uploaded_levels;
+      decoded->num_uploaded_rows = 0;
+    }
+  } while (decoded->num_uploaded_levels < cooked.num_levels() &&
+           num_uploaded_bytes < budget_bytes);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  return std::min(budget_bytes, num_uploaded_bytes);
+}
+
+GLuint AsyncTextureLoader::texture_id(const TextureHandle handle) const {
+  if (handle < 0 || handle >= static_cast<int>(textures_.size()) ||
+      textures_[handle].state != TEXTURE_READY) {
+    return placeholder_texture_id_;
+  }
+  return textures_[handle].texture_id;
+}
+
+AsyncTextureLoader::TextureState AsyncTextureLoader::state(
+    const TextureHandle handle) const {
+  if (handle < 0 || handle >= static_cast<int>(textures_.size())) {
+    return TEXTURE_FAILED;
+  }
+  return textures_[handle].state;
+}
+
+}  // namespace wvu
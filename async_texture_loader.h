@@ -0,0 +1,186 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_ASYNC_TEXTURE_LOADER_H_
+#define GLUTILS_ASYNC_TEXTURE_LOADER_H_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <GL/glew.h>
+
+#include "staging_buffer_pool.h"
+#include "texture_cache.h"
+#include "texture_cooker.h"
+#include "texture_uploader.h"
+
+namespace wvu {
+// Handle of a texture requested from an AsyncTextureLoader.
+typedef int TextureHandle;
+
+// This class loads textures without blocking the rendering loop. Load()
+// returns a handle immediately and the texture is decoded by a pool of worker
+// threads. Until the texture is ready, the handle resolves to a placeholder
+// texture (a small checkerboard). The workers also cook the textures, i.e.,
+// compute their mip chains, or map them from the cache of cooked textures.
+// Only the transfer to the GPU happens on the
+// thread that owns the OpenGL context, in ProcessUploads(), which uploads at
+// most a given number of bytes per call. Large textures are uploaded in bands
+// of rows across several frames, so the frames do not hitch while many
+// textures stream in.
+// All the member functions must be called from the thread that owns the
+// OpenGL context.
+//
+// Example:
+//
+// wvu::AsyncTextureLoader::Options options;
+// options.num_decode_threads = 4;
+// wvu::AsyncTextureLoader texture_loader(options);
+// const wvu::TextureHandle handle = texture_loader.Load("/path/to/image.png");
+// while (...) {  // Rendering loop.
+//   texture_loader.ProcessUploads();
+//   glBindTexture(GL_TEXTURE_2D, texture_loader.texture_id(handle));
+//   ...
+// }
+class AsyncTextureLoader {
+ public:
+  // Configuration of the loader.
+  struct Options {
+    // Number of threads that decode the images.
+    int num_decode_threads = 2;
+    // Maximum number of bytes transferred to the GPU per call to
+    // ProcessUploads().
+    size_t upload_budget_bytes = 16 << 20;
+    // Maximum number of bytes of decoding memory kept for reuse.
+    size_t max_pooled_staging_bytes = 256 << 20;
+    // Uploader that transfers the texels through PBOs. It is not owned by the
+    // loader and must outlive it. If null, the texels are transferred from
+    // client memory.
+    TextureUploader* texture_uploader = nullptr;
+    // Cache of cooked textures. It is not owned by the loader and must outlive
+    // it. If null, the textures are cooked every time.
+    TextureCache* texture_cache = nullptr;
+    // How the textures are cooked.
+    TextureCookingOptions cooking_options;
+  };
+
+  // States of a requested texture.
+  enum TextureState {
+    TEXTURE_PENDING = 0,
+    TEXTURE_READY = 1,
+    TEXTURE_FAILED = 2
+  };
+
+  // Creates the placeholder texture and starts the worker threads.
+  explicit AsyncTextureLoader(const Options& options);
+  // Stops the worker threads and deletes the textures.
+  ~AsyncTextureLoader();
+
+  // Requests the texture and returns its handle immediately.
+  // Parameters:
+  //   texture_filepath  The filepath of the image to use as texture.
+  TextureHandle Load(const std::string& texture_filepath);
+
+  // Transfers decoded textures to the GPU until the upload budget is spent.
+  // Call it once per frame. Returns the number of textures that became ready.
+  int ProcessUploads();
+
+  // Returns the texture id to bind for the handle: the texture when it is
+  // ready, and the placeholder texture otherwise.
+  GLuint texture_id(const TextureHandle handle) const;
+
+  // Returns the state of the texture.
+  TextureState state(const TextureHandle handle) const;
+
+  // Number of textures that are not ready nor failed.
+  int num_pending_textures() const { return num_pending_textures_; }
+
+ private:
+  // A texture requested to the workers.
+  struct DecodeRequest {
+    TextureHandle handle;
+    std::string texture_filepath;
+  };
+
+  // A cooked texture waiting to be uploaded.
+  struct DecodedTexture {
+    TextureHandle handle;
+    bool success;
+    CookedTexture cooked;
+    // Number of levels already transferred to the GPU.
+    int num_uploaded_levels;
+    // Number of rows of the current level already transferred to the GPU. The
+    // rows of compressed textures are rows of blocks.
+    int num_uploaded_rows;
+  };
+
+  // Bookkeeping of a requested texture.
+  struct TextureEntry {
+    std::string texture_filepath;
+    TextureState state;
+    GLuint texture_id;
+  };
+
+  // Loop executed by the worker threads.
+  void DecodeLoop();
+
+  // Transfers up to budget_bytes of the levels of the decoded texture. Returns
+  // the number of transferred bytes.
+  size_t UploadRows(const size_t budget_bytes, DecodedTexture* decoded);
+
+  const Options options_;
+  StagingBufferPool staging_buffer_pool_;
+  GLuint placeholder_texture_id_;
+  std::vector<TextureEntry> textures_;
+  int num_pending_textures_;
+
+  // Decoded textures in the order in which they are uploaded. Only the OpenGL
+  // thread accesses this queue.
+  std::deque<DecodedTexture> upload_queue_;
+
+  // The members below are shared with the workers and guarded by mutex_.
+  std::mutex mutex_;
+  std::condition_variable decode_condition_;
+  std::deque<DecodeRequest> decode_queue_;
+  std::deque<DecodedTexture> decoded_queue_;
+  bool stop_;
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace wvu
+
+#endif  // GLUTILS_ASYNC_TEXTURE_LOADER_H_
@@ -0,0 +1,896 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "bc_encoder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "cpu_features.h"
+
+#ifdef GLUTILS_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace wvu {
+namespace {
+// Number of texels per block.
+constexpr int kNumBlockTexels = 16;
+// Weight of the first endpoint in the colors of the 4-color palette.
+constexpr float kColorWeights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+// Maximum number of passes of the local search of the endpoints.
+constexpr int kMaxLocalSearchPasses = 8;
+
+// The texels of a block. The color channels are stored in planes of floats for
+// the SIMD kernels.
+struct Block {
+  float r[kNumBlockTexels];
+  float g[kNumBlockTexels];
+  float b[kNumBlockTexels];
+  int alpha[kNumBlockTexels];
+};
+
+// Copies the block from the image, repeating the last row and column when the
+// block crosses the border of the image.
+void LoadBlock(const unsigned char* rgba,
+               const int width,
+               const int height,
+               const int block_x,
+               const int block_y,
+               Block* block) {
+  for (int y = 0; y < 4; ++y) {
+    const int image_y = std::min(4 * block_y + y, height - 1);
+    for (int x = 0; x < 4; ++x) {
+      const int image_x = std::min(4 * block_x + x, width - 1);
+      const unsigned char* texel =
+          rgba + 4 * (static_cast<size_t>(image_y) * width + image_x);
+      const int i = 4 * y + x;
+      block->r[i] = texel[0];
+      block->g[i] = texel[1];
+      block->b[i] = texel[2];
+      block->alpha[i] = texel[3];
+    }
+  }
+}
+
+// -------------------- Colors -------------------------------------------------
+// Quantizes a color to 5:6:5 bits.
+uint16_t PackColor565(const float r, const float g, const float b) {
+  const int r5 = static_cast<int>(std::min(std::max(r, 0.0f), 255.0f) *
+                                  31.0f / 255.0f + 0.5f);
+  const int g6 = static_cast<int>(std::min(std::max(g, 0.0f), 255.0f) *
+                                  63.0f / 255.0f + 0.5f);
+  const int b5 = static_cast<int>(std::min(std::max(b, 0.0f), 255.0f) *
+                                  31.0f / 255.0f + 0.5f);
+  return static_cast<uint16_t>((r5 << 11) | (g6 << 5) | b5);
+}
+
+// Expands a 5:6:5 color to 8 bits per channel by replicating the high bits.
+void UnpackColor565(const uint16_t color, int rgb[3]) {
+  const int r5 = (color >> 11) & 31;
+  const int g6 = (color >> 5) & 63;
+  const int b5 = color & 31;
+  rgb[0] = (r5 << 3) | (r5 >> 2);
+  rgb[1] = (g6 << 2) | (g6 >> 4);
+  rgb[2] = (b5 << 3) | (b5 >> 2);
+}
+
+// Computes the 4-color palette of the endpoints. palette[3 * k + c] holds the
+// channel c of the color k. The palette holds integers, so the errors computed
+// from it are exact in floating point and do not depend on the order of the
+// sums, i.e., every SIMD kernel chooses the same endpoints.
+void BuildColorPalette(const uint16_t color0,
+                       const uint16_t color1,
+                       float palette[12]) {
+  int rgb0[3], rgb1[3];
+  UnpackColor565(color0, rgb0);
+  UnpackColor565(color1, rgb1);
+  for (int c = 0; c < 3; ++c) {
+    palette[c] = rgb0[c];
+    palette[3 + c] = rgb1[c];
+    palette[6 + c] = (2 * rgb0[c] + rgb1[c]) / 3;
+    palette[9 + c] = (rgb0[c] + 2 * rgb1[c]) / 3;
+  }
+}
+
+// Finds the closest palette color of every texel. Returns the sum of squared
+// errors of the block.
+float FindColorIndicesScalar(const Block& block,
+                             const float palette[12],
+                             int indices[kNumBlockTexels]) {
+  float error = 0.0f;
+  for (int i = 0; i < kNumBlockTexels; ++i) {
+    float best_distance = FLT_MAX;
+    int best_index = 0;
+    for (int k = 0; k < 4; ++k) {
+      const float dr = block.r[i] - palette[3 * k];
+      const float dg = block.g[i] - palette[3 * k + 1];
+      const float db = block.b[i] - palette[3 * k + 2];
+      const float distance = dr * dr + dg * dg + db * db;
+      if (distance < best_distance) {
+        best_distance = distance;
+        best_index = k;
+      }
+    }
+    indices[i] = best_index;
+    error += best_distance;
+  }
+  return error;
+}
+
+#ifdef GLUTILS_X86_SIMD
+// The SIMD kernels compare every texel against the four palette colors at
+// once: SSE2 processes 4 texels per iteration and AVX2 processes 8.
+
+GLUTILS_TARGET_SSE2
+float FindColorIndicesSse2(const Block& block,
+                           const float palette[12],
+                           int indices[kNumBlockTexels]) {
+  __m128 error = _mm_setzero_ps();
+  for (int i = 0; i < kNumBlockTexels; i += 4) {
+    const __m128 r = _mm_loadu_ps(block.r + i);
+    const __m128 g = _mm_loadu_ps(block.g + i);
+    const __m128 b = _mm_loadu_ps(block.b + i);
+    __m128 best_distance = _mm_set1_ps(FLT_MAX);
+    __m128i best_index = _mm_setzero_si128();
+    for (int k = 0; k < 4; ++k) {
+      const __m128 dr = _mm_sub_ps(r, _mm_set1_ps(palette[3 * k]));
+      const __m128 dg = _mm_sub_ps(g, _mm_set1_ps(palette[3 * k + 1]));
+      const __m128 db = _mm_sub_ps(b, _mm_set1_ps(palette[3 * k + 2]));
+      const __m128 distance = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)),
+          _mm_mul_ps(db, db));
+      const __m128i closer = _mm_castps_si128(
+          _mm_cmplt_ps(distance, best_distance));
+      best_distance = _mm_min_ps(distance, best_distance);
+      best_index = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(k)),
+                                _mm_andnot_si128(closer, best_index));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(indices + i), best_index);
+    error = _mm_add_ps(error, best_distance);
+  }
+  float errors[4];
+  _mm_storeu_ps(errors, error);
+  return (errors[0] + errors[1]) + (errors[2] + errors[3]);
+}
+
+GLUTILS_TARGET_AVX2
+float FindColorIndicesAvx2(const Block& block,
+                           const float palette[12],
+                           int indices[kNumBlockTexels]) {
+  __m256 error = _mm256_setzero_ps();
+  for (int i = 0; i < kNumBlockTexels; i += 8) {
+    const __m256 r = _mm256_loadu_ps(block.r + i);
+    const __m256 g = _mm256_loadu_ps(block.g + i);
+    const __m256 b = _mm256_loadu_ps(block.b + i);
+    __m256 best_distance = _mm256_set1_ps(FLT_MAX);
+    __m256i best_index = _mm256_setzero_si256();
+    for (int k = 0; k < 4; ++k) {
+      const __m256 dr = _mm256_sub_ps(r, _mm256_set1_ps(palette[3 * k]));
+      const __m256 dg = _mm256_sub_ps(g, _mm256_set1_ps(palette[3 * k + 1]));
+      const __m256 db = _mm256_sub_ps(b, _mm256_set1_ps(palette[3 * k + 2]));
+      const __m256 distance = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(dr, dr), _mm256_mul_ps(dg, dg)),
+          _mm256_mul_ps(db, db));
+      const __m256 closer =
+          _mm256_cmp_ps(distance, best_distance, _CMP_LT_OQ);
+      best_distance = _mm256_min_ps(distance, best_distance);
+      best_index = _mm256_castps_si256(_mm256_blendv_ps(
+          _mm256_castsi256_ps(best_index),
+          _mm256_castsi256_ps(_mm256_set1_epi32(k)), closer));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(indices + i), best_index);
+    error = _mm256_add_ps(error, best_distance);
+  }
+  float errors[8];
+  _mm256_storeu_ps(errors, error);
+  return ((errors[0] + errors[1]) + (errors[2] + errors[3])) +
+      ((errors[4] + errors[5]) + (errors[6] + errors[7]));
+}
+
+#endif  // GLUTILS_X86_SIMD
+
+// Runs the best kernel for the CPU.
+float FindColorIndices(const Block& block,
+                       const float palette[12],
+                       int indices[kNumBlockTexels]) {
+#ifdef GLUTILS_X86_SIMD
+  switch (GetSimdLevel()) {
+    case SIMD_AVX2:
+      return FindColorIndicesAvx2(block, palette, indices);
+    case SIMD_SSE2:
+      return FindColorIndicesSse2(block, palette, indices);
+    default:
+      break;
+  }
+#endif
+  return FindColorIndicesScalar(block, palette, indices);
+}
+
+// Endpoints of a color block and the indices that they produce.
+struct ColorFit {
+  uint16_t color0;
+  uint16_t color1;
+  int indices[kNumBlockTexels];
+  float error;
+};
+
+// Evaluates the endpoints and keeps them if they are better than the fit.
+// Returns true if the endpoints were kept.
+bool TryColorEndpoints(const Block& block,
+                       const uint16_t color0,
+                       const uint16_t color1,
+                       ColorFit* fit) {
+  float palette[12];
+  BuildColorPalette(color0, color1, palette);
+  int indices[kNumBlockTexels];
+  const float error = FindColorIndices(block, palette, indices);
+  if (error >= fit->error) {
+    return false;
+  }
+  fit->color0 = color0;
+  fit->color1 = color1;
+  fit->error = error;
+  memcpy(fit->indices, indices, sizeof(indices));
+  return true;
+}
+
+// Computes the initial endpoints from the bounding box of the colors. The
+// diagonal of the box follows the sign of the covariance of red and blue with
+// green, and the endpoints are inset to reduce the error of the extremes.
+void FitBoundingBox(const Block& block, uint16_t* color0, uint16_t* color1) {
+  float minimum[3] = { 255.0f, 255.0f, 255.0f };
+  float maximum[3] = { 0.0f, 0.0f, 0.0f };
+  float mean[3] = { 0.0f, 0.0f, 0.0f };
+  const float* channels[3] = { block.r, block.g, block.b };
+  for (int c = 0; c < 3; ++c) {
+    for (int i = 0; i < kNumBlockTexels; ++i) {
+      minimum[c] = std::min(minimum[c], channels[c][i]);
+      maximum[c] = std::max(maximum[c], channels[c][i]);
+      mean[c] += channels[c][i];
+    }
+    mean[c] /= kNumBlockTexels;
+  }
+  for (const int c : { 0, 2 }) {
+    float covariance = 0.0f;
+    for (int i = 0; i < kNumBlockTexels; ++i) {
+      covariance += (channels[c][i] - mean[c]) * (block.g[i] - mean[1]);
+    }
+    if (covariance < 0.0f) {
+      std::swap(minimum[c], maximum[c]);
+    }
+  }
+  for (int c = 0; c < 3; ++c) {
+    const float inset = (maximum[c] - minimum[c]) / 16.0f;
+    maximum[c] -= inset;
+    minimum[c] += inset;
+  }
+  *color0 = PackColor565(maximum[0], maximum[1], maximum[2]);
+  *color1 = PackColor565(minimum[0], minimum[1], minimum[2]);
+}
+
+// Computes the initial endpoints from the extremes of the colors along their
+// principal axis.
+void FitPrincipalAxis(const Block& block, uint16_t* color0, uint16_t* color1) {
+  const float* channels[3] = { block.r, block.g, block.b };
+  float mean[3] = { 0.0f, 0.0f, 0.0f };
+  for (int c = 0; c < 3; ++c) {
+    for (int i = 0; i < kNumBlockTexels; ++i) {
+      mean[c] += channels[c][i];
+    }
+    mean[c] /= kNumBlockTexels;
+  }
+  float covariance[3][3] = {{ 0.0f }};
+  for (int i = 0; i < kNumBlockTexels; ++i) {
+    const float d[3] = { block.r[i] - mean[0], block.g[i] - mean[1],
+                         block.b[i] - mean[2] };
+    for (int row = 0; row < 3; ++row) {
+      for (int col = 0; col < 3; ++col) {
+        covariance[row][col] += d[row] * d[col];
+      }
+    }
+  }
+  // Power iterations converge to the principal axis.
+  float axis[3] = { 1.0f, 1.0f, 1.0f };
+  for (int iteration = 0; iteration < 8; ++iteration) {
+    float next_axis[3];
+    for (int row = 0; row < 3; ++row) {
+      next_axis[row] = covariance[row][0] * axis[0] +
+          covariance[row][1] * axis[1] + covariance[row][2] * axis[2];
+    }
+    const float norm = std::max(std::fabs(next_axis[0]),
+                                std::max(std::fabs(next_axis[1]),
+                                         std::fabs(next_axis[2])));
+    if (norm < 1e-6f) {
+      // All the colors are the same.
+      *color0 = *color1 = PackColor565(mean[0], mean[1], mean[2]);
+      return;
+    }
+    for (int c = 0; c < 3; ++c) {
+      axis[c] = next_axis[c] / norm;
+    }
+  }
+  const float axis_norm2 =
+      axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+  float minimum = FLT_MAX;
+  float maximum = -FLT_MAX;
+  for (int i = 0; i < kNumBlockTexels; ++i) {
+    const float t = ((block.r[i] - mean[0]) * axis[0] +
+                     (block.g[i] - mean[1]) * axis[1] +
+                     (block.b[i] - mean[2]) * axis[2]) / axis_norm2;
+    minimum = std::min(minimum, t);
+    maximum = std::max(maximum, t);
+  }
+  *color0 = PackColor565(mean[0] + maximum * axis[0],
+                         mean[1] + maximum * axis[1],
+                         mean[2] + maximum * axis[2]);
+  *color1 = PackColor565(mean[0] + minimum * axis[0],
+                         mean[1] + minimum * axis[1],
+                         mean[2] + minimum * axis[2]);
+}
+
+// Computes the endpoints that minimize the squared error for the indices of
+// the fit. Returns false if the indices do not determine the endpoints (e.g.,
+// all the texels use the same index).
+bool FitLeastSquares(const Block& block,
+                     const ColorFit& fit,
+                     uint16_t* color0,
+                     uint16_t* color1) {
+  float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+  float ax[3] = { 0.0f, 0.0f, 0.0f };
+  float bx[3] = { 0.0f, 0.0f, 0.0f };
+  const float* channels[3] = { block.r, block.g, block.b };
+  for (int i = 0; i < kNumBlockTexels; ++i) {
+    const float a = kColorWeights[fit.indices[i]];
+    const float b = 1.0f - a;
+    aa += a * a;
+    ab += a * b;
+    bb += b * b;
+    for (int c = 0; c < 3; ++c) {
+      ax[c] += a * channels[c][i];
+      bx[c] += b * channels[c][i];
+    }
+  }
+  const float determinant = aa * bb - ab * ab;
+  if (std::fabs(determinant) < 1e-6f) {
+    return false;
+  }
+  float endpoint0[3], endpoint1[3];
+  for (int c = 0; c < 3; ++c) {
+    endpoint0[c] = (bb * ax[c] - ab * bx[c]) / determinant;
+    endpoint1[c] = (aa * bx[c] - ab * ax[c]) / determinant;
+  }
+  *color0 = PackColor565(endpoint0[0], endpoint0[1], endpoint0[2]);
+  *color1 = PackColor565(endpoint1[0], endpoint1[1], endpoint1[2]);
+  return true;
+}
+
+// Moves every channel of every endpoint by one quantization step while the
+// error decreases.
+void SearchColorEndpoints(const Block& block, ColorFit* fit) {
+  // Bit offsets and maximum values of the 5:6:5 channels.
+  static const int kShifts[3] = { 11, 5, 0 };
+  static const int kMaxValues[3] = { 31, 63, 31 };
+  for (int pass = 0; pass < kMaxLocalSearchPasses; ++pass) {
+    bool improved = false;
+    for (int endpoint = 0; endpoint < 2; ++endpoint) {
+      for (int c = 0; c < 3; ++c) {
+        for (const int step : { -1, 1 }) {
+          uint16_t colors[2] = { fit->color0, fit->color1 };
+          const int value =
+              ((colors[endpoint] >> kShifts[c]) & kMaxValues[c]) + step;
+          if (value < 0 || value > kMaxValues[c]) {
+            continue;
+          }
+          colors[endpoint] = static_cast<uint16_t>(
+              (colors[endpoint] & ~(kMaxValues[c] << kShifts[c])) |
+              (value << kShifts[c]));
+          improved |= TryColorEndpoints(block, colors[0], colors[1], fit);
+        }
+      }
+    }
+    if (!improved) {
+      break;
+    }
+  }
+}
+
+// Encodes the colors of the block into the 8 bytes of a BC1 block.
+void EncodeColorBlock(const Block& block,
+                      const BcQuality quality,
+                      unsigned char* output) {
+  ColorFit fit = {};
+  fit.error = FLT_MAX;
+  uint16_t color0, color1;
+  FitBoundingBox(block, &color0, &color1);
+  TryColorEndpoints(block, color0, color1, &fit);
+  if (quality != BC_QUALITY_FAST) {
+    FitPrincipalAxis(block, &color0, &color1);
+    TryColorEndpoints(block, color0, color1, &fit);
+    const int num_iterations = quality == BC_QUALITY_HIGH ? 4 : 1;
+    for (int iteration = 0; iteration < num_iterations; ++iteration) {
+      if (!FitLeastSquares(block, fit, &color0, &color1) ||
+          !TryColorEndpoints(block, color0, color1, &fit)) {
+        break;
+      }
+    }
+  }
+  if (quality == BC_QUALITY_HIGH) {
+    SearchColorEndpoints(block, &fit);
+  }
+  // The 4-color palette requires color0 > color1. Swapping the endpoints
+  // swaps the indices 0 <-> 1 and 2 <-> 3.
+  int index_mask = 0;
+  if (fit.color0 < fit.color1) {
+    std::swap(fit.color0, fit.color1);
+    index_mask = 1;
+  } else if (fit.color0 == fit.color1) {
+    // All the colors of the palette are the same; use index 0, which is valid
+    // in both palettes.
+    index_mask = -1;
+  }
+  uint32_t indices = 0;
+  for (int i = 0; i < kNumBlockTexels; ++i) {
+    const int index = index_mask < 0 ? 0 : fit.indices[i] ^ index_mask;
+    indices |= static_cast<uint32_t>(index) << (2 * i);
+  }
+  output[0] = fit.color0 & 0xFF;
+  output[1] = fit.color0 >> 8;
+  output[2] = fit.color1 & 0xFF;
+  output[3] = fit.color1 >> 8;
+  for (int i = 0; i < 4; ++i) {
+    output[4 + i] = (indices >> (8 * i)) & 0xFF;
+  }
+}
+
+// -------------------- Alpha --------------------------------------------------
+// Computes the alpha palette. If alpha0 > alpha1 the palette interpolates 8
+// values; otherwise it interpolates 6 values and adds 0 and 255.
+void BuildAlphaPalette(const int alpha0, const int alpha1, int palette[8]) {
+  palette[0] = alpha0;
+  palette[1] = alpha1;
+  if (alpha0 > alpha1) {
+    for (int k = 1; k < 7; ++k) {
+      palette[1 + k] = ((7 - k) * alpha0 + k * alpha1) / 7;
+    }
+  } else {
+    for (int k = 1; k < 5; ++k) {
+      palette[1 + k] = ((5 - k) * alpha0 + k * alpha1) / 5;
+    }
+    palette[6] = 0;
+    palette[7] = 255;
+  }
+}
+
+// Endpoints of an alpha block and the indices that they produce.
+struct AlphaFit {
+  int alpha0;
+  int alpha1;
+  int indices[kNumBlockTexels];
+  int error;
+};
+
+// Evaluates the endpoints and keeps them if they are better than the fit.
+void TryAlphaEndpoints(const Block& block,
+                       const int alpha0,
+                       const int alpha1,
+                       AlphaFit* fit) {
+  int palette[8];
+  BuildAlphaPalette(alpha0, alpha1, palette);
+  int indices[kNumBlockTexels];
+  int error = 0;
+  for (int i = 0; i < kNumBlockTexels; ++i) {
+    int best_distance = INT32_MAX;
+    for (int k = 0; k < 8; ++k) {
+      const int distance = (block.alpha[i] - palette[k]) *
+          (block.alpha[i] - palette[k]);
+      if (distance < best_distance) {
+        best_distance = distance;
+        indices[i] = k;
+      }
+    }
+    error += best_distance;
+  }
+  if (error < fit->error) {
+    fit->alpha0 = alpha0;
+    fit->alpha1 = alpha1;
+    fit->error = error;
+    memcpy(fit->indices, indices, sizeof(indices));
+  }
+}
+
+// Encodes the alpha of the block into the 8 bytes of a BC3 alpha block.
+void EncodeAlphaBlock(const Block& block,
+                      const BcQuality quality,
+                      unsigned char* output) {
+  int minimum = 255, maximum = 0;
+  // Extremes of the values other than 0 and 255, which the 6-value palette
+  // represents exactly.
+  int inner_minimum = 255, inner_maximum = 0;
+  for (int i = 0; i < kNumBlockTexels; ++i) {
+    minimum = std::min(minimum, block.alpha[i]);
+    maximum = std::max(maximum, block.alpha[i]);
+    if (block.alpha[i] != 0 && block.alpha[i] != 255) {
+      inner_minimum = std::min(inner_minimum, block.alpha[i]);
+      inner_maximum = std::max(inner_maximum, block.alpha[i]);
+    }
+  }
+  AlphaFit fit = {};
+  fit.error = INT32_MAX;
+  TryAlphaEndpoints(block, maximum, minimum, &fit);
+  if (quality != BC_QUALITY_FAST && (minimum == 0 || maximum == 255)) {
+    if (inner_minimum > inner_maximum) {
+      // Only 0 and 255.
+      inner_minimum = inner_maximum = 0;
+    }
+    TryAlphaEndpoints(block, inner_minimum, inner_maximum, &fit);
+  }
+  if (quality == BC_QUALITY_HIGH) {
+    // Search around the endpoints while keeping the palette mode.
+    for (int pass = 0; pass < kMaxLocalSearchPasses; ++pass) {
+      const int error = fit.error;
+      const bool eight_values = fit.alpha0 > fit.alpha1;
+      const int alpha0 = fit.alpha0;
+      const int alpha1 = fit.alpha1;
+      for (const int step : { -2, -1, 1, 2 }) {
+        const int candidates[2][2] = {
+          { alpha0 + step, alpha1 }, { alpha0, alpha1 + step }
+        };
+        for (const auto& candidate : candidates) {
+          if (candidate[0] < 0 || candidate[0] > 255 || candidate[1] < 0 ||
+              candidate[1] > 255 ||
+              (candidate[0] > candidate[1]) != eight_values) {
+            continue;
+          }
+          TryAlphaEndpoints(block, candidate[0], candidate[1], &fit);
+        }
+      }
+      if (fit.error == error) {
+        break;
+      }
+    }
+  }
+  output[0] = static_cast<unsigned char>(fit.alpha0);
+  output[1] = static_cast<unsigned char>(fit.alpha1);
+  uint64_t indices = 0;
+  for (int i = 0; i < kNumBlockTexels; ++i) {
+    indices |= static_cast<uint64_t>(fit.indices[i]) << (3 * i);
+  }
+  for (int i = 0; i < 6; ++i) {
+    output[2 + i] = (indices >> (8 * i)) & 0xFF;
+  }
+}
+
+// -------------------- Rate-distortion optimization ---------------------------
+// The blocks are replaced by cheaper blocks to code when the increase of the
+// error is worth it: an LZ compressor (see supercompression.h) stores a run of
+// bytes that repeats a recent block as a short match instead of literals. The
+// candidates reuse the endpoints, the indices or the whole block of the
+// previous blocks of the row, and the block with the lowest
+//   error + lambda * bits
+// is kept. The bits are rough estimates of the cost of the block for an LZ
+// compressor.
+constexpr float kLiteralBlockBits = 64.0f;
+constexpr float kHalfMatchBlockBits = 40.0f;
+constexpr float kFullMatchBlockBits = 16.0f;
+// Number of previous blocks whose parts are reused.
+constexpr int kRdoWindowSize = 8;
+
+// Returns the sum of squared errors of the colors of the block encoded in the
+// 8 bytes of a BC1 block. The endpoints are in the 4-color order, or equal
+// with all the indices zero, as the encoder writes them.
+float ColorBlockError(const Block& block, const unsigned char* encoded) {
+  const uint16_t color0 = encoded[0] | (encoded[1] << 8);
+  const uint16_t color1 = encoded[2] | (encoded[3] << 8);
+  float palette[12];
+  BuildColorPalette(color0, color1, palette);
+  const uint32_t indices =
+      encoded[4] | (encoded[5] << 8) | (encoded[6] << 16) |
+      (static_cast<uint32_t>(encoded[7]) << 24);
+  float error = 0.0f;
+  for (int i = 0; i < kNumBlockTexels; ++i) {
+    const float* color = palette + 3 * ((indices >> (2 * i)) & 3);
+    const float dr = block.r[i] - color[0];
+    const float dg = block.g[i] - color[1];
+    const float db = block.b[i] - color[2];
+    error += dr * dr + dg * dg + db * db;
+  }
+  return error;
+}
+
+// Returns the sum of squared errors of the alpha of the block encoded in the
+// 8 bytes of a BC3 alpha block.
+float AlphaBlockError(const Block& block, const unsigned char* encoded) {
+  int palette[8];
+  BuildAlphaPalette(encoded[0], encoded[1], palette);
+  uint64_t indices = 0;
+  for (int i = 0; i < 6; ++i) {
+    indices |= static_cast<uint64_t>(encoded[2 + i]) << (8 * i);
+  }
+  float error = 0.0f;
+  for (int i = 0; i < kNumBlockTexels; ++i) {
+    const int difference = block.alpha[i] - palette[(indices >> (3 * i)) & 7];
+    error += difference * difference;
+  }
+  return error;
+}
+
+// Keeps the candidate if its cost is lower than the best cost.
+void TryRdoCandidate(const unsigned char candidate[8],
+                     const float cost,
+                     float* best_cost,
+                     unsigned char best[8]) {
+  if (cost < *best_cost) {
+    *best_cost = cost;
+    memcpy(best, candidate, 8);
+  }
+}
+
+// Replaces the BC1 color block in output with the cheapest candidate.
+// Parameters:
+//   block  The texels of the block.
+//   previous_blocks  The color blocks before the block, the closest first.
+//   num_previous_blocks  The number of previous blocks.
+//   lambda  The weight of the bits against the squared errors.
+//   output  The 8 bytes of the color block.
+void OptimizeColorBlockRate(const Block& block,
+                            const unsigned char* const* previous_blocks,
+                            const int num_previous_blocks,
+                            const float lambda,
+                            unsigned char* output) {
+  unsigned char best[8];
+  memcpy(best, output, sizeof(best));
+  float best_cost =
+      ColorBlockError(block, output) + lambda * kLiteralBlockBits;
+  const bool equal_endpoints = output[0] == output[2] && output[1] == output[3];
+  unsigned char candidate[8];
+  for (int i = 0; i < num_previous_blocks; ++i) {
+    const unsigned char* previous = previous_blocks[i];
+    TryRdoCandidate(previous,
+                    ColorBlockError(block, previous) +
+                        lambda * kFullMatchBlockBits,
+                    &best_cost, best);
+    // The endpoints of the previous block with the best indices for them.
+    const uint16_t color0 = previous[0] | (previous[1] << 8);
+    const uint16_t color1 = previous[2] | (previous[3] << 8);
+    float palette[12];
+    BuildColorPalette(color0, color1, palette);
+    int indices[kNumBlockTexels];
+    const float error = FindColorIndices(block, palette, indices);
+    uint32_t packed_indices = 0;
+    for (int j = 0; j < kNumBlockTexels && color0 != color1; ++j) {
+      packed_indices |= static_cast<uint32_t>(indices[j]) << (2 * j);
+    }
+    memcpy(candidate, previous, 4);
+    for (int j = 0; j < 4; ++j) {
+      candidate[4 + j] = (packed_indices >> (8 * j)) & 0xFF;
+    }
+    TryRdoCandidate(candidate,
+                    (color0 != color1 ? error :
+                     ColorBlockError(block, candidate)) +
+                        lambda * kHalfMatchBlockBits,
+                    &best_cost, best);
+    // The endpoints of the block with the indices of the previous block.
+    // Equal endpoints require zero indices.
+    if (!equal_endpoints) {
+      memcpy(candidate, output, 4);
+      memcpy(candidate + 4, previous + 4, 4);
+      TryRdoCandidate(candidate,
+                      ColorBlockError(block, candidate) +
+                          lambda * kHalfMatchBlockBits,
+                      &best_cost, best);
+    }
+  }
+  memcpy(output, best, sizeof(best));
+}
+
+// Replaces the BC3 alpha block in output with a previous alpha block if it is
+// cheaper. The parameters are those of OptimizeColorBlockRate().
+void OptimizeAlphaBlockRate(const Block& block,
+                            const unsigned char* const* previous_blocks,
+                            const int num_previous_blocks,
+                            const float lambda,
+                            unsigned char* output) {
+  unsigned char best[8];
+  memcpy(best, output, sizeof(best));
+  float best_cost =
+      AlphaBlockError(block, output) + lambda * kLiteralBlockBits;
+  for (int i = 0; i < num_previous_blocks; ++i) {
+    TryRdoCandidate(previous_blocks[i],
+                    AlphaBlockError(block, previous_blocks[i]) +
+                        lambda * kFullMatchBlockBits,
+                    &best_cost, best);
+  }
+  memcpy(output, best, sizeof(best));
+}
+
+// -------------------- Decoding -----------------------------------------------
+// Decodes a BC1 color block into 16 RGBA8 texels.
+void DecodeColorBlock(const unsigned char* input,
+                      const bool four_colors_only,
+                      unsigned char texels[kNumBlockTexels][4]) {
+  const uint16_t color0 = input[0] | (input[1] << 8);
+  const uint16_t color1 = input[2] | (input[3] << 8);
+  int palette[4][4];
+  UnpackColor565(color0, palette[0]);
+  UnpackColor565(color1, palette[1]);
+  palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+  for (int c = 0; c < 3; ++c) {
+    if (color0 > color1 || four_colors_only) {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    } else {
+      // The RGB formats decode the fourth color as opaque black.
+      palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+      palette[3][c] = 0;
+    }
+  }
+  const uint32_t indices =
+      input[4] | (input[5] << 8) | (input[6] << 16) |
+      (static_cast<uint32_t>(input[7]) << 24);
+  for (int i = 0; i < kNumBlockTexels; ++i) {
+    const int* color = palette[(indices >> (2 * i)) & 3];
+    for (int c = 0; c < 4; ++c) {
+      texels[i][c] = static_cast<unsigned char>(color[c]);
+    }
+  }
+}
+
+// Decodes a BC3 alpha block into the alpha of 16 RGBA8 texels.
+void DecodeAlphaBlock(const unsigned char* input,
+                      unsigned char texels[kNumBlockTexels][4]) {
+  int palette[8];
+  BuildAlphaPalette(input[0], input[1], palette);
+  uint64_t indices = 0;
+  for (int i = 0; i < 6; ++i) {
+    indices |= static_cast<uint64_t>(input[2 + i]) << (8 * i);
+  }
+  for (int i = 0; i < kNumBlockTexels; ++i) {
+    texels[i][3] =
+        static_cast<unsigned char>(palette[(indices >> (3 * i)) & 7]);
+  }
+}
+
+}  // namespace
+
+int BcBlockSizeInBytes(const BcFormat format) {
+  return format == BC1_FORMAT ? 8 : 16;
+}
+
+size_t BcCompressedSizeInBytes(const BcFormat format,
+                               const int width,
+                               const int height) {
+  const size_t num_blocks_x = (width + 3) / 4;
+  const size_t num_blocks_y = (height + 3) / 4;
+  return num_blocks_x * num_blocks_y * BcBlockSizeInBytes(format);
+}
+
+void EncodeBc(const unsigned char* rgba,
+              const int width,
+              const int height,
+              const BcFormat format,
+              const BcQuality quality,
+              const int num_threads,
+              const float rdo_lambda,
+              unsigned char* blocks) {
+  const int num_blocks_x = (width + 3) / 4;
+  const int num_blocks_y = (height + 3) / 4;
+  const int block_size_in_bytes = BcBlockSizeInBytes(format);
+  // The threads take rows of blocks until there are none left, which balances
+  // the work when some rows are slower to encode than others.
+  std::atomic<int> next_block_row(0);
+  auto encode_block_rows = [&]() {
+    Block block;
+    for (int block_y = next_block_row++; block_y < num_blocks_y;
+         block_y = next_block_row++) {
+      unsigned char* output = blocks +
+          static_cast<size_t>(block_y) * num_blocks_x * block_size_in_bytes;
+      for (int block_x = 0; block_x < num_blocks_x; ++block_x) {
+        LoadBlock(rgba, width, height, block_x, block_y, &block);
+        // The blocks of the row before this one, the closest first.
+        const int num_previous_blocks =
+            rdo_lambda > 0.0f ? std::min(block_x, kRdoWindowSize) : 0;
+        const unsigned char* previous_blocks[kRdoWindowSize];
+        if (format == BC3_FORMAT) {
+          EncodeAlphaBlock(block, quality, output);
+          for (int i = 0; i < num_previous_blocks; ++i) {
+            previous_blocks[i] = output - (i + 1) * block_size_in_bytes;
+          }
+          if (num_previous_blocks > 0) {
+            OptimizeAlphaBlockRate(block, previous_blocks,
+                                   num_previous_blocks, rdo_lambda, output);
+          }
+          output += 8;
+        }
+        EncodeColorBlock(block, quality, output);
+        for (int i = 0; i < num_previous_blocks; ++i) {
+          previous_blocks[i] = output - (i + 1) * block_size_in_bytes;
+        }
+        if (num_previous_blocks > 0) {
+          OptimizeColorBlockRate(block, previous_blocks, num_previous_blocks,
+                                 rdo_lambda, output);
+        }
+        output += 8;
+      }
+    }
+  };
+  const int max_num_threads = num_threads > 0 ?
+      num_threads : std::max(1u, std::thread::hardware_concurrency());
+  const int num_workers = std::min(max_num_threads, num_blocks_y) - 1;
+  std::vector<std::thread> workers;
+  for (int i = 0; i < num_workers; ++i) {
+    workers.emplace_back(encode_block_rows);
+  }
+  encode_block_rows();
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+}
+
+void DecodeBc(const unsigned char* blocks,
+              const int width,
+              const int height,
+              const BcFormat format,
+              unsigned char* rgba) {
+  const int num_blocks_x = (width + 3) / 4;
+  const int num_blocks_y = (height + 3) / 4;
+  unsigned char texels[kNumBlockTexels][4];
+  for (int block_y = 0; block_y < num_blocks_y; ++block_y) {
+    for (int block_x = 0; block_x < num_blocks_x; ++block_x) {
+      if (format == BC3_FORMAT) {
+        DecodeColorBlock(blocks + 8, true, texels);
+        DecodeAlphaBlock(blocks, texels);
+      } else {
+        DecodeColorBlock(blocks, false, texels);
+      }
+      blocks += BcBlockSizeInBytes(format);
+      // Copy the texels that are inside the image.
+      for (int y = 0; y < 4 && 4 * block_y + y < height; ++y) {
+        for (int x = 0; x < 4 && 4 * block_x + x < width; ++x) {
+          memcpy(rgba + 4 * ((static_cast<size_t>(4 * block_y + y)) * width +
+                             4 * block_x + x),
+                 texels[4 * y + x], 4);
+        }
+      }
+    }
+  }
+}
+
+}  // namespace wvu
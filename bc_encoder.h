@@ -0,0 +1,114 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_BC_ENCODER_H_
+#define GLUTILS_BC_ENCODER_H_
+
+#include <cstddef>
+
+namespace wvu {
+// Block-compressed (S3TC) formats. The textures are split into blocks of 4x4
+// texels, and every block stores two endpoint colors and, for every texel, the
+// index of a color interpolated between the endpoints. The GPU samples the
+// blocks directly, so the textures take 4-8x less memory and bandwidth than
+// RGBA8 textures.
+enum BcFormat {
+  // 8 bytes per block: RGB endpoints in 5:6:5 bits and 2-bit indices. The
+  // alpha is ignored (GL_COMPRESSED_RGB_S3TC_DXT1_EXT).
+  BC1_FORMAT = 0,
+  // 16 bytes per block: a BC1 block for RGB plus 8-bit alpha endpoints and
+  // 3-bit alpha indices (GL_COMPRESSED_RGBA_S3TC_DXT5_EXT).
+  BC3_FORMAT = 1
+};
+
+// Trade-off between the time to encode and the quality of the blocks.
+enum BcQuality {
+  // Endpoints from the bounding box of the block colors.
+  BC_QUALITY_FAST = 0,
+  // The best of the bounding box and the extremes along the principal axis
+  // of the block colors, refined once by least squares.
+  BC_QUALITY_NORMAL = 1,
+  // Iterative least squares followed by a local search of the endpoints.
+  BC_QUALITY_HIGH = 2
+};
+
+// Returns the number of bytes of a block of the format.
+int BcBlockSizeInBytes(const BcFormat format);
+
+// Returns the number of bytes of an image of the given size in the format.
+size_t BcCompressedSizeInBytes(const BcFormat format,
+                               const int width,
+                               const int height);
+
+// Encodes an RGBA8 image into blocks. The rows of blocks are split among
+// threads, and the search of the endpoints evaluates the candidates with SSE2
+// or AVX2 when the CPU supports them, see cpu_features.h. Images whose size is
+// not a multiple of 4 repeat their last row and column in the border blocks.
+// Parameters:
+//   rgba  The RGBA8 image.
+//   width, height  The size of the image.
+//   format  The format of the blocks.
+//   quality  The quality of the encoding.
+//   num_threads  The number of threads; 0 uses one thread per core.
+//   rdo_lambda  If positive, the blocks are rate-distortion optimized: they
+//     reuse the endpoints or the indices of the previous blocks of their row
+//     when the squared error grows by less than rdo_lambda per saved bit, so
+//     that LZ compressors shrink the blocks further. Typical values are 1-20.
+//   blocks  The buffer that holds BcCompressedSizeInBytes() bytes. The blocks
+//     are stored in row-major order.
+void EncodeBc(const unsigned char* rgba,
+              const int width,
+              const int height,
+              const BcFormat format,
+              const BcQuality quality,
+              const int num_threads,
+              const float rdo_lambda,
+              unsigned char* blocks);
+
+// Decodes the blocks into an RGBA8 image, as the GPU does. Useful to verify
+// the encoder and to measure its quality.
+// Parameters:
+//   blocks  The blocks of the image.
+//   width, height  The size of the image.
+//   format  The format of the blocks.
+//   rgba  The buffer that holds the 4 * width * height bytes of the image.
+void DecodeBc(const unsigned char* blocks,
+              const int width,
+              const int height,
+              const BcFormat format,
+              unsigned char* rgba);
+
+}  // namespace wvu
+
+#endif  // GLUTILS_BC_ENCODER_H_
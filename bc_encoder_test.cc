@@ -0,0 +1,210 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "bc_encoder.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "cpu_features.h"
+#include "image_metrics.h"
+
+namespace wvu {
+namespace {
+// The images are not multiples of the block size, so the border blocks repeat
+// their last row and column.
+constexpr int kWidth = 67;
+constexpr int kHeight = 45;
+
+// Returns an RGBA8 image of smooth gradients, with a gradient in the alpha.
+std::vector<unsigned char> MakeGradientImage() {
+  std::vector<unsigned char> rgba(4 * kWidth * kHeight);
+  for (int y = 0; y < kHeight; ++y) {
+    for (int x = 0; x < kWidth; ++x) {
+      unsigned char* texel = &rgba[4 * (y * kWidth + x)];
+      texel[0] = x * 255 / (kWidth - 1);
+      texel[1] = y * 255 / (kHeight - 1);
+      texel[2] = 2 * (x + y);
+      texel[3] = (3 * x + 5 * y) & 255;
+    }
+  }
+  return rgba;
+}
+
+// Returns the gradient image with noise, which the endpoints cannot fit.
+std::vector<unsigned char> MakeNoisyImage() {
+  std::vector<unsigned char> rgba = MakeGradientImage();
+  std::mt19937 random_engine(7);
+  std::uniform_int_distribution<int> noise(-12, 12);
+  for (unsigned char& value : rgba) {
+    value = std::min(std::max(value + noise(random_engine), 0), 255);
+  }
+  return rgba;
+}
+
+// Encodes the image, decodes the blocks and returns the PSNR of the decoded
+// image in dB over the channels that the format stores.
+double EncodeDecodePsnr(const std::vector<unsigned char>& rgba,
+                        const BcFormat format,
+                        const BcQuality quality) {
+  std::vector<unsigned char> blocks(
+      BcCompressedSizeInBytes(format, kWidth, kHeight));
+  EncodeBc(rgba.data(), kWidth, kHeight, format, quality, 1, 0.0f,
+           blocks.data());
+  std::vector<unsigned char> decoded(rgba.size());
+  DecodeBc(blocks.data(), kWidth, kHeight, format, decoded.data());
+  return ComputePsnr(rgba.data(), decoded.data(), kWidth * kHeight,
+                     format == BC1_FORMAT ? 3 : 4);
+}
+
+// Returns the blocks of the image encoded with the instruction sets up to
+// max_simd_level.
+std::vector<unsigned char> EncodeWithSimdLevel(
+    const std::vector<unsigned char>& rgba,
+    const BcFormat format,
+    const BcQuality quality,
+    const SimdLevel max_simd_level) {
+  SetMaxSimdLevel(max_simd_level);
+  std::vector<unsigned char> blocks(
+      BcCompressedSizeInBytes(format, kWidth, kHeight));
+  EncodeBc(rgba.data(), kWidth, kHeight, format, quality, 1, 0.0f,
+           blocks.data());
+  SetMaxSimdLevel(SIMD_AVX2);
+  return blocks;
+}
+
+TEST(BcEncoderTest, CompressedSize) {
+  EXPECT_EQ(BcBlockSizeInBytes(BC1_FORMAT), 8);
+  EXPECT_EQ(BcBlockSizeInBytes(BC3_FORMAT), 16);
+  EXPECT_EQ(BcCompressedSizeInBytes(BC1_FORMAT, kWidth, kHeight),
+            8u * 17 * 12);
+  EXPECT_EQ(BcCompressedSizeInBytes(BC3_FORMAT, 4, 4), 16u);
+}
+
+TEST(BcEncoderTest, Bc1RoundTripPsnr) {
+  const std::vector<unsigned char> gradient = MakeGradientImage();
+  const std::vector<unsigned char> noisy = MakeNoisyImage();
+  for (const BcQuality quality :
+       { BC_QUALITY_FAST, BC_QUALITY_NORMAL, BC_QUALITY_HIGH }) {
+    EXPECT_GT(EncodeDecodePsnr(gradient, BC1_FORMAT, quality), 36.0)
+        << "quality " << quality;
+    EXPECT_GT(EncodeDecodePsnr(noisy, BC1_FORMAT, quality), 30.0)
+        << "quality " << quality;
+  }
+}
+
+TEST(BcEncoderTest, Bc3RoundTripPsnr) {
+  const std::vector<unsigned char> gradient = MakeGradientImage();
+  const std::vector<unsigned char> noisy = MakeNoisyImage();
+  for (const BcQuality quality :
+       { BC_QUALITY_FAST, BC_QUALITY_NORMAL, BC_QUALITY_HIGH }) {
+    EXPECT_GT(EncodeDecodePsnr(gradient, BC3_FORMAT, quality), 36.0)
+        << "quality " << quality;
+    EXPECT_GT(EncodeDecodePsnr(noisy, BC3_FORMAT, quality), 30.0)
+        << "quality " << quality;
+  }
+}
+
+TEST(BcEncoderTest, HigherQualityDoesNotLosePsnr) {
+  const std::vector<unsigned char> noisy = MakeNoisyImage();
+  for (const BcFormat format : { BC1_FORMAT, BC3_FORMAT }) {
+    const double fast_psnr =
+        EncodeDecodePsnr(noisy, format, BC_QUALITY_FAST);
+    const double normal_psnr =
+        EncodeDecodePsnr(noisy, format, BC_QUALITY_NORMAL);
+    const double high_psnr =
+        EncodeDecodePsnr(noisy, format, BC_QUALITY_HIGH);
+    EXPECT_GE(normal_psnr, fast_psnr) << "format " << format;
+    EXPECT_GE(high_psnr, normal_psnr) << "format " << format;
+  }
+}
+
+TEST(BcEncoderTest, SolidBlocksAreExact) {
+  // 5:6:5 colors and any alpha are stored without error.
+  std::vector<unsigned char> rgba(4 * kWidth * kHeight);
+  for (size_t i = 0; i < rgba.size(); i += 4) {
+    rgba[i] = 0xFF;
+    rgba[i + 1] = 0x82;
+    rgba[i + 2] = 0x00;
+    rgba[i + 3] = 0x5A;
+  }
+  std::vector<unsigned char> blocks(
+      BcCompressedSizeInBytes(BC3_FORMAT, kWidth, kHeight));
+  EncodeBc(rgba.data(), kWidth, kHeight, BC3_FORMAT, BC_QUALITY_NORMAL, 1,
+           0.0f, blocks.data());
+  std::vector<unsigned char> decoded(rgba.size());
+  DecodeBc(blocks.data(), kWidth, kHeight, BC3_FORMAT, decoded.data());
+  EXPECT_EQ(decoded, rgba);
+}
+
+TEST(BcEncoderTest, SimdKernelsMatchScalar) {
+  const std::vector<unsigned char> noisy = MakeNoisyImage();
+  const SimdLevel simd_level = GetSimdLevel();
+  for (const BcFormat format : { BC1_FORMAT, BC3_FORMAT }) {
+    for (const BcQuality quality :
+         { BC_QUALITY_FAST, BC_QUALITY_NORMAL, BC_QUALITY_HIGH }) {
+      const std::vector<unsigned char> scalar_blocks =
+          EncodeWithSimdLevel(noisy, format, quality, SIMD_SCALAR);
+      if (simd_level >= SIMD_SSE2) {
+        EXPECT_EQ(EncodeWithSimdLevel(noisy, format, quality, SIMD_SSE2),
+                  scalar_blocks)
+            << "format " << format << " quality " << quality;
+      }
+      if (simd_level >= SIMD_AVX2) {
+        EXPECT_EQ(EncodeWithSimdLevel(noisy, format, quality, SIMD_AVX2),
+                  scalar_blocks)
+            << "format " << format << " quality " << quality;
+      }
+    }
+  }
+}
+
+TEST(BcEncoderTest, ThreadsDoNotChangeTheBlocks) {
+  const std::vector<unsigned char> noisy = MakeNoisyImage();
+  std::vector<unsigned char> blocks(
+      BcCompressedSizeInBytes(BC3_FORMAT, kWidth, kHeight));
+  EncodeBc(noisy.data(), kWidth, kHeight, BC3_FORMAT, BC_QUALITY_HIGH, 1,
+           0.0f, blocks.data());
+  std::vector<unsigned char> threaded_blocks(blocks.size());
+  EncodeBc(noisy.data(), kWidth, kHeight, BC3_FORMAT, BC_QUALITY_HIGH, 4,
+           0.0f, threaded_blocks.data());
+  EXPECT_EQ(threaded_blocks, blocks);
+}
+
+}  // namespace
+}  // namespace wvu
@@ -0,0 +1,1115 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "bptc_encoder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "half_float.h"
+
+namespace wvu {
+namespace {
+// Number of texels per block.
+constexpr int kNumBlockTexels = 16;
+// Number of bytes per block.
+constexpr int kBlockSizeInBytes = 16;
+// Number of partitions of the modes with two subsets.
+constexpr int kNumPartitions = 64;
+// Number of partitions fully encoded by the normal and high qualities, out of
+// the partitions ranked best by their estimated error.
+constexpr int kNumNormalPartitions = 4;
+constexpr int kNumHighPartitions = 16;
+// Maximum number of passes of the local search of the endpoints.
+constexpr int kMaxLocalSearchPasses = 4;
+
+// Partitions of the blocks with two subsets: bit i is the subset of texel i,
+// in row-major order.
+constexpr uint16_t kPartitions[kNumPartitions] = {
+  0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+  0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+  0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+  0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+  0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A,
+  0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+  0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+  0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22
+};
+
+// Anchor texel of the second subset of every partition. The index of an
+// anchor texel (and of texel 0, the anchor of the first subset) is stored
+// with one bit less: its most significant bit is zero.
+constexpr int kAnchors[kNumPartitions] = {
+  15, 15, 15, 15, 15, 15, 15, 15,
+  15, 15, 15, 15, 15, 15, 15, 15,
+  15, 2, 8, 2, 2, 8, 8, 15,
+  2, 8, 2, 2, 8, 8, 2, 2,
+  15, 15, 6, 8, 2, 8, 15, 15,
+  2, 8, 2, 2, 2, 15, 15, 6,
+  6, 2, 6, 8, 15, 15, 2, 2,
+  15, 15, 15, 15, 15, 2, 2, 15
+};
+
+// Interpolation weights (out of 64) of the indices of 2, 3 and 4 bits.
+constexpr int kWeights2[4] = { 0, 21, 43, 64 };
+constexpr int kWeights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+constexpr int kWeights4[16] = {
+  0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64
+};
+
+const int* IndexWeights(const int index_bits) {
+  return index_bits == 2 ? kWeights2 :
+      (index_bits == 3 ? kWeights3 : kWeights4);
+}
+
+inline int Interpolate(const int endpoint0,
+                       const int endpoint1,
+                       const int weight) {
+  return ((64 - weight) * endpoint0 + weight * endpoint1 + 32) >> 6;
+}
+
+// Returns true if the texel is an anchor of the partition.
+inline bool IsAnchor(const int num_subsets,
+                     const int partition,
+                     const int texel) {
+  return texel == 0 || (num_subsets == 2 && texel == kAnchors[partition]);
+}
+
+// Writes the fields of a block from its least significant bit.
+class BitWriter {
+ public:
+  explicit BitWriter(unsigned char* block) : block_(block), position_(0) {
+    memset(block_, 0, kBlockSizeInBytes);
+  }
+
+  void Write(const uint32_t value, const int num_bits) {
+    for (int i = 0; i < num_bits; ++i, ++position_) {
+      if ((value >> i) & 1) {
+        block_[position_ >> 3] |= 1 << (position_ & 7);
+      }
+    }
+  }
+
+ private:
+  unsigned char* block_;
+  int position_;
+};
+
+// Reads the fields of a block from its least significant bit.
+class BitReader {
+ public:
+  explicit BitReader(const unsigned char* block) :
+      block_(block), position_(0) {}
+
+  uint32_t Read(const int num_bits) {
+    uint32_t value = 0;
+    for (int i = 0; i < num_bits; ++i, ++position_) {
+      value |= ((block_[position_ >> 3] >> (position_ & 7)) & 1u) << i;
+    }
+    return value;
+  }
+
+ private:
+  const unsigned char* block_;
+  int position_;
+};
+
+// Encodes all the blocks of the image. The rows of blocks are shared among the
+// threads; once the time budget is spent, the remaining blocks are encoded
+// with the fast quality.
+// Parameters:
+//   encode_block  Function (block_x, block_y, quality, output) that encodes a
+//     block.
+template <typename EncodeBlockFunction>
+void EncodeBlocks(const int width,
+                  const int height,
+                  const BptcEncodingOptions& options,
+                  const EncodeBlockFunction& encode_block,
+                  unsigned char* blocks,
+                  BptcEncodingStatistics* statistics) {
+  typedef std::chrono::steady_clock Clock;
+  const Clock::time_point start = Clock::now();
+  const bool has_deadline = options.time_budget_seconds > 0.0;
+  const Clock::time_point deadline = start +
+      std::chrono::duration_cast<Clock::duration>(
+          std::chrono::duration<double>(options.time_budget_seconds));
+  const int num_blocks_x = (width + 3) / 4;
+  const int num_blocks_y = (height + 3) / 4;
+  std::atomic<int> next_block_row(0);
+  std::atomic<size_t> num_fast_blocks(0);
+  auto encode_block_rows = [&]() {
+    for (int block_y = next_block_row++; block_y < num_blocks_y;
+         block_y = next_block_row++) {
+      unsigned char* output = blocks +
+          static_cast<size_t>(block_y) * num_blocks_x * kBlockSizeInBytes;
+      for (int block_x = 0; block_x < num_blocks_x; ++block_x) {
+        BcQuality quality = options.quality;
+        if (has_deadline && quality != BC_QUALITY_FAST &&
+            Clock::now() > deadline) {
+          quality = BC_QUALITY_FAST;
+          ++num_fast_blocks;
+        }
+        encode_block(block_x, block_y, quality, output);
+        output += kBlockSizeInBytes;
+      }
+    }
+  };
+  const int max_num_threads = options.num_threads > 0 ?
+      options.num_threads : std::max(1u, std::thread::hardware_concurrency());
+  const int num_workers = std::min(max_num_threads, num_blocks_y) - 1;
+  std::vector<std::thread> workers;
+  for (int i = 0; i < num_workers; ++i) {
+    workers.emplace_back(encode_block_rows);
+  }
+  encode_block_rows();
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  if (statistics != nullptr) {
+    statistics->seconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    statistics->num_blocks = static_cast<size_t>(num_blocks_x) * num_blocks_y;
+    statistics->num_fast_blocks = num_fast_blocks;
+  }
+}
+
+// Computes the principal axis of the points with power iterations. Returns
+// false if all the points are the same.
+// Parameters:
+//   points  The points, num_channels values per point.
+//   num_points  The number of points.
+//   num_channels  The dimension of the points, up to 4.
+//   mean  The mean of the points.
+//   axis  The principal axis.
+//   residual  The variance of the points off the axis. Can be null.
+bool ComputePrincipalAxis(const float points[][4],
+                          const int num_points,
+                          const int num_channels,
+                          float mean[4],
+                          float axis[4],
+                          float* residual) {
+  for (int c = 0; c < num_channels; ++c) {
+    mean[c] = 0.0f;
+    for (int i = 0; i < num_points; ++i) {
+      mean[c] += points[i][c];
+    }
+    mean[c] /= num_points;
+  }
+  float covariance[4][4] = {{ 0.0f }};
+  for (int i = 0; i < num_points; ++i) {
+    for (int row = 0; row < num_channels; ++row) {
+      for (int col = 0; col < num_channels; ++col) {
+        covariance[row][col] +=
+            (points[i][row] - mean[row]) * (points[i][col] - mean[col]);
+      }
+    }
+  }
+  float trace = 0.0f;
+  for (int c = 0; c < num_channels; ++c) {
+    axis[c] = 1.0f;
+    trace += covariance[c][c];
+  }
+  float eigenvalue = 0.0f;
+  for (int iteration = 0; iteration < 8; ++iteration) {
+    float next_axis[4];
+    float norm2 = 0.0f;
+    for (int row = 0; row < num_channels; ++row) {
+      next_axis[row] = 0.0f;
+      for (int col = 0; col < num_channels; ++col) {
+        next_axis[row] += covariance[row][col] * axis[col];
+      }
+      norm2 += next_axis[row] * next_axis[row];
+    }
+    if (norm2 < 1e-12f) {
+      if (residual != nullptr) {
+        *residual = 0.0f;
+      }
+      return false;
+    }
+    const float norm = std::sqrt(norm2);
+    for (int c = 0; c < num_channels; ++c) {
+      axis[c] = next_axis[c] / norm;
+    }
+    eigenvalue = norm;
+  }
+  if (residual != nullptr) {
+    *residual = trace - eigenvalue;
+  }
+  return true;
+}
+
+// Computes the extremes of the points along the axis.
+void ComputeAxisExtremes(const float points[][4],
+                         const int num_points,
+                         const int num_channels,
+                         const float mean[4],
+                         const float axis[4],
+                         float endpoints[2][4]) {
+  float minimum = FLT_MAX;
+  float maximum = -FLT_MAX;
+  for (int i = 0; i < num_points; ++i) {
+    float t = 0.0f;
+    for (int c = 0; c < num_channels; ++c) {
+      t += (points[i][c] - mean[c]) * axis[c];
+    }
+    minimum = std::min(minimum, t);
+    maximum = std::max(maximum, t);
+  }
+  for (int c = 0; c < num_channels; ++c) {
+    endpoints[0][c] = mean[c] + minimum * axis[c];
+    endpoints[1][c] = mean[c] + maximum * axis[c];
+  }
+}
+
+// Computes the endpoints that minimize the squared error of the points given
+// their interpolation weights (out of 64). Returns false if the weights do not
+// determine the endpoints.
+bool SolveLeastSquares(const float points[][4],
+                       const int weights[],
+                       const int num_points,
+                       const int num_channels,
+                       float endpoints[2][4]) {
+  float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+  float ax[4] = { 0.0f }, bx[4] = { 0.0f };
+  for (int i = 0; i < num_points; ++i) {
+    const float b = weights[i] / 64.0f;
+    const float a = 1.0f - b;
+    aa += a * a;
+    ab += a * b;
+    bb += b * b;
+    for (int c = 0; c < num_channels; ++c) {
+      ax[c] += a * points[i][c];
+      bx[c] += b * points[i][c];
+    }
+  }
+  const float determinant = aa * bb - ab * ab;
+  if (std::fabs(determinant) < 1e-6f) {
+    return false;
+  }
+  for (int c = 0; c < num_channels; ++c) {
+    endpoints[0][c] = (bb * ax[c] - ab * bx[c]) / determinant;
+    endpoints[1][c] = (aa * bx[c] - ab * ax[c]) / determinant;
+  }
+  return true;
+}
+
+// -------------------- BC7 ----------------------------------------------------
+// Layout of a BC7 mode.
+struct Bc7Mode {
+  int mode;
+  int num_subsets;
+  // Bits per color and alpha channel of the endpoints, without p-bits.
+  int color_bits;
+  int alpha_bits;
+  // Whether every endpoint has a p-bit (the shared least significant bit of
+  // its channels), or every subset shares one.
+  bool endpoint_pbits;
+  bool shared_pbits;
+  int index_bits;
+};
+
+constexpr Bc7Mode kBc7Mode1 = { 1, 2, 6, 0, false, true, 3 };
+constexpr Bc7Mode kBc7Mode3 = { 3, 2, 7, 0, true, false, 2 };
+constexpr Bc7Mode kBc7Mode6 = { 6, 1, 7, 7, true, false, 4 };
+constexpr Bc7Mode kBc7Mode7 = { 7, 2, 5, 5, true, false, 2 };
+
+const Bc7Mode* FindBc7Mode(const int mode) {
+  static const Bc7Mode* kModes[] = {
+    &kBc7Mode1, &kBc7Mode3, &kBc7Mode6, &kBc7Mode7
+  };
+  for (const Bc7Mode* bc7_mode : kModes) {
+    if (bc7_mode->mode == mode) {
+      return bc7_mode;
+    }
+  }
+  return nullptr;
+}
+
+inline int NumChannels(const Bc7Mode& mode) {
+  return mode.alpha_bits > 0 ? 4 : 3;
+}
+
+inline bool HasPbits(const Bc7Mode& mode) {
+  return mode.endpoint_pbits || mode.shared_pbits;
+}
+
+// The quantized endpoints of a subset.
+struct Bc7Endpoints {
+  int quantized[2][4];
+  int pbits[2];
+};
+
+// A subset and its fit.
+struct Bc7Subset {
+  int num_texels;
+  int texels[kNumBlockTexels];
+  float points[kNumBlockTexels][4];
+  Bc7Endpoints endpoints;
+  // The indices of the texels of the subset.
+  int indices[kNumBlockTexels];
+  int error;
+};
+
+// Expands a quantized endpoint to 8 bits per channel. Modes without alpha
+// have an alpha of 255.
+void UnquantizeBc7Endpoint(const Bc7Mode& mode,
+                           const int quantized[4],
+                           const int pbit,
+                           int color[4]) {
+  for (int c = 0; c < 4; ++c) {
+    int num_bits = c < 3 ? mode.color_bits : mode.alpha_bits;
+    if (num_bits == 0) {
+      color[c] = 255;
+      continue;
+    }
+    int value = quantized[c];
+    if (HasPbits(mode)) {
+      value = (value << 1) | pbit;
+      ++num_bits;
+    }
+    value <<= 8 - num_bits;
+    color[c] = value | (value >> num_bits);
+  }
+}
+
+// Quantizes an endpoint given its p-bit.
+void QuantizeBc7Endpoint(const Bc7Mode& mode,
+                         const float color[4],
+                         const int pbit,
+                         int quantized[4]) {
+  for (int c = 0; c < 4; ++c) {
+    const int num_bits = c < 3 ? mode.color_bits : mode.alpha_bits;
+    if (num_bits == 0) {
+      quantized[c] = 0;
+      continue;
+    }
+    const float value = std::min(std::max(color[c], 0.0f), 255.0f);
+    int level;
+    if (HasPbits(mode)) {
+      const float scaled = value * ((2 << num_bits) - 1) / 255.0f;
+      level = static_cast<int>(std::floor((scaled - pbit) / 2.0f + 0.5f));
+    } else {
+      level = static_cast<int>(value * ((1 << num_bits) - 1) / 255.0f + 0.5f);
+    }
+    quantized[c] = std::min(std::max(level, 0), (1 << num_bits) - 1);
+  }
+}
+
+// Computes the indices and the squared error of the subset for the endpoints.
+int EvaluateBc7Subset(const Bc7Mode& mode,
+                      const Bc7Endpoints& endpoints,
+                      const Bc7Subset& subset,
+                      int indices[kNumBlockTexels]) {
+  int colors[2][4];
+  UnquantizeBc7Endpoint(mode, endpoints.quantized[0], endpoints.pbits[0],
+                        colors[0]);
+  UnquantizeBc7Endpoint(mode, endpoints.quantized[1], endpoints.pbits[1],
+                        colors[1]);
+  const int* weights = IndexWeights(mode.index_bits);
+  const int num_indices = 1 << mode.index_bits;
+  int palette[16][4];
+  for (int k = 0; k < num_indices; ++k) {
+    for (int c = 0; c < 4; ++c) {
+      palette[k][c] = Interpolate(colors[0][c], colors[1][c], weights[k]);
+    }
+  }
+  int error = 0;
+  for (int i = 0; i < subset.num_texels; ++i) {
+    int best_distance = INT_MAX;
+    for (int k = 0; k < num_indices; ++k) {
+      int distance = 0;
+      for (int c = 0; c < 4; ++c) {
+        const int difference =
+            static_cast<int>(subset.points[i][c]) - palette[k][c];
+        distance += difference * difference;
+      }
+      if (distance < best_distance) {
+        best_distance = distance;
+        indices[i] = k;
+      }
+    }
+    error += best_distance;
+  }
+  return error;
+}
+
+// Evaluates the quantized endpoints and keeps them if they are better than the
+// fit of the subset. Returns true if they were kept.
+bool TryBc7Quantized(const Bc7Mode& mode,
+                     const Bc7Endpoints& endpoints,
+                     Bc7Subset* subset) {
+  int indices[kNumBlockTexels];
+  const int error = EvaluateBc7Subset(mode, endpoints, *subset, indices);
+  if (error >= subset->error) {
+    return false;
+  }
+  subset->endpoints = endpoints;
+  subset->error = error;
+  memcpy(subset->indices, indices, sizeof(indices));
+  return true;
+}
+
+// Quantizes the endpoints with every combination of p-bits and keeps the best
+// one. Returns true if the fit of the subset improved.
+bool TryBc7Endpoints(const Bc7Mode& mode,
+                     const float endpoints[2][4],
+                     Bc7Subset* subset) {
+  bool improved = false;
+  for (int pbits = 0; pbits < 4; ++pbits) {
+    Bc7Endpoints candidate;
+    candidate.pbits[0] = pbits & 1;
+    candidate.pbits[1] = pbits >> 1;
+    if ((!HasPbits(mode) && pbits != 0) ||
+        (mode.shared_pbits && candidate.pbits[0] != candidate.pbits[1])) {
+      continue;
+    }
+    QuantizeBc7Endpoint(mode, endpoints[0], candidate.pbits[0],
+                        candidate.quantized[0]);
+    QuantizeBc7Endpoint(mode, endpoints[1], candidate.pbits[1],
+                        candidate.quantized[1]);
+    improved |= TryBc7Quantized(mode, candidate, subset);
+  }
+  return improved;
+}
+
+// Finds the endpoints of the subset.
+void FitBc7Subset(const Bc7Mode& mode,
+                  const BcQuality quality,
+                  Bc7Subset* subset) {
+  subset->error = INT_MAX;
+  const int num_channels = NumChannels(mode);
+  float mean[4], axis[4];
+  float endpoints[2][4] = {{ 0.0f, 0.0f, 0.0f, 255.0f },
+                           { 0.0f, 0.0f, 0.0f, 255.0f }};
+  if (ComputePrincipalAxis(subset->points, subset->num_texels, num_channels,
+                           mean, axis, nullptr)) {
+    ComputeAxisExtremes(subset->points, subset->num_texels, num_channels, mean,
+                        axis, endpoints);
+  } else {
+    for (int c = 0; c < num_channels; ++c) {
+      endpoints[0][c] = endpoints[1][c] = mean[c];
+    }
+  }
+  TryBc7Endpoints(mode, endpoints, subset);
+  if (quality == BC_QUALITY_FAST) {
+    return;
+  }
+  // Refine the endpoints given the indices.
+  const int num_iterations = quality == BC_QUALITY_HIGH ? 3 : 1;
+  const int* index_weights = IndexWeights(mode.index_bits);
+  for (int iteration = 0; iteration < num_iterations; ++iteration) {
+    int weights[kNumBlockTexels];
+    for (int i = 0; i < subset->num_texels; ++i) {
+      weights[i] = index_weights[subset->indices[i]];
+    }
+    if (!SolveLeastSquares(subset->points, weights, subset->num_texels,
+                           num_channels, endpoints) ||
+        !TryBc7Endpoints(mode, endpoints, subset)) {
+      break;
+    }
+  }
+  if (quality != BC_QUALITY_HIGH) {
+    return;
+  }
+  // Move every quantized channel of every endpoint by one step, and flip the
+  // p-bits, while the error decreases.
+  for (int pass = 0; pass < kMaxLocalSearchPasses; ++pass) {
+    bool improved = false;
+    for (int endpoint = 0; endpoint < 2; ++endpoint) {
+      for (int c = 0; c < num_channels; ++c) {
+        const int max_level =
+            (1 << (c < 3 ? mode.color_bits : mode.alpha_bits)) - 1;
+        for (const int step : { -1, 1 }) {
+          Bc7Endpoints candidate = subset->endpoints;
+          const int level = candidate.quantized[endpoint][c] + step;
+          if (level < 0 || level > max_level) {
+            continue;
+          }
+          candidate.quantized[endpoint][c] = level;
+          improved |= TryBc7Quantized(mode, candidate, subset);
+        }
+      }
+      if (mode.endpoint_pbits) {
+        Bc7Endpoints candidate = subset->endpoints;
+        candidate.pbits[endpoint] ^= 1;
+        improved |= TryBc7Quantized(mode, candidate, subset);
+      }
+    }
+    if (mode.shared_pbits) {
+      Bc7Endpoints candidate = subset->endpoints;
+      candidate.pbits[0] ^= 1;
+      candidate.pbits[1] ^= 1;
+      improved |= TryBc7Quantized(mode, candidate, subset);
+    }
+    if (!improved) {
+      break;
+    }
+  }
+}
+
+// The texels of a block.
+struct Bc7Block {
+  float texels[kNumBlockTexels][4];
+};
+
+void LoadBc7Block(const unsigned char* rgba,
+                  const int width,
+                  const int height,
+                  const int block_x,
+                  const int block_y,
+                  Bc7Block* block) {
+  for (int y = 0; y < 4; ++y) {
+    const int image_y = std::min(4 * block_y + y, height - 1);
+    for (int x = 0; x < 4; ++x) {
+      const int image_x = std::min(4 * block_x + x, width - 1);
+      const unsigned char* texel =
+          rgba + 4 * (static_cast<size_t>(image_y) * width + image_x);
+      for (int c = 0; c < 4; ++c) {
+        block->texels[4 * y + x][c] = texel[c];
+      }
+    }
+  }
+}
+
+// Splits the block into the subsets of the partition.
+void PartitionBc7Block(const Bc7Block& block,
+                       const int num_subsets,
+                       const int partition,
+                       Bc7Subset subsets[2]) {
+  subsets[0].num_texels = subsets[1].num_texels = 0;
+  for (int i = 0; i < kNumBlockTexels; ++i) {
+    const int s = num_subsets == 2 ? (kPartitions[partition] >> i) & 1 : 0;
+    Bc7Subset& subset = subsets[s];
+    subset.texels[subset.num_texels] = i;
+    memcpy(subset.points[subset.num_texels], block.texels[i],
+           sizeof(block.texels[i]));
+    ++subset.num_texels;
+  }
+}
+
+// Sorts the partitions by their estimated error: the variance of the subsets
+// off their principal axes, which a line of endpoints cannot represent.
+void RankPartitions(const Bc7Block& block,
+                    const int num_channels,
+                    int partitions[kNumPartitions]) {
+  float estimates[kNumPartitions];
+  for (int partition = 0; partition < kNumPartitions; ++partition) {
+    Bc7Subset subsets[2];
+    PartitionBc7Block(block, 2, partition, subsets);
+    estimates[partition] = 0.0f;
+    for (const Bc7Subset& subset : subsets) {
+      float mean[4], axis[4], residual;
+      ComputePrincipalAxis(subset.points, subset.num_texels, num_channels,
+                           mean, axis, &residual);
+      estimates[partition] += residual;
+    }
+    partitions[partition] = partition;
+  }
+  std::stable_sort(partitions, partitions + kNumPartitions,
+                   [&estimates](const int a, const int b) {
+                     return estimates[a] < estimates[b];
+                   });
+}
+
+// Writes the block. The endpoints are swapped where needed so that the most
+// significant bit of the anchor indices is zero.
+void WriteBc7Block(const Bc7Mode& mode,
+                   const int partition,
+                   Bc7Subset subsets[2],
+                   unsigned char* output) {
+  int indices[kNumBlockTexels];
+  const int max_index = (1 << mode.index_bits) - 1;
+  for (int s = 0; s < mode.num_subsets; ++s) {
+    Bc7Subset& subset = subsets[s];
+    const int anchor = s == 0 ? 0 : kAnchors[partition];
+    bool swap = false;
+    for (int i = 0; i < subset.num_texels; ++i) {
+      if (subset.texels[i] == anchor) {
+        swap = subset.indices[i] > (max_index >> 1);
+      }
+    }
+    if (swap) {
+      std::swap(subset.endpoints.quantized[0], subset.endpoints.quantized[1]);
+      std::swap(subset.endpoints.pbits[0], subset.endpoints.pbits[1]);
+    }
+    for (int i = 0; i < subset.num_texels; ++i) {
+      indices[subset.texels[i]] =
+          swap ? max_index - subset.indices[i] : subset.indices[i];
+    }
+  }
+  BitWriter writer(output);
+  writer.Write(1u << mode.mode, mode.mode + 1);
+  if (mode.num_subsets == 2) {
+    writer.Write(partition, 6);
+  }
+  for (int c = 0; c < NumChannels(mode); ++c) {
+    const int num_bits = c < 3 ? mode.color_bits : mode.alpha_bits;
+    for (int s = 0; s < mode.num_subsets; ++s) {
+      writer.Write(subsets[s].endpoints.quantized[0][c], num_bits);
+      writer.Write(subsets[s].endpoints.quantized[1][c], num_bits);
+    }
+  }
+  for (int s = 0; s < mode.num_subsets; ++s) {
+    if (mode.endpoint_pbits) {
+      writer.Write(subsets[s].endpoints.pbits[0], 1);
+      writer.Write(subsets[s].endpoints.pbits[1], 1);
+    } else if (mode.shared_pbits) {
+      writer.Write(subsets[s].endpoints.pbits[0], 1);
+    }
+  }
+  for (int i = 0; i < kNumBlockTexels; ++i) {
+    const bool anchor = IsAnchor(mode.num_subsets, partition, i);
+    writer.Write(indices[i], mode.index_bits - (anchor ? 1 : 0));
+  }
+}
+
+void EncodeBc7Block(const Bc7Block& block,
+                    const BcQuality quality,
+                    unsigned char* output) {
+  bool opaque = true;
+  for (int i = 0; i < kNumBlockTexels; ++i) {
+    opaque &= block.texels[i][3] == 255.0f;
+  }
+  // One subset with RGBA endpoints and 4-bit indices.
+  const Bc7Mode* best_mode = &kBc7Mode6;
+  int best_partition = 0;
+  Bc7Subset best_subsets[2];
+  PartitionBc7Block(block, 1, 0, best_subsets);
+  FitBc7Subset(kBc7Mode6, quality, &best_subsets[0]);
+  int best_error = best_subsets[0].error;
+  if (quality != BC_QUALITY_FAST && best_error > 0) {
+    // Two subsets, searching the partitions ranked best.
+    int partitions[kNumPartitions];
+    RankPartitions(block, opaque ? 3 : 4, partitions);
+    const int num_partitions = quality == BC_QUALITY_HIGH ?
+        kNumHighPartitions : kNumNormalPartitions;
+    static const Bc7Mode* kOpaqueModes[] = { &kBc7Mode1, &kBc7Mode3 };
+    static const Bc7Mode* kTransparentModes[] = { &kBc7Mode7 };
+    const Bc7Mode* const* modes = opaque ? kOpaqueModes : kTransparentModes;
+    const int num_modes = opaque ? 2 : 1;
+    for (int m = 0; m < num_modes; ++m) {
+      for (int p = 0; p < num_partitions; ++p) {
+        Bc7Subset subsets[2];
+        PartitionBc7Block(block, 2, partitions[p], subsets);
+        FitBc7Subset(*modes[m], quality, &subsets[0]);
+        if (subsets[0].error >= best_error) {
+          continue;
+        }
+        FitBc7Subset(*modes[m], quality, &subsets[1]);
+        const int error = subsets[0].error + subsets[1].error;
+        if (error < best_error) {
+          best_error = error;
+          best_mode = modes[m];
+          best_partition = partitions[p];
+          best_subsets[0] = subsets[0];
+          best_subsets[1] = subsets[1];
+        }
+      }
+    }
+  }
+  WriteBc7Block(*best_mode, best_partition, best_subsets, output);
+}
+
+void DecodeBc7Block(const unsigned char* input,
+                    unsigned char texels[kNumBlockTexels][4]) {
+  BitReader reader(input);
+  int mode = 0;
+  while (mode < 8 && reader.Read(1) == 0) {
+    ++mode;
+  }
+  const Bc7Mode* bc7_mode = FindBc7Mode(mode);
+  if (bc7_mode == nullptr) {
+    memset(texels, 0, kNumBlockTexels * 4);
+    return;
+  }
+  const int partition = bc7_mode->num_subsets == 2 ? reader.Read(6) : 0;
+  Bc7Endpoints endpoints[2];
+  for (int c = 0; c < 4; ++c) {
+    const int num_bits = c < 3 ? bc7_mode->color_bits : bc7_mode->alpha_bits;
+    for (int s = 0; s < bc7_mode->num_subsets; ++s) {
+      endpoints[s].quantized[0][c] = reader.Read(num_bits);
+      endpoints[s].quantized[1][c] = reader.Read(num_bits);
+    }
+  }
+  for (int s = 0; s < bc7_mode->num_subsets; ++s) {
+    endpoints[s].pbits[0] = endpoints[s].pbits[1] = 0;
+    if (bc7_mode->endpoint_pbits) {
+      endpoints[s].pbits[0] = reader.Read(1);
+      endpoints[s].pbits[1] = reader.Read(1);
+    } else if (bc7_mode->shared_pbits) {
+      endpoints[s].pbits[0] = endpoints[s].pbits[1] = reader.Read(1);
+    }
+  }
+  int colors[2][2][4];
+  for (int s = 0; s < bc7_mode->num_subsets; ++s) {
+    for (int e = 0; e < 2; ++e) {
+      UnquantizeBc7Endpoint(*bc7_mode, endpoints[s].quantized[e],
+                            endpoints[s].pbits[e], colors[s][e]);
+    }
+  }
+  const int* weights = IndexWeights(bc7_mode->index_bits);
+  for (int i = 0; i < kNumBlockTexels; ++i) {
+    const bool anchor = IsAnchor(bc7_mode->num_subsets, partition, i);
+    const int index = reader.Read(bc7_mode->index_bits - (anchor ? 1 : 0));
+    const int s = bc7_mode->num_subsets == 2 ?
+        (kPartitions[partition] >> i) & 1 : 0;
+    for (int c = 0; c < 4; ++c) {
+      texels[i][c] = static_cast<unsigned char>(
+          Interpolate(colors[s][0][c], colors[s][1][c], weights[index]));
+    }
+  }
+}
+
+// -------------------- BC6H ---------------------------------------------------
+// The encoder uses mode 11: one subset, 10-bit endpoints and 4-bit indices.
+// The texels are encoded as the bits of their half floats, the space where
+// the GPU interpolates.
+constexpr int kBc6hMode11 = 0x03;
+constexpr int kBc6hEndpointBits = 10;
+constexpr int kBc6hMaxEndpoint = (1 << kBc6hEndpointBits) - 1;
+// Largest finite half float.
+constexpr int kMaxHalf = 0x7BFF;
+
+// Expands a 10-bit endpoint to 16 bits.
+inline int UnquantizeBc6hEndpoint(const int endpoint) {
+  if (endpoint == 0) {
+    return 0;
+  }
+  if (endpoint == kBc6hMaxEndpoint) {
+    return 0xFFFF;
+  }
+  return ((endpoint << 16) + 0x8000) >> kBc6hEndpointBits;
+}
+
+// Scales an interpolated value to the bits of an unsigned half float.
+inline int FinishBc6hValue(const int value) {
+  return (value * 31) >> 6;
+}
+
+// Quantizes the bits of a half float to a 10-bit endpoint.
+inline int QuantizeBc6hEndpoint(const float half_bits) {
+  const int endpoint =
+      static_cast<int>(std::floor((half_bits - 15.0f) / 31.0f + 0.5f));
+  return std::min(std::max(endpoint, 0), kBc6hMaxEndpoint);
+}
+
+// The texels of a block as the bits of their half floats.
+struct Bc6hBlock {
+  float texels[kNumBlockTexels][4];
+};
+
+// The endpoints of a block and their fit.
+struct Bc6hFit {
+  int endpoints[2][3];
+  int indices[kNumBlockTexels];
+  int64_t error;
+};
+
+void LoadBc6hBlock(const float* rgba,
+                   const int width,
+                   const int height,
+                   const int block_x,
+                   const int block_y,
+                   Bc6hBlock* block) {
+  for (int y = 0; y < 4; ++y) {
+    const int image_y = std::min(4 * block_y + y, height - 1);
+    for (int x = 0; x < 4; ++x) {
+      const int image_x = std::min(4 * block_x + x, width - 1);
+      const float* texel =
+          rgba + 4 * (static_cast<size_t>(image_y) * width + image_x);
+      for (int c = 0; c < 3; ++c) {
+        // Negative values and NaNs become zero; infinities the largest half.
+        block->texels[4 * y + x][c] = texel[c] > 0.0f ?
+            std::min<int>(FloatToHalf(texel[c]), kMaxHalf) : 0.0f;
+      }
+      block->texels[4 * y + x][3] = 0.0f;
+    }
+  }
+}
+
+// Evaluates the endpoints and keeps them if they are better than the fit.
+bool TryBc6hEndpoints(const Bc6hBlock& block,
+                      const int endpoints[2][3],
+                      Bc6hFit* fit) {
+  int palette[16][3];
+  for (int k = 0; k < 16; ++k) {
+    for (int c = 0; c < 3; ++c) {
+      palette[k][c] = FinishBc6hValue(Interpolate(
+          UnquantizeBc6hEndpoint(endpoints[0][c]),
+          UnquantizeBc6hEndpoint(endpoints[1][c]), kWeights4[k]));
+    }
+  }
+  int indices[kNumBlockTexels];
+  int64_t error = 0;
+  for (int i = 0; i < kNumBlockTexels; ++i) {
+    int64_t best_distance = INT64_MAX;
+    for (int k = 0; k < 16; ++k) {
+      int64_t distance = 0;
+      for (int c = 0; c < 3; ++c) {
+        const int64_t difference =
+            static_cast<int>(block.texels[i][c]) - palette[k][c];
+        distance += difference * difference;
+      }
+      if (distance < best_distance) {
+        best_distance = distance;
+        indices[i] = k;
+      }
+    }
+    error += best_distance;
+  }
+  if (error >= fit->error) {
+    return false;
+  }
+  memcpy(fit->endpoints, endpoints, sizeof(fit->endpoints));
+  memcpy(fit->indices, indices, sizeof(indices));
+  fit->error = error;
+  return true;
+}
+
+bool TryBc6hEndpoints(const Bc6hBlock& block,
+                      const float endpoints[2][4],
+                      Bc6hFit* fit) {
+  int quantized[2][3];
+  for (int e = 0; e < 2; ++e) {
+    for (int c = 0; c < 3; ++c) {
+      quantized[e][c] = QuantizeBc6hEndpoint(endpoints[e][c]);
+    }
+  }
+  return TryBc6hEndpoints(block, quantized, fit);
+}
+
+void EncodeBc6hBlock(const Bc6hBlock& block,
+                     const BcQuality quality,
+                     unsigned char* output) {
+  Bc6hFit fit;
+  fit.error = INT64_MAX;
+  float mean[4], axis[4];
+  float endpoints[2][4];
+  if (ComputePrincipalAxis(block.texels, kNumBlockTexels, 3, mean, axis,
+                           nullptr)) {
+    ComputeAxisExtremes(block.texels, kNumBlockTexels, 3, mean, axis,
+                        endpoints);
+  } else {
+    for (int c = 0; c < 3; ++c) {
+      endpoints[0][c] = endpoints[1][c] = mean[c];
+    }
+  }
+  TryBc6hEndpoints(block, endpoints, &fit);
+  if (quality != BC_QUALITY_FAST) {
+    const int num_iterations = quality == BC_QUALITY_HIGH ? 3 : 1;
+    for (int iteration = 0; iteration < num_iterations; ++iteration) {
+      int weights[kNumBlockTexels];
+      for (int i = 0; i < kNumBlockTexels; ++i) {
+        weights[i] = kWeights4[fit.indices[i]];
+      }
+      if (!SolveLeastSquares(block.texels, weights, kNumBlockTexels, 3,
+                             endpoints) ||
+          !TryBc6hEndpoints(block, endpoints, &fit)) {
+        break;
+      }
+    }
+  }
+  if (quality == BC_QUALITY_HIGH) {
+    for (int pass = 0; pass < kMaxLocalSearchPasses; ++pass) {
+      bool improved = false;
+      for (int e = 0; e < 2; ++e) {
+        for (int c = 0; c < 3; ++c) {
+          for (const int step : { -1, 1 }) {
+            int candidate[2][3];
+            memcpy(candidate, fit.endpoints, sizeof(candidate));
+            candidate[e][c] += step;
+            if (candidate[e][c] < 0 || candidate[e][c] > kBc6hMaxEndpoint) {
+              continue;
+            }
+            improved |= TryBc6hEndpoints(block, candidate, &fit);
+          }
+        }
+      }
+      if (!improved) {
+        break;
+      }
+    }
+  }
+  // The most significant bit of the index of texel 0 must be zero.
+  if (fit.indices[0] > 7) {
+    for (int c = 0; c < 3; ++c) {
+      std::swap(fit.endpoints[0][c], fit.endpoints[1][c]);
+    }
+    for (int i = 0; i < kNumBlockTexels; ++i) {
+      fit.indices[i] = 15 - fit.indices[i];
+    }
+  }
+  BitWriter writer(output);
+  writer.Write(kBc6hMode11, 5);
+  for (int e = 0; e < 2; ++e) {
+    for (int c = 0; c < 3; ++c) {
+      writer.Write(fit.endpoints[e][c], kBc6hEndpointBits);
+    }
+  }
+  for (int i = 0; i < kNumBlockTexels; ++i) {
+    writer.Write(fit.indices[i], i == 0 ? 3 : 4);
+  }
+}
+
+void DecodeBc6hBlock(const unsigned char* input,
+                     float texels[kNumBlockTexels][4]) {
+  BitReader reader(input);
+  int mode = reader.Read(2);
+  if (mode > 1) {
+    mode |= reader.Read(3) << 2;
+  }
+  if (mode != kBc6hMode11) {
+    for (int i = 0; i < kNumBlockTexels; ++i) {
+      texels[i][0] = texels[i][1] = texels[i][2] = 0.0f;
+      texels[i][3] = 1.0f;
+    }
+    return;
+  }
+  int endpoints[2][3];
+  for (int e = 0; e < 2; ++e) {
+    for (int c = 0; c < 3; ++c) {
+      endpoints[e][c] =
+          UnquantizeBc6hEndpoint(reader.Read(kBc6hEndpointBits));
+    }
+  }
+  for (int i = 0; i < kNumBlockTexels; ++i) {
+    const int index = reader.Read(i == 0 ? 3 : 4);
+    for (int c = 0; c < 3; ++c) {
+      texels[i][c] = HalfToFloat(static_cast<uint16_t>(FinishBc6hValue(
+          Interpolate(endpoints[0][c], endpoints[1][c], kWeights4[index]))));
+    }
+    texels[i][3] = 1.0f;
+  }
+}
+
+// Copies the texels of a decoded block that are inside the image.
+template <typename T>
+void StoreBlock(const T texels[kNumBlockTexels][4],
+                const int width,
+                const int height,
+                const int block_x,
+                const int block_y,
+                T* rgba) {
+  for (int y = 0; y < 4 && 4 * block_y + y < height; ++y) {
+    for (int x = 0; x < 4 && 4 * block_x + x < width; ++x) {
+      memcpy(rgba + 4 * (static_cast<size_t>(4 * block_y + y) * width +
+                         4 * block_x + x),
+             texels[4 * y + x], 4 * sizeof(T));
+    }
+  }
+}
+
+}  // namespace
+
+size_t BptcCompressedSizeInBytes(const int width, const int height) {
+  const size_t num_blocks_x = (width + 3) / 4;
+  const size_t num_blocks_y = (height + 3) / 4;
+  return num_blocks_x * num_blocks_y * kBlockSizeInBytes;
+}
+
+void EncodeBc7(const unsigned char* rgba,
+               const int width,
+               const int height,
+               const BptcEncodingOptions& options,
+               unsigned char* blocks,
+               BptcEncodingStatistics* statistics) {
+  auto encode_block = [&](const int block_x,
+                          const int block_y,
+                          const BcQuality quality,
+                          unsigned char* output) {
+    Bc7Block block;
+    LoadBc7Block(rgba, width, height, block_x, block_y, &block);
+    EncodeBc7Block(block, quality, output);
+  };
+  EncodeBlocks(width, height, options, encode_block, blocks, statistics);
+}
+
+void DecodeBc7(const unsigned char* blocks,
+               const int width,
+               const int height,
+               unsigned char* rgba) {
+  const int num_blocks_x = (width + 3) / 4;
+  const int num_blocks_y = (height + 3) / 4;
+  unsigned char texels[kNumBlockTexels][4];
+  for (int block_y = 0; block_y < num_blocks_y; ++block_y) {
+    for (int block_x = 0; block_x < num_blocks_x; ++block_x) {
+      DecodeBc7Block(blocks, texels);
+      blocks += kBlockSizeInBytes;
+      StoreBlock(texels, width, height, block_x, block_y, rgba);
+    }
+  }
+}
+
+void EncodeBc6h(const float* rgba,
+                const int width,
+                const int height,
+                const BptcEncodingOptions& options,
+                unsigned char* blocks,
+                BptcEncodingStatistics* statistics) {
+  auto encode_block = [&](const int block_x,
+                          const int block_y,
+                          const BcQuality quality,
+                          unsigned char* output) {
+    Bc6hBlock block;
+    LoadBc6hBlock(rgba, width, height, block_x, block_y, &block);
+    EncodeBc6hBlock(block, quality, output);
+  };
+  EncodeBlocks(width, height, options, encode_block, blocks, statistics);
+}
+
+void DecodeBc6h(const unsigned char* blocks,
+                const int width,
+                const int height,
+                float* rgba) {
+  const int num_blocks_x = (width + 3) / 4;
+  const int num_blocks_y = (height + 3) / 4;
+  float texels[kNumBlockTexels][4];
+  for (int block_y = 0; block_y < num_blocks_y; ++block_y) {
+    for (int block_x = 0; block_x < num_blocks_x; ++block_x) {
+      DecodeBc6hBlock(blocks, texels);
+      blocks += kBlockSizeInBytes;
+      StoreBlock(texels, width, height, block_x, block_y, rgba);
+    }
+  }
+}
+
+}  // namespace wvu
@@ -0,0 +1,138 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_BPTC_ENCODER_H_
+#define GLUTILS_BPTC_ENCODER_H_
+
+#include <cstddef>
+
+#include "bc_encoder.h"
+
+namespace wvu {
+// Encoders of the BPTC formats, which store blocks of 4x4 texels in 16 bytes:
+//   BC7 (GL_COMPRESSED_RGBA_BPTC_UNORM): RGBA8 textures. Every block chooses
+//     among several modes; the modes with two subsets split the block into
+//     two regions with their own endpoints, following one of 64 partitions.
+//     The quality is close to the source even for detailed color textures.
+//   BC6H (GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT): RGB half-float textures,
+//     e.g., HDR skies.
+// Both encoders split the rows of blocks among threads. A time budget bounds
+// the time per texture: once the budget is spent, the remaining blocks are
+// encoded with the fast quality.
+//
+// Example:
+//
+// wvu::BptcEncodingOptions options;
+// options.quality = wvu::BC_QUALITY_HIGH;
+// options.time_budget_seconds = 10.0;
+// std::vector<unsigned char> blocks(
+//     wvu::BptcCompressedSizeInBytes(width, height));
+// wvu::BptcEncodingStatistics statistics;
+// wvu::EncodeBc7(rgba, width, height, options, blocks.data(), &statistics);
+
+// Options of the encoders.
+struct BptcEncodingOptions {
+  // Quality of the encoding. The fast quality only uses one subset (BC7 mode
+  // 6); the normal and high qualities also search the partitions of the modes
+  // with two subsets (BC7 modes 1, 3 and 7), the high quality more of them and
+  // with a local search of the endpoints.
+  BcQuality quality = BC_QUALITY_NORMAL;
+  // Number of threads; 0 uses one thread per core.
+  int num_threads = 0;
+  // Maximum time to encode the texture in seconds; 0 for no limit.
+  double time_budget_seconds = 0.0;
+};
+
+// Statistics of an encoding.
+struct BptcEncodingStatistics {
+  // Time spent encoding in seconds.
+  double seconds = 0.0;
+  // Number of encoded blocks.
+  size_t num_blocks = 0;
+  // Number of blocks encoded with the fast quality because the time budget was
+  // spent.
+  size_t num_fast_blocks = 0;
+};
+
+// Returns the number of bytes of a BC7 or BC6H image of the given size.
+size_t BptcCompressedSizeInBytes(const int width, const int height);
+
+// Encodes an RGBA8 image into BC7 blocks.
+// Parameters:
+//   rgba  The RGBA8 image.
+//   width, height  The size of the image.
+//   options  The options of the encoder.
+//   blocks  The buffer that holds BptcCompressedSizeInBytes() bytes.
+//   statistics  The statistics of the encoding. Can be null.
+void EncodeBc7(const unsigned char* rgba,
+               const int width,
+               const int height,
+               const BptcEncodingOptions& options,
+               unsigned char* blocks,
+               BptcEncodingStatistics* statistics);
+
+// Decodes BC7 blocks into an RGBA8 image. Only the modes that the encoder
+// produces (1, 3, 6 and 7) are supported; the blocks of other modes decode to
+// transparent black.
+void DecodeBc7(const unsigned char* blocks,
+               const int width,
+               const int height,
+               unsigned char* rgba);
+
+// Encodes an RGBA float image into BC6H blocks (unsigned). The alpha is
+// ignored and negative values are clamped to zero.
+// Parameters:
+//   rgba  The RGBA float image.
+//   width, height  The size of the image.
+//   options  The options of the encoder.
+//   blocks  The buffer that holds BptcCompressedSizeInBytes() bytes.
+//   statistics  The statistics of the encoding. Can be null.
+void EncodeBc6h(const float* rgba,
+                const int width,
+                const int height,
+                const BptcEncodingOptions& options,
+                unsigned char* blocks,
+                BptcEncodingStatistics* statistics);
+
+// Decodes unsigned BC6H blocks into an RGBA float image with alpha 1. Only the
+// mode that the encoder produces (mode 11) is supported; the blocks of other
+// modes decode to black.
+void DecodeBc6h(const unsigned char* blocks,
+                const int width,
+                const int height,
+                float* rgba);
+
+}  // namespace wvu
+
+#endif  // GLUTILS_BPTC_ENCODER_H_
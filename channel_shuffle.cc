@@ -0,0 +1,676 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "channel_shuffle.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include <glog/logging.h>
+
+#include "cpu_features.h"
+
+#ifdef GLUTILS_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace wvu {
+namespace {
+// -------------------- Scalar kernels -----------------------------------------
+// The scalar kernels interleave the texels in [begin, end). They process the
+// images when the CPU has no SIMD support and the tails that do not fill a
+// SIMD register.
+
+template <typename T>
+void Interleave2Scalar(const T* plane0,
+                       const T* plane1,
+                       const size_t begin,
+                       const size_t end,
+                       T* interleaved) {
+  for (size_t i = begin; i < end; ++i) {
+    interleaved[2 * i + 0] = plane0[i];
+    interleaved[2 * i + 1] = plane1[i];
+  }
+}
+
+template <typename T>
+void Interleave3Scalar(const T* plane0,
+                       const T* plane1,
+                       const T* plane2,
+                       const size_t begin,
+                       const size_t end,
+                       T* interleaved) {
+  for (size_t i = begin; i < end; ++i) {
+    interleaved[3 * i + 0] = plane0[i];
+    interleaved[3 * i + 1] = plane1[i];
+    interleaved[3 * i + 2] = plane2[i];
+  }
+}
+
+// When plane3 is nullptr, the fourth channel is set to constant_value.
+template <typename T>
+void Interleave4Scalar(const T* plane0,
+                       const T* plane1,
+                       const T* plane2,
+                       const T* plane3,
+                       const T constant_value,
+                       const size_t begin,
+                       const size_t end,
+                       T* interleaved) {
+  for (size_t i = begin; i < end; ++i) {
+    interleaved[4 * i + 0] = plane0[i];
+    interleaved[4 * i + 1] = plane1[i];
+    interleaved[4 * i + 2] = plane2[i];
+    interleaved[4 * i + 3] = plane3 != nullptr ? plane3[i] : constant_value;
+  }
+}
+
+#ifdef GLUTILS_X86_SIMD
+// -------------------- SSE2 kernels -------------------------------------------
+// The SIMD kernels process the largest multiple of the register width and
+// return the number of processed texels.
+
+// Stores the lower 12 bytes of the register.
+GLUTILS_TARGET_SSE2
+inline void Store12Bytes(const __m128i value, unsigned char* destination) {
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(destination), value);
+  const int32_t upper_bytes = _mm_cvtsi128_si32(_mm_srli_si128(value, 8));
+  std::memcpy(destination + 8, &upper_bytes, sizeof(upper_bytes));
+}
+
+// Removes the fourth byte of every 32-bit lane: RGBX RGBX RGBX RGBX becomes
+// RGB RGB RGB RGB in the lower 12 bytes. SSE2 has no byte shuffle, so the
+// texels are moved with masks and shifts.
+GLUTILS_TARGET_SSE2
+inline __m128i PackRgbxToRgb(const __m128i rgbx) {
+  const __m128i even_texels = _mm_set_epi32(0, 0x00FFFFFF, 0, 0x00FFFFFF);
+  const __m128i odd_texels = _mm_set_epi32(0x00FFFFFF, 0, 0x00FFFFFF, 0);
+  // Every 64-bit half holds two texels in its lower 6 bytes.
+  const __m128i halves =
+      _mm_or_si128(_mm_and_si128(rgbx, even_texels),
+                   _mm_srli_epi64(_mm_and_si128(rgbx, odd_texels), 8));
+  const __m128i lower_half = _mm_set_epi32(0, 0, -1, -1);
+  const __m128i upper_half = _mm_set_epi32(-1, -1, 0, 0);
+  return _mm_or_si128(_mm_and_si128(halves, lower_half),
+                      _mm_srli_si128(_mm_and_si128(halves, upper_half), 2));
+}
+
+GLUTILS_TARGET_SSE2
+size_t Interleave2Sse2(const unsigned char* plane0,
+                       const unsigned char* plane1,
+                       const size_t num_texels,
+                       unsigned char* interleaved) {
+  size_t i = 0;
+  for (; i + 16 <= num_texels; i += 16) {
+    const __m128i a =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(plane0 + i));
+    const __m128i b =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(plane1 + i));
+    __m128i* output = reinterpret_cast<__m128i*>(interleaved + 2 * i);
+    _mm_storeu_si128(output + 0, _mm_unpacklo_epi8(a, b));
+    _mm_storeu_si128(output + 1, _mm_unpackhi_epi8(a, b));
+  }
+  return i;
+}
+
+GLUTILS_TARGET_SSE2
+size_t Interleave3Sse2(const unsigned char* plane0,
+                       const unsigned char* plane1,
+                       const unsigned char* plane2,
+                       const size_t num_texels,
+                       unsigned char* interleaved) {
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 16 <= num_texels; i += 16) {
+    const __m128i r =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(plane0 + i));
+    const __m128i g =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(plane1 + i));
+    const __m128i b =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(plane2 + i));
+    const __m128i rg_low = _mm_unpacklo_epi8(r, g);
+    const __m128i rg_high = _mm_unpackhi_epi8(r, g);
+    const __m128i bx_low = _mm_unpacklo_epi8(b, zero);
+    const __m128i bx_high = _mm_unpackhi_epi8(b, zero);
+    unsigned char* output = interleaved + 3 * i;
+    Store12Bytes(PackRgbxToRgb(_mm_unpacklo_epi16(rg_low, bx_low)), output);
+    Store12Bytes(PackRgbxToRgb(_mm_unpackhi_epi16(rg_low, bx_low)),
+                 output + 12);
+    Store12Bytes(PackRgbxToRgb(_mm_unpacklo_epi16(rg_high, bx_high)),
+                 output + 24);
+    Store12Bytes(PackRgbxToRgb(_mm_unpackhi_epi16(rg_high, bx_high)),
+                 output + 36);
+  }
+  return i;
+}
+
+GLUTILS_TARGET_SSE2
+size_t Interleave4Sse2(const unsigned char* plane0,
+                       const unsigned char* plane1,
+                       const unsigned char* plane2,
+                       const unsigned char* plane3,
+                       const unsigned char constant_value,
+                       const size_t num_texels,
+                       unsigned char* interleaved) {
+  const __m128i constant =
+      _mm_set1_epi8(static_cast<char>(constant_value));
+  size_t i = 0;
+  for (; i + 16 <= num_texels; i += 16) {
+    const __m128i r =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(plane0 + i));
+    const __m128i g =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(plane1 + i));
+    const __m128i b =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(plane2 + i));
+    const __m128i a = plane3 != nullptr ?
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(plane3 + i)) :
+        constant;
+    const __m128i rg_low = _mm_unpacklo_epi8(r, g);
+    const __m128i rg_high = _mm_unpackhi_epi8(r, g);
+    const __m128i ba_low = _mm_unpacklo_epi8(b, a);
+    const __m128i ba_high = _mm_unpackhi_epi8(b, a);
+    __m128i* output = reinterpret_cast<__m128i*>(interleaved + 4 * i);
+    _mm_storeu_si128(output + 0, _mm_unpacklo_epi16(rg_low, ba_low));
+    _mm_storeu_si128(output + 1, _mm_unpackhi_epi16(rg_low, ba_low));
+    _mm_storeu_si128(output + 2, _mm_unpacklo_epi16(rg_high, ba_high));
+    _mm_storeu_si128(output + 3, _mm_unpackhi_epi16(rg_high, ba_high));
+  }
+  return i;
+}
+
+GLUTILS_TARGET_SSE2
+size_t Interleave2Sse2(const float* plane0,
+                       const float* plane1,
+                       const size_t num_texels,
+                       float* interleaved) {
+  size_t i = 0;
+  for (; i + 4 <= num_texels; i += 4) {
+    const __m128 a = _mm_loadu_ps(plane0 + i);
+    const __m128 b = _mm_loadu_ps(plane1 + i);
+    _mm_storeu_ps(interleaved + 2 * i, _mm_unpacklo_ps(a, b));
+    _mm_storeu_ps(interleaved + 2 * i + 4, _mm_unpackhi_ps(a, b));
+  }
+  return i;
+}
+
+GLUTILS_TARGET_SSE2
+size_t Interleave3Sse2(const float* plane0,
+                       const float* plane1,
+                       const float* plane2,
+                       const size_t num_texels,
+                       float* interleaved) {
+  size_t i = 0;
+  for (; i + 4 <= num_texels; i += 4) {
+    __m128 r = _mm_loadu_ps(plane0 + i);
+    __m128 g = _mm_loadu_ps(plane1 + i);
+    __m128 b = _mm_loadu_ps(plane2 + i);
+    __m128 x = _mm_setzero_ps();
+    // After the transposition every register holds one texel: RGBX.
+    _MM_TRANSPOSE4_PS(r, g, b, x);
+    const __m128 texels[4] = { r, g, b, x };
+    for (int j = 0; j < 4; ++j) {
+      float* output = interleaved + 3 * (i + j);
+      _mm_storel_pi(reinterpret_cast<__m64*>(output), texels[j]);
+      _mm_store_ss(output + 2, _mm_movehl_ps(texels[j], texels[j]));
+    }
+  }
+  return i;
+}
+
+GLUTILS_TARGET_SSE2
+size_t Interleave4Sse2(const float* plane0,
+                       const float* plane1,
+                       const float* plane2,
+                       const float* plane3,
+                       const float constant_value,
+                       const size_t num_texels,
+                       float* interleaved) {
+  const __m128 constant = _mm_set1_ps(constant_value);
+  size_t i = 0;
+  for (; i + 4 <= num_texels; i += 4) {
+    __m128 r = _mm_loadu_ps(plane0 + i);
+    __m128 g = _mm_loadu_ps(plane1 + i);
+    __m128 b = _mm_loadu_ps(plane2 + i);
+    __m128 a = plane3 != nullptr ? _mm_loadu_ps(plane3 + i) : constant;
+    _MM_TRANSPOSE4_PS(r, g, b, a);
+    _mm_storeu_ps(interleaved + 4 * i + 0, r);
+    _mm_storeu_ps(interleaved + 4 * i + 4, g);
+    _mm_storeu_ps(interleaved + 4 * i + 8, b);
+    _mm_storeu_ps(interleaved + 4 * i + 12, a);
+  }
+  return i;
+}
+
+// -------------------- AVX2 kernels -------------------------------------------
+// The AVX2 unpack instructions operate within each 128-bit lane. The results
+// hold the texels [0, 8) in the lower lanes and [16, 24) in the upper lanes,
+// and so on; the permutations restore the order of the texels.
+
+GLUTILS_TARGET_AVX2
+size_t Interleave2Avx2(const unsigned char* plane0,
+                       const unsigned char* plane1,
+                       const size_t num_texels,
+                       unsigned char* interleaved) {
+  size_t i = 0;
+  for (; i + 32 <= num_texels; i += 32) {
+    const __m256i a =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(plane0 + i));
+    const __m256i b =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(plane1 + i));
+    const __m256i low = _mm256_unpacklo_epi8(a, b);
+    const __m256i high = _mm256_unpackhi_epi8(a, b);
+    __m256i* output = reinterpret_cast<__m256i*>(interleaved + 2 * i);
+    _mm256_storeu_si256(output + 0, _mm256_permute2x128_si256(low, high, 0x20));
+    _mm256_storeu_si256(output + 1, _mm256_permute2x128_si256(low, high, 0x31));
+  }
+  return i;
+}
+
+GLUTILS_TARGET_AVX2
+size_t Interleave3Avx2(const unsigned char* plane0,
+                       const unsigned char* plane1,
+                       const unsigned char* plane2,
+                       const size_t num_texels,
+                       unsigned char* interleaved) {
+  const __m256i zero = _mm256_setzero_si256();
+  // Removes the fourth byte of every texel in each 128-bit lane.
+  const __m256i pack_rgb = _mm256_setr_epi8(
+      0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+      0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+  size_t i = 0;
+  for (; i + 32 <= num_texels; i += 32) {
+    const __m256i r =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(plane0 + i));
+    const __m256i g =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(plane1 + i));
+    const __m256i b =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(plane2 + i));
+    const __m256i rg_low = _mm256_unpacklo_epi8(r, g);
+    const __m256i rg_high = _mm256_unpackhi_epi8(r, g);
+    const __m256i bx_low = _mm256_unpacklo_epi8(b, zero);
+    const __m256i bx_high = _mm256_unpackhi_epi8(b, zero);
+    // Texels [0, 4) | [16, 20), [4, 8) | [20, 24), and so on.
+    const __m256i rgb[4] = {
+      _mm256_shuffle_epi8(_mm256_unpacklo_epi16(rg_low, bx_low), pack_rgb),
+      _mm256_shuffle_epi8(_mm256_unpackhi_epi16(rg_low, bx_low), pack_rgb),
+      _mm256_shuffle_epi8(_mm256_unpacklo_epi16(rg_high, bx_high), pack_rgb),
+      _mm256_shuffle_epi8(_mm256_unpackhi_epi16(rg_high, bx_high), pack_rgb)
+    };
+    unsigned char* output = interleaved + 3 * i;
+    for (int j = 0; j < 4; ++j) {
+      Store12Bytes(_mm256_castsi256_si128(rgb[j]), output + 12 * j);
+      Store12Bytes(_mm256_extracti128_si256(rgb[j], 1), output + 48 + 12 * j);
+    }
+  }
+  return i;
+}
+
+GLUTILS_TARGET_AVX2
+size_t Interleave4Avx2(const unsigned char* plane0,
+                       const unsigned char* plane1,
+                       const unsigned char* plane2,
+                       const unsigned char* plane3,
+                       const unsigned char constant_value,
+                       const size_t num_texels,
+                       unsigned char* interleaved) {
+  const __m256i constant =
+      _mm256_set1_epi8(static_cast<char>(constant_value));
+  size_t i = 0;
+  for (; i + 32 <= num_texels; i += 32) {
+    const __m256i r =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(plane0 + i));
+    const __m256i g =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(plane1 + i));
+    const __m256i b =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(plane2 + i));
+    const __m256i a = plane3 != nullptr ?
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(plane3 + i)) :
+        constant;
+    const __m256i rg_low = _mm256_unpacklo_epi8(r, g);
+    const __m256i rg_high = _mm256_unpackhi_epi8(r, g);
+    const __m256i ba_low = _mm256_unpacklo_epi8(b, a);
+    const __m256i ba_high = _mm256_unpackhi_epi8(b, a);
+    // Texels [0, 4) | [16, 20), [4, 8) | [20, 24), and so on.
+    const __m256i rgba0 = _mm256_unpacklo_epi16(rg_low, ba_low);
+    const __m256i rgba1 = _mm256_unpackhi_epi16(rg_low, ba_low);
+    const __m256i rgba2 = _mm256_unpacklo_epi16(rg_high, ba_high);
+    const __m256i rgba3 = _mm256_unpackhi_epi16(rg_high, ba_high);
+    __m256i* output = reinterpret_cast<__m256i*>(interleaved + 4 * i);
+    _mm256_storeu_si256(output + 0,
+                        _mm256_permute2x128_si256(rgba0, rgba1, 0x20));
+    _mm256_storeu_si256(output + 1,
+                        _mm256_permute2x128_si256(rgba2, rgba3, 0x20));
+    _mm256_storeu_si256(output + 2,
+                        _mm256_permute2x128_si256(rgba0, rgba1, 0x31));
+    _mm256_storeu_si256(output + 3,
+                        _mm256_permute2x128_si256(rgba2, rgba3, 0x31));
+  }
+  return i;
+}
+
+GLUTILS_TARGET_AVX2
+size_t Interleave2Avx2(const float* plane0,
+                       const float* plane1,
+                       const size_t num_texels,
+                       float* interleaved) {
+  size_t i = 0;
+  for (; i + 8 <= num_texels; i += 8) {
+    const __m256 a = _mm256_loadu_ps(plane0 + i);
+    const __m256 b = _mm256_loadu_ps(plane1 + i);
+    const __m256 low = _mm256_unpacklo_ps(a, b);
+    const __m256 high = _mm256_unpackhi_ps(a, b);
+    _mm256_storeu_ps(interleaved + 2 * i,
+                     _mm256_permute2f128_ps(low, high, 0x20));
+    _mm256_storeu_ps(interleaved + 2 * i + 8,
+                     _mm256_permute2f128_ps(low, high, 0x31));
+  }
+  return i;
+}
+
+GLUTILS_TARGET_AVX2
+size_t Interleave4Avx2(const float* plane0,
+                       const float* plane1,
+                       const float* plane2,
+                       const float* plane3,
+                       const float constant_value,
+                       const size_t num_texels,
+                       float* interleaved) {
+  const __m256 constant = _mm256_set1_ps(constant_value);
+  size_t i = 0;
+  for (; i + 8 <= num_texels; i += 8) {
+    const __m256 r = _mm256_loadu_ps(plane0 + i);
+    const __m256 g = _mm256_loadu_ps(plane1 + i);
+    const __m256 b = _mm256_loadu_ps(plane2 + i);
+    const __m256 a =
+        plane3 != nullptr ? _mm256_loadu_ps(plane3 + i) : constant;
+    const __m256 rg_low = _mm256_unpacklo_ps(r, g);
+    const __m256 rg_high = _mm256_unpackhi_ps(r, g);
+    const __m256 ba_low = _mm256_unpacklo_ps(b, a);
+    const __m256 ba_high = _mm256_unpackhi_ps(b, a);
+    // Texels 0 | 4, 1 | 5, 2 | 6 and 3 | 7.
+    const __m256 rgba0 = _mm256_shuffle_ps(rg_low, ba_low, 0x44);
+    const __m256 rgba1 = _mm256_shuffle_ps(rg_low, ba_low, 0xEE);
+    const __m256 rgba2 = _mm256_shuffle_ps(rg_high, ba_high, 0x44);
+    const __m256 rgba3 = _mm256_shuffle_ps(rg_high, ba_high, 0xEE);
+    float* output = interleaved + 4 * i;
+    _mm256_storeu_ps(output + 0, _mm256_permute2f128_ps(rgba0, rgba1, 0x20));
+    _mm256_storeu_ps(output + 8, _mm256_permute2f128_ps(rgba2, rgba3, 0x20));
+    _mm256_storeu_ps(output + 16, _mm256_permute2f128_ps(rgba0, rgba1, 0x31));
+    _mm256_storeu_ps(output + 24, _mm256_permute2f128_ps(rgba2, rgba3, 0x31));
+  }
+  return i;
+}
+#endif  // GLUTILS_X86_SIMD
+
+// -------------------- Dispatch -----------------------------------------------
+// The functions below run the best SIMD kernel for the CPU and return the
+// number of processed texels.
+
+size_t Interleave2Simd(const unsigned char* plane0,
+                       const unsigned char* plane1,
+                       const size_t num_texels,
+                       unsigned char* interleaved) {
+#ifdef GLUTILS_X86_SIMD
+  switch (GetSimdLevel()) {
+    case SIMD_AVX2:
+      return Interleave2Avx2(plane0, plane1, num_texels, interleaved);
+    case SIMD_SSE2:
+      return Interleave2Sse2(plane0, plane1, num_texels, interleaved);
+    default:
+      break;
+  }
+#endif
+  return 0;
+}
+
+size_t Interleave2Simd(const float* plane0,
+                       const float* plane1,
+                       const size_t num_texels,
+                       float* interleaved) {
+#ifdef GLUTILS_X86_SIMD
+  switch (GetSimdLevel()) {
+    case SIMD_AVX2:
+      return Interleave2Avx2(plane0, plane1, num_texels, interleaved);
+    case SIMD_SSE2:
+      return Interleave2Sse2(plane0, plane1, num_texels, interleaved);
+    default:
+      break;
+  }
+#endif
+  return 0;
+}
+
+size_t Interleave3Simd(const unsigned char* plane0,
+                       const unsigned char* plane1,
+                       const unsigned char* plane2,
+                       const size_t num_texels,
+                       unsigned char* interleaved) {
+#ifdef GLUTILS_X86_SIMD
+  switch (GetSimdLevel()) {
+    case SIMD_AVX2:
+      return Interleave3Avx2(plane0, plane1, plane2, num_texels, interleaved);
+    case SIMD_SSE2:
+      return Interleave3Sse2(plane0, plane1, plane2, num_texels, interleaved);
+    default:
+      break;
+  }
+#endif
+  return 0;
+}
+
+size_t Interleave3Simd(const float* plane0,
+                       const float* plane1,
+                       const float* plane2,
+                       const size_t num_texels,
+                       float* interleaved) {
+#ifdef GLUTILS_X86_SIMD
+  // The SSE2 kernel is used with AVX2 as well: three floats per texel do not
+  // map well onto 256-bit registers.
+  if (GetSimdLevel() >= SIMD_SSE2) {
+    return Interleave3Sse2(plane0, plane1, plane2, num_texels, interleaved);
+  }
+#endif
+  return 0;
+}
+
+size_t Interleave4Simd(const unsigned char* plane0,
+                       const unsigned char* plane1,
+                       const unsigned char* plane2,
+                       const unsigned char* plane3,
+                       const unsigned char constant_value,
+                       const size_t num_texels,
+                       unsigned char* interleaved) {
+#ifdef GLUTILS_X86_SIMD
+  switch (GetSimdLevel()) {
+    case SIMD_AVX2:
+      return Interleave4Avx2(plane0, plane1, plane2, plane3, constant_value,
+                             num_texels, interleaved);
+    case SIMD_SSE2:
+      return Interleave4Sse2(plane0, plane1, plane2, plane3, constant_value,
+                             num_texels, interleaved);
+    default:
+      break;
+  }
+#endif
+  return 0;
+}
+
+size_t Interleave4Simd(const float* plane0,
+                       const float* plane1,
+                       const float* plane2,
+                       const float* plane3,
+                       const float constant_value,
+                       const size_t num_texels,
+                       float* interleaved) {
+#ifdef GLUTILS_X86_SIMD
+  switch (GetSimdLevel()) {
+    case SIMD_AVX2:
+      return Interleave4Avx2(plane0, plane1, plane2, plane3, constant_value,
+                             num_texels, interleaved);
+    case SIMD_SSE2:
+      return Interleave4Sse2(plane0, plane1, plane2, plane3, constant_value,
+                             num_texels, interleaved);
+    default:
+      break;
+  }
+#endif
+  return 0;
+}
+
+// Interleaves the texels with the SIMD kernels and finishes the tail with the
+// scalar kernels.
+template <typename T>
+void Interleave2(const T* plane0,
+                 const T* plane1,
+                 const size_t num_texels,
+                 T* interleaved) {
+  const size_t begin =
+      Interleave2Simd(plane0, plane1, num_texels, interleaved);
+  Interleave2Scalar(plane0, plane1, begin, num_texels, interleaved);
+}
+
+template <typename T>
+void Interleave3(const T* plane0,
+                 const T* plane1,
+                 const T* plane2,
+                 const size_t num_texels,
+                 T* interleaved) {
+  const size_t begin =
+      Interleave3Simd(plane0, plane1, plane2, num_texels, interleaved);
+  Interleave3Scalar(plane0, plane1, plane2, begin, num_texels, interleaved);
+}
+
+template <typename T>
+void Interleave4(const T* plane0,
+                 const T* plane1,
+                 const T* plane2,
+                 const T* plane3,
+                 const T constant_value,
+                 const size_t num_texels,
+                 T* interleaved) {
+  const size_t begin = Interleave4Simd(plane0, plane1, plane2, plane3,
+                                       constant_value, num_texels, interleaved);
+  Interleave4Scalar(plane0, plane1, plane2, plane3, constant_value, begin,
+                    num_texels, interleaved);
+}
+
+template <typename T>
+void InterleavePlanesImpl(const T* planes,
+                          const int num_channels,
+                          const size_t num_texels,
+                          T* interleaved) {
+  switch (num_channels) {
+    case 1:
+      std::memcpy(interleaved, planes, num_texels * sizeof(T));
+      break;
+    case 2:
+      Interleave2(planes, planes + num_texels, num_texels, interleaved);
+      break;
+    case 3:
+      Interleave3(planes, planes + num_texels, planes + 2 * num_texels,
+                  num_texels, interleaved);
+      break;
+    case 4:
+      Interleave4(planes, planes + num_texels, planes + 2 * num_texels,
+                  planes + 3 * num_texels, T(0), num_texels, interleaved);
+      break;
+    default:
+      LOG(ERROR) << "Cannot interleave " << num_channels << " channels.";
+      break;
+  }
+}
+
+template <typename T>
+void InterleavePlanesToRgbaImpl(const T* planes,
+                                const int num_channels,
+                                const size_t num_texels,
+                                const T alpha,
+                                T* rgba) {
+  const T* gray = planes;
+  switch (num_channels) {
+    case 1:
+      Interleave4(gray, gray, gray, static_cast<const T*>(nullptr), alpha,
+                  num_texels, rgba);
+      break;
+    case 2:
+      Interleave4(gray, gray, gray, planes + num_texels, alpha, num_texels,
+                  rgba);
+      break;
+    case 3:
+      Interleave4(planes, planes + num_texels, planes + 2 * num_texels,
+                  static_cast<const T*>(nullptr), alpha, num_texels, rgba);
+      break;
+    case 4:
+      Interleave4(planes, planes + num_texels, planes + 2 * num_texels,
+                  planes + 3 * num_texels, alpha, num_texels, rgba);
+      break;
+    default:
+      LOG(ERROR) << "Cannot interleave " << num_channels << " channels.";
+      break;
+  }
+}
+
+}  // namespace
+
+void InterleavePlanes(const unsigned char* planes,
+                      const int num_channels,
+                      const size_t num_texels,
+                      unsigned char* interleaved) {
+  InterleavePlanesImpl(planes, num_channels, num_texels, interleaved);
+}
+
+void InterleavePlanes(const float* planes,
+                      const int num_channels,
+                      const size_t num_texels,
+                      float* interleaved) {
+  InterleavePlanesImpl(planes, num_channels, num_texels, interleaved);
+}
+
+void InterleavePlanesToRgba(const unsigned char* planes,
+                            const int num_channels,
+                            const size_t num_texels,
+                            const unsigned char alpha,
+                            unsigned char* rgba) {
+  InterleavePlanesToRgbaImpl(planes, num_channels, num_texels, alpha, rgba);
+}
+
+void InterleavePlanesToRgba(const float* planes,
+                            const int num_channels,
+                            const size_t num_texels,
+                            const float alpha,
+                            float* rgba) {
+  InterleavePlanesToRgbaImpl(planes, num_channels, num_texels, alpha, rgba);
+}
+
+}  // namespace wvu
@@ -0,0 +1,97 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_CHANNEL_SHUFFLE_H_
+#define GLUTILS_CHANNEL_SHUFFLE_H_
+
+#include <cstddef>
+
+namespace wvu {
+// Kernels that convert planar images (e.g., CImg images, where every channel is
+// stored in its own plane) into interleaved images (e.g., RGBARGBA...), which
+// is the layout that OpenGL expects. The kernels read every plane sequentially
+// and use SSE2 or AVX2 when the CPU supports them, see cpu_features.h.
+//
+// In all the functions below the planes are stored contiguously, one after
+// the other, as CImg does: the channel c of the texel i is stored in
+// planes[c * num_texels + i].
+//
+// Example:
+//
+// cimg_library::CImg<unsigned char> image(...);
+// std::vector<unsigned char> rgba(4 * image.width() * image.height());
+// wvu::InterleavePlanesToRgba(image.data(), image.spectrum(),
+//                             image.width() * image.height(), 255,
+//                             rgba.data());
+
+// Interleaves num_channels planes of num_texels values. The interleaved image
+// holds num_channels values per texel.
+// Parameters:
+//   planes  The planar image.
+//   num_channels  The number of planes, between 1 and 4.
+//   num_texels  The number of texels in every plane.
+//   interleaved  The buffer that holds num_channels * num_texels values.
+void InterleavePlanes(const unsigned char* planes,
+                      const int num_channels,
+                      const size_t num_texels,
+                      unsigned char* interleaved);
+void InterleavePlanes(const float* planes,
+                      const int num_channels,
+                      const size_t num_texels,
+                      float* interleaved);
+
+// Interleaves the planes into RGBA. Gray images (1 channel) replicate the gray
+// value into red, green and blue; gray-alpha images (2 channels) also keep
+// their alpha. Images without alpha (1 or 3 channels) receive the constant
+// alpha value.
+// Parameters:
+//   planes  The planar image.
+//   num_channels  The number of planes, between 1 and 4.
+//   num_texels  The number of texels in every plane.
+//   alpha  The alpha value of the images without alpha.
+//   rgba  The buffer that holds 4 * num_texels values.
+void InterleavePlanesToRgba(const unsigned char* planes,
+                            const int num_channels,
+                            const size_t num_texels,
+                            const unsigned char alpha,
+                            unsigned char* rgba);
+void InterleavePlanesToRgba(const float* planes,
+                            const int num_channels,
+                            const size_t num_texels,
+                            const float alpha,
+                            float* rgba);
+
+}  // namespace wvu
+
+#endif  // GLUTILS_CHANNEL_SHUFFLE_H_
@@ -0,0 +1,92 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "cpu_features.h"
+
+#include <atomic>
+
+namespace wvu {
+namespace {
+// Upper bound of the instruction sets set by the user.
+std::atomic<int> max_simd_level(SIMD_AVX2);
+
+// Queries the CPU for the supported instruction sets.
+SimdLevel DetectSimdLevel() {
+#ifdef GLUTILS_X86_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return SIMD_AVX2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return SIMD_SSE2;
+  }
+#endif
+  return SIMD_SCALAR;
+}
+
+}  // namespace
+
+SimdLevel GetSimdLevel() {
+  // The detection runs once; C++11 guarantees a thread-safe initialization.
+  static const SimdLevel detected_simd_level = DetectSimdLevel();
+  const int simd_level = max_simd_level.load(std::memory_order_relaxed);
+  return detected_simd_level < simd_level ?
+      detected_simd_level : static_cast<SimdLevel>(simd_level);
+}
+
+void SetMaxSimdLevel(const SimdLevel simd_level) {
+  max_simd_level.store(simd_level, std::memory_order_relaxed);
+}
+
+bool CpuSupportsF16C() {
+#ifdef GLUTILS_X86_SIMD
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("f16c") && GetSimdLevel() == SIMD_AVX2;
+#else
+  return false;
+#endif
+}
+
+const char* SimdLevelName(const SimdLevel simd_level) {
+  switch (simd_level) {
+    case SIMD_SSE2:
+      return "sse2";
+    case SIMD_AVX2:
+      return "avx2";
+    default:
+      return "scalar";
+  }
+}
+
+}  // namespace wvu
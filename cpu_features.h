@@ -0,0 +1,73 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_CPU_FEATURES_H_
+#define GLUTILS_CPU_FEATURES_H_
+
+// The SIMD kernels are compiled for x86 with GCC or Clang. Every kernel is
+// compiled with a target attribute, so the files do not require -mavx2, and the
+// kernel to run is selected at runtime according to the CPU.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GLUTILS_X86_SIMD 1
+#define GLUTILS_TARGET_SSE2 __attribute__((target("sse2")))
+#define GLUTILS_TARGET_AVX2 __attribute__((target("avx2")))
+#define GLUTILS_TARGET_F16C __attribute__((target("avx2,f16c")))
+#endif
+
+namespace wvu {
+// Instruction sets used by the SIMD kernels, ordered by capability.
+enum SimdLevel {
+  SIMD_SCALAR = 0,
+  SIMD_SSE2 = 1,
+  SIMD_AVX2 = 2
+};
+
+// Returns the most capable instruction set that the CPU supports, limited by
+// SetMaxSimdLevel().
+SimdLevel GetSimdLevel();
+
+// Limits the instruction sets that the kernels use. This is mainly useful to
+// compare the kernels in benchmarks. The function is thread-safe.
+void SetMaxSimdLevel(const SimdLevel max_simd_level);
+
+// Returns true if the CPU supports the F16C (half-float conversion)
+// instructions.
+bool CpuSupportsF16C();
+
+// Returns the name of the instruction set (e.g., "avx2").
+const char* SimdLevelName(const SimdLevel simd_level);
+
+}  // namespace wvu
+
+#endif  // GLUTILS_CPU_FEATURES_H_
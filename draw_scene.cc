@@ -41,18 +41,17 @@
 
 // Include first C-Headers.
 #define _USE_MATH_DEFINES  // For using M_PI.
+#include <cctype>
 #include <cmath>
+#include <cstdio>
 // Include second C++-Headers.
 #include <iostream>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 // Include library headers.
-// Include CImg library to load textures.
-// The macro below disables the capabilities of displaying images in CImg.
-#define cimg_display 0
-#include <CImg.h>
-
 // The macro below tells the linker to use the GLEW library in a static way.
 // This is mainly for compatibility with Windows.
 // Glew is a library that "scans" and knows what "extensions" (i.e.,
@@ -72,7 +71,23 @@
 #include <glog/logging.h>
 
 // Include system headers.
+#include "async_texture_loader.h"
+#include "hdr_texture.h"
+#include "program_binary_cache.h"
 #include "shader_program.h"
+#include "shader_program_batch.h"
+#include "shader_variant_cache.h"
+#include "texture_atlas.h"
+#include "texture_cache.h"
+#include "texture_cooker.h"
+#include "texture_format.h"
+#include "texture_hot_reloader.h"
+#include "texture_registry.h"
+#include "texture_residency_manager.h"
+#include "texture_uploader.h"
+#include "tiff_region_reader.h"
+#include "uniform_buffer.h"
+#include "virtual_texture.h"
 
 // Google flags.
 // (<name of the flag>, <default value>, <Brief description of flat>)
@@ -85,14 +100,115 @@ DEFINE_string(vertex_shader_filepath, "",
               "Filepath of the vertex shader.");
 DEFINE_string(fragment_shader_filepath, "",
               "Filepath of the fragment shader.");
+DEFINE_string(program_binary_cache_directory, "",
+              "Directory of the cache of shader program binaries. If empty, "
+              "the shaders are compiled every run.");
+DEFINE_string(shader_features, "TEXTURE",
+              "Features of the variant of the shaders, separated by commas: "
+              "TEXTURE, VERTEX_COLOR and ALPHA_TEST.");
+DEFINE_string(shader_variant_manifest, "",
+              "Manifest of the shader variants to compile ahead of time. The "
+              "variants used by the run are written back to it.");
 DEFINE_string(texture_filepath, "", 
               "Filepath of the texture.");
+DEFINE_int32(texture_decode_threads, 2,
+             "Number of threads that decode textures in the background. If "
+             "zero, the textures are loaded before the rendering loop starts.");
+DEFINE_int32(texture_upload_budget_bytes, 16 << 20,
+             "Maximum number of texture bytes transferred to the GPU per "
+             "frame.");
+DEFINE_string(texture_cache_directory, "",
+              "Directory of the cache of cooked textures (textures with their "
+              "mip chains). If empty, the textures are cooked every run.");
+DEFINE_string(texture_cache_supercompression, "none",
+              "Compression of the levels of the cached textures: none, zstd "
+              "or lz4. Compressed textures are smaller on disk but are "
+              "decompressed instead of memory-mapped.");
+DEFINE_string(texture_compression, "none",
+              "GPU format of the textures: none (RGBA8), bc1, bc3, bc (bc3 "
+              "for textures with transparency and bc1 otherwise), bc7, "
+              "etc2_rgb, etc2_rgba, etc2 (etc2_rgba for textures with "
+              "transparency and etc2_rgb otherwise), eac_r11 or eac_rg11. If "
+              "the GPU does not support the format, the textures are RGBA8.");
+DEFINE_string(texture_compression_quality, "normal",
+              "Quality of the texture compression: fast, normal or high.");
+DEFINE_double(texture_compression_time_budget, 0.0,
+              "Maximum time in seconds to compress a bc7 texture; the blocks "
+              "left when it is spent use the fast quality. If zero, there is "
+              "no limit.");
+DEFINE_double(texture_compression_min_psnr, 0.0,
+              "Minimum PSNR in dB of a compressed texture decoded back; the "
+              "textures below it are not compressed. If zero, the textures "
+              "are not verified.");
+DEFINE_bool(texture_compression_report, false,
+            "If true, logs the PSNR and the compression time of every "
+            "compressed texture.");
+DEFINE_double(texture_compression_rdo_lambda, 0.0,
+              "If positive, the bc1 and bc3 blocks trade quality for smaller "
+              "supercompressed textures; higher values trade more. Typical "
+              "values are 1-20.");
+DEFINE_string(texture_mip_filter, "gpu",
+              "Filter of the mip levels of the textures: gpu (the driver "
+              "generates them when the textures are neither cached nor "
+              "compressed, and the CPU box filter otherwise), box, kaiser or "
+              "lanczos.");
+DEFINE_bool(texture_srgb_mipmaps, false,
+            "If true, the colors of the textures are sRGB and their mip levels "
+            "are filtered in linear light on the CPU.");
+DEFINE_double(texture_alpha_coverage, 0.0,
+              "If positive, the mip levels keep the fraction of texels whose "
+              "alpha is above this reference, e.g., 0.5 for alpha-tested "
+              "cutouts.");
+DEFINE_string(texture_atlas_manifest, "",
+              "Manifest of a texture atlas built with texture_atlas_builder. "
+              "If not empty, the texture is the atlas page that holds "
+              "--texture_filepath and the texture coordinates are remapped "
+              "to its image.");
+DEFINE_string(texture_region, "",
+              "If not empty, the region x,y,width,height of the TIFF "
+              "--texture_filepath is the texture. Only the tiles or strips "
+              "that overlap the region are decoded.");
+DEFINE_int32(texture_region_level, 0,
+             "Resolution of --texture_region in a pyramidal TIFF: 0 is the "
+             "full resolution and every level is a smaller directory.");
+DEFINE_string(texture_hdr_format, "rgba16f",
+              "Internal format of the textures loaded from floating-point "
+              "images (PFM, Radiance HDR and OpenEXR): rgba16f, "
+              "r11g11b10f, which has no alpha and takes half the memory, or "
+              "bc6h, which is compressed with --texture_compression_quality "
+              "and takes an eighth of the memory.");
+DEFINE_int32(texture_memory_budget_mb, 0,
+             "If positive, the textures are loaded before the rendering loop "
+             "and kept within this budget of GPU memory in MB: the top mip "
+             "levels of the least recently used textures are dropped first, "
+             "and then the textures are evicted.");
+DEFINE_string(virtual_texture_filepath, "",
+              "Virtual texture built with virtual_texture_builder. If not "
+              "empty, the texture is the virtual texture, which streams the "
+              "pages of the image that the scene needs. Use it with "
+              "virtual_texture_fragment_shader.glsl as the fragment shader.");
+DEFINE_string(virtual_texture_feedback_shader_filepath,
+              "virtual_texture_feedback_shader.glsl",
+              "Filepath of the fragment shader of the feedback pass of the "
+              "virtual texture.");
+DEFINE_bool(texture_hot_reload, false,
+              "If true, the texture is reloaded in the background whenever its "
+              "file changes. It needs the textures loaded before the "
+              "rendering loop (--texture_decode_threads=0).");
+DEFINE_int32(texture_upload_slots, 4,
+             "Number of pixel buffer objects used to transfer the textures. If "
+             "zero, the textures are transferred from client memory.");
+DEFINE_int32(texture_upload_slot_bytes, 8 << 20,
+             "Size in bytes of every pixel buffer object used to transfer the "
+             "textures.");
 
 // Annonymous namespace for constants and helper functions.
 namespace {
 // Window dimensions.
 constexpr int kWindowWidth = 640;
 constexpr int kWindowHeight = 480;
+// Maximum number of bytes kept for decoding textures (256 MB).
+constexpr size_t kMaxPooledStagingBytes = 256 << 20;
 
 // Error callback function. This function follows the required signature of
 // GLFW. See http://www.glfw.org/docs/3.0/group__error.html for more
@@ -170,6 +286,10 @@ public:
     return &position_;
   }
 
+  Eigen::MatrixXf* mutable_vertices() {
+    return &vertices_;
+  }
+
   // Getters, return a const reference to the member.
   const Eigen::Vector3f& GetOrientation() {
     return orientation_;
@@ -279,32 +399,188 @@ Eigen::Matrix4f ComputeProjectionMatrix(const GLfloat field_of_view,
 }
 
 // -------------------- Texture helper functions -------------------------------
-GLuint LoadTexture(const std::string& texture_filepath) {
-  cimg_library::CImg<unsigned char> image;
-  image.load(texture_filepath.c_str());
-  const int width = image.width();
-  const int height = image.height();
-  // OpenGL expects to have the pixel values interleaved (e.g., RGBD, ...). CImg
-  // flatens out the planes. To have them interleaved, CImg has to re-arrange
-  // the values.
-  // Also, OpenGL has the y-axis of the texture flipped.
-  image.permute_axes("cxyz");
+// Maps the texture coordinates of the model (rows 6 and 7 of its vertices) to
+// the sub-rectangle of its image in the atlas.
+// Params
+//  atlas  The texture atlas.
+//  entry  The entry of the image of the model.
+//  model  The model whose texture coordinates are remapped.
+void RemapModelTexcoords(const wvu::TextureAtlas& atlas,
+                         const wvu::TextureAtlasEntry& entry,
+                         Model* model) {
+  Eigen::MatrixXf* vertices = model->mutable_vertices();
+  for (int i = 0; i < vertices->cols(); ++i) {
+    wvu::RemapAtlasTexcoord(atlas, entry, &(*vertices)(6, i),
+                            &(*vertices)(7, i));
+  }
+}
+
+// Loads a region of a TIFF image as the texture, uploading the texels
+// straight from the decoded tiles. Returns the handle of the texture if
+// successful, and null otherwise.
+// Params
+//  texture_filepath  The filepath of the TIFF image.
+//  region  The region as x,y,width,height in texels of the level.
+//  level  The level of the region in a pyramidal TIFF.
+wvu::SharedTextureHandle LoadTextureRegion(const std::string& texture_filepath,
+                                           const std::string& region,
+                                           const int level) {
+  int x, y, width, height;
+  if (std::sscanf(region.c_str(), "%d,%d,%d,%d", &x, &y, &width, &height) !=
+      4) {
+    std::cerr << "ERROR: Invalid texture region " << region << "\n";
+    return nullptr;
+  }
+  wvu::TiffRegionReader region_reader((wvu::TiffRegionReader::Options()));
+  if (!region_reader.Open(texture_filepath)) {
+    return nullptr;
+  }
+  if (level < 0 || level >= region_reader.num_levels()) {
+    std::cerr << "ERROR: The TIFF image has " << region_reader.num_levels()
+              << " levels.\n";
+    return nullptr;
+  }
   GLuint texture_id;
   glGenTextures(1, &texture_id);
   glBindTexture(GL_TEXTURE_2D, texture_id);
-  // We are configuring texture wrapper, each per dimension,s:x, t:y.
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  // Define the interpolation behavior for this texture.
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  const int num_levels = wvu::ComputeNumMipLevels(width, height);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                  wvu::ComputeMinFilter(num_levels));
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  /// Sending the texture information to the GPU.
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height,
-               0, GL_RGB, GL_UNSIGNED_BYTE, image.data());
-  // Generate a mipmap.
+  const wvu::TextureUploadFormat upload_format;
+  wvu::AllocateTextureStorage(GL_TEXTURE_2D, num_levels, upload_format, width,
+                              height);
+  if (!region_reader.UploadRegion(level, x, y, width, height, GL_TEXTURE_2D,
+                                  0, 0, 0)) {
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDeleteTextures(1, &texture_id);
+    return nullptr;
+  }
   glGenerateMipmap(GL_TEXTURE_2D);
   glBindTexture(GL_TEXTURE_2D, 0);
-  return texture_id;
+  return std::make_shared<const wvu::SharedTexture>(
+      texture_id, 0, 4 * static_cast<size_t>(width) * height * 4 / 3);
+}
+
+// Loads a floating-point image as the texture. Returns the handle of the
+// texture if successful, and null otherwise.
+// Params
+//  texture_filepath  The filepath of the floating-point image.
+//  cooking_options  The cooking options; their compression quality and time
+//     budget apply to BC6H.
+//  texture_uploader  The uploader that transfers the texels through pixel
+//     buffer objects. If null, the texels are transferred from client memory.
+wvu::SharedTextureHandle LoadFloatTexture(
+    const std::string& texture_filepath,
+    const wvu::TextureCookingOptions& cooking_options,
+    wvu::TextureUploader* texture_uploader) {
+  wvu::HdrTextureFormat format;
+  if (FLAGS_texture_hdr_format == "rgba16f") {
+    format = wvu::HDR_TEXTURE_FORMAT_RGBA16F;
+  } else if (FLAGS_texture_hdr_format == "r11g11b10f") {
+    format = wvu::HDR_TEXTURE_FORMAT_R11G11B10F;
+  } else if (FLAGS_texture_hdr_format == "bc6h") {
+    format = wvu::HDR_TEXTURE_FORMAT_BC6H;
+  } else {
+    std::cerr << "ERROR: Unknown HDR texture format "
+              << FLAGS_texture_hdr_format << "\n";
+    return nullptr;
+  }
+  wvu::BptcEncodingOptions bc6h_options;
+  bc6h_options.quality = cooking_options.compression_quality;
+  bc6h_options.time_budget_seconds =
+      cooking_options.compression_time_budget_seconds;
+  size_t size_in_bytes;
+  const GLuint texture_id = wvu::LoadHdrTexture(
+      texture_filepath, format, bc6h_options, texture_uploader,
+      &size_in_bytes);
+  if (texture_id == 0) {
+    return nullptr;
+  }
+  return std::make_shared<const wvu::SharedTexture>(texture_id, 0,
+                                                    size_in_bytes);
+}
+
+// Sets the cooking options from the flags. Returns true if successful, and
+// false if a flag has an unknown value.
+bool ParseTextureCookingOptions(wvu::TextureCookingOptions* cooking_options) {
+  if (FLAGS_texture_compression == "none") {
+    cooking_options->compression = wvu::TEXTURE_COMPRESSION_NONE;
+  } else if (FLAGS_texture_compression == "bc1") {
+    cooking_options->compression = wvu::TEXTURE_COMPRESSION_BC1;
+  } else if (FLAGS_texture_compression == "bc3") {
+    cooking_options->compression = wvu::TEXTURE_COMPRESSION_BC3;
+  } else if (FLAGS_texture_compression == "bc") {
+    cooking_options->compression = wvu::TEXTURE_COMPRESSION_BC_AUTO;
+  } else if (FLAGS_texture_compression == "bc7") {
+    cooking_options->compression = wvu::TEXTURE_COMPRESSION_BC7;
+  } else if (FLAGS_texture_compression == "etc2_rgb") {
+    cooking_options->compression = wvu::TEXTURE_COMPRESSION_ETC2_RGB8;
+  } else if (FLAGS_texture_compression == "etc2_rgba") {
+    cooking_options->compression = wvu::TEXTURE_COMPRESSION_ETC2_RGBA8;
+  } else if (FLAGS_texture_compression == "etc2") {
+    cooking_options->compression = wvu::TEXTURE_COMPRESSION_ETC2_AUTO;
+  } else if (FLAGS_texture_compression == "eac_r11") {
+    cooking_options->compression = wvu::TEXTURE_COMPRESSION_EAC_R11;
+  } else if (FLAGS_texture_compression == "eac_rg11") {
+    cooking_options->compression = wvu::TEXTURE_COMPRESSION_EAC_RG11;
+  } else {
+    std::cerr << "ERROR: Unknown texture compression "
+              << FLAGS_texture_compression << "\n";
+    return false;
+  }
+  if (FLAGS_texture_compression_quality == "fast") {
+    cooking_options->compression_quality = wvu::BC_QUALITY_FAST;
+  } else if (FLAGS_texture_compression_quality == "normal") {
+    cooking_options->compression_quality = wvu::BC_QUALITY_NORMAL;
+  } else if (FLAGS_texture_compression_quality == "high") {
+    cooking_options->compression_quality = wvu::BC_QUALITY_HIGH;
+  } else {
+    std::cerr << "ERROR: Unknown texture compression quality "
+              << FLAGS_texture_compression_quality << "\n";
+    return false;
+  }
+  cooking_options->compression_time_budget_seconds =
+      FLAGS_texture_compression_time_budget;
+  if (FLAGS_texture_mip_filter == "gpu" || FLAGS_texture_mip_filter == "box") {
+    cooking_options->mip_generation.filter = wvu::MIP_FILTER_BOX;
+  } else if (FLAGS_texture_mip_filter == "kaiser") {
+    cooking_options->mip_generation.filter = wvu::MIP_FILTER_KAISER;
+  } else if (FLAGS_texture_mip_filter == "lanczos") {
+    cooking_options->mip_generation.filter = wvu::MIP_FILTER_LANCZOS;
+  } else {
+    std::cerr << "ERROR: Unknown texture mip filter "
+              << FLAGS_texture_mip_filter << "\n";
+    return false;
+  }
+  cooking_options->mip_generation.srgb = FLAGS_texture_srgb_mipmaps;
+  cooking_options->mip_generation.alpha_coverage_reference =
+      static_cast<float>(FLAGS_texture_alpha_coverage);
+  cooking_options->min_compression_psnr = FLAGS_texture_compression_min_psnr;
+  cooking_options->report_compression = FLAGS_texture_compression_report;
+  cooking_options->compression_rdo_lambda =
+      static_cast<float>(FLAGS_texture_compression_rdo_lambda);
+  return true;
+}
+
+// Returns true if the GPU can sample the textures cooked with the compression.
+bool GpuSupportsTextureCompression(
+    const wvu::TextureCompression compression) {
+  switch (compression) {
+    case wvu::TEXTURE_COMPRESSION_NONE:
+      return true;
+    case wvu::TEXTURE_COMPRESSION_BC1:
+    case wvu::TEXTURE_COMPRESSION_BC3:
+    case wvu::TEXTURE_COMPRESSION_BC_AUTO:
+      return GLEW_EXT_texture_compression_s3tc;
+    case wvu::TEXTURE_COMPRESSION_BC7:
+      return GLEW_ARB_texture_compression_bptc;
+    default:
+      // ETC2 and EAC are core in OpenGL 4.3.
+      return GLEW_VERSION_4_3 || GLEW_ARB_ES3_compatibility;
+  }
 }
 
 // -------------------- End of Helper Functions --------------------------------
@@ -441,40 +717,58 @@ void SetVertexArrayObject(const Model& model,
   glBindVertexArray(0);
 }
 
-// Renders the scene.
+// Assigns the shared uniform blocks that the program declares to the binding
+// points of their buffers. Returns false if a block does not match its layout.
+bool BindSharedUniformBlocks(const wvu::UniformBuffer& camera_buffer,
+                             const wvu::UniformBuffer& object_buffer,
+                             wvu::ShaderProgram* shader_program) {
+  for (const wvu::UniformBuffer* buffer : {&camera_buffer, &object_buffer}) {
+    const wvu::UniformBlockLayout& layout = buffer->layout();
+    // The blocks that the shaders do not read are not active.
+    if (!shader_program->FindUniformBlock(layout.block_name())) continue;
+    std::string mismatch;
+    if (!layout.Matches(*shader_program, &mismatch)) {
+      std::string instance_name = layout.block_name();
+      instance_name[0] = std::tolower(instance_name[0]);
+      std::cerr << "ERROR: " << mismatch << " Declare it as:\n"
+                << layout.GlslDeclaration(instance_name);
+      return false;
+    }
+    shader_program->BindUniformBlock(layout.block_name(), buffer->binding());
+  }
+  return true;
+}
+
+// Renders the scene. The camera block must be uploaded already; the matrices
+// of the object are combined here and uploaded through object_buffer.
 void RenderScene(const wvu::ShaderProgram& shader_program,
                  const GLuint vertex_array_object_id,
-                 const Eigen::Matrix4f& projection,
+                 const Eigen::Matrix4f& view_projection,
                  const GLfloat angle,
                  const GLuint texture_id,
+                 wvu::UniformBuffer* object_buffer,
                  GLFWwindow* window) {
   // Clear the buffer.
   ClearTheFrameBuffer();
   // Let OpenGL know that we want to use our shader program.
   shader_program.Use();
-  // Get the locations of the uniform variables.
-  const GLint model_location = 
-    glGetUniformLocation(shader_program.shader_program_id(), "model");
-  const GLint view_location = 
-    glGetUniformLocation(shader_program.shader_program_id(), "view");
-  const GLint projection_location = 
-    glGetUniformLocation(shader_program.shader_program_id(), "projection");
-  // When variable is not found you get a - 1.
   Eigen::Matrix4f translation = 
     ComputeTranslation(Eigen::Vector3f(0.0f, 0.0f, -5.0f));
   Eigen::Matrix4f rotation = 
       ComputeRotation(Eigen::Vector3f(0.0, 1.0, 0.0f).normalized(), angle);
   Eigen::Matrix4f model = translation * rotation;
   std::cout << "Model: \n" << model << std::endl;
-  Eigen::Matrix4f view = Eigen::Matrix4f::Identity();
+  // The vertex shader transforms the vertices with a single matrix.
+  const Eigen::Matrix4f model_view_projection = view_projection * model;
+  const Eigen::Matrix3f normal_matrix =
+      model.topLeftCorner<3, 3>().inverse().transpose();
+  object_buffer->SetMatrix4f(wvu::OBJECT_MODEL_VIEW_PROJECTION,
+                             model_view_projection.data());
+  object_buffer->SetMatrix4f(wvu::OBJECT_MODEL, model.data());
+  object_buffer->SetMatrix3f(wvu::OBJECT_NORMAL_MATRIX, normal_matrix.data());
+  object_buffer->Upload();
   // Bind texture.
   glBindTexture(GL_TEXTURE_2D, texture_id);
-  // We do not create the projection matrix here because the projection 
-  // matrix does not change.
-  // Eigen::Matrix4f projection = Eigen::Matrix4f::Identity();
-  glUniformMatrix4fv(model_location, 1, GL_FALSE, model.data());
-  glUniformMatrix4fv(view_location, 1, GL_FALSE, view.data());
-  glUniformMatrix4fv(projection_location, 1, GL_FALSE, projection.data());
   GLfloat color_scalar = static_cast<GLfloat>(glfwGetTime());
   // Draw the triangle.
   // Let OpenGL know what vertex array object we will use.
@@ -544,18 +838,53 @@ int main(int argc, char** argv) {
     FLAGS_vertex_shader_filepath;
   const std::string fragment_shader_filepath =
     FLAGS_fragment_shader_filepath;
-  wvu::ShaderProgram shader_program;
+  // Program binaries are kept on disk across runs.
+  std::unique_ptr<wvu::ProgramBinaryCache> program_binary_cache;
+  if (!FLAGS_program_binary_cache_directory.empty()) {
+    program_binary_cache.reset(
+        new wvu::ProgramBinaryCache(FLAGS_program_binary_cache_directory));
+  }
+  // The shaders are compiled into a variant per combination of features.
+  wvu::ShaderVariantCache shader_variants(
+      {"TEXTURE", "VERTEX_COLOR", "ALPHA_TEST"}, program_binary_cache.get());
   std::cout << vertex_shader_filepath << std::endl;
   std::cout << fragment_shader_filepath << std::endl;
-  shader_program.LoadVertexShaderFromFile(vertex_shader_filepath);
-  shader_program.LoadFragmentShaderFromFile(fragment_shader_filepath);
-  std::string error_info_log;
-  if (!shader_program.Create(&error_info_log)) {
-    std::cout << "ERROR: " << error_info_log << "\n";
-  }
-  // TODO(vfragoso): Implement me!
-  if (!shader_program.shader_program_id()) {
-    std::cerr << "ERROR: Could not create a shader program.\n";
+  if (!shader_variants.LoadVertexShaderFromFile(vertex_shader_filepath) ||
+      !shader_variants.LoadFragmentShaderFromFile(fragment_shader_filepath)) {
+    std::cerr << "ERROR: Could not read the shaders.\n";
+    return -1;
+  }
+  wvu::ShaderFeatureMask shader_features = 0;
+  if (!shader_variants.ParseFeatures(FLAGS_shader_features,
+                                     &shader_features)) {
+    std::cerr << "ERROR: Unknown shader feature in " << FLAGS_shader_features
+              << "\n";
+    return -1;
+  }
+  if (!FLAGS_shader_variant_manifest.empty()) {
+    shader_variants.WarmFromManifest(FLAGS_shader_variant_manifest);
+  }
+  shader_variants.Warm(shader_features);
+  // The feedback pass draws the scene with the same vertex shader.
+  wvu::ShaderProgram feedback_shader_program;
+  if (!FLAGS_virtual_texture_filepath.empty()) {
+    feedback_shader_program.LoadVertexShaderFromFile(vertex_shader_filepath);
+    feedback_shader_program.LoadFragmentShaderFromFile(
+        FLAGS_virtual_texture_feedback_shader_filepath);
+  }
+  // The driver compiles the programs while the textures are loaded, and they
+  // are finished before the rendering loop.
+  wvu::ShaderProgramBatch program_batch(program_binary_cache.get());
+  if (!FLAGS_virtual_texture_filepath.empty()) {
+    program_batch.Add(&feedback_shader_program);
+  }
+  program_batch.Submit();
+  // The camera and the object are passed to all the programs through uniform
+  // buffers bound to fixed binding points.
+  wvu::UniformBuffer camera_buffer(wvu::CameraBlockLayout());
+  wvu::UniformBuffer object_buffer(wvu::ObjectBlockLayout());
+  if (!camera_buffer.Create(wvu::kCameraBlockBinding) ||
+      !object_buffer.Create(wvu::kObjectBlockBinding)) {
     return -1;
   }
 
@@ -588,11 +917,196 @@ int main(int argc, char** argv) {
               Eigen::Vector3f(0, 0, 0),  // Position of object.
               vertices,
               indices);
+  // With an atlas, the model samples the sub-rectangle of its image in the
+  // page that holds it, so models with different images share the texture.
+  // The levels of the page above the max mip level of the atlas would bleed
+  // the neighboring images into it, so they are not cooked.
+  std::string texture_filepath = FLAGS_texture_filepath;
+  int atlas_max_mip_level = -1;
+  if (!FLAGS_texture_atlas_manifest.empty()) {
+    if (!FLAGS_texture_region.empty()) {
+      std::cerr << "ERROR: A texture region cannot be loaded from a texture "
+                << "atlas.\n";
+      return -1;
+    }
+    wvu::TextureAtlas atlas;
+    if (!wvu::ReadTextureAtlasManifest(FLAGS_texture_atlas_manifest,
+                                       &atlas)) {
+      std::cerr << "ERROR: Could not read the texture atlas.\n";
+      return -1;
+    }
+    const wvu::TextureAtlasEntry* atlas_entry =
+        atlas.FindEntry(FLAGS_texture_filepath);
+    if (atlas_entry == nullptr) {
+      std::cerr << "ERROR: The texture is not in the texture atlas.\n";
+      return -1;
+    }
+    RemapModelTexcoords(atlas, *atlas_entry, &model);
+    texture_filepath = atlas.page_filepaths[atlas_entry->page];
+    atlas_max_mip_level = atlas.max_mip_level;
+  }
   SetVertexArrayObject(model,
                        &vertex_buffer_object_id,
                        &vertex_array_object_id,
                        &element_buffer_object_id);
-  const GLuint texture_id = LoadTexture(FLAGS_texture_filepath);
+  // Load the texture. With decoding threads the texture is loaded in the
+  // background and a placeholder is rendered until it is ready.
+  // The textures are transferred through a ring of pixel buffer objects.
+  GLuint texture_id = 0;
+  std::unique_ptr<wvu::TextureUploader> texture_uploader;
+  if (FLAGS_texture_upload_slots > 0) {
+    wvu::TextureUploader::Options texture_uploader_options;
+    texture_uploader_options.num_slots = FLAGS_texture_upload_slots;
+    texture_uploader_options.slot_size_in_bytes =
+        FLAGS_texture_upload_slot_bytes;
+    texture_uploader.reset(
+        new wvu::TextureUploader(texture_uploader_options));
+  }
+  // Textures are compressed only if the GPU can sample the compressed format.
+  wvu::TextureCookingOptions cooking_options;
+  if (!ParseTextureCookingOptions(&cooking_options)) {
+    return -1;
+  }
+  cooking_options.max_mip_level = atlas_max_mip_level;
+  if (!GpuSupportsTextureCompression(cooking_options.compression)) {
+    std::cerr << "WARNING: The GPU does not support the texture compression "
+              << FLAGS_texture_compression << "; the textures are not "
+              << "compressed.\n";
+    cooking_options.compression = wvu::TEXTURE_COMPRESSION_NONE;
+  }
+  // Cooked textures are kept on disk across runs.
+  std::unique_ptr<wvu::TextureCache> texture_cache;
+  if (!FLAGS_texture_cache_directory.empty()) {
+    wvu::TextureCache::Options texture_cache_options;
+    if (FLAGS_texture_cache_supercompression == "zstd") {
+      texture_cache_options.supercompression = wvu::SUPERCOMPRESSION_ZSTD;
+    } else if (FLAGS_texture_cache_supercompression == "lz4") {
+      texture_cache_options.supercompression = wvu::SUPERCOMPRESSION_LZ4;
+    } else if (FLAGS_texture_cache_supercompression != "none") {
+      std::cerr << "ERROR: Unknown texture cache supercompression "
+                << FLAGS_texture_cache_supercompression << "\n";
+      return -1;
+    }
+    texture_cache.reset(new wvu::TextureCache(FLAGS_texture_cache_directory,
+                                              texture_cache_options));
+  }
+  // The driver only has a linear box filter, cannot cache nor compress the
+  // textures, and generates the complete mip chain.
+  const bool gpu_mipmaps = FLAGS_texture_mip_filter == "gpu" &&
+      !FLAGS_texture_srgb_mipmaps && FLAGS_texture_alpha_coverage <= 0.0 &&
+      !texture_cache && atlas_max_mip_level < 0 &&
+      cooking_options.compression == wvu::TEXTURE_COMPRESSION_NONE;
+  // With a memory budget, the residency manager owns the textures.
+  std::unique_ptr<wvu::TextureResidencyManager> texture_manager;
+  std::unique_ptr<wvu::VirtualTexture> virtual_texture;
+  std::unique_ptr<wvu::AsyncTextureLoader> texture_loader;
+  std::unique_ptr<wvu::TextureRegistry> texture_registry;
+  wvu::SharedTextureHandle shared_texture;
+  wvu::TextureHandle texture_handle = 0;
+  if (!FLAGS_virtual_texture_filepath.empty()) {
+    virtual_texture.reset(
+        new wvu::VirtualTexture(wvu::VirtualTexture::Options()));
+    if (!virtual_texture->Open(FLAGS_virtual_texture_filepath)) {
+      std::cerr << "ERROR: Could not open the virtual texture.\n";
+      return -1;
+    }
+    texture_id = virtual_texture->physical_texture_id();
+  } else if (!FLAGS_texture_region.empty()) {
+    shared_texture = LoadTextureRegion(texture_filepath, FLAGS_texture_region,
+                                       FLAGS_texture_region_level);
+    if (!shared_texture) {
+      std::cerr << "ERROR: Could not load the texture region.\n";
+      return -1;
+    }
+    texture_id = shared_texture->texture_id();
+  } else if (wvu::IsHdrImageFormat(
+                 wvu::IdentifyImageFormat(texture_filepath))) {
+    // Floating-point images are neither cooked nor cached; they are converted
+    // into half floats and their mip chain is generated by the GPU, or
+    // compressed into BC6H with a mip chain filtered on the CPU.
+    shared_texture = LoadFloatTexture(texture_filepath, cooking_options,
+                                      texture_uploader.get());
+    if (!shared_texture) {
+      std::cerr << "ERROR: Could not load the HDR texture.\n";
+      return -1;
+    }
+    texture_id = shared_texture->texture_id();
+  } else if (FLAGS_texture_memory_budget_mb > 0) {
+    wvu::TextureResidencyManager::Options texture_manager_options;
+    texture_manager_options.budget_bytes =
+        static_cast<size_t>(FLAGS_texture_memory_budget_mb) << 20;
+    texture_manager_options.max_pooled_staging_bytes = kMaxPooledStagingBytes;
+    texture_manager_options.texture_uploader = texture_uploader.get();
+    texture_manager_options.texture_cache = texture_cache.get();
+    texture_manager_options.cooking_options = cooking_options;
+    texture_manager.reset(
+        new wvu::TextureResidencyManager(texture_manager_options));
+    texture_handle = texture_manager->Add(texture_filepath);
+    if (!texture_manager->texture_id(texture_handle)) {
+      std::cerr << "ERROR: Could not load the texture.\n";
+      return -1;
+    }
+  } else if (FLAGS_texture_decode_threads > 0) {
+    wvu::AsyncTextureLoader::Options texture_loader_options;
+    texture_loader_options.num_decode_threads = FLAGS_texture_decode_threads;
+    texture_loader_options.upload_budget_bytes =
+        FLAGS_texture_upload_budget_bytes;
+    texture_loader_options.max_pooled_staging_bytes = kMaxPooledStagingBytes;
+    texture_loader_options.texture_uploader = texture_uploader.get();
+    texture_loader_options.texture_cache = texture_cache.get();
+    texture_loader_options.cooking_options = cooking_options;
+    texture_loader.reset(new wvu::AsyncTextureLoader(texture_loader_options));
+    texture_handle = texture_loader->Load(texture_filepath);
+  } else {
+    // Textures loaded from the same file, or from files with the same
+    // texels, share the GL texture.
+    wvu::TextureRegistry::Options texture_registry_options;
+    texture_registry_options.max_pooled_staging_bytes = kMaxPooledStagingBytes;
+    texture_registry_options.texture_uploader = texture_uploader.get();
+    texture_registry_options.texture_cache = texture_cache.get();
+    texture_registry_options.cooking_options = cooking_options;
+    texture_registry_options.gpu_mipmaps = gpu_mipmaps;
+    texture_registry_options.mutable_storage = FLAGS_texture_hot_reload;
+    texture_registry.reset(new wvu::TextureRegistry(texture_registry_options));
+    shared_texture = texture_registry->Load(texture_filepath);
+    if (!shared_texture) {
+      std::cerr << "ERROR: Could not load the texture.\n";
+      return -1;
+    }
+    texture_id = shared_texture->texture_id();
+  }
+
+  // The texture object is kept and its texels replaced when the file changes.
+  std::unique_ptr<wvu::TextureHotReloader> texture_reloader;
+  if (FLAGS_texture_hot_reload) {
+    if (texture_registry) {
+      wvu::TextureHotReloader::Options texture_reloader_options;
+      texture_reloader_options.texture_uploader = texture_uploader.get();
+      texture_reloader_options.texture_cache = texture_cache.get();
+      texture_reloader_options.cooking_options = cooking_options;
+      texture_reloader_options.gpu_mipmaps = gpu_mipmaps;
+      texture_reloader.reset(
+          new wvu::TextureHotReloader(texture_reloader_options));
+      texture_reloader->Watch(texture_filepath, texture_id);
+    } else {
+      std::cerr << "WARNING: The texture is only reloaded when it is loaded "
+                << "before the rendering loop.\n";
+    }
+  }
+
+  // The programs were compiling since they were submitted.
+  wvu::ShaderProgram* shader_program = shader_variants.Get(shader_features);
+  if (shader_program == nullptr || !program_batch.Wait()) {
+    std::cerr << "ERROR: Could not create the shader programs.\n";
+    return -1;
+  }
+  if (!BindSharedUniformBlocks(camera_buffer, object_buffer,
+                               shader_program) ||
+      (virtual_texture &&
+       !BindSharedUniformBlocks(camera_buffer, object_buffer,
+                                &feedback_shader_program))) {
+    return -1;
+  }
 
   // Create projection matrix.
   const GLfloat field_of_view = 45.0f;
@@ -600,6 +1114,10 @@ int main(int argc, char** argv) {
   const Eigen::Matrix4f projection_matrix = 
       ComputeProjectionMatrix(field_of_view, aspect_ratio, 0.1, 10);
   std::cout << projection_matrix << std::endl;
+  const Eigen::Matrix4f view_matrix = Eigen::Matrix4f::Identity();
+  const Eigen::Matrix4f view_projection_matrix =
+      projection_matrix * view_matrix;
+  const Eigen::Vector4f camera_position(0.0f, 0.0f, 0.0f, 1.0f);
   GLfloat angle = 0.0f;  // State of rotation.
 
   // Loop until the user closes the window.
@@ -609,8 +1127,45 @@ int main(int argc, char** argv) {
     // Casting using (<type>) -- which is the C way -- is not recommended.
     // Instead, use static_cast<type>(input argument).
     angle = rotation_speed * static_cast<GLfloat>(glfwGetTime()) * M_PI / 180.f;
-    RenderScene(shader_program, vertex_array_object_id, 
-                projection_matrix, angle, texture_id, window);
+    // The variants of the manifest are finished as they become ready.
+    shader_variants.Poll(1);
+    // Transfer the textures decoded in the background, within the budget.
+    if (texture_loader) {
+      texture_loader->ProcessUploads();
+      texture_id = texture_loader->texture_id(texture_handle);
+    }
+    // Edited textures are replaced once they are decoded in the background.
+    if (texture_reloader) {
+      texture_reloader->ProcessReloads();
+    }
+    // Bound textures are restored if they were degraded or evicted.
+    if (texture_manager) {
+      texture_manager->BeginFrame();
+      texture_id = texture_manager->Bind(texture_handle);
+    }
+    // The camera is shared by the programs, so it is uploaded once per frame,
+    // and only when it moves.
+    camera_buffer.SetMatrix4f(wvu::CAMERA_VIEW, view_matrix.data());
+    camera_buffer.SetMatrix4f(wvu::CAMERA_PROJECTION, projection_matrix.data());
+    camera_buffer.SetMatrix4f(wvu::CAMERA_VIEW_PROJECTION,
+                              view_projection_matrix.data());
+    camera_buffer.SetVector(wvu::CAMERA_POSITION, camera_position.data());
+    camera_buffer.Upload();
+    // The feedback of the previous frames requests the pages of this one.
+    if (virtual_texture) {
+      int framebuffer_width, framebuffer_height;
+      glfwGetFramebufferSize(window, &framebuffer_width, &framebuffer_height);
+      virtual_texture->SetUniforms(&feedback_shader_program, true);
+      virtual_texture->BeginFeedback(framebuffer_width, framebuffer_height);
+      RenderScene(feedback_shader_program, vertex_array_object_id,
+                  view_projection_matrix, angle, 0, &object_buffer, window);
+      virtual_texture->EndFeedback();
+      virtual_texture->Update();
+      virtual_texture->SetUniforms(shader_program, false);
+    }
+    RenderScene(*shader_program, vertex_array_object_id,
+                view_projection_matrix, angle, texture_id, &object_buffer,
+                window);
 
     // Swap front and back buffers.
     glfwSwapBuffers(window);
@@ -622,6 +1177,75 @@ int main(int argc, char** argv) {
   // Cleaning up tasks.
   glDeleteVertexArrays(1, &vertex_array_object_id);
   glDeleteBuffers(1, &vertex_buffer_object_id);
+  // The loader, the manager, the virtual texture and the last handle of a
+  // shared texture delete their textures, so they need the OpenGL context.
+  texture_loader.reset();
+  if (texture_reloader) {
+    const wvu::TextureHotReloader::Statistics& statistics =
+        texture_reloader->statistics();
+    LOG(INFO) << "Texture reloads: " << statistics.num_reloads << " ("
+              << statistics.num_reallocations << " reallocated), "
+              << statistics.num_failures << " failed.";
+    texture_reloader.reset();
+  }
+  shared_texture.reset();
+  if (virtual_texture) {
+    const wvu::VirtualTexture::Statistics statistics =
+        virtual_texture->statistics();
+    LOG(INFO) << "Virtual texture: " << statistics.num_resident_pages
+              << " pages resident, " << statistics.num_requested_pages
+              << " requested, " << statistics.num_uploaded_pages
+              << " uploaded, " << statistics.num_evicted_pages
+              << " evicted, " << statistics.num_dropped_pages << " dropped.";
+    virtual_texture.reset();
+  }
+  texture_registry.reset();
+  if (texture_manager) {
+    const wvu::TextureResidencyManager::Statistics statistics =
+        texture_manager->statistics();
+    LOG(INFO) << "Texture memory: " << statistics.resident_bytes << " of "
+              << statistics.budget_bytes << " bytes resident (peak "
+              << statistics.peak_resident_bytes << "), "
+              << statistics.num_dropped_levels << " levels dropped, "
+              << statistics.num_evictions << " evictions, "
+              << statistics.num_restores << " restores.";
+    texture_manager.reset();
+  }
+  if (texture_uploader) {
+    const wvu::TextureUploader::Statistics& statistics =
+        texture_uploader->statistics();
+    LOG(INFO) << "Texture uploads: " << statistics.num_transferred_bytes
+              << " bytes at " << statistics.megabytes_per_second()
+              << " MB/s, " << statistics.num_stalls << " stalls ("
+              << 1000.0 * statistics.stall_seconds << " ms).";
+    texture_uploader.reset();
+  }
+  if (program_binary_cache) {
+    LOG(INFO) << "Program binary cache: " << program_binary_cache->num_hits()
+              << " hits, " << program_binary_cache->num_misses()
+              << " misses (" << program_binary_cache->num_rejected()
+              << " rejected by the driver); "
+              << program_binary_cache->saved_milliseconds()
+              << " ms of compilation saved.";
+  }
+  if (texture_cache) {
+    LOG(INFO) << "Texture cache: " << texture_cache->num_hits() << " hits, "
+              << texture_cache->num_misses() << " misses.";
+  }
+  const wvu::ShaderVariantCache::Statistics& variant_statistics =
+      shader_variants.statistics();
+  LOG(INFO) << "Shader variants: " << variant_statistics.num_variants
+            << " created (" << variant_statistics.num_compiled_on_demand
+            << " on demand), " << variant_statistics.num_failed
+            << " failed, " << variant_statistics.compile_milliseconds
+            << " ms spent creating them (slowest "
+            << variant_statistics.max_compile_milliseconds << " ms).";
+  if (!FLAGS_shader_variant_manifest.empty()) {
+    shader_variants.WriteManifest(FLAGS_shader_variant_manifest);
+  }
+  LOG(INFO) << "Uniform buffers: " << camera_buffer.num_uploads()
+            << " camera uploads, " << object_buffer.num_uploads()
+            << " object uploads.";
   // Destroy window.
   glfwDestroyWindow(window);
   // Tear down GLFW library.
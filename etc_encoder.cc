@@ -0,0 +1,1020 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "etc_encoder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace wvu {
+namespace {
+// Number of texels per block.
+constexpr int kNumBlockTexels = 16;
+
+// Intensity modifiers of the sub-block modes: index 0 adds the first value,
+// 1 adds the second, 2 subtracts the first and 3 subtracts the second.
+constexpr int kIntensityTables[8][2] = {
+  { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 },
+  { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+};
+
+// Distances between the paint colors of the T and H modes.
+constexpr int kPaintDistances[8] = { 3, 6, 11, 16, 23, 32, 41, 64 };
+
+// Offsets of the EAC blocks, multiplied by the multiplier of the block.
+constexpr int kEacModifiers[16][8] = {
+  { -3, -6, -9, -15, 2, 5, 8, 14 },
+  { -3, -7, -10, -13, 2, 6, 9, 12 },
+  { -2, -5, -8, -13, 1, 4, 7, 12 },
+  { -2, -4, -6, -13, 1, 3, 5, 12 },
+  { -3, -6, -8, -12, 2, 5, 7, 11 },
+  { -3, -7, -9, -11, 2, 6, 8, 10 },
+  { -4, -7, -8, -11, 3, 6, 7, 10 },
+  { -3, -5, -8, -11, 2, 4, 7, 10 },
+  { -2, -6, -8, -10, 1, 5, 7, 9 },
+  { -2, -5, -8, -10, 1, 4, 7, 9 },
+  { -2, -4, -8, -10, 1, 3, 7, 9 },
+  { -2, -5, -7, -10, 1, 4, 6, 9 },
+  { -3, -4, -7, -10, 2, 3, 6, 9 },
+  { -1, -2, -3, -10, 0, 1, 2, 9 },
+  { -4, -6, -8, -9, 3, 5, 7, 8 },
+  { -3, -5, -7, -9, 2, 4, 6, 8 }
+};
+
+// Texels of the sub-blocks, in row-major order, for the two values of the flip
+// bit: side by side 2x4 sub-blocks, or 4x2 sub-blocks on top of each other.
+constexpr int kSubblockTexels[2][2][8] = {
+  { { 0, 1, 4, 5, 8, 9, 12, 13 }, { 2, 3, 6, 7, 10, 11, 14, 15 } },
+  { { 0, 1, 2, 3, 4, 5, 6, 7 }, { 8, 9, 10, 11, 12, 13, 14, 15 } }
+};
+
+inline int Clamp(const int value, const int minimum, const int maximum) {
+  return std::min(std::max(value, minimum), maximum);
+}
+
+// Expands a channel of the given number of bits to 8 bits.
+inline int Expand(const int value, const int num_bits) {
+  return (value << (8 - num_bits)) | (value >> (2 * num_bits - 8));
+}
+
+// Quantizes an 8-bit channel to the given number of bits.
+inline int Quantize(const float value, const int num_bits) {
+  const int maximum = (1 << num_bits) - 1;
+  return Clamp(static_cast<int>(value * maximum / 255.0f + 0.5f), 0, maximum);
+}
+
+// Returns the 3-bit two's complement value.
+inline int SignExtend3(const int value) {
+  return value >= 4 ? value - 8 : value;
+}
+
+// Position of a texel, in row-major order, in the indices of the blocks, which
+// are in column-major order.
+inline int IndexPosition(const int texel) {
+  return 4 * (texel & 3) + (texel >> 2);
+}
+
+inline int ColorDistance(const int a[4], const int b[3]) {
+  const int dr = a[0] - b[0];
+  const int dg = a[1] - b[1];
+  const int db = a[2] - b[2];
+  return dr * dr + dg * dg + db * db;
+}
+
+// Writes the bits of a block from its most significant byte.
+void StoreBits(const uint64_t bits, unsigned char* output) {
+  for (int i = 0; i < 8; ++i) {
+    output[i] = static_cast<unsigned char>(bits >> (56 - 8 * i));
+  }
+}
+
+uint64_t LoadBits(const unsigned char* input) {
+  uint64_t bits = 0;
+  for (int i = 0; i < 8; ++i) {
+    bits = (bits << 8) | input[i];
+  }
+  return bits;
+}
+
+// The texels of a block.
+struct Block {
+  int texels[kNumBlockTexels][4];
+};
+
+void LoadBlock(const unsigned char* rgba,
+               const int width,
+               const int height,
+               const int block_x,
+               const int block_y,
+               Block* block) {
+  for (int y = 0; y < 4; ++y) {
+    const int image_y = std::min(4 * block_y + y, height - 1);
+    for (int x = 0; x < 4; ++x) {
+      const int image_x = std::min(4 * block_x + x, width - 1);
+      const unsigned char* texel =
+          rgba + 4 * (static_cast<size_t>(image_y) * width + image_x);
+      for (int c = 0; c < 4; ++c) {
+        block->texels[4 * y + x][c] = texel[c];
+      }
+    }
+  }
+}
+
+// Packs the 2-bit indices of the texels into the low 32 bits of a color
+// block: the most significant bits first, then the least significant ones.
+uint64_t PackColorIndices(const int indices[kNumBlockTexels]) {
+  uint64_t bits = 0;
+  for (int i = 0; i < kNumBlockTexels; ++i) {
+    const int position = IndexPosition(i);
+    bits |= static_cast<uint64_t>(indices[i] >> 1) << (16 + position);
+    bits |= static_cast<uint64_t>(indices[i] & 1) << position;
+  }
+  return bits;
+}
+
+inline int ColorIndex(const uint64_t bits, const int texel) {
+  const int position = IndexPosition(texel);
+  return static_cast<int>(((bits >> (16 + position)) & 1) << 1 |
+                          ((bits >> position) & 1));
+}
+
+// -------------------- ETC2 color: sub-block modes ----------------------------
+// An encoded color block and its squared error.
+struct ColorFit {
+  uint64_t bits;
+  int error;
+};
+
+// Finds the intensity table and the indices of the texels of a sub-block for
+// the base color. Returns the squared error.
+int FitSubblockTable(const Block& block,
+                     const int texels[8],
+                     const int base[3],
+                     int* table,
+                     int indices[8]) {
+  int best_error = INT_MAX;
+  for (int t = 0; t < 8; ++t) {
+    int error = 0;
+    int table_indices[8];
+    for (int i = 0; i < 8 && error < best_error; ++i) {
+      int best_distance = INT_MAX;
+      for (int index = 0; index < 4; ++index) {
+        const int modifier = (index & 2 ? -1 : 1) *
+            kIntensityTables[t][index & 1];
+        const int color[3] = {
+          Clamp(base[0] + modifier, 0, 255),
+          Clamp(base[1] + modifier, 0, 255),
+          Clamp(base[2] + modifier, 0, 255)
+        };
+        const int distance = ColorDistance(block.texels[texels[i]], color);
+        if (distance < best_distance) {
+          best_distance = distance;
+          table_indices[i] = index;
+        }
+      }
+      error += best_distance;
+    }
+    if (error < best_error) {
+      best_error = error;
+      *table = t;
+      std::copy(table_indices, table_indices + 8, indices);
+    }
+  }
+  return best_error;
+}
+
+// The base color of a sub-block and its fit.
+struct SubblockFit {
+  int base[3];
+  int table;
+  int indices[8];
+  int error;
+};
+
+// Finds the base color of a sub-block, quantized to the given number of bits
+// and within the bounds. The high quality also searches the colors around the
+// average of the sub-block.
+void FitSubblock(const Block& block,
+                 const int texels[8],
+                 const int num_bits,
+                 const int lower[3],
+                 const int upper[3],
+                 const BcQuality quality,
+                 SubblockFit* fit) {
+  int center[3];
+  for (int c = 0; c < 3; ++c) {
+    float sum = 0.0f;
+    for (int i = 0; i < 8; ++i) {
+      sum += block.texels[texels[i]][c];
+    }
+    center[c] = Clamp(Quantize(sum / 8.0f, num_bits), lower[c], upper[c]);
+  }
+  const int radius = quality == BC_QUALITY_HIGH ? 1 : 0;
+  fit->error = INT_MAX;
+  for (int dr = -radius; dr <= radius; ++dr) {
+    for (int dg = -radius; dg <= radius; ++dg) {
+      for (int db = -radius; db <= radius; ++db) {
+        const int candidate[3] = {
+          Clamp(center[0] + dr, lower[0], upper[0]),
+          Clamp(center[1] + dg, lower[1], upper[1]),
+          Clamp(center[2] + db, lower[2], upper[2])
+        };
+        const int base[3] = {
+          Expand(candidate[0], num_bits),
+          Expand(candidate[1], num_bits),
+          Expand(candidate[2], num_bits)
+        };
+        int table = 0;
+        int indices[8];
+        const int error =
+            FitSubblockTable(block, texels, base, &table, indices);
+        if (error < fit->error) {
+          std::copy(candidate, candidate + 3, fit->base);
+          fit->table = table;
+          std::copy(indices, indices + 8, fit->indices);
+          fit->error = error;
+        }
+      }
+    }
+  }
+}
+
+// Returns the indices of the texels of the block from those of its
+// sub-blocks.
+uint64_t PackSubblockIndices(const int flip, const SubblockFit fits[2]) {
+  int indices[kNumBlockTexels];
+  for (int s = 0; s < 2; ++s) {
+    for (int i = 0; i < 8; ++i) {
+      indices[kSubblockTexels[flip][s][i]] = fits[s].indices[i];
+    }
+  }
+  return PackColorIndices(indices);
+}
+
+// Encodes the block with two sub-blocks, either with individual 4-bit base
+// colors or with a 5-bit base color and a 3-bit difference.
+void FitSubblockModes(const Block& block,
+                      const BcQuality quality,
+                      ColorFit* best) {
+  const int lower[3] = { 0, 0, 0 };
+  const int upper4[3] = { 15, 15, 15 };
+  const int upper5[3] = { 31, 31, 31 };
+  for (int flip = 0; flip < 2; ++flip) {
+    SubblockFit fits[2];
+    FitSubblock(block, kSubblockTexels[flip][0], 4, lower, upper4, quality,
+                &fits[0]);
+    FitSubblock(block, kSubblockTexels[flip][1], 4, lower, upper4, quality,
+                &fits[1]);
+    if (fits[0].error + fits[1].error < best->error) {
+      best->error = fits[0].error + fits[1].error;
+      best->bits = static_cast<uint64_t>(fits[0].base[0]) << 60 |
+          static_cast<uint64_t>(fits[1].base[0]) << 56 |
+          static_cast<uint64_t>(fits[0].base[1]) << 52 |
+          static_cast<uint64_t>(fits[1].base[1]) << 48 |
+          static_cast<uint64_t>(fits[0].base[2]) << 44 |
+          static_cast<uint64_t>(fits[1].base[2]) << 40 |
+          static_cast<uint64_t>(fits[0].table) << 37 |
+          static_cast<uint64_t>(fits[1].table) << 34 |
+          static_cast<uint64_t>(flip) << 32 |
+          PackSubblockIndices(flip, fits);
+    }
+    // The base color of the second sub-block must be within the difference
+    // range of the first one.
+    FitSubblock(block, kSubblockTexels[flip][0], 5, lower, upper5, quality,
+                &fits[0]);
+    int difference_lower[3], difference_upper[3];
+    for (int c = 0; c < 3; ++c) {
+      difference_lower[c] = std::max(fits[0].base[c] - 4, 0);
+      difference_upper[c] = std::min(fits[0].base[c] + 3, 31);
+    }
+    FitSubblock(block, kSubblockTexels[flip][1], 5, difference_lower,
+                difference_upper, quality, &fits[1]);
+    if (fits[0].error + fits[1].error < best->error) {
+      best->error = fits[0].error + fits[1].error;
+      uint64_t bits = static_cast<uint64_t>(1) << 33 |
+          static_cast<uint64_t>(fits[0].table) << 37 |
+          static_cast<uint64_t>(fits[1].table) << 34 |
+          static_cast<uint64_t>(flip) << 32 |
+          PackSubblockIndices(flip, fits);
+      for (int c = 0; c < 3; ++c) {
+        const int difference = fits[1].base[c] - fits[0].base[c];
+        bits |= static_cast<uint64_t>(fits[0].base[c]) << (59 - 8 * c);
+        bits |= static_cast<uint64_t>(difference & 7) << (56 - 8 * c);
+      }
+      best->bits = bits;
+    }
+  }
+}
+
+// -------------------- ETC2 color: planar mode --------------------------------
+// Returns the value of a channel of the plane at the texel.
+inline int PlaneValue(const int origin,
+                      const int horizontal,
+                      const int vertical,
+                      const int x,
+                      const int y) {
+  return Clamp((x * (horizontal - origin) + y * (vertical - origin) +
+                4 * origin + 2) >> 2, 0, 255);
+}
+
+float Determinant(const float m[3][3]) {
+  return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+      m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+      m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+}
+
+// Returns the squared error of a channel of the plane given its quantized
+// origin, horizontal and vertical values.
+int PlaneChannelError(const Block& block,
+                      const int channel,
+                      const int num_bits[3],
+                      const int quantized[3]) {
+  const int origin = Expand(quantized[0], num_bits[0]);
+  const int horizontal = Expand(quantized[1], num_bits[1]);
+  const int vertical = Expand(quantized[2], num_bits[2]);
+  int error = 0;
+  for (int i = 0; i < kNumBlockTexels; ++i) {
+    const int difference = block.texels[i][channel] -
+        PlaneValue(origin, horizontal, vertical, i & 3, i >> 2);
+    error += difference * difference;
+  }
+  return error;
+}
+
+// Encodes the block as a plane: the colors at the origin, at x = 4 and at
+// y = 4, which are fit by least squares to the texels.
+void FitPlanarMode(const Block& block,
+                   const BcQuality quality,
+                   ColorFit* best) {
+  // The value at (x, y) weights the origin, horizontal and vertical colors by
+  // 1 - x / 4 - y / 4, x / 4 and y / 4. Solve the normal equations.
+  float normal[3][3] = {{ 0.0f }};
+  float rhs[3][3] = {{ 0.0f }};
+  for (int i = 0; i < kNumBlockTexels; ++i) {
+    const float x = (i & 3) / 4.0f;
+    const float y = (i >> 2) / 4.0f;
+    const float weights[3] = { 1.0f - x - y, x, y };
+    for (int row = 0; row < 3; ++row) {
+      for (int col = 0; col < 3; ++col) {
+        normal[row][col] += weights[row] * weights[col];
+      }
+      for (int c = 0; c < 3; ++c) {
+        rhs[c][row] += weights[row] * block.texels[i][c];
+      }
+    }
+  }
+  const float determinant = Determinant(normal);
+  // Bits of the origin, horizontal and vertical values of every channel.
+  const int kNumBits[3][3] = { { 6, 6, 6 }, { 7, 7, 7 }, { 6, 6, 6 } };
+  int quantized[3][3];
+  int error = 0;
+  for (int c = 0; c < 3; ++c) {
+    // Cramer's rule.
+    for (int k = 0; k < 3; ++k) {
+      float matrix[3][3];
+      for (int row = 0; row < 3; ++row) {
+        for (int col = 0; col < 3; ++col) {
+          matrix[row][col] = col == k ? rhs[c][row] : normal[row][col];
+        }
+      }
+      const float value = Determinant(matrix) / determinant;
+      quantized[c][k] = Quantize(std::min(std::max(value, 0.0f), 255.0f),
+                                 kNumBits[c][k]);
+    }
+    int channel_error = PlaneChannelError(block, c, kNumBits[c], quantized[c]);
+    // The channels are independent, so they are refined one by one.
+    for (int pass = 0; quality == BC_QUALITY_HIGH && pass < 4; ++pass) {
+      bool improved = false;
+      for (int k = 0; k < 3; ++k) {
+        for (const int step : { -1, 1 }) {
+          int candidate[3] = { quantized[c][0], quantized[c][1],
+                               quantized[c][2] };
+          candidate[k] += step;
+          if (candidate[k] < 0 || candidate[k] >= (1 << kNumBits[c][k])) {
+            continue;
+          }
+          const int candidate_error =
+              PlaneChannelError(block, c, kNumBits[c], candidate);
+          if (candidate_error < channel_error) {
+            channel_error = candidate_error;
+            std::copy(candidate, candidate + 3, quantized[c]);
+            improved = true;
+          }
+        }
+      }
+      if (!improved) {
+        break;
+      }
+    }
+    error += channel_error;
+  }
+  if (error >= best->error) {
+    return;
+  }
+  const int ro = quantized[0][0], rh = quantized[0][1], rv = quantized[0][2];
+  const int go = quantized[1][0], gh = quantized[1][1], gv = quantized[1][2];
+  const int bo = quantized[2][0], bh = quantized[2][1], bv = quantized[2][2];
+  uint64_t bits = static_cast<uint64_t>(ro) << 57 |
+      static_cast<uint64_t>(go >> 6) << 56 |
+      static_cast<uint64_t>(go & 63) << 49 |
+      static_cast<uint64_t>(bo >> 5) << 48 |
+      static_cast<uint64_t>((bo >> 3) & 3) << 43 |
+      static_cast<uint64_t>(bo & 7) << 39 |
+      static_cast<uint64_t>(rh >> 1) << 34 |
+      static_cast<uint64_t>(1) << 33 |
+      static_cast<uint64_t>(rh & 1) << 32 |
+      static_cast<uint64_t>(gh) << 25 |
+      static_cast<uint64_t>(bh) << 19 |
+      static_cast<uint64_t>(rv) << 13 |
+      static_cast<uint64_t>(gv) << 6 |
+      static_cast<uint64_t>(bv);
+  // The mode is signaled by a red and green sum in range and a blue sum out
+  // of range in the differential layout; the unused bits are set to get them.
+  if ((ro >> 2) + SignExtend3(((ro & 3) << 1) | (go >> 6)) < 0) {
+    bits |= static_cast<uint64_t>(1) << 63;
+  }
+  if (((go >> 2) & 15) + SignExtend3(((go & 3) << 1) | (bo >> 5)) < 0) {
+    bits |= static_cast<uint64_t>(1) << 55;
+  }
+  if (((bo >> 3) & 3) + ((bo >> 1) & 3) >= 4) {
+    bits |= static_cast<uint64_t>(7) << 45;
+  } else {
+    bits |= static_cast<uint64_t>(1) << 42;
+  }
+  best->bits = bits;
+  best->error = error;
+}
+
+// -------------------- ETC2 color: T and H modes ------------------------------
+// Returns the squared error of the block with the nearest paint colors.
+int FitPaintColors(const Block& block,
+                   const int paint[4][3],
+                   int indices[kNumBlockTexels]) {
+  int error = 0;
+  for (int i = 0; i < kNumBlockTexels; ++i) {
+    int best_distance = INT_MAX;
+    for (int k = 0; k < 4; ++k) {
+      const int distance = ColorDistance(block.texels[i], paint[k]);
+      if (distance < best_distance) {
+        best_distance = distance;
+        indices[i] = k;
+      }
+    }
+    error += best_distance;
+  }
+  return error;
+}
+
+// Splits the texels of the block into two clusters by k-means and returns
+// their mean colors.
+void ClusterBlock(const Block& block, float means[2][3]) {
+  // Start from the darkest and the brightest texels.
+  int darkest = 0, brightest = 0;
+  for (int i = 1; i < kNumBlockTexels; ++i) {
+    const int* texel = block.texels[i];
+    const int luma = texel[0] + texel[1] + texel[2];
+    if (luma < block.texels[darkest][0] + block.texels[darkest][1] +
+        block.texels[darkest][2]) {
+      darkest = i;
+    }
+    if (luma > block.texels[brightest][0] + block.texels[brightest][1] +
+        block.texels[brightest][2]) {
+      brightest = i;
+    }
+  }
+  for (int c = 0; c < 3; ++c) {
+    means[0][c] = block.texels[darkest][c];
+    means[1][c] = block.texels[brightest][c];
+  }
+  for (int iteration = 0; iteration < 4; ++iteration) {
+    float sums[2][3] = {{ 0.0f }};
+    int counts[2] = { 0, 0 };
+    for (int i = 0; i < kNumBlockTexels; ++i) {
+      float distances[2] = { 0.0f, 0.0f };
+      for (int k = 0; k < 2; ++k) {
+        for (int c = 0; c < 3; ++c) {
+          const float difference = block.texels[i][c] - means[k][c];
+          distances[k] += difference * difference;
+        }
+      }
+      const int k = distances[1] < distances[0] ? 1 : 0;
+      ++counts[k];
+      for (int c = 0; c < 3; ++c) {
+        sums[k][c] += block.texels[i][c];
+      }
+    }
+    for (int k = 0; k < 2; ++k) {
+      for (int c = 0; c < 3 && counts[k] > 0; ++c) {
+        means[k][c] = sums[k][c] / counts[k];
+      }
+    }
+  }
+}
+
+// Encodes the block with paint colors derived from two 4-bit base colors:
+// either one base color plus the other one and its two shifts (T mode), or
+// the two shifts of both base colors (H mode).
+void FitPaintModes(const Block& block, ColorFit* best) {
+  float means[2][3];
+  ClusterBlock(block, means);
+  int colors[2][3];
+  int expanded[2][3];
+  for (int k = 0; k < 2; ++k) {
+    for (int c = 0; c < 3; ++c) {
+      colors[k][c] = Quantize(means[k][c], 4);
+      expanded[k][c] = Expand(colors[k][c], 4);
+    }
+  }
+  int indices[kNumBlockTexels];
+  // T mode; either cluster can be the single color.
+  for (int single = 0; single < 2; ++single) {
+    const int* c1 = colors[single];
+    const int* c2 = colors[1 - single];
+    const int* e1 = expanded[single];
+    const int* e2 = expanded[1 - single];
+    for (int d = 0; d < 8; ++d) {
+      const int distance = kPaintDistances[d];
+      int paint[4][3];
+      for (int c = 0; c < 3; ++c) {
+        paint[0][c] = e1[c];
+        paint[1][c] = Clamp(e2[c] + distance, 0, 255);
+        paint[2][c] = e2[c];
+        paint[3][c] = Clamp(e2[c] - distance, 0, 255);
+      }
+      const int error = FitPaintColors(block, paint, indices);
+      if (error >= best->error) {
+        continue;
+      }
+      const int r1a = c1[0] >> 2, r1b = c1[0] & 3;
+      uint64_t bits = static_cast<uint64_t>(r1a) << 59 |
+          static_cast<uint64_t>(r1b) << 56 |
+          static_cast<uint64_t>(c1[1]) << 52 |
+          static_cast<uint64_t>(c1[2]) << 48 |
+          static_cast<uint64_t>(c2[0]) << 44 |
+          static_cast<uint64_t>(c2[1]) << 40 |
+          static_cast<uint64_t>(c2[2]) << 36 |
+          static_cast<uint64_t>(d >> 1) << 34 |
+          static_cast<uint64_t>(1) << 33 |
+          static_cast<uint64_t>(d & 1) << 32 |
+          PackColorIndices(indices);
+      // The mode is signaled by a red sum out of range.
+      if (r1a + r1b >= 4) {
+        bits |= static_cast<uint64_t>(7) << 61;
+      } else {
+        bits |= static_cast<uint64_t>(1) << 58;
+      }
+      best->bits = bits;
+      best->error = error;
+    }
+  }
+  // H mode. The order of the base colors is the lowest bit of the distance.
+  for (int d = 0; d < 8; ++d) {
+    int first = 0;
+    const int value0 = (colors[0][0] << 8) | (colors[0][1] << 4) | colors[0][2];
+    const int value1 = (colors[1][0] << 8) | (colors[1][1] << 4) | colors[1][2];
+    if ((value0 >= value1) != ((d & 1) == 1)) {
+      first = 1;
+    }
+    if (value0 == value1 && (d & 1) == 0) {
+      continue;
+    }
+    const int* c1 = colors[first];
+    const int* c2 = colors[1 - first];
+    const int* e1 = expanded[first];
+    const int* e2 = expanded[1 - first];
+    const int distance = kPaintDistances[d];
+    int paint[4][3];
+    for (int c = 0; c < 3; ++c) {
+      paint[0][c] = Clamp(e1[c] + distance, 0, 255);
+      paint[1][c] = Clamp(e1[c] - distance, 0, 255);
+      paint[2][c] = Clamp(e2[c] + distance, 0, 255);
+      paint[3][c] = Clamp(e2[c] - distance, 0, 255);
+    }
+    const int error = FitPaintColors(block, paint, indices);
+    if (error >= best->error) {
+      continue;
+    }
+    uint64_t bits = static_cast<uint64_t>(c1[0]) << 59 |
+        static_cast<uint64_t>(c1[1] >> 1) << 56 |
+        static_cast<uint64_t>(c1[1] & 1) << 52 |
+        static_cast<uint64_t>(c1[2] >> 3) << 51 |
+        static_cast<uint64_t>(c1[2] & 7) << 47 |
+        static_cast<uint64_t>(c2[0]) << 43 |
+        static_cast<uint64_t>(c2[1]) << 39 |
+        static_cast<uint64_t>(c2[2]) << 35 |
+        static_cast<uint64_t>(d >> 2) << 34 |
+        static_cast<uint64_t>(1) << 33 |
+        static_cast<uint64_t>((d >> 1) & 1) << 32 |
+        PackColorIndices(indices);
+    // The mode is signaled by a red sum in range and a green sum out of range.
+    if (c1[0] + SignExtend3(c1[1] >> 1) < 0) {
+      bits |= static_cast<uint64_t>(1) << 63;
+    }
+    if ((((c1[1] & 1) << 1) | (c1[2] >> 3)) + ((c1[2] & 7) >> 1) >= 4) {
+      bits |= static_cast<uint64_t>(7) << 53;
+    } else {
+      bits |= static_cast<uint64_t>(1) << 50;
+    }
+    best->bits = bits;
+    best->error = error;
+  }
+}
+
+void EncodeColorBlock(const Block& block,
+                      const BcQuality quality,
+                      unsigned char* output) {
+  ColorFit best;
+  best.bits = 0;
+  best.error = INT_MAX;
+  FitSubblockModes(block, quality, &best);
+  if (quality != BC_QUALITY_FAST && best.error > 0) {
+    FitPlanarMode(block, quality, &best);
+  }
+  if (quality == BC_QUALITY_HIGH && best.error > 0) {
+    FitPaintModes(block, &best);
+  }
+  StoreBits(best.bits, output);
+}
+
+void DecodeColorBlock(const unsigned char* input,
+                      unsigned char texels[kNumBlockTexels][4]) {
+  const uint64_t bits = LoadBits(input);
+  auto field = [bits](const int shift, const int num_bits) {
+    return static_cast<int>((bits >> shift) & ((1u << num_bits) - 1));
+  };
+  int colors[kNumBlockTexels][3];
+  const int r = field(59, 5), dr = SignExtend3(field(56, 3));
+  const int g = field(51, 5), dg = SignExtend3(field(48, 3));
+  const int b = field(43, 5), db = SignExtend3(field(40, 3));
+  const bool differential = field(33, 1) == 1;
+  if (differential && (r + dr < 0 || r + dr > 31 || g + dg < 0 ||
+                       g + dg > 31)) {
+    // T or H mode.
+    const bool t_mode = r + dr < 0 || r + dr > 31;
+    int c1[3], c2[3], d;
+    if (t_mode) {
+      c1[0] = Expand((field(59, 2) << 2) | field(56, 2), 4);
+      c1[1] = Expand(field(52, 4), 4);
+      c1[2] = Expand(field(48, 4), 4);
+      c2[0] = Expand(field(44, 4), 4);
+      c2[1] = Expand(field(40, 4), 4);
+      c2[2] = Expand(field(36, 4), 4);
+      d = kPaintDistances[(field(34, 2) << 1) | field(32, 1)];
+    } else {
+      const int r1 = field(59, 4);
+      const int g1 = (field(56, 3) << 1) | field(52, 1);
+      const int b1 = (field(51, 1) << 3) | field(47, 3);
+      const int r2 = field(43, 4), g2 = field(39, 4), b2 = field(35, 4);
+      const int order =
+          ((r1 << 8) | (g1 << 4) | b1) >= ((r2 << 8) | (g2 << 4) | b2) ? 1 : 0;
+      c1[0] = Expand(r1, 4);
+      c1[1] = Expand(g1, 4);
+      c1[2] = Expand(b1, 4);
+      c2[0] = Expand(r2, 4);
+      c2[1] = Expand(g2, 4);
+      c2[2] = Expand(b2, 4);
+      d = kPaintDistances[(field(34, 1) << 2) | (field(32, 1) << 1) | order];
+    }
+    int paint[4][3];
+    for (int c = 0; c < 3; ++c) {
+      if (t_mode) {
+        paint[0][c] = c1[c];
+        paint[1][c] = Clamp(c2[c] + d, 0, 255);
+        paint[2][c] = c2[c];
+        paint[3][c] = Clamp(c2[c] - d, 0, 255);
+      } else {
+        paint[0][c] = Clamp(c1[c] + d, 0, 255);
+        paint[1][c] = Clamp(c1[c] - d, 0, 255);
+        paint[2][c] = Clamp(c2[c] + d, 0, 255);
+        paint[3][c] = Clamp(c2[c] - d, 0, 255);
+      }
+    }
+    for (int i = 0; i < kNumBlockTexels; ++i) {
+      std::copy(paint[ColorIndex(bits, i)], paint[ColorIndex(bits, i)] + 3,
+                colors[i]);
+    }
+  } else if (differential && (b + db < 0 || b + db > 31)) {
+    // Planar mode.
+    const int origin[3] = {
+      Expand(field(57, 6), 6),
+      Expand((field(56, 1) << 6) | field(49, 6), 7),
+      Expand((field(48, 1) << 5) | (field(43, 2) << 3) | field(39, 3), 6)
+    };
+    const int horizontal[3] = {
+      Expand((field(34, 5) << 1) | field(32, 1), 6),
+      Expand(field(25, 7), 7),
+      Expand(field(19, 6), 6)
+    };
+    const int vertical[3] = {
+      Expand(field(13, 6), 6), Expand(field(6, 7), 7), Expand(field(0, 6), 6)
+    };
+    for (int i = 0; i < kNumBlockTexels; ++i) {
+      for (int c = 0; c < 3; ++c) {
+        colors[i][c] = PlaneValue(origin[c], horizontal[c], vertical[c],
+                                  i & 3, i >> 2);
+      }
+    }
+  } else {
+    // Individual or differential sub-block mode.
+    int bases[2][3];
+    if (differential) {
+      const int base5[3] = { r, g, b };
+      const int differences[3] = { dr, dg, db };
+      for (int c = 0; c < 3; ++c) {
+        bases[0][c] = Expand(base5[c], 5);
+        bases[1][c] = Expand(base5[c] + differences[c], 5);
+      }
+    } else {
+      for (int c = 0; c < 3; ++c) {
+        bases[0][c] = Expand(field(60 - 8 * c, 4), 4);
+        bases[1][c] = Expand(field(56 - 8 * c, 4), 4);
+      }
+    }
+    const int tables[2] = { field(37, 3), field(34, 3) };
+    const int flip = field(32, 1);
+    for (int i = 0; i < kNumBlockTexels; ++i) {
+      const int s = flip ? (i >> 2) >= 2 : (i & 3) >= 2;
+      const int index = ColorIndex(bits, i);
+      const int modifier =
+          (index & 2 ? -1 : 1) * kIntensityTables[tables[s]][index & 1];
+      for (int c = 0; c < 3; ++c) {
+        colors[i][c] = Clamp(bases[s][c] + modifier, 0, 255);
+      }
+    }
+  }
+  for (int i = 0; i < kNumBlockTexels; ++i) {
+    for (int c = 0; c < 3; ++c) {
+      texels[i][c] = static_cast<unsigned char>(colors[i][c]);
+    }
+  }
+}
+
+// -------------------- EAC ----------------------------------------------------
+// Returns the value of an EAC texel: 8-bit for the alpha of ETC2 RGBA8
+// blocks, or 11-bit for the R11 and RG11 formats.
+inline int EacValue(const bool eleven_bits,
+                    const int base,
+                    const int multiplier,
+                    const int modifier) {
+  if (!eleven_bits) {
+    return Clamp(base + modifier * multiplier, 0, 255);
+  }
+  return Clamp(8 * base + 4 + modifier * (multiplier > 0 ? 8 * multiplier : 1),
+               0, 2047);
+}
+
+// Converts an 11-bit EAC value into the 8-bit value that it decodes to.
+inline int EacValueTo8Bits(const int value) {
+  return (value * 255 + 1023) / 2047;
+}
+
+// Encodes the channel of the block into an EAC block by searching the
+// tables, and the base values and multipliers around those that span the
+// range of the channel. The higher qualities search supersets of the
+// candidates of the lower ones. The error of 11-bit values is measured on
+// the 8-bit values they decode to, so that a higher quality never loses PSNR,
+// and ties are broken by the error of the 11-bit values.
+void EncodeEacBlock(const Block& block,
+                    const int channel,
+                    const bool eleven_bits,
+                    const BcQuality quality,
+                    unsigned char* output) {
+  int targets[kNumBlockTexels];
+  int eleven_bit_targets[kNumBlockTexels];
+  int minimum = INT_MAX, maximum = INT_MIN;
+  for (int i = 0; i < kNumBlockTexels; ++i) {
+    const int value = block.texels[i][channel];
+    targets[i] = value;
+    eleven_bit_targets[i] = (value * 2047 + 127) / 255;
+    minimum = std::min(minimum, value);
+    maximum = std::max(maximum, value);
+  }
+  const int multiplier_radius = quality == BC_QUALITY_FAST ? 0 : 1;
+  const int base_radius = quality == BC_QUALITY_FAST ? 0 :
+      (quality == BC_QUALITY_NORMAL ? 1 : 3);
+  // The error of the 8-bit values in the high 32 bits, and the error of the
+  // 11-bit values in the low 32 bits (at most 16 * 2047^2).
+  int64_t best_error = INT64_MAX;
+  uint64_t best_bits = 0;
+  for (int table = 0; table < 16 && best_error > 0; ++table) {
+    const int* modifiers = kEacModifiers[table];
+    const int span = modifiers[7] - modifiers[3];
+    const int center_multiplier = Clamp(
+        static_cast<int>(std::lround(static_cast<float>(maximum - minimum) /
+                                     span)), 1, 15);
+    for (int multiplier = std::max(center_multiplier - multiplier_radius, 1);
+         multiplier <= std::min(center_multiplier + multiplier_radius, 15);
+         ++multiplier) {
+      const int center_base = Clamp(static_cast<int>(std::lround(
+          0.5f * (minimum + maximum) -
+          0.5f * (modifiers[3] + modifiers[7]) * multiplier)), 0, 255);
+      for (int base = std::max(center_base - base_radius, 0);
+           base <= std::min(center_base + base_radius, 255); ++base) {
+        int values[8];
+        int decoded_values[8];
+        for (int k = 0; k < 8; ++k) {
+          values[k] = EacValue(eleven_bits, base, multiplier, modifiers[k]);
+          decoded_values[k] =
+              eleven_bits ? EacValueTo8Bits(values[k]) : values[k];
+        }
+        int64_t error = 0;
+        uint64_t bits = static_cast<uint64_t>(base) << 56 |
+            static_cast<uint64_t>(multiplier) << 52 |
+            static_cast<uint64_t>(table) << 48;
+        for (int i = 0; i < kNumBlockTexels && error < best_error; ++i) {
+          int64_t best_distance = INT64_MAX;
+          int best_index = 0;
+          for (int k = 0; k < 8; ++k) {
+            const int difference = decoded_values[k] - targets[i];
+            int64_t distance =
+                static_cast<int64_t>(difference * difference) << 32;
+            if (eleven_bits) {
+              const int eleven_bit_difference =
+                  values[k] - eleven_bit_targets[i];
+              distance += eleven_bit_difference * eleven_bit_difference;
+            }
+            if (distance < best_distance) {
+              best_distance = distance;
+              best_index = k;
+            }
+          }
+          error += best_distance;
+          bits |= static_cast<uint64_t>(best_index) <<
+              (45 - 3 * IndexPosition(i));
+        }
+        if (error < best_error) {
+          best_error = error;
+          best_bits = bits;
+        }
+      }
+    }
+  }
+  StoreBits(best_bits, output);
+}
+
+void DecodeEacBlock(const unsigned char* input,
+                    const int channel,
+                    const bool eleven_bits,
+                    unsigned char texels[kNumBlockTexels][4]) {
+  const uint64_t bits = LoadBits(input);
+  const int base = static_cast<int>(bits >> 56);
+  const int multiplier = static_cast<int>((bits >> 52) & 15);
+  const int* modifiers = kEacModifiers[(bits >> 48) & 15];
+  for (int i = 0; i < kNumBlockTexels; ++i) {
+    const int index =
+        static_cast<int>((bits >> (45 - 3 * IndexPosition(i))) & 7);
+    const int value =
+        EacValue(eleven_bits, base, multiplier, modifiers[index]);
+    texels[i][channel] = static_cast<unsigned char>(
+        eleven_bits ? EacValueTo8Bits(value) : value);
+  }
+}
+
+}  // namespace
+
+int EtcBlockSizeInBytes(const EtcFormat format) {
+  return format == ETC2_RGB8_FORMAT || format == EAC_R11_FORMAT ? 8 : 16;
+}
+
+size_t EtcCompressedSizeInBytes(const EtcFormat format,
+                                const int width,
+                                const int height) {
+  const size_t num_blocks_x = (width + 3) / 4;
+  const size_t num_blocks_y = (height + 3) / 4;
+  return num_blocks_x * num_blocks_y * EtcBlockSizeInBytes(format);
+}
+
+void EncodeEtc(const unsigned char* rgba,
+               const int width,
+               const int height,
+               const EtcFormat format,
+               const BcQuality quality,
+               const int num_threads,
+               unsigned char* blocks) {
+  const int num_blocks_x = (width + 3) / 4;
+  const int num_blocks_y = (height + 3) / 4;
+  const int block_size_in_bytes = EtcBlockSizeInBytes(format);
+  // The threads take rows of blocks until there are none left, which balances
+  // the work when some rows are slower to encode than others.
+  std::atomic<int> next_block_row(0);
+  auto encode_block_rows = [&]() {
+    Block block;
+    for (int block_y = next_block_row++; block_y < num_blocks_y;
+         block_y = next_block_row++) {
+      unsigned char* output = blocks +
+          static_cast<size_t>(block_y) * num_blocks_x * block_size_in_bytes;
+      for (int block_x = 0; block_x < num_blocks_x; ++block_x) {
+        LoadBlock(rgba, width, height, block_x, block_y, &block);
+        switch (format) {
+          case ETC2_RGBA8_FORMAT:
+            EncodeEacBlock(block, 3, false, quality, output);
+            EncodeColorBlock(block, quality, output + 8);
+            break;
+          case EAC_R11_FORMAT:
+            EncodeEacBlock(block, 0, true, quality, output);
+            break;
+          case EAC_RG11_FORMAT:
+            EncodeEacBlock(block, 0, true, quality, output);
+            EncodeEacBlock(block, 1, true, quality, output + 8);
+            break;
+          default:
+            EncodeColorBlock(block, quality, output);
+            break;
+        }
+        output += block_size_in_bytes;
+      }
+    }
+  };
+  const int max_num_threads = num_threads > 0 ?
+      num_threads : std::max(1u, std::thread::hardware_concurrency());
+  const int num_workers = std::min(max_num_threads, num_blocks_y) - 1;
+  std::vector<std::thread> workers;
+  for (int i = 0; i < num_workers; ++i) {
+    workers.emplace_back(encode_block_rows);
+  }
+  encode_block_rows();
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+}
+
+void DecodeEtc(const unsigned char* blocks,
+               const int width,
+               const int height,
+               const EtcFormat format,
+               unsigned char* rgba) {
+  const int num_blocks_x = (width + 3) / 4;
+  const int num_blocks_y = (height + 3) / 4;
+  unsigned char texels[kNumBlockTexels][4];
+  for (int block_y = 0; block_y < num_blocks_y; ++block_y) {
+    for (int block_x = 0; block_x < num_blocks_x; ++block_x) {
+      for (int i = 0; i < kNumBlockTexels; ++i) {
+        texels[i][0] = texels[i][1] = texels[i][2] = 0;
+        texels[i][3] = 255;
+      }
+      switch (format) {
+        case ETC2_RGBA8_FORMAT:
+          DecodeEacBlock(blocks, 3, false, texels);
+          DecodeColorBlock(blocks + 8, texels);
+          break;
+        case EAC_R11_FORMAT:
+          DecodeEacBlock(blocks, 0, true, texels);
+          break;
+        case EAC_RG11_FORMAT:
+          DecodeEacBlock(blocks, 0, true, texels);
+          DecodeEacBlock(blocks + 8, 1, true, texels);
+          break;
+        default:
+          DecodeColorBlock(blocks, texels);
+          break;
+      }
+      blocks += EtcBlockSizeInBytes(format);
+      for (int y = 0; y < 4 && 4 * block_y + y < height; ++y) {
+        for (int x = 0; x < 4 && 4 * block_x + x < width; ++x) {
+          unsigned char* texel = rgba +
+              4 * (static_cast<size_t>(4 * block_y + y) * width +
+                   4 * block_x + x);
+          std::copy(texels[4 * y + x], texels[4 * y + x] + 4, texel);
+        }
+      }
+    }
+  }
+}
+
+}  // namespace wvu
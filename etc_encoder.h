@@ -0,0 +1,111 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_ETC_ENCODER_H_
+#define GLUTILS_ETC_ENCODER_H_
+
+#include <cstddef>
+
+#include "bc_encoder.h"
+
+namespace wvu {
+// ETC2 and EAC formats, which are part of OpenGL 4.3 and OpenGL ES 3.0 and are
+// thus the portable compressed formats. As the BC formats, they store blocks of
+// 4x4 texels; every ETC2 color block chooses among several modes (two
+// sub-blocks with a base color and an intensity table, two or three paint
+// colors, or a color plane), and every EAC block stores a base value, a
+// multiplier and a table of offsets.
+enum EtcFormat {
+  // 8 bytes per block of RGB; the alpha is ignored
+  // (GL_COMPRESSED_RGB8_ETC2).
+  ETC2_RGB8_FORMAT = 0,
+  // 16 bytes per block: an EAC block for the alpha followed by an ETC2 block
+  // for RGB (GL_COMPRESSED_RGBA8_ETC2_EAC).
+  ETC2_RGBA8_FORMAT = 1,
+  // 8 bytes per block: an EAC block of 11-bit precision for the red channel
+  // (GL_COMPRESSED_R11_EAC).
+  EAC_R11_FORMAT = 2,
+  // 16 bytes per block: EAC blocks for the red and green channels, e.g., for
+  // normal maps (GL_COMPRESSED_RG11_EAC).
+  EAC_RG11_FORMAT = 3
+};
+
+// Returns the number of bytes of a block of the format.
+int EtcBlockSizeInBytes(const EtcFormat format);
+
+// Returns the number of bytes of an image of the given size in the format.
+size_t EtcCompressedSizeInBytes(const EtcFormat format,
+                                const int width,
+                                const int height);
+
+// Encodes an RGBA8 image into blocks. The rows of blocks are split among
+// threads. The fast quality only uses the sub-block modes with the average
+// colors of the sub-blocks; the normal quality adds the planar mode, which
+// suits smooth gradients; the high quality also searches the colors around
+// the averages and the modes with paint colors (T and H). Images whose size is
+// not a multiple of 4 repeat their last row and column in the border blocks.
+// Parameters:
+//   rgba  The RGBA8 image.
+//   width, height  The size of the image.
+//   format  The format of the blocks.
+//   quality  The quality of the encoding.
+//   num_threads  The number of threads; 0 uses one thread per core.
+//   blocks  The buffer that holds EtcCompressedSizeInBytes() bytes. The
+//     blocks are stored in row-major order.
+void EncodeEtc(const unsigned char* rgba,
+               const int width,
+               const int height,
+               const EtcFormat format,
+               const BcQuality quality,
+               const int num_threads,
+               unsigned char* blocks);
+
+// Decodes the blocks into an RGBA8 image, as the GPU does when the texture is
+// read back as unsigned bytes: the channels that the format does not store are
+// zero, and the alpha is 255. Useful to verify the encoder and to measure its
+// quality.
+// Parameters:
+//   blocks  The blocks of the image.
+//   width, height  The size of the image.
+//   format  The format of the blocks.
+//   rgba  The buffer that holds the 4 * width * height bytes of the image.
+void DecodeEtc(const unsigned char* blocks,
+               const int width,
+               const int height,
+               const EtcFormat format,
+               unsigned char* rgba);
+
+}  // namespace wvu
+
+#endif  // GLUTILS_ETC_ENCODER_H_
@@ -0,0 +1,136 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+
+#include "etc_encoder.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "image_metrics.h"
+
+namespace wvu {
+namespace {
+// The image is not a multiple of the block size, so the border blocks repeat
+// their last row and column.
+constexpr int kWidth = 67;
+constexpr int kHeight = 45;
+
+// Returns an RGBA8 image of low-contrast gradients with noise, whose blocks
+// span a few values, where the rounding of the 11-bit values matters.
+std::vector<unsigned char> MakeLowContrastImage() {
+  std::vector<unsigned char> rgba(4 * kWidth * kHeight);
+  std::mt19937 random_engine(7);
+  std::uniform_int_distribution<int> noise(-3, 3);
+  for (int y = 0; y < kHeight; ++y) {
+    for (int x = 0; x < kWidth; ++x) {
+      unsigned char* texel = &rgba[4 * (y * kWidth + x)];
+      texel[0] = std::min(std::max(x + noise(random_engine), 0), 255);
+      texel[1] = std::min(std::max(200 - y + noise(random_engine), 0), 255);
+      texel[2] = x + y;
+      texel[3] = 255;
+    }
+  }
+  return rgba;
+}
+
+// Encodes the image, decodes the blocks and returns the PSNR of the decoded
+// image in dB over the first num_channels channels.
+double EncodeDecodePsnr(const std::vector<unsigned char>& rgba,
+                        const EtcFormat format,
+                        const BcQuality quality,
+                        const int num_channels) {
+  std::vector<unsigned char> blocks(
+      EtcCompressedSizeInBytes(format, kWidth, kHeight));
+  EncodeEtc(rgba.data(), kWidth, kHeight, format, quality, 1, blocks.data());
+  std::vector<unsigned char> decoded(rgba.size());
+  DecodeEtc(blocks.data(), kWidth, kHeight, format, decoded.data());
+  return ComputePsnr(rgba.data(), decoded.data(), kWidth * kHeight,
+                     num_channels);
+}
+
+TEST(EtcEncoderTest, HigherEacQualityDoesNotLosePsnr) {
+  const std::vector<unsigned char> rgba = MakeLowContrastImage();
+  for (const EtcFormat format : { EAC_R11_FORMAT, EAC_RG11_FORMAT }) {
+    const int num_channels = format == EAC_R11_FORMAT ? 1 : 2;
+    const double fast_psnr =
+        EncodeDecodePsnr(rgba, format, BC_QUALITY_FAST, num_channels);
+    const double normal_psnr =
+        EncodeDecodePsnr(rgba, format, BC_QUALITY_NORMAL, num_channels);
+    const double high_psnr =
+        EncodeDecodePsnr(rgba, format, BC_QUALITY_HIGH, num_channels);
+    EXPECT_GT(fast_psnr, 40.0) << "format " << format;
+    EXPECT_GE(normal_psnr, fast_psnr) << "format " << format;
+    EXPECT_GE(high_psnr, normal_psnr) << "format " << format;
+  }
+}
+
+TEST(EtcEncoderTest, HigherEacQualityDoesNotLoseAnyBlock) {
+  // Random blocks of a few values around random levels.
+  std::mt19937 random_engine(11);
+  std::uniform_int_distribution<int> level(0, 255);
+  std::uniform_int_distribution<int> offset(-4, 4);
+  for (int trial = 0; trial < 2000; ++trial) {
+    std::vector<unsigned char> rgba(4 * 16, 255);
+    const int block_level = level(random_engine);
+    for (int i = 0; i < 16; ++i) {
+      rgba[4 * i] = std::min(std::max(block_level + offset(random_engine), 0),
+                             255);
+    }
+    int previous_error = -1;
+    for (const BcQuality quality :
+         { BC_QUALITY_FAST, BC_QUALITY_NORMAL, BC_QUALITY_HIGH }) {
+      unsigned char block[8];
+      EncodeEtc(rgba.data(), 4, 4, EAC_R11_FORMAT, quality, 1, block);
+      std::vector<unsigned char> decoded(rgba.size());
+      DecodeEtc(block, 4, 4, EAC_R11_FORMAT, decoded.data());
+      int error = 0;
+      for (int i = 0; i < 16; ++i) {
+        const int difference = decoded[4 * i] - rgba[4 * i];
+        error += difference * difference;
+      }
+      if (previous_error >= 0) {
+        ASSERT_LE(error, previous_error)
+            << "trial " << trial << " quality " << quality;
+      }
+      previous_error = error;
+    }
+  }
+}
+
+}  // namespace
+}  // namespace wvu
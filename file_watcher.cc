@@ -0,0 +1,151 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "file_watcher.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glog/logging.h>
+
+namespace wvu {
+namespace {
+// Splits the filepath into its directory and its name.
+void SplitFilepath(const std::string& filepath,
+                   std::string* directory,
+                   std::string* name) {
+  const size_t separator = filepath.find_last_of('/');
+  if (separator == std::string::npos) {
+    *directory = ".";
+    *name = filepath;
+  } else {
+    *directory = separator == 0 ? "/" : filepath.substr(0, separator);
+    *name = filepath.substr(separator + 1);
+  }
+}
+
+}  // namespace
+
+FileWatcher::FileWatcher() : inotify_(-1) {
+#ifdef __linux__
+  inotify_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_ == -1) {
+    LOG(ERROR) << "Could not initialize inotify: " << std::strerror(errno);
+  }
+#endif  // __linux__
+}
+
+FileWatcher::~FileWatcher() {
+#ifdef __linux__
+  if (inotify_ != -1) {
+    close(inotify_);
+  }
+#endif  // __linux__
+}
+
+bool FileWatcher::Watch(const std::string& filepath) {
+#ifdef __linux__
+  if (inotify_ == -1) {
+    return false;
+  }
+  std::string directory, name;
+  SplitFilepath(filepath, &directory, &name);
+  if (directory_watches_.count(directory) == 0) {
+    const int watch = inotify_add_watch(inotify_, directory.c_str(),
+                                        IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (watch == -1) {
+      LOG(ERROR) << "Could not watch " << directory << ": "
+                 << std::strerror(errno);
+      return false;
+    }
+    directory_watches_[directory] = watch;
+    directories_[watch] = directory;
+  }
+  filepaths_[directory + "/" + name] = filepath;
+  return true;
+#else
+  LOG(WARNING) << "Could not watch " << filepath
+               << ": file watching needs inotify.";
+  return false;
+#endif  // __linux__
+}
+
+void FileWatcher::Poll(std::vector<std::string>* changed_filepaths) {
+#ifdef __linux__
+  if (inotify_ == -1) {
+    return;
+  }
+  const size_t num_previous_filepaths = changed_filepaths->size();
+  // The events are aligned like the struct that they start with.
+  alignas(struct inotify_event) char buffer[16384];
+  while (true) {
+    const ssize_t size = read(inotify_, buffer, sizeof(buffer));
+    if (size <= 0) {
+      // EAGAIN: no more events.
+      break;
+    }
+    ssize_t offset = 0;
+    while (offset < size) {
+      const struct inotify_event* event =
+          reinterpret_cast<const struct inotify_event*>(buffer + offset);
+      offset += sizeof(struct inotify_event) + event->len;
+      const auto directory = directories_.find(event->wd);
+      if (directory == directories_.end() || event->len == 0) {
+        continue;
+      }
+      const auto filepath =
+          filepaths_.find(directory->second + "/" + event->name);
+      if (filepath == filepaths_.end()) {
+        continue;
+      }
+      // A file saved several times is reported once.
+      if (std::find(changed_filepaths->begin() + num_previous_filepaths,
+                    changed_filepaths->end(), filepath->second) ==
+          changed_filepaths->end()) {
+        changed_filepaths->push_back(filepath->second);
+      }
+    }
+  }
+#endif  // __linux__
+}
+
+}  // namespace wvu
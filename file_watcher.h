@@ -0,0 +1,88 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_FILE_WATCHER_H_
+#define GLUTILS_FILE_WATCHER_H_
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace wvu {
+// This class reports the files that changed on disk with inotify. The
+// directories of the files are watched rather than the files themselves,
+// since editors often save a file by writing a new one and renaming it over
+// the old one, which replaces the inode that a watch on the file would follow.
+// A file is reported once it is closed after writing or moved into place, so
+// it is complete when it is reported. Polling never blocks. Without inotify
+// (non-Linux systems), Watch() fails.
+//
+// Example:
+//
+// wvu::FileWatcher watcher;
+// watcher.Watch("/path/to/texture.png");
+// while (...) {  // Rendering loop.
+//   std::vector<std::string> changed_filepaths;
+//   watcher.Poll(&changed_filepaths);
+//   ...
+// }
+class FileWatcher {
+ public:
+  FileWatcher();
+  ~FileWatcher();
+
+  // Starts watching the file. Returns true if successful, and false
+  // otherwise.
+  // Parameters:
+  //   filepath  The filepath of the file, which is also the one reported.
+  bool Watch(const std::string& filepath);
+
+  // Appends the watched files that changed since the last call, each once.
+  // Parameters:
+  //   changed_filepaths  The filepaths of the files that changed.
+  void Poll(std::vector<std::string>* changed_filepaths);
+
+ private:
+  // The inotify instance, or -1.
+  int inotify_;
+  // Watched directory of every watch descriptor and its watch descriptor.
+  std::unordered_map<int, std::string> directories_;
+  std::unordered_map<std::string, int> directory_watches_;
+  // Filepath given to Watch() for every watched directory/name pair.
+  std::unordered_map<std::string, std::string> filepaths_;
+};
+
+}  // namespace wvu
+
+#endif  // GLUTILS_FILE_WATCHER_H_
@@ -37,6 +37,11 @@
 // calculate the color of the pixel corresponding to a vertex. This is why we
 // declare a variable named color of type vec4 (4D vector) as its output. This
 // shader sets the output color to a (1.0, 0.5, 0.2, 1.0) using an RGBA format.
+// The features of the variants (see ShaderVariantCache) are defined after the
+// #version line:
+//   TEXTURE  Samples the texture; otherwise the surface is white.
+//   VERTEX_COLOR  Modulates the color with the color of the vertices.
+//   ALPHA_TEST  Discards the pixels whose alpha is below 0.5.
 
 #version 330 core
 
@@ -49,6 +54,17 @@ in vec2 texel;
 uniform sampler2D texture_sampler;
 
 void main() {
-  // color = vertex_color;
+#ifdef TEXTURE
   color = texture(texture_sampler, texel);
+#else
+  color = vec4(1.0f);
+#endif
+#ifdef VERTEX_COLOR
+  color *= vertex_color;
+#endif
+#ifdef ALPHA_TEST
+  if (color.a < 0.5f) {
+    discard;
+  }
+#endif
 }
@@ -0,0 +1,271 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "half_float.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "cpu_features.h"
+
+#ifdef GLUTILS_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace wvu {
+namespace {
+// Number of texels that RgbaFloatsToR11G11B10F() converts into half floats at
+// a time.
+constexpr size_t kPackChunkSize = 256;
+
+#ifdef GLUTILS_X86_SIMD
+// The F16C kernels convert eight values at a time and return the number of
+// converted values; the caller converts the tail.
+GLUTILS_TARGET_F16C
+size_t FloatsToHalvesF16C(const float* values,
+                          const size_t count,
+                          uint16_t* halves) {
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m256 floats = _mm256_loadu_ps(values + i);
+    const __m128i packed = _mm256_cvtps_ph(floats, _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(halves + i), packed);
+  }
+  return i;
+}
+
+GLUTILS_TARGET_F16C
+size_t HalvesToFloatsF16C(const uint16_t* halves,
+                          const size_t count,
+                          float* values) {
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m128i packed =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(halves + i));
+    _mm256_storeu_ps(values + i, _mm256_cvtph_ps(packed));
+  }
+  return i;
+}
+#endif
+
+// Rounds a half float to an unsigned float with a 5-bit exponent and the given
+// number of mantissa bits (6 for 11-bit floats and 5 for 10-bit floats).
+uint32_t HalfToUnsignedFloat(const uint16_t half, const int mantissa_bits) {
+  const int shift = 10 - mantissa_bits;
+  const uint32_t infinity = 0x1Fu << mantissa_bits;
+  if ((half & 0x7FFF) > 0x7C00) {
+    // NaNs keep a nonzero mantissa.
+    return infinity | 1;
+  }
+  if (half & 0x8000) {
+    return 0;
+  }
+  // Round to nearest even. The exponent and mantissa are contiguous, so a
+  // carry out of the mantissa increments the exponent. Infinity and the values
+  // that round to it are clamped to the largest finite value.
+  const uint32_t magnitude = half;
+  const uint32_t rounded =
+      (magnitude + (1u << (shift - 1)) - 1 + ((magnitude >> shift) & 1)) >>
+      shift;
+  return std::min(rounded, infinity - 1);
+}
+
+#ifdef GLUTILS_X86_SIMD
+// Packs RGBA half floats into R11G11B10F texels like HalfToUnsignedFloat(),
+// two texels at a time: every 32-bit lane holds a channel, so the channels
+// use their own shift and limits. Returns the number of packed texels; the
+// caller packs the tail.
+GLUTILS_TARGET_AVX2
+size_t HalvesToR11G11B10FAvx2(const uint16_t* halves,
+                              const size_t num_texels,
+                              uint32_t* packed) {
+  // The constants of the red, green, blue and alpha lanes. The alpha lanes
+  // are cleared by their zero limits.
+  const __m256i shifts = _mm256_setr_epi32(4, 4, 5, 0, 4, 4, 5, 0);
+  const __m256i round_biases = _mm256_setr_epi32(7, 7, 15, 0, 7, 7, 15, 0);
+  const __m256i max_values =
+      _mm256_setr_epi32(0x7BF, 0x7BF, 0x3DF, 0, 0x7BF, 0x7BF, 0x3DF, 0);
+  const __m256i nan_values =
+      _mm256_setr_epi32(0x7C1, 0x7C1, 0x3E1, 0, 0x7C1, 0x7C1, 0x3E1, 0);
+  const __m256i positions = _mm256_setr_epi32(0, 11, 22, 0, 0, 11, 22, 0);
+  const __m256i magnitude_mask = _mm256_set1_epi32(0x7FFF);
+  const __m256i infinity = _mm256_set1_epi32(0x7C00);
+  const __m256i one = _mm256_set1_epi32(1);
+  size_t i = 0;
+  for (; i + 2 <= num_texels; i += 2) {
+    const __m256i texels = _mm256_cvtepu16_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(halves + 4 * i)));
+    const __m256i is_nan = _mm256_cmpgt_epi32(
+        _mm256_and_si256(texels, magnitude_mask), infinity);
+    const __m256i is_negative = _mm256_cmpgt_epi32(texels, magnitude_mask);
+    // Round to nearest even, as HalfToUnsignedFloat() does.
+    const __m256i odd =
+        _mm256_and_si256(_mm256_srlv_epi32(texels, shifts), one);
+    __m256i values = _mm256_srlv_epi32(
+        _mm256_add_epi32(_mm256_add_epi32(texels, round_biases), odd), shifts);
+    values = _mm256_min_epu32(values, max_values);
+    values = _mm256_andnot_si256(is_negative, values);
+    values = _mm256_blendv_epi8(values, nan_values, is_nan);
+    // Merge the channels of every texel into its first lane.
+    values = _mm256_sllv_epi32(values, positions);
+    values = _mm256_or_si256(
+        values, _mm256_shuffle_epi32(values, _MM_SHUFFLE(2, 3, 0, 1)));
+    values = _mm256_or_si256(
+        values, _mm256_shuffle_epi32(values, _MM_SHUFFLE(1, 0, 3, 2)));
+    packed[i] = _mm256_extract_epi32(values, 0);
+    packed[i + 1] = _mm256_extract_epi32(values, 4);
+  }
+  return i;
+}
+#endif
+
+}  // namespace
+
+uint16_t FloatToHalf(const float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  const uint16_t sign = (bits >> 16) & 0x8000;
+  const uint32_t magnitude = bits & 0x7FFFFFFF;
+  if (magnitude >= 0x7F800000) {
+    // Infinity or NaN.
+    return sign | (magnitude > 0x7F800000 ? 0x7E00 : 0x7C00);
+  }
+  if (magnitude >= 0x477FF000) {
+    // Rounds beyond 65504, the largest half.
+    return sign | 0x7C00;
+  }
+  if (magnitude < 0x38800000) {
+    // Below 2^-14, the smallest normal half: the result is subnormal.
+    if (magnitude < 0x33000000) {
+      return sign;
+    }
+    const int exponent = magnitude >> 23;
+    const uint32_t mantissa = (magnitude & 0x7FFFFF) | 0x800000;
+    const int shift = 126 - exponent;
+    uint32_t half = mantissa >> shift;
+    const uint32_t remainder = mantissa & ((1u << shift) - 1);
+    const uint32_t halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (half & 1))) {
+      ++half;
+    }
+    return sign | static_cast<uint16_t>(half);
+  }
+  // Rebias the exponent from 127 to 15 and round the mantissa to nearest even.
+  uint32_t half = (magnitude - 0x38000000) >> 13;
+  const uint32_t remainder = magnitude & 0x1FFF;
+  if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+    ++half;
+  }
+  return sign | static_cast<uint16_t>(half);
+}
+
+float HalfToFloat(const uint16_t half) {
+  const uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+  int exponent = (half >> 10) & 0x1F;
+  uint32_t mantissa = half & 0x3FF;
+  uint32_t bits;
+  if (exponent == 0) {
+    if (mantissa == 0) {
+      bits = sign;
+    } else {
+      // Normalize the subnormal half.
+      exponent = 113;
+      while ((mantissa & 0x400) == 0) {
+        mantissa <<= 1;
+        --exponent;
+      }
+      bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+    }
+  } else if (exponent == 31) {
+    bits = sign | 0x7F800000 | (mantissa << 13);
+  } else {
+    bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  }
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+void FloatsToHalves(const float* values, const size_t count, uint16_t* halves) {
+  size_t i = 0;
+#ifdef GLUTILS_X86_SIMD
+  if (CpuSupportsF16C()) {
+    i = FloatsToHalvesF16C(values, count, halves);
+  }
+#endif
+  for (; i < count; ++i) {
+    halves[i] = FloatToHalf(values[i]);
+  }
+}
+
+void HalvesToFloats(const uint16_t* halves, const size_t count, float* values) {
+  size_t i = 0;
+#ifdef GLUTILS_X86_SIMD
+  if (CpuSupportsF16C()) {
+    i = HalvesToFloatsF16C(halves, count, values);
+  }
+#endif
+  for (; i < count; ++i) {
+    values[i] = HalfToFloat(halves[i]);
+  }
+}
+
+void RgbaFloatsToR11G11B10F(const float* rgba,
+                            const size_t num_texels,
+                            uint32_t* packed) {
+  // Converting into half floats first rounds twice, but the half floats have
+  // the same exponent range and more mantissa bits than the packed floats, and
+  // the F16C instructions make the first rounding cheap. The second rounding
+  // uses AVX2 when the CPU supports it.
+  uint16_t halves[4 * kPackChunkSize];
+  for (size_t begin = 0; begin < num_texels; begin += kPackChunkSize) {
+    const size_t chunk_size = std::min(kPackChunkSize, num_texels - begin);
+    FloatsToHalves(rgba + 4 * begin, 4 * chunk_size, halves);
+    size_t i = 0;
+#ifdef GLUTILS_X86_SIMD
+    if (GetSimdLevel() == SIMD_AVX2) {
+      i = HalvesToR11G11B10FAvx2(halves, chunk_size, packed + begin);
+    }
+#endif
+    for (; i < chunk_size; ++i) {
+      const uint16_t* texel = halves + 4 * i;
+      packed[begin + i] = HalfToUnsignedFloat(texel[0], 6) |
+          (HalfToUnsignedFloat(texel[1], 6) << 11) |
+          (HalfToUnsignedFloat(texel[2], 5) << 22);
+    }
+  }
+}
+
+}  // namespace wvu
@@ -0,0 +1,87 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_HALF_FLOAT_H_
+#define GLUTILS_HALF_FLOAT_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace wvu {
+// Converts a float into an IEEE 754 half-precision float (e.g., the texels of
+// GL_RGBA16F textures). Rounds to the nearest half; values beyond the range of
+// half floats become infinity.
+uint16_t FloatToHalf(const float value);
+
+// Converts a half-precision float into a float. The conversion is exact.
+float HalfToFloat(const uint16_t half);
+
+// Converts an array of floats into half floats. The conversion uses the F16C
+// instructions when the CPU supports them (see CpuSupportsF16C()) and matches
+// FloatToHalf() otherwise, except for the payload of NaNs.
+//
+// Parameters:
+//   values  The floats to convert.
+//   count  The number of floats.
+//   halves  The converted half floats. The array must hold count elements.
+void FloatsToHalves(const float* values, const size_t count, uint16_t* halves);
+
+// Converts an array of half floats into floats using the F16C instructions
+// when the CPU supports them. The conversion is exact.
+//
+// Parameters:
+//   halves  The half floats to convert.
+//   count  The number of half floats.
+//   values  The converted floats. The array must hold count elements.
+void HalvesToFloats(const uint16_t* halves, const size_t count, float* values);
+
+// Packs RGBA float texels into the texels of GL_R11F_G11F_B10F textures (i.e.,
+// the type GL_UNSIGNED_INT_10F_11F_11F_REV): red in the bits [0, 11), green in
+// [11, 22), and blue in [22, 32). The packed floats have no sign bit, so
+// negative values become zero; the alpha channel is dropped. Values that round
+// beyond the largest packed float (65024 for red and green, 64512 for blue),
+// including infinity, are clamped to it. The conversion uses the F16C and
+// AVX2 instructions when the CPU supports them, with the same results.
+//
+// Parameters:
+//   rgba  The RGBA texels, four floats per texel.
+//   num_texels  The number of texels.
+//   packed  The packed texels. The array must hold num_texels elements.
+void RgbaFloatsToR11G11B10F(const float* rgba,
+                            const size_t num_texels,
+                            uint32_t* packed);
+
+}  // namespace wvu
+
+#endif  // GLUTILS_HALF_FLOAT_H_
@@ -0,0 +1,60 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_HASH_H_
+#define GLUTILS_HASH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace wvu {
+// Computes the 64-bit hash of the bytes with the XXH64 algorithm. XXH64 hashes
+// several GB/s, so hashing the source of a texture is much cheaper than
+// decoding it. The hash is not cryptographic: it identifies content, it does
+// not authenticate it.
+// Parameters:
+//   data  The bytes to hash.
+//   num_bytes  The number of bytes.
+//   seed  The seed of the hash. Hashing with the hash of other data as seed
+//     combines both hashes.
+uint64_t Hash64(const void* data, const size_t num_bytes, const uint64_t seed);
+
+// Computes the 64-bit hash of the contents of the file. Returns true if
+// successful, and false otherwise.
+bool HashFile(const std::string& filepath, uint64_t* hash);
+
+}  // namespace wvu
+
+#endif  // GLUTILS_HASH_H_
@@ -0,0 +1,541 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "hdr_texture.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+#include <GL/glew.h>
+
+#include <glog/logging.h>
+
+#include "half_float.h"
+#include "mapped_file.h"
+#include "texture_format.h"
+
+namespace wvu {
+namespace {
+// Radiance scanlines between these widths may be run-length encoded.
+constexpr int kMinRadianceRleWidth = 8;
+constexpr int kMaxRadianceRleWidth = 0x7FFF;
+
+// Reads the bytes of a header sequentially.
+class HeaderParser {
+ public:
+  HeaderParser(const unsigned char* data, const size_t size) :
+      data_(data), size_(size), position_(0) {}
+
+  // Reads the next token delimited by whitespace.
+  std::string ReadToken() {
+    while (position_ < size_ && std::isspace(data_[position_])) {
+      ++position_;
+    }
+    std::string token;
+    while (position_ < size_ && !std::isspace(data_[position_])) {
+      token.push_back(static_cast<char>(data_[position_++]));
+    }
+    return token;
+  }
+
+  // Reads the rest of the line, without the newline.
+  std::string ReadLine() {
+    std::string line;
+    while (position_ < size_ && data_[position_] != '\n') {
+      line.push_back(static_cast<char>(data_[position_++]));
+    }
+    if (position_ < size_) {
+      ++position_;
+    }
+    return line;
+  }
+
+  // Skips a single whitespace character, i.e., the end of a PFM header.
+  void SkipWhitespace() {
+    if (position_ < size_ && std::isspace(data_[position_])) {
+      ++position_;
+    }
+  }
+
+  size_t position() const { return position_; }
+
+ private:
+  const unsigned char* data_;
+  const size_t size_;
+  size_t position_;
+};
+
+// Parses a positive integer. Returns false if the token is not one.
+bool ParseDimension(const std::string& token, int* value) {
+  char* end;
+  const long parsed = std::strtol(token.c_str(), &end, 10);
+  if (token.empty() || *end != '\0' || parsed <= 0 || parsed > (1 << 20)) {
+    return false;
+  }
+  *value = static_cast<int>(parsed);
+  return true;
+}
+
+bool HostIsLittleEndian() {
+  const uint16_t one = 1;
+  unsigned char first_byte;
+  std::memcpy(&first_byte, &one, 1);
+  return first_byte == 1;
+}
+
+// Loads a portable float map: a text header ("PF" or "Pf", the dimensions and
+// a scale whose sign gives the byte order) followed by the rows of floats from
+// bottom to top.
+bool LoadPfm(const MappedFile& file,
+             int* width,
+             int* height,
+             std::vector<float>* rgba) {
+  HeaderParser parser(file.data(), file.size());
+  const std::string magic = parser.ReadToken();
+  const int num_channels = magic == "PF" ? 3 : 1;
+  char* end;
+  if (!ParseDimension(parser.ReadToken(), width) ||
+      !ParseDimension(parser.ReadToken(), height)) {
+    LOG(ERROR) << "Invalid PFM dimensions.";
+    return false;
+  }
+  const std::string scale_token = parser.ReadToken();
+  const double scale = std::strtod(scale_token.c_str(), &end);
+  if (scale_token.empty() || *end != '\0' || scale == 0.0) {
+    LOG(ERROR) << "Invalid PFM scale.";
+    return false;
+  }
+  parser.SkipWhitespace();
+  const size_t num_texels = static_cast<size_t>(*width) * *height;
+  const size_t num_bytes = num_texels * num_channels * sizeof(float);
+  if (file.size() - parser.position() < num_bytes) {
+    LOG(ERROR) << "The PFM file is truncated.";
+    return false;
+  }
+  // A negative scale means little-endian floats.
+  const bool swap_bytes = (scale < 0.0) != HostIsLittleEndian();
+  const unsigned char* floats = file.data() + parser.position();
+  rgba->resize(4 * num_texels);
+  for (int y = 0; y < *height; ++y) {
+    const unsigned char* row = floats +
+        static_cast<size_t>(*height - 1 - y) * *width * num_channels *
+        sizeof(float);
+    float* output = rgba->data() + 4 * static_cast<size_t>(y) * *width;
+    for (int x = 0; x < *width; ++x) {
+      float values[3];
+      for (int c = 0; c < num_channels; ++c) {
+        unsigned char bytes[sizeof(float)];
+        std::memcpy(bytes, row + (x * num_channels + c) * sizeof(float),
+                    sizeof(float));
+        if (swap_bytes) {
+          std::swap(bytes[0], bytes[3]);
+          std::swap(bytes[1], bytes[2]);
+        }
+        std::memcpy(&values[c], bytes, sizeof(float));
+      }
+      output[4 * x + 0] = values[0];
+      output[4 * x + 1] = values[num_channels == 3 ? 1 : 0];
+      output[4 * x + 2] = values[num_channels == 3 ? 2 : 0];
+      output[4 * x + 3] = 1.0f;
+    }
+  }
+  return true;
+}
+
+// Decodes a Radiance scanline of RGBE texels. The scanline is either flat
+// (possibly with the old run-length encoding) or encoded with the adaptive
+// run-length encoding, one channel after the other. Returns false if the data
+// is corrupt.
+bool DecodeRadianceScanline(const unsigned char* data,
+                            const size_t size,
+                            const int width,
+                            size_t* position,
+                            unsigned char* rgbe) {
+  const unsigned char* bytes = data + *position;
+  if (size - *position < 4) {
+    return false;
+  }
+  const bool adaptive_rle = width >= kMinRadianceRleWidth &&
+      width <= kMaxRadianceRleWidth && bytes[0] == 2 && bytes[1] == 2 &&
+      (bytes[2] & 0x80) == 0;
+  if (!adaptive_rle) {
+    // Flat texels; a texel (1, 1, 1, n) repeats the previous texel, and
+    // consecutive repeats extend the count by 8 bits each.
+    int x = 0;
+    int shift = 0;
+    while (x < width) {
+      if (size - *position < 4) {
+        return false;
+      }
+      const unsigned char* texel = data + *position;
+      *position += 4;
+      if (texel[0] == 1 && texel[1] == 1 && texel[2] == 1) {
+        if (x == 0) {
+          return false;
+        }
+        const int count = texel[3] << shift;
+        if (count > width - x) {
+          return false;
+        }
+        for (int i = 0; i < count; ++i, ++x) {
+          std::memcpy(rgbe + 4 * x, rgbe + 4 * (x - 1), 4);
+        }
+        shift += 8;
+      } else {
+        std::memcpy(rgbe + 4 * x, texel, 4);
+        ++x;
+        shift = 0;
+      }
+    }
+    return true;
+  }
+  if (((bytes[2] << 8) | bytes[3]) != width) {
+    return false;
+  }
+  *position += 4;
+  for (int channel = 0; channel < 4; ++channel) {
+    int x = 0;
+    while (x < width) {
+      if (*position >= size) {
+        return false;
+      }
+      int count = data[(*position)++];
+      if (count > 128) {
+        // A run of a single value.
+        count -= 128;
+        if (count > width - x || *position >= size) {
+          return false;
+        }
+        const unsigned char value = data[(*position)++];
+        for (int i = 0; i < count; ++i, ++x) {
+          rgbe[4 * x + channel] = value;
+        }
+      } else {
+        // A run of literal values.
+        if (count == 0 || count > width - x ||
+            size - *position < static_cast<size_t>(count)) {
+          return false;
+        }
+        for (int i = 0; i < count; ++i, ++x) {
+          rgbe[4 * x + channel] = data[(*position)++];
+        }
+      }
+    }
+  }
+  return true;
+}
+
+// Loads a Radiance (RGBE) image: a text header terminated by an empty line, a
+// resolution line and the scanlines. Only the standard orientations (rows from
+// top to bottom or from bottom to top, columns from left to right) are
+// supported.
+bool LoadRadianceHdr(const MappedFile& file,
+                     int* width,
+                     int* height,
+                     std::vector<float>* rgba) {
+  HeaderParser parser(file.data(), file.size());
+  std::string line = parser.ReadLine();
+  while (!line.empty()) {
+    if (line.compare(0, 7, "FORMAT=") == 0 &&
+        line != "FORMAT=32-bit_rle_rgbe") {
+      LOG(ERROR) << "Unsupported Radiance format: " << line.substr(7);
+      return false;
+    }
+    if (parser.position() >= file.size()) {
+      LOG(ERROR) << "The Radiance header is truncated.";
+      return false;
+    }
+    line = parser.ReadLine();
+  }
+  const std::string y_axis = parser.ReadToken();
+  const std::string height_token = parser.ReadToken();
+  const std::string x_axis = parser.ReadToken();
+  const std::string width_token = parser.ReadToken();
+  if ((y_axis != "-Y" && y_axis != "+Y") || x_axis != "+X" ||
+      !ParseDimension(height_token, height) ||
+      !ParseDimension(width_token, width)) {
+    LOG(ERROR) << "Unsupported Radiance resolution.";
+    return false;
+  }
+  parser.ReadLine();
+  const bool bottom_up = y_axis == "+Y";
+  size_t position = parser.position();
+  std::vector<unsigned char> rgbe(4 * static_cast<size_t>(*width));
+  rgba->resize(4 * static_cast<size_t>(*width) * *height);
+  for (int i = 0; i < *height; ++i) {
+    if (!DecodeRadianceScanline(file.data(), file.size(), *width, &position,
+                                rgbe.data())) {
+      LOG(ERROR) << "Corrupt Radiance scanline " << i << ".";
+      return false;
+    }
+    const int y = bottom_up ? *height - 1 - i : i;
+    float* output = rgba->data() + 4 * static_cast<size_t>(y) * *width;
+    for (int x = 0; x < *width; ++x) {
+      const unsigned char* texel = rgbe.data() + 4 * x;
+      // The mantissas share the exponent e: value = m * 2^(e - 128 - 8).
+      const float scale = texel[3] == 0 ?
+          0.0f : static_cast<float>(std::ldexp(1.0, texel[3] - (128 + 8)));
+      output[4 * x + 0] = texel[0] * scale;
+      output[4 * x + 1] = texel[1] * scale;
+      output[4 * x + 2] = texel[2] * scale;
+      output[4 * x + 3] = 1.0f;
+    }
+  }
+  return true;
+}
+
+#ifdef cimg_use_openexr
+// Loads an OpenEXR image through CImg.
+bool LoadExr(const std::string& image_filepath,
+             int* width,
+             int* height,
+             std::vector<float>* rgba) {
+  cimg_library::CImg<float> image;
+  try {
+    image.load_exr(image_filepath.c_str());
+  } catch (const cimg_library::CImgException& exception) {
+    LOG(ERROR) << "Could not load " << image_filepath << ": "
+               << exception.what();
+    return false;
+  }
+  *width = image.width();
+  *height = image.height();
+  const int num_channels = image.spectrum();
+  rgba->resize(4 * static_cast<size_t>(*width) * *height);
+  for (int y = 0; y < *height; ++y) {
+    for (int x = 0; x < *width; ++x) {
+      float* texel = rgba->data() + 4 * (static_cast<size_t>(y) * *width + x);
+      for (int c = 0; c < 3; ++c) {
+        texel[c] = image(x, y, 0, num_channels >= 3 ? c : 0);
+      }
+      texel[3] = num_channels == 4 || num_channels == 2 ?
+          image(x, y, 0, num_channels - 1) : 1.0f;
+    }
+  }
+  return true;
+}
+#else
+// OpenEXR was not found when the library was configured.
+bool LoadExr(const std::string& image_filepath,
+             int* /* width */,
+             int* /* height */,
+             std::vector<float>* /* rgba */) {
+  LOG(ERROR) << "Loading " << image_filepath << " requires OpenEXR "
+             << "(GLUTILS_WITH_OPENEXR).";
+  return false;
+}
+#endif
+
+// Averages the texels of an RGBA float level into the next level of the mip
+// chain. The last row or column of odd dimensions is clamped.
+void DownsampleRgbaFloats(const float* source,
+                          const int source_width,
+                          const int source_height,
+                          float* rgba) {
+  const int width = std::max(source_width / 2, 1);
+  const int height = std::max(source_height / 2, 1);
+  for (int y = 0; y < height; ++y) {
+    const int y0 = std::min(2 * y, source_height - 1);
+    const int y1 = std::min(2 * y + 1, source_height - 1);
+    for (int x = 0; x < width; ++x) {
+      const int x0 = std::min(2 * x, source_width - 1);
+      const int x1 = std::min(2 * x + 1, source_width - 1);
+      for (int c = 0; c < 4; ++c) {
+        rgba[4 * (static_cast<size_t>(y) * width + x) + c] = 0.25f * (
+            source[4 * (static_cast<size_t>(y0) * source_width + x0) + c] +
+            source[4 * (static_cast<size_t>(y0) * source_width + x1) + c] +
+            source[4 * (static_cast<size_t>(y1) * source_width + x0) + c] +
+            source[4 * (static_cast<size_t>(y1) * source_width + x1) + c]);
+      }
+    }
+  }
+}
+
+}  // namespace
+
+void CookBc6hTexture(const float* rgba,
+                     const int width,
+                     const int height,
+                     const BptcEncodingOptions& options,
+                     CookedTexture* cooked) {
+  const int num_levels = ComputeNumMipLevels(width, height);
+  std::vector<CookedTexture::Level> levels(num_levels);
+  size_t size_in_bytes = 0;
+  for (int i = 0; i < num_levels; ++i) {
+    CookedTexture::Level& level = levels[i];
+    level.width = std::max(width >> i, 1);
+    level.height = std::max(height >> i, 1);
+    level.offset = size_in_bytes;
+    level.size_in_bytes = BptcCompressedSizeInBytes(level.width, level.height);
+    size_in_bytes += level.size_in_bytes;
+  }
+  StagingBuffer buffer(size_in_bytes);
+  // Every level is filtered from the previous one, so only two are kept.
+  std::vector<float> level_texels[2];
+  const float* texels = rgba;
+  for (int i = 0; i < num_levels; ++i) {
+    const CookedTexture::Level& level = levels[i];
+    if (i > 0) {
+      std::vector<float>& next_texels = level_texels[i % 2];
+      next_texels.resize(4 * static_cast<size_t>(level.width) * level.height);
+      DownsampleRgbaFloats(texels, levels[i - 1].width, levels[i - 1].height,
+                           next_texels.data());
+      texels = next_texels.data();
+    }
+    EncodeBc6h(texels, level.width, level.height, options,
+               buffer.data() + level.offset, nullptr);
+  }
+  cooked->Assign(GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT, 0, 0, levels,
+                 std::move(buffer));
+}
+
+bool IsHdrImageFormat(const ImageFormat format) {
+  return format == PFM_IMAGE_FORMAT || format == RADIANCE_HDR_IMAGE_FORMAT ||
+      format == EXR_IMAGE_FORMAT;
+}
+
+bool LoadHdrImageFromFile(const std::string& image_filepath,
+                          int* width,
+                          int* height,
+                          std::vector<float>* rgba) {
+  const ImageFormat format = IdentifyImageFormat(image_filepath);
+  if (format == EXR_IMAGE_FORMAT) {
+    return LoadExr(image_filepath, width, height, rgba);
+  }
+  if (format != PFM_IMAGE_FORMAT && format != RADIANCE_HDR_IMAGE_FORMAT) {
+    LOG(ERROR) << image_filepath << " is not a floating-point image.";
+    return false;
+  }
+  MappedFile file;
+  if (!file.Open(image_filepath)) {
+    LOG(ERROR) << "Could not open " << image_filepath;
+    return false;
+  }
+  const bool success = format == PFM_IMAGE_FORMAT ?
+      LoadPfm(file, width, height, rgba) :
+      LoadRadianceHdr(file, width, height, rgba);
+  if (!success) {
+    LOG(ERROR) << "Could not load " << image_filepath;
+  }
+  return success;
+}
+
+GLuint LoadHdrTexture(const std::string& image_filepath,
+                      const HdrTextureFormat format,
+                      const BptcEncodingOptions& bc6h_options,
+                      TextureUploader* texture_uploader,
+                      size_t* size_in_bytes) {
+  int width, height;
+  std::vector<float> rgba;
+  if (!LoadHdrImageFromFile(image_filepath, &width, &height, &rgba)) {
+    return 0;
+  }
+  if (format == HDR_TEXTURE_FORMAT_BC6H) {
+    if (!(GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc)) {
+      LOG(ERROR) << "BC6H textures require OpenGL 4.2 or "
+                 << "GL_ARB_texture_compression_bptc.";
+      return 0;
+    }
+    CookedTexture cooked;
+    CookBc6hTexture(rgba.data(), width, height, bc6h_options, &cooked);
+    if (size_in_bytes != nullptr) {
+      *size_in_bytes = 0;
+      for (int i = 0; i < cooked.num_levels(); ++i) {
+        *size_in_bytes += cooked.level(i).size_in_bytes;
+      }
+    }
+    return UploadCookedTexture(cooked, 0, false, texture_uploader);
+  }
+  const size_t num_texels = static_cast<size_t>(width) * height;
+  // Both formats have rows that are multiples of 4 bytes, which is the default
+  // unpack alignment.
+  std::vector<uint16_t> halves;
+  std::vector<uint32_t> packed;
+  TextureUploadFormat upload_format;
+  const void* texels;
+  if (format == HDR_TEXTURE_FORMAT_R11G11B10F) {
+    packed.resize(num_texels);
+    RgbaFloatsToR11G11B10F(rgba.data(), num_texels, packed.data());
+    upload_format.internal_format = GL_R11F_G11F_B10F;
+    upload_format.format = GL_RGB;
+    upload_format.type = GL_UNSIGNED_INT_10F_11F_11F_REV;
+    upload_format.num_channels = 1;
+    upload_format.bytes_per_channel = sizeof(uint32_t);
+    texels = packed.data();
+  } else {
+    halves.resize(4 * num_texels);
+    FloatsToHalves(rgba.data(), 4 * num_texels, halves.data());
+    upload_format.internal_format = GL_RGBA16F;
+    upload_format.format = GL_RGBA;
+    upload_format.type = GL_HALF_FLOAT;
+    upload_format.num_channels = 4;
+    upload_format.bytes_per_channel = sizeof(uint16_t);
+    texels = halves.data();
+  }
+  const size_t texel_size_in_bytes = upload_format.texel_size_in_bytes();
+  GLuint texture_id;
+  glGenTextures(1, &texture_id);
+  glBindTexture(GL_TEXTURE_2D, texture_id);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  const int num_levels = ComputeNumMipLevels(width, height);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                  ComputeMinFilter(num_levels));
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  AllocateTextureStorage(GL_TEXTURE_2D, num_levels, upload_format, width,
+                         height);
+  if (texture_uploader != nullptr) {
+    texture_uploader->Upload(GL_TEXTURE_2D, 0, 0, 0, width, height,
+                             upload_format.format, upload_format.type,
+                             texel_size_in_bytes * width, texels);
+  } else {
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height,
+                    upload_format.format, upload_format.type, texels);
+  }
+  glGenerateMipmap(GL_TEXTURE_2D);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  if (size_in_bytes != nullptr) {
+    // The mip chain adds a third of level 0.
+    *size_in_bytes = texel_size_in_bytes * num_texels * 4 / 3;
+  }
+  return texture_id;
+}
+
+}  // namespace wvu
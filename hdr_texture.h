@@ -0,0 +1,115 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_HDR_TEXTURE_H_
+#define GLUTILS_HDR_TEXTURE_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+
+#include "bptc_encoder.h"
+#include "texture_cooker.h"
+#include "texture_loader.h"
+#include "texture_uploader.h"
+
+namespace wvu {
+// Internal formats of the textures made from floating-point (HDR) images.
+enum HdrTextureFormat {
+  // Half floats per channel (8 bytes per texel). Keeps the alpha channel and
+  // negative values.
+  HDR_TEXTURE_FORMAT_RGBA16F = 0,
+  // Packed unsigned floats without alpha (4 bytes per texel). Suitable for
+  // lighting (e.g., environment maps) at half the memory of RGBA16F.
+  HDR_TEXTURE_FORMAT_R11G11B10F = 1,
+  // BC6H blocks (1 byte per texel) of unsigned half floats without alpha.
+  // Compressed on the CPU, so it is slower to load but takes a quarter of the
+  // memory of R11G11B10F. Requires OpenGL 4.2 or
+  // GL_ARB_texture_compression_bptc.
+  HDR_TEXTURE_FORMAT_BC6H = 2
+};
+
+// Returns true if the image format stores floating-point texels.
+bool IsHdrImageFormat(const ImageFormat format);
+
+// Loads a floating-point image into RGBA floats. PFM and Radiance (RGBE) files
+// are decoded in-process; OpenEXR files require the library to be configured
+// with OpenEXR (the CMake option GLUTILS_WITH_OPENEXR, which defines
+// cimg_use_openexr when OpenEXR is found). Grayscale images are replicated
+// into the color channels and the alpha channel is one. Returns true if
+// successful, and false otherwise.
+// Parameters:
+//   image_filepath  The filepath of the image to load.
+//   width, height  The dimensions of the image.
+//   rgba  The texels, four floats per texel and the rows from top to bottom.
+bool LoadHdrImageFromFile(const std::string& image_filepath,
+                          int* width,
+                          int* height,
+                          std::vector<float>* rgba);
+
+// Cooks an RGBA float image into a BC6H texture with its mip chain. The GPU
+// cannot generate the levels of a compressed texture, so they are box-filtered
+// on the CPU before every level is encoded with EncodeBc6h().
+// Parameters:
+//   rgba  The RGBA float image.
+//   width, height  The dimensions of the image.
+//   options  The options of the BC6H encoder.
+//   cooked  The cooked texture.
+void CookBc6hTexture(const float* rgba,
+                     const int width,
+                     const int height,
+                     const BptcEncodingOptions& options,
+                     CookedTexture* cooked);
+
+// Loads a floating-point image into a new texture with its mip chain, which
+// is generated by the GPU, or cooked by CookBc6hTexture() for BC6H. The
+// floats are converted into half floats with the F16C instructions when the
+// CPU supports them. Returns the texture id if successful, and zero otherwise.
+// Parameters:
+//   image_filepath  The filepath of the image to load.
+//   format  The internal format of the texture.
+//   bc6h_options  The options of the BC6H encoder, used by that format only.
+//   texture_uploader  The uploader that transfers the texels through PBOs. If
+//     null, the texels are transferred from client memory.
+//   size_in_bytes  The size of the texture, including its mip chain.
+GLuint LoadHdrTexture(const std::string& image_filepath,
+                      const HdrTextureFormat format,
+                      const BptcEncodingOptions& bc6h_options,
+                      TextureUploader* texture_uploader,
+                      size_t* size_in_bytes);
+
+}  // namespace wvu
+
+#endif  // GLUTILS_HDR_TEXTURE_H_
@@ -0,0 +1,447 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "image_metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include "cpu_features.h"
+
+#ifdef GLUTILS_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace wvu {
+namespace {
+// Size and step of the SSIM windows in texels.
+constexpr int kSsimWindowSize = 8;
+constexpr int kSsimWindowStep = 4;
+// Stabilizing constants of the SSIM: (0.01 * 255)^2 and (0.03 * 255)^2.
+constexpr double kSsimC1 = 6.5025;
+constexpr double kSsimC2 = 58.5225;
+
+// Sums of a window, per channel, needed by the SSIM.
+struct WindowSums {
+  int32_t reference[4];
+  int32_t image[4];
+  int32_t reference_squared[4];
+  int32_t image_squared[4];
+  int32_t product[4];
+};
+
+// Returns the mask of the first num_channels bytes of every RGBA8 texel.
+uint32_t ChannelMask(const int num_channels) {
+  return num_channels >= 4 ? 0xFFFFFFFFu : (1u << (8 * num_channels)) - 1;
+}
+
+// -------------------- Scalar kernels -----------------------------------------
+
+uint64_t SumSquaredErrorsScalar(const unsigned char* reference,
+                                const unsigned char* image,
+                                const size_t begin,
+                                const size_t end,
+                                const int num_channels) {
+  uint64_t sum = 0;
+  for (size_t i = begin; i < end; ++i) {
+    for (int c = 0; c < num_channels; ++c) {
+      const int difference = reference[4 * i + c] - image[4 * i + c];
+      sum += difference * difference;
+    }
+  }
+  return sum;
+}
+
+// Accumulates the sums of a window of width x height texels whose rows are
+// row_size_in_bytes apart.
+void SumWindowScalar(const unsigned char* reference,
+                     const unsigned char* image,
+                     const size_t row_size_in_bytes,
+                     const int width,
+                     const int height,
+                     WindowSums* sums) {
+  std::memset(sums, 0, sizeof(*sums));
+  for (int y = 0; y < height; ++y) {
+    const unsigned char* reference_row = reference + y * row_size_in_bytes;
+    const unsigned char* image_row = image + y * row_size_in_bytes;
+    for (int x = 0; x < width; ++x) {
+      for (int c = 0; c < 4; ++c) {
+        const int32_t a = reference_row[4 * x + c];
+        const int32_t b = image_row[4 * x + c];
+        sums->reference[c] += a;
+        sums->image[c] += b;
+        sums->reference_squared[c] += a * a;
+        sums->image_squared[c] += b * b;
+        sums->product[c] += a * b;
+      }
+    }
+  }
+}
+
+#ifdef GLUTILS_X86_SIMD
+// -------------------- SSE2 kernels -------------------------------------------
+// The differences and the texels are widened to 16 bits and squared with
+// _mm_madd_epi16(), which adds pairs of products into 32-bit lanes. The 32-bit
+// sums of the squared errors are flushed into 64 bits before they overflow.
+
+// Number of iterations after which the 32-bit sums of the squared errors are
+// flushed: every lane grows by at most 4 * 255^2 per iteration.
+constexpr size_t kMaxIterationsPerFlush = 4096;
+
+GLUTILS_TARGET_SSE2
+uint64_t HorizontalSum(const __m128i sums) {
+  uint32_t lanes[4];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), sums);
+  return static_cast<uint64_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+}
+
+GLUTILS_TARGET_SSE2
+size_t SumSquaredErrorsSse2(const unsigned char* reference,
+                            const unsigned char* image,
+                            const size_t num_texels,
+                            const int num_channels,
+                            uint64_t* sum) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i mask = _mm_set1_epi32(ChannelMask(num_channels));
+  size_t i = 0;
+  while (i + 4 <= num_texels) {
+    __m128i sums = _mm_setzero_si128();
+    const size_t end = std::min(num_texels & ~size_t(3),
+                                i + 4 * kMaxIterationsPerFlush);
+    for (; i < end; i += 4) {
+      const __m128i a = _mm_and_si128(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(reference + 4 * i)),
+          mask);
+      const __m128i b = _mm_and_si128(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(image + 4 * i)),
+          mask);
+      const __m128i low = _mm_sub_epi16(_mm_unpacklo_epi8(a, zero),
+                                        _mm_unpacklo_epi8(b, zero));
+      const __m128i high = _mm_sub_epi16(_mm_unpackhi_epi8(a, zero),
+                                         _mm_unpackhi_epi8(b, zero));
+      sums = _mm_add_epi32(sums, _mm_madd_epi16(low, low));
+      sums = _mm_add_epi32(sums, _mm_madd_epi16(high, high));
+    }
+    *sum += HorizontalSum(sums);
+  }
+  return i;
+}
+
+// Accumulates the sums of a texel held in the 32-bit lanes of the registers.
+GLUTILS_TARGET_SSE2
+inline void AccumulateTexelSse2(const __m128i a,
+                                const __m128i b,
+                                __m128i accumulators[5]) {
+  accumulators[0] = _mm_add_epi32(accumulators[0], a);
+  accumulators[1] = _mm_add_epi32(accumulators[1], b);
+  accumulators[2] = _mm_add_epi32(accumulators[2], _mm_madd_epi16(a, a));
+  accumulators[3] = _mm_add_epi32(accumulators[3], _mm_madd_epi16(b, b));
+  accumulators[4] = _mm_add_epi32(accumulators[4], _mm_madd_epi16(a, b));
+}
+
+// Accumulates the sums of a window of 8x8 texels. Every texel is widened into
+// four 32-bit lanes, so the lanes hold the sums of the channels.
+GLUTILS_TARGET_SSE2
+void SumWindowSse2(const unsigned char* reference,
+                   const unsigned char* image,
+                   const size_t row_size_in_bytes,
+                   WindowSums* sums) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i accumulators[5];
+  for (__m128i& accumulator : accumulators) {
+    accumulator = _mm_setzero_si128();
+  }
+  for (int y = 0; y < kSsimWindowSize; ++y) {
+    for (int x = 0; x < kSsimWindowSize; x += 4) {
+      const size_t offset = y * row_size_in_bytes + 4 * x;
+      const __m128i a =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(reference + offset));
+      const __m128i b =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(image + offset));
+      const __m128i a_low = _mm_unpacklo_epi8(a, zero);
+      const __m128i a_high = _mm_unpackhi_epi8(a, zero);
+      const __m128i b_low = _mm_unpacklo_epi8(b, zero);
+      const __m128i b_high = _mm_unpackhi_epi8(b, zero);
+      AccumulateTexelSse2(_mm_unpacklo_epi16(a_low, zero),
+                          _mm_unpacklo_epi16(b_low, zero), accumulators);
+      AccumulateTexelSse2(_mm_unpackhi_epi16(a_low, zero),
+                          _mm_unpackhi_epi16(b_low, zero), accumulators);
+      AccumulateTexelSse2(_mm_unpacklo_epi16(a_high, zero),
+                          _mm_unpacklo_epi16(b_high, zero), accumulators);
+      AccumulateTexelSse2(_mm_unpackhi_epi16(a_high, zero),
+                          _mm_unpackhi_epi16(b_high, zero), accumulators);
+    }
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(sums->reference),
+                   accumulators[0]);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(sums->image), accumulators[1]);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(sums->reference_squared),
+                   accumulators[2]);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(sums->image_squared),
+                   accumulators[3]);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(sums->product),
+                   accumulators[4]);
+}
+
+// -------------------- AVX2 kernels -------------------------------------------
+// The AVX2 kernels process twice the texels of the SSE2 kernels; the 128-bit
+// lanes are added together at the end.
+
+GLUTILS_TARGET_AVX2
+inline __m128i AddLanes(const __m256i value) {
+  return _mm_add_epi32(_mm256_castsi256_si128(value),
+                       _mm256_extracti128_si256(value, 1));
+}
+
+GLUTILS_TARGET_AVX2
+size_t SumSquaredErrorsAvx2(const unsigned char* reference,
+                            const unsigned char* image,
+                            const size_t num_texels,
+                            const int num_channels,
+                            uint64_t* sum) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i mask = _mm256_set1_epi32(ChannelMask(num_channels));
+  size_t i = 0;
+  while (i + 8 <= num_texels) {
+    __m256i sums = _mm256_setzero_si256();
+    const size_t end = std::min(num_texels & ~size_t(7),
+                                i + 8 * kMaxIterationsPerFlush);
+    for (; i < end; i += 8) {
+      const __m256i a = _mm256_and_si256(
+          _mm256_loadu_si256(
+              reinterpret_cast<const __m256i*>(reference + 4 * i)),
+          mask);
+      const __m256i b = _mm256_and_si256(
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(image + 4 * i)),
+          mask);
+      const __m256i low = _mm256_sub_epi16(_mm256_unpacklo_epi8(a, zero),
+                                           _mm256_unpacklo_epi8(b, zero));
+      const __m256i high = _mm256_sub_epi16(_mm256_unpackhi_epi8(a, zero),
+                                            _mm256_unpackhi_epi8(b, zero));
+      sums = _mm256_add_epi32(sums, _mm256_madd_epi16(low, low));
+      sums = _mm256_add_epi32(sums, _mm256_madd_epi16(high, high));
+    }
+    uint32_t lanes[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), AddLanes(sums));
+    // Each half holds at most 4096 * 4 * 255^2 per lane, so their sum still
+    // fits in 32 bits.
+    *sum += static_cast<uint64_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+  }
+  return i;
+}
+
+GLUTILS_TARGET_AVX2
+inline void AccumulateTexelsAvx2(const __m256i a,
+                                 const __m256i b,
+                                 __m256i accumulators[5]) {
+  accumulators[0] = _mm256_add_epi32(accumulators[0], a);
+  accumulators[1] = _mm256_add_epi32(accumulators[1], b);
+  accumulators[2] =
+      _mm256_add_epi32(accumulators[2], _mm256_madd_epi16(a, a));
+  accumulators[3] =
+      _mm256_add_epi32(accumulators[3], _mm256_madd_epi16(b, b));
+  accumulators[4] =
+      _mm256_add_epi32(accumulators[4], _mm256_madd_epi16(a, b));
+}
+
+// Every row of the window is a single register of 8 texels.
+GLUTILS_TARGET_AVX2
+void SumWindowAvx2(const unsigned char* reference,
+                   const unsigned char* image,
+                   const size_t row_size_in_bytes,
+                   WindowSums* sums) {
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i accumulators[5];
+  for (__m256i& accumulator : accumulators) {
+    accumulator = _mm256_setzero_si256();
+  }
+  for (int y = 0; y < kSsimWindowSize; ++y) {
+    const size_t offset = y * row_size_in_bytes;
+    const __m256i a = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(reference + offset));
+    const __m256i b =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(image + offset));
+    const __m256i a_low = _mm256_unpacklo_epi8(a, zero);
+    const __m256i a_high = _mm256_unpackhi_epi8(a, zero);
+    const __m256i b_low = _mm256_unpacklo_epi8(b, zero);
+    const __m256i b_high = _mm256_unpackhi_epi8(b, zero);
+    AccumulateTexelsAvx2(_mm256_unpacklo_epi16(a_low, zero),
+                         _mm256_unpacklo_epi16(b_low, zero), accumulators);
+    AccumulateTexelsAvx2(_mm256_unpackhi_epi16(a_low, zero),
+                         _mm256_unpackhi_epi16(b_low, zero), accumulators);
+    AccumulateTexelsAvx2(_mm256_unpacklo_epi16(a_high, zero),
+                         _mm256_unpacklo_epi16(b_high, zero), accumulators);
+    AccumulateTexelsAvx2(_mm256_unpackhi_epi16(a_high, zero),
+                         _mm256_unpackhi_epi16(b_high, zero), accumulators);
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(sums->reference),
+                   AddLanes(accumulators[0]));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(sums->image),
+                   AddLanes(accumulators[1]));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(sums->reference_squared),
+                   AddLanes(accumulators[2]));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(sums->image_squared),
+                   AddLanes(accumulators[3]));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(sums->product),
+                   AddLanes(accumulators[4]));
+}
+#endif  // GLUTILS_X86_SIMD
+
+// -------------------- Dispatch -----------------------------------------------
+
+// Sums the squared errors of the texels that fill the SIMD registers and
+// returns the number of processed texels.
+size_t SumSquaredErrorsSimd(const unsigned char* reference,
+                            const unsigned char* image,
+                            const size_t num_texels,
+                            const int num_channels,
+                            uint64_t* sum) {
+#ifdef GLUTILS_X86_SIMD
+  switch (GetSimdLevel()) {
+    case SIMD_AVX2:
+      return SumSquaredErrorsAvx2(reference, image, num_texels, num_channels,
+                                  sum);
+    case SIMD_SSE2:
+      return SumSquaredErrorsSse2(reference, image, num_texels, num_channels,
+                                  sum);
+    default:
+      break;
+  }
+#endif
+  return 0;
+}
+
+// Sums a window with the best kernel for the CPU; the SIMD kernels require
+// windows of kSsimWindowSize texels.
+void SumWindow(const unsigned char* reference,
+               const unsigned char* image,
+               const size_t row_size_in_bytes,
+               const int width,
+               const int height,
+               WindowSums* sums) {
+#ifdef GLUTILS_X86_SIMD
+  if (width == kSsimWindowSize && height == kSsimWindowSize) {
+    switch (GetSimdLevel()) {
+      case SIMD_AVX2:
+        SumWindowAvx2(reference, image, row_size_in_bytes, sums);
+        return;
+      case SIMD_SSE2:
+        SumWindowSse2(reference, image, row_size_in_bytes, sums);
+        return;
+      default:
+        break;
+    }
+  }
+#endif
+  SumWindowScalar(reference, image, row_size_in_bytes, width, height, sums);
+}
+
+// Returns the SSIM of a channel of a window of num_texels texels.
+double ComputeWindowSsim(const WindowSums& sums,
+                         const int channel,
+                         const int num_texels) {
+  const double mean_reference =
+      static_cast<double>(sums.reference[channel]) / num_texels;
+  const double mean_image = static_cast<double>(sums.image[channel]) /
+      num_texels;
+  const double variance_reference =
+      static_cast<double>(sums.reference_squared[channel]) / num_texels -
+      mean_reference * mean_reference;
+  const double variance_image =
+      static_cast<double>(sums.image_squared[channel]) / num_texels -
+      mean_image * mean_image;
+  const double covariance =
+      static_cast<double>(sums.product[channel]) / num_texels -
+      mean_reference * mean_image;
+  return (2.0 * mean_reference * mean_image + kSsimC1) *
+      (2.0 * covariance + kSsimC2) /
+      ((mean_reference * mean_reference + mean_image * mean_image + kSsimC1) *
+       (variance_reference + variance_image + kSsimC2));
+}
+
+}  // namespace
+
+double ComputePsnr(const unsigned char* reference,
+                   const unsigned char* image,
+                   const size_t num_texels,
+                   const int num_channels) {
+  const int clamped_num_channels = std::min(std::max(num_channels, 1), 4);
+  uint64_t squared_error = 0;
+  const size_t num_simd_texels = SumSquaredErrorsSimd(
+      reference, image, num_texels, clamped_num_channels, &squared_error);
+  squared_error += SumSquaredErrorsScalar(reference, image, num_simd_texels,
+                                          num_texels, clamped_num_channels);
+  if (squared_error == 0) {
+    return std::numeric_limits<double>::infinity();
+  }
+  const double mean_squared_error = static_cast<double>(squared_error) /
+      (static_cast<double>(num_texels) * clamped_num_channels);
+  return 10.0 * std::log10(255.0 * 255.0 / mean_squared_error);
+}
+
+double ComputeSsim(const unsigned char* reference,
+                   const unsigned char* image,
+                   const int width,
+                   const int height,
+                   const int num_channels) {
+  if (width <= 0 || height <= 0) {
+    return 1.0;
+  }
+  const int clamped_num_channels = std::min(std::max(num_channels, 1), 4);
+  // Images smaller than a window are a single window.
+  const int window_width = std::min(width, kSsimWindowSize);
+  const int window_height = std::min(height, kSsimWindowSize);
+  const size_t row_size_in_bytes = 4 * static_cast<size_t>(width);
+  double ssim_sum = 0.0;
+  size_t num_windows = 0;
+  WindowSums sums;
+  for (int y = 0; y + window_height <= height; y += kSsimWindowStep) {
+    for (int x = 0; x + window_width <= width; x += kSsimWindowStep) {
+      const size_t offset = y * row_size_in_bytes + 4 * static_cast<size_t>(x);
+      SumWindow(reference + offset, image + offset, row_size_in_bytes,
+                window_width, window_height, &sums);
+      for (int c = 0; c < clamped_num_channels; ++c) {
+        ssim_sum +=
+            ComputeWindowSsim(sums, c, window_width * window_height);
+      }
+      ++num_windows;
+    }
+  }
+  return ssim_sum / (static_cast<double>(num_windows) * clamped_num_channels);
+}
+
+}  // namespace wvu
@@ -0,0 +1,85 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_IMAGE_METRICS_H_
+#define GLUTILS_IMAGE_METRICS_H_
+
+#include <cstddef>
+
+namespace wvu {
+// Metrics that compare an RGBA8 image against its reference, e.g., a texture
+// decoded back from a compressed format against its source. Only the first
+// num_channels channels of every texel are compared, so that formats without
+// alpha (e.g., BC1) are not penalized for it. The kernels use SSE2 or AVX2
+// when the CPU supports them, see cpu_features.h, and produce the same results
+// as the scalar kernels.
+//
+// Example:
+//
+// std::vector<unsigned char> decoded(4 * width * height);
+// wvu::DecodeBc(blocks, width, height, wvu::BC1_FORMAT, decoded.data());
+// const double psnr = wvu::ComputePsnr(source, decoded.data(),
+//                                      width * height, 3);
+// const double ssim = wvu::ComputeSsim(source, decoded.data(), width,
+//                                      height, 3);
+
+// Returns the peak signal-to-noise ratio in dB of the image, or infinity if
+// the images are identical.
+// Parameters:
+//   reference  The reference RGBA8 image.
+//   image  The RGBA8 image to compare.
+//   num_texels  The number of texels of the images.
+//   num_channels  The number of channels to compare, between 1 and 4.
+double ComputePsnr(const unsigned char* reference,
+                   const unsigned char* image,
+                   const size_t num_texels,
+                   const int num_channels);
+
+// Returns the mean structural similarity (SSIM) of the image, between -1 and
+// 1 (identical images). The SSIM is computed in windows of 8x8 texels every 4
+// texels, as in libvpx, and averaged over the windows and the channels.
+// Parameters:
+//   reference  The reference RGBA8 image.
+//   image  The RGBA8 image to compare.
+//   width, height  The dimensions of the images.
+//   num_channels  The number of channels to compare, between 1 and 4.
+double ComputeSsim(const unsigned char* reference,
+                   const unsigned char* image,
+                   const int width,
+                   const int height,
+                   const int num_channels);
+
+}  // namespace wvu
+
+#endif  // GLUTILS_IMAGE_METRICS_H_
@@ -0,0 +1,598 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "image_reader.h"
+
+#include <algorithm>
+#include <csetjmp>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#ifdef cimg_use_png
+#include <png.h>
+#endif
+#ifdef cimg_use_jpeg
+#include <jpeglib.h>
+#endif
+#ifdef cimg_use_tiff
+#include <tiffio.h>
+#endif
+
+#include <glog/logging.h>
+
+#include "channel_shuffle.h"
+#include "texture_loader.h"
+
+namespace wvu {
+
+// Interface of the decoders. A decoder is opened once and decodes the image
+// once.
+class ImageReader::Decoder {
+ public:
+  virtual ~Decoder() {}
+  // Reads the header of the image. Returns true if successful.
+  virtual bool Open(const std::string& image_filepath,
+                    int* width,
+                    int* height,
+                    int* num_channels) = 0;
+  // Decodes the image into an interleaved RGBA8 buffer. Returns true if
+  // successful.
+  virtual bool ReadRgba8(unsigned char* pixels) = 0;
+  // Returns the layout of the texels decoded by ReadNative().
+  virtual void GetNativeLayout(int* num_channels,
+                               int* bytes_per_channel) const = 0;
+  // Decodes the image into its native interleaved layout. Returns true if
+  // successful.
+  virtual bool ReadNative(void* pixels) = 0;
+};
+
+namespace {
+// Number of channels of an RGBA8 texel.
+constexpr int kNumRgba8Channels = 4;
+
+// Expands a row of num_texels texels with num_channels channels into RGBA8.
+// The source can be the beginning of the destination row, which is why the
+// texels are expanded from the last one to the first one.
+void ExpandRowToRgba8(const int num_texels,
+                      const int num_channels,
+                      unsigned char* row) {
+  for (int x = num_texels - 1; x >= 0; --x) {
+    const unsigned char* source = row + x * num_channels;
+    unsigned char* destination = row + x * kNumRgba8Channels;
+    unsigned char red, green, blue, alpha;
+    switch (num_channels) {
+      case 1:
+        red = green = blue = source[0];
+        alpha = 255;
+        break;
+      case 2:
+        red = green = blue = source[0];
+        alpha = source[1];
+        break;
+      case 3:
+        red = source[0];
+        green = source[1];
+        blue = source[2];
+        alpha = 255;
+        break;
+      default:
+        red = source[0];
+        green = source[1];
+        blue = source[2];
+        alpha = source[3];
+        break;
+    }
+    destination[0] = red;
+    destination[1] = green;
+    destination[2] = blue;
+    destination[3] = alpha;
+  }
+}
+
+#ifdef cimg_use_png
+// libpng reports errors through this callback. The callback must not return,
+// so it jumps back to the setjmp() in the decoder.
+void PngErrorCallback(png_structp png, png_const_charp message) {
+  LOG(ERROR) << "libpng: " << message;
+  png_longjmp(png, 1);
+}
+
+void PngWarningCallback(png_structp png, png_const_charp message) {
+  VLOG(1) << "libpng: " << message;
+}
+
+// Decodes PNG images with libpng. libpng converts every color type and bit
+// depth to RGBA8, or to 8-bit or 16-bit gray, gray-alpha, RGB or RGBA, while
+// it decodes the rows.
+class PngDecoder : public ImageReader::Decoder {
+ public:
+  PngDecoder() : file_(nullptr), png_(nullptr), info_(nullptr),
+                 color_type_(0), bit_depth_(0), has_transparency_(false),
+                 width_(0), height_(0), num_channels_(0) {}
+  ~PngDecoder() override {
+    if (png_ != nullptr) {
+      png_destroy_read_struct(&png_, info_ != nullptr ? &info_ : nullptr,
+                              nullptr);
+    }
+    if (file_ != nullptr) {
+      std::fclose(file_);
+    }
+  }
+
+  bool Open(const std::string& image_filepath,
+            int* width,
+            int* height,
+            int* num_channels) override {
+    file_ = std::fopen(image_filepath.c_str(), "rb");
+    if (file_ == nullptr) {
+      return false;
+    }
+    png_ = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr,
+                                  PngErrorCallback, PngWarningCallback);
+    if (png_ == nullptr) {
+      return false;
+    }
+    info_ = png_create_info_struct(png_);
+    if (info_ == nullptr) {
+      return false;
+    }
+    // libpng jumps here when an error occurs.
+    if (setjmp(png_jmpbuf(png_))) {
+      return false;
+    }
+    png_init_io(png_, file_);
+    png_read_info(png_, info_);
+    color_type_ = png_get_color_type(png_, info_);
+    bit_depth_ = png_get_bit_depth(png_, info_);
+    has_transparency_ = png_get_valid(png_, info_, PNG_INFO_tRNS);
+    width_ = *width = png_get_image_width(png_, info_);
+    height_ = *height = png_get_image_height(png_, info_);
+    *num_channels = png_get_channels(png_, info_);
+    // Palettes are expanded and the transparency becomes an alpha channel.
+    if (color_type_ == PNG_COLOR_TYPE_PALETTE) {
+      *num_channels = has_transparency_ ? 4 : 3;
+    } else if (has_transparency_) {
+      ++*num_channels;
+    }
+    num_channels_ = *num_channels;
+    return true;
+  }
+
+  bool ReadRgba8(unsigned char* pixels) override {
+    if (setjmp(png_jmpbuf(png_))) {
+      return false;
+    }
+    // Transformations that convert any PNG into RGBA8.
+    SetExpansions();
+    if (bit_depth_ == 16) {
+      png_set_strip_16(png_);
+    }
+    if (color_type_ == PNG_COLOR_TYPE_GRAY ||
+        color_type_ == PNG_COLOR_TYPE_GRAY_ALPHA) {
+      png_set_gray_to_rgb(png_);
+    }
+    if (!(color_type_ & PNG_COLOR_MASK_ALPHA) && !has_transparency_) {
+      png_set_filler(png_, 0xFF, PNG_FILLER_AFTER);
+    }
+    return ReadRows(static_cast<size_t>(width_) * kNumRgba8Channels, pixels);
+  }
+
+  void GetNativeLayout(int* num_channels,
+                       int* bytes_per_channel) const override {
+    *num_channels = num_channels_;
+    *bytes_per_channel = bit_depth_ == 16 ? 2 : 1;
+  }
+
+  bool ReadNative(void* pixels) override {
+    if (setjmp(png_jmpbuf(png_))) {
+      return false;
+    }
+    SetExpansions();
+    // PNG stores 16-bit samples in big-endian order.
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (bit_depth_ == 16) {
+      png_set_swap(png_);
+    }
+#endif
+    return ReadRows(static_cast<size_t>(width_) * num_channels_ *
+                    (bit_depth_ == 16 ? 2 : 1),
+                    static_cast<unsigned char*>(pixels));
+  }
+
+ private:
+  // Expands the palettes, the gray images with fewer than 8 bits and the
+  // transparency into 8-bit texels.
+  void SetExpansions() {
+    if (color_type_ == PNG_COLOR_TYPE_PALETTE) {
+      png_set_palette_to_rgb(png_);
+    }
+    if (color_type_ == PNG_COLOR_TYPE_GRAY && bit_depth_ < 8) {
+      png_set_expand_gray_1_2_4_to_8(png_);
+    }
+    if (has_transparency_) {
+      png_set_tRNS_to_alpha(png_);
+    }
+  }
+
+  // Decodes the rows once the transformations are set. The caller must have
+  // called setjmp().
+  bool ReadRows(const size_t row_size_in_bytes, unsigned char* pixels) {
+    const int num_passes = png_set_interlace_handling(png_);
+    png_read_update_info(png_, info_);
+    if (png_get_rowbytes(png_, info_) != row_size_in_bytes) {
+      return false;
+    }
+    // Interlaced images visit every row once per pass.
+    for (int pass = 0; pass < num_passes; ++pass) {
+      for (int y = 0; y < height_; ++y) {
+        png_read_row(png_, pixels + y * row_size_in_bytes, nullptr);
+      }
+    }
+    png_read_end(png_, nullptr);
+    return true;
+  }
+
+  std::FILE* file_;
+  png_structp png_;
+  png_infop info_;
+  png_byte color_type_;
+  png_byte bit_depth_;
+  bool has_transparency_;
+  int width_;
+  int height_;
+  int num_channels_;
+};
+#endif  // cimg_use_png
+
+#ifdef cimg_use_jpeg
+// libjpeg's error manager extended with the jump buffer used to return to the
+// decoder on errors.
+struct JpegErrorManager {
+  struct jpeg_error_mgr manager;
+  std::jmp_buf jump_buffer;
+};
+
+// libjpeg reports errors through this callback. The callback must not return,
+// so it jumps back to the setjmp() in the decoder.
+void JpegErrorExit(j_common_ptr info) {
+  char message[JMSG_LENGTH_MAX];
+  (*info->err->format_message)(info, message);
+  LOG(ERROR) << "libjpeg: " << message;
+  JpegErrorManager* error_manager =
+      reinterpret_cast<JpegErrorManager*>(info->err);
+  std::longjmp(error_manager->jump_buffer, 1);
+}
+
+// Decodes JPEG images with libjpeg. libjpeg-turbo writes RGBA8 scanlines
+// directly; other versions write gray or RGB scanlines, since they cannot
+// convert gray to RGB, which are expanded in place.
+// The native layout is 8-bit gray or RGB.
+class JpegDecoder : public ImageReader::Decoder {
+ public:
+  JpegDecoder() : file_(nullptr), created_(false), num_channels_(0) {}
+  ~JpegDecoder() override {
+    if (created_) {
+      jpeg_destroy_decompress(&info_);
+    }
+    if (file_ != nullptr) {
+      std::fclose(file_);
+    }
+  }
+
+  bool Open(const std::string& image_filepath,
+            int* width,
+            int* height,
+            int* num_channels) override {
+    file_ = std::fopen(image_filepath.c_str(), "rb");
+    if (file_ == nullptr) {
+      return false;
+    }
+    info_.err = jpeg_std_error(&error_manager_.manager);
+    error_manager_.manager.error_exit = JpegErrorExit;
+    // libjpeg jumps here when an error occurs.
+    if (setjmp(error_manager_.jump_buffer)) {
+      return false;
+    }
+    jpeg_create_decompress(&info_);
+    created_ = true;
+    jpeg_stdio_src(&info_, file_);
+    jpeg_read_header(&info_, TRUE);
+    switch (info_.jpeg_color_space) {
+      case JCS_GRAYSCALE:
+        *num_channels = 1;
+        break;
+      case JCS_RGB:
+      case JCS_YCbCr:
+        *num_channels = 3;
+        break;
+      default:
+        // CMYK and YCCK images are left to CImg.
+        return false;
+    }
+    *width = info_.image_width;
+    *height = info_.image_height;
+    num_channels_ = *num_channels;
+    return true;
+  }
+
+  bool ReadRgba8(unsigned char* pixels) override {
+    if (setjmp(error_manager_.jump_buffer)) {
+      return false;
+    }
+#ifdef JCS_EXTENSIONS
+    info_.out_color_space = JCS_EXT_RGBA;
+#else
+    info_.out_color_space = num_channels_ == 1 ? JCS_GRAYSCALE : JCS_RGB;
+#endif
+    jpeg_start_decompress(&info_);
+    const size_t row_size_in_bytes =
+        static_cast<size_t>(info_.output_width) * kNumRgba8Channels;
+    while (info_.output_scanline < info_.output_height) {
+      JSAMPROW row = pixels + info_.output_scanline * row_size_in_bytes;
+      jpeg_read_scanlines(&info_, &row, 1);
+#ifndef JCS_EXTENSIONS
+      ExpandRowToRgba8(info_.output_width, info_.output_components, row);
+#endif
+    }
+    jpeg_finish_decompress(&info_);
+    return true;
+  }
+
+  void GetNativeLayout(int* num_channels,
+                       int* bytes_per_channel) const override {
+    *num_channels = num_channels_;
+    *bytes_per_channel = 1;
+  }
+
+  bool ReadNative(void* pixels) override {
+    if (setjmp(error_manager_.jump_buffer)) {
+      return false;
+    }
+    info_.out_color_space = num_channels_ == 1 ? JCS_GRAYSCALE : JCS_RGB;
+    jpeg_start_decompress(&info_);
+    const size_t row_size_in_bytes =
+        static_cast<size_t>(info_.output_width) * num_channels_;
+    while (info_.output_scanline < info_.output_height) {
+      JSAMPROW row = static_cast<unsigned char*>(pixels) +
+          info_.output_scanline * row_size_in_bytes;
+      jpeg_read_scanlines(&info_, &row, 1);
+    }
+    jpeg_finish_decompress(&info_);
+    return true;
+  }
+
+ private:
+  std::FILE* file_;
+  struct jpeg_decompress_struct info_;
+  JpegErrorManager error_manager_;
+  bool created_;
+  int num_channels_;
+};
+#endif  // cimg_use_jpeg
+
+#ifdef cimg_use_tiff
+// Decodes TIFF images with libtiff. libtiff converts any photometric
+// interpretation and bit depth to RGBA8 texels stored as 32-bit words, which
+// is also the native layout.
+class TiffDecoder : public ImageReader::Decoder {
+ public:
+  TiffDecoder() : tiff_(nullptr), width_(0), height_(0) {}
+  ~TiffDecoder() override {
+    if (tiff_ != nullptr) {
+      TIFFClose(tiff_);
+    }
+  }
+
+  bool Open(const std::string& image_filepath,
+            int* width,
+            int* height,
+            int* num_channels) override {
+    tiff_ = TIFFOpen(image_filepath.c_str(), "r");
+    if (tiff_ == nullptr) {
+      return false;
+    }
+    char message[1024];
+    if (!TIFFRGBAImageOK(tiff_, message)) {
+      LOG(ERROR) << "libtiff: " << message;
+      return false;
+    }
+    uint32_t tiff_width = 0;
+    uint32_t tiff_height = 0;
+    uint16_t samples_per_pixel = 1;
+    TIFFGetField(tiff_, TIFFTAG_IMAGEWIDTH, &tiff_width);
+    TIFFGetField(tiff_, TIFFTAG_IMAGELENGTH, &tiff_height);
+    TIFFGetFieldDefaulted(tiff_, TIFFTAG_SAMPLESPERPIXEL, &samples_per_pixel);
+    width_ = *width = tiff_width;
+    height_ = *height = tiff_height;
+    *num_channels = samples_per_pixel;
+    return true;
+  }
+
+  bool ReadRgba8(unsigned char* pixels) override {
+    // libtiff packs every texel as A << 24 | B << 16 | G << 8 | R, which is
+    // laid out as R, G, B, A in little-endian memory. The buffer must be
+    // aligned to 4 bytes.
+    uint32_t* raster = reinterpret_cast<uint32_t*>(pixels);
+    if (!TIFFReadRGBAImageOriented(tiff_, width_, height_, raster,
+                                   ORIENTATION_TOPLEFT, 0)) {
+      return false;
+    }
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    TIFFSwabArrayOfLong(raster, static_cast<tmsize_t>(width_) * height_);
+#endif
+    return true;
+  }
+
+  void GetNativeLayout(int* num_channels,
+                       int* bytes_per_channel) const override {
+    *num_channels = kNumRgba8Channels;
+    *bytes_per_channel = 1;
+  }
+
+  bool ReadNative(void* pixels) override {
+    return ReadRgba8(static_cast<unsigned char*>(pixels));
+  }
+
+ private:
+  TIFF* tiff_;
+  int width_;
+  int height_;
+};
+#endif  // cimg_use_tiff
+
+// Decodes the formats without an in-process decoder. CImg decodes the image
+// into 8-bit planes, which are interleaved afterwards.
+class CImgDecoder : public ImageReader::Decoder {
+ public:
+  CImgDecoder() {}
+  ~CImgDecoder() override {}
+
+  bool Open(const std::string& image_filepath,
+            int* width,
+            int* height,
+            int* num_channels) override {
+    if (!LoadImageFromFile(image_filepath, &image_)) {
+      return false;
+    }
+    *width = image_.width();
+    *height = image_.height();
+    *num_channels = image_.spectrum();
+    return true;
+  }
+
+  bool ReadRgba8(unsigned char* pixels) override {
+    // The SIMD kernels read the planes sequentially, which is much faster than
+    // the strided accesses of CImg's permute_axes("cxyz").
+    const size_t num_texels = static_cast<size_t>(image_.width()) *
+        image_.height();
+    InterleavePlanesToRgba(image_.data(), std::min(image_.spectrum(), 4),
+                           num_texels, 255, pixels);
+    image_.assign();
+    return true;
+  }
+
+  void GetNativeLayout(int* num_channels,
+                       int* bytes_per_channel) const override {
+    *num_channels = std::min(image_.spectrum(), kNumRgba8Channels);
+    *bytes_per_channel = 1;
+  }
+
+  bool ReadNative(void* pixels) override {
+    const size_t num_texels = static_cast<size_t>(image_.width()) *
+        image_.height();
+    InterleavePlanes(image_.data(), std::min(image_.spectrum(), 4),
+                     num_texels, static_cast<unsigned char*>(pixels));
+    image_.assign();
+    return true;
+  }
+
+ private:
+  cimg_library::CImg<unsigned char> image_;
+};
+
+// Creates the in-process decoder for the format. Returns nullptr if there is
+// no in-process decoder for the format.
+ImageReader::Decoder* CreateInProcessDecoder(const ImageFormat format) {
+  switch (format) {
+#ifdef cimg_use_png
+    case PNG_IMAGE_FORMAT:
+      return new PngDecoder;
+#endif
+#ifdef cimg_use_jpeg
+    case JPEG_IMAGE_FORMAT:
+      return new JpegDecoder;
+#endif
+#ifdef cimg_use_tiff
+    case TIFF_IMAGE_FORMAT:
+      return new TiffDecoder;
+#endif
+    default:
+      return nullptr;
+  }
+}
+
+}  // namespace
+
+ImageReader::ImageReader() : width_(0), height_(0), num_channels_(0),
+                             native_num_channels_(0),
+                             native_bytes_per_channel_(0) {}
+
+ImageReader::~ImageReader() {}
+
+bool ImageReader::Open(const std::string& image_filepath) {
+  Close();
+  decoder_.reset(CreateInProcessDecoder(IdentifyImageFormat(image_filepath)));
+  if (decoder_ == nullptr ||
+      !decoder_->Open(image_filepath, &width_, &height_, &num_channels_)) {
+    // Use CImg for the images that the in-process decoders cannot handle.
+    decoder_.reset(new CImgDecoder);
+    if (!decoder_->Open(image_filepath, &width_, &height_, &num_channels_)) {
+      Close();
+      return false;
+    }
+  }
+  decoder_->GetNativeLayout(&native_num_channels_, &native_bytes_per_channel_);
+  return true;
+}
+
+bool ImageReader::ReadRgba8(unsigned char* pixels) {
+  if (decoder_ == nullptr || pixels == nullptr) {
+    return false;
+  }
+  const bool success = decoder_->ReadRgba8(pixels);
+  decoder_.reset();
+  return success;
+}
+
+bool ImageReader::ReadNative(void* pixels) {
+  if (decoder_ == nullptr || pixels == nullptr) {
+    return false;
+  }
+  const bool success = decoder_->ReadNative(pixels);
+  decoder_.reset();
+  return success;
+}
+
+void ImageReader::Close() {
+  decoder_.reset();
+  width_ = 0;
+  height_ = 0;
+  num_channels_ = 0;
+  native_num_channels_ = 0;
+  native_bytes_per_channel_ = 0;
+}
+
+}  // namespace wvu
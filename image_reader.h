@@ -0,0 +1,130 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_IMAGE_READER_H_
+#define GLUTILS_IMAGE_READER_H_
+
+#include <memory>
+#include <string>
+
+namespace wvu {
+// This class decodes an image directly into an interleaved RGBA8 buffer, which
+// is the layout that OpenGL expects when uploading a GL_RGBA texture, or into
+// the interleaved layout of the file (e.g., gray or 16-bit texels). The
+// decoders write every scanline straight into the destination buffer, so no
+// planar copy of the image is created and the channels do not have to be
+// re-arranged afterwards (e.g., with CImg's permute_axes()). The destination
+// can be any memory with room for the image, such as a pooled host buffer or a
+// mapped pixel buffer object.
+// PNG, JPEG and TIFF images are decoded with libpng, libjpeg and libtiff. Other
+// formats are loaded with CImg and interleaved afterwards.
+//
+// Example:
+//
+// wvu::ImageReader reader;
+// if (!reader.Open("/path/to/image.png")) {
+//   ...
+// }
+// std::vector<unsigned char> pixels(reader.rgba8_size_in_bytes());
+// if (!reader.ReadRgba8(pixels.data())) {
+//   ...
+// }
+class ImageReader {
+ public:
+  // Interface of the decoders. Every format implements this interface.
+  class Decoder;
+
+  ImageReader();
+  ~ImageReader();
+
+  // Opens the image and reads its header. Returns true if successful, and
+  // false otherwise.
+  // Parameters:
+  //   image_filepath  The filepath of the image.
+  bool Open(const std::string& image_filepath);
+
+  // Decodes the opened image into pixels. The rows are stored top to bottom
+  // and every texel holds four bytes: red, green, blue and alpha. Missing
+  // channels are expanded, i.e., gray is replicated into red, green and blue,
+  // and alpha is set to 255 for images without alpha. The reader is closed
+  // after this call. Returns true if successful, and false otherwise.
+  // Parameters:
+  //   pixels  A buffer that can hold rgba8_size_in_bytes() bytes.
+  bool ReadRgba8(unsigned char* pixels);
+
+  // Decodes the opened image into pixels without expanding its channels, in
+  // the layout given by native_num_channels() and native_bytes_per_channel()
+  // (e.g., one byte per texel for 8-bit gray images). The rows are stored top
+  // to bottom without padding, and 16-bit channels are stored in the byte
+  // order of the host. The reader is closed after this call. Returns true if
+  // successful, and false otherwise.
+  // Parameters:
+  //   pixels  A buffer that can hold native_size_in_bytes() bytes.
+  bool ReadNative(void* pixels);
+
+  // Releases the resources of the opened image.
+  void Close();
+
+  // Dimensions of the opened image.
+  int width() const { return width_; }
+  int height() const { return height_; }
+  // Number of channels stored in the file (e.g., 1 for gray images).
+  int num_channels() const { return num_channels_; }
+  // Number of bytes needed to hold the image in RGBA8.
+  size_t rgba8_size_in_bytes() const {
+    return static_cast<size_t>(width_) * height_ * 4;
+  }
+  // Layout of the texels decoded by ReadNative(). It matches the file unless
+  // the decoder converts the texels anyway (e.g., palettes are expanded to
+  // RGB or RGBA, and TIFF images are decoded into RGBA8).
+  int native_num_channels() const { return native_num_channels_; }
+  int native_bytes_per_channel() const { return native_bytes_per_channel_; }
+  // Number of bytes needed to hold the image in its native layout.
+  size_t native_size_in_bytes() const {
+    return static_cast<size_t>(width_) * height_ * native_num_channels_ *
+        native_bytes_per_channel_;
+  }
+
+ private:
+  std::unique_ptr<Decoder> decoder_;
+  int width_;
+  int height_;
+  int num_channels_;
+  int native_num_channels_;
+  int native_bytes_per_channel_;
+};
+
+}  // namespace wvu
+
+#endif  // GLUTILS_IMAGE_READER_H_
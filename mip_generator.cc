@@ -0,0 +1,696 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "mip_generator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include "cpu_features.h"
+
+#ifdef GLUTILS_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace wvu {
+namespace {
+// Number of bytes per texel of RGBA8 textures.
+constexpr int kNumBytesPerTexel = 4;
+// Number of rows of the next level that a thread computes at a time.
+constexpr int kBandHeight = 16;
+// Maximum number of texels of a level that contribute to a texel of the next
+// level along each axis.
+constexpr int kMaxNumTaps = 12;
+// Radius of the windowed-sinc filters in texels of the next level.
+constexpr float kSincFilterRadius = 3.0f;
+// Shape of the Kaiser window; higher values reduce the ringing.
+constexpr float kKaiserBeta = 4.0f;
+constexpr float kPi = 3.14159265358979f;
+// Number of buckets of the table that converts linear values to sRGB.
+constexpr int kNumSrgbBuckets = 4096;
+
+// Runs function(begin, end) over bands of rows, which the threads take until
+// there are none left.
+template <typename Function>
+void ParallelForRowBands(const int num_rows,
+                         const int num_threads,
+                         const Function& function) {
+  const int num_bands = (num_rows + kBandHeight - 1) / kBandHeight;
+  std::atomic<int> next_band(0);
+  auto run_bands = [&]() {
+    for (int band = next_band++; band < num_bands; band = next_band++) {
+      function(band * kBandHeight,
+               std::min((band + 1) * kBandHeight, num_rows));
+    }
+  };
+  const int max_num_threads = num_threads > 0 ?
+      num_threads : std::max(1u, std::thread::hardware_concurrency());
+  const int num_workers = std::min(max_num_threads, num_bands) - 1;
+  std::vector<std::thread> workers;
+  for (int i = 0; i < num_workers; ++i) {
+    workers.emplace_back(run_bands);
+  }
+  run_bands();
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+}
+
+// -------------------- Box filter of RGBA8 levels -----------------------------
+// The box filter of linear textures averages the texels in integers, which is
+// exact and faster than the filters in floats.
+
+// Computes the texels [begin, end) of a row of the next level from two rows of
+// the level.
+void DownsampleRowScalar(const unsigned char* row0,
+                         const unsigned char* row1,
+                         const int width,
+                         const int begin,
+                         const int end,
+                         unsigned char* next_row) {
+  for (int x = begin; x < end; ++x) {
+    const int x0 = 2 * x * kNumBytesPerTexel;
+    const int x1 = std::min(2 * x + 1, width - 1) * kNumBytesPerTexel;
+    for (int c = 0; c < kNumBytesPerTexel; ++c) {
+      next_row[x * kNumBytesPerTexel + c] = static_cast<unsigned char>(
+          (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2)
+          >> 2);
+    }
+  }
+}
+
+#ifdef GLUTILS_X86_SIMD
+// The SIMD kernels below return the number of texels of the next row that
+// they computed; the scalar kernel computes the rest. They require that both
+// texels of every pair are in the row, i.e., a width of 2 or more.
+
+GLUTILS_TARGET_SSE2
+int DownsampleRowSse2(const unsigned char* row0,
+                      const unsigned char* row1,
+                      const int next_width,
+                      unsigned char* next_row) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i two = _mm_set1_epi16(2);
+  int x = 0;
+  // 4 texels of the level give 2 texels of the next level.
+  for (; x + 2 <= next_width; x += 2) {
+    const __m128i texels0 = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(row0 + 2 * x * kNumBytesPerTexel));
+    const __m128i texels1 = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(row1 + 2 * x * kNumBytesPerTexel));
+    const __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(texels0, zero),
+                                      _mm_unpacklo_epi8(texels1, zero));
+    const __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(texels0, zero),
+                                       _mm_unpackhi_epi8(texels1, zero));
+    // Add the horizontal pairs.
+    const __m128i sums = _mm_unpacklo_epi64(
+        _mm_add_epi16(low, _mm_srli_si128(low, 8)),
+        _mm_add_epi16(high, _mm_srli_si128(high, 8)));
+    const __m128i averages = _mm_srli_epi16(_mm_add_epi16(sums, two), 2);
+    _mm_storel_epi64(
+        reinterpret_cast<__m128i*>(next_row + x * kNumBytesPerTexel),
+        _mm_packus_epi16(averages, averages));
+  }
+  return x;
+}
+
+GLUTILS_TARGET_AVX2
+int DownsampleRowAvx2(const unsigned char* row0,
+                      const unsigned char* row1,
+                      const int next_width,
+                      unsigned char* next_row) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i two = _mm256_set1_epi16(2);
+  int x = 0;
+  // 8 texels of the level give 4 texels of the next level.
+  for (; x + 4 <= next_width; x += 4) {
+    const __m256i texels0 = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(row0 + 2 * x * kNumBytesPerTexel));
+    const __m256i texels1 = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(row1 + 2 * x * kNumBytesPerTexel));
+    const __m256i low = _mm256_add_epi16(_mm256_unpacklo_epi8(texels0, zero),
+                                         _mm256_unpacklo_epi8(texels1, zero));
+    const __m256i high = _mm256_add_epi16(_mm256_unpackhi_epi8(texels0, zero),
+                                          _mm256_unpackhi_epi8(texels1, zero));
+    const __m256i sums = _mm256_unpacklo_epi64(
+        _mm256_add_epi16(low, _mm256_srli_si256(low, 8)),
+        _mm256_add_epi16(high, _mm256_srli_si256(high, 8)));
+    const __m256i averages = _mm256_srli_epi16(_mm256_add_epi16(sums, two), 2);
+    // Every 128-bit lane holds 2 texels in its low 64 bits.
+    const __m256i packed = _mm256_permute4x64_epi64(
+        _mm256_packus_epi16(averages, averages), 0x08);
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i*>(next_row + x * kNumBytesPerTexel),
+        _mm256_castsi256_si128(packed));
+  }
+  return x;
+}
+#endif  // GLUTILS_X86_SIMD
+
+// Computes the rows [begin, end) of the next level with the 2x2 box filter.
+void DownsampleRgba8Rows(const int width,
+                         const int height,
+                         const unsigned char* level,
+                         const int begin,
+                         const int end,
+                         unsigned char* next_level) {
+  const int next_width = MipLevelSize(width, 1);
+  const size_t row_size_in_bytes =
+      static_cast<size_t>(width) * kNumBytesPerTexel;
+  for (int y = begin; y < end; ++y) {
+    const unsigned char* row0 = level + 2 * y * row_size_in_bytes;
+    const unsigned char* row1 =
+        level + std::min(2 * y + 1, height - 1) * row_size_in_bytes;
+    unsigned char* next_row =
+        next_level + static_cast<size_t>(y) * next_width * kNumBytesPerTexel;
+    int x = 0;
+#ifdef GLUTILS_X86_SIMD
+    if (width > 1) {
+      switch (GetSimdLevel()) {
+        case SIMD_AVX2:
+          x = DownsampleRowAvx2(row0, row1, next_width, next_row);
+          break;
+        case SIMD_SSE2:
+          x = DownsampleRowSse2(row0, row1, next_width, next_row);
+          break;
+        default:
+          break;
+      }
+    }
+#endif
+    DownsampleRowScalar(row0, row1, width, x, next_width, next_row);
+  }
+}
+
+// -------------------- Separable filters in floats ----------------------------
+// The weights of the texels of a level that contribute to a texel of the next
+// level, along one axis. Texel x of the next level is centered between texels
+// 2x and 2x + 1 of the level, and it weights the texels from 2x + first_tap.
+struct Kernel {
+  int first_tap;
+  int num_taps;
+  float weights[kMaxNumTaps];
+};
+
+float Sinc(const float x) {
+  return std::fabs(x) < 1e-6f ? 1.0f : std::sin(kPi * x) / (kPi * x);
+}
+
+// Modified Bessel function of the first kind of order 0.
+float BesselI0(const float x) {
+  float sum = 1.0f;
+  float term = 1.0f;
+  for (int k = 1; k < 20; ++k) {
+    term *= (x / (2.0f * k)) * (x / (2.0f * k));
+    sum += term;
+  }
+  return sum;
+}
+
+Kernel MakeKernel(const MipFilter filter) {
+  Kernel kernel;
+  if (filter == MIP_FILTER_BOX) {
+    kernel.first_tap = 0;
+    kernel.num_taps = 2;
+    kernel.weights[0] = kernel.weights[1] = 0.5f;
+    return kernel;
+  }
+  kernel.first_tap = 1 - kMaxNumTaps / 2;
+  kernel.num_taps = kMaxNumTaps;
+  float sum = 0.0f;
+  for (int k = 0; k < kernel.num_taps; ++k) {
+    // Distance to the center in texels of the next level.
+    const float t = (kernel.first_tap + k - 0.5f) / 2.0f;
+    const float window = filter == MIP_FILTER_LANCZOS ?
+        Sinc(t / kSincFilterRadius) :
+        BesselI0(kKaiserBeta * std::sqrt(std::max(
+            1.0f - (t / kSincFilterRadius) * (t / kSincFilterRadius), 0.0f))) /
+        BesselI0(kKaiserBeta);
+    kernel.weights[k] = Sinc(t) * window;
+    sum += kernel.weights[k];
+  }
+  for (int k = 0; k < kernel.num_taps; ++k) {
+    kernel.weights[k] /= sum;
+  }
+  return kernel;
+}
+
+// Conversions between 8-bit channels and floats in [0, 1].
+struct ChannelTables {
+  // The float of every 8-bit linear or sRGB value.
+  float linear[256];
+  float srgb_to_linear[256];
+  // The linear values halfway between consecutive sRGB values, to round
+  // linear values to the nearest sRGB value.
+  float srgb_thresholds[256];
+  // The sRGB value of the start of every bucket of linear values. The sRGB
+  // values are at most a few thresholds apart within a bucket.
+  unsigned char srgb_buckets[kNumSrgbBuckets];
+
+  ChannelTables() {
+    auto srgb_to_linear_value = [](const float value) {
+      return value <= 0.04045f ?
+          value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    };
+    for (int i = 0; i < 256; ++i) {
+      linear[i] = i / 255.0f;
+      srgb_to_linear[i] = srgb_to_linear_value(i / 255.0f);
+    }
+    for (int i = 0; i < 255; ++i) {
+      srgb_thresholds[i] = srgb_to_linear_value((i + 0.5f) / 255.0f);
+    }
+    // A sentinel above every linear value.
+    srgb_thresholds[255] = 2.0f;
+    for (int i = 0; i < kNumSrgbBuckets; ++i) {
+      srgb_buckets[i] = static_cast<unsigned char>(
+          std::upper_bound(srgb_thresholds, srgb_thresholds + 255,
+                           static_cast<float>(i) / kNumSrgbBuckets) -
+          srgb_thresholds);
+    }
+  }
+};
+
+const ChannelTables& GetChannelTables() {
+  static const ChannelTables tables;
+  return tables;
+}
+
+// Converts a row of RGBA8 texels to floats, in linear light for sRGB colors.
+void DecodeRow(const unsigned char* row,
+               const int width,
+               const bool srgb,
+               float* decoded) {
+  const ChannelTables& tables = GetChannelTables();
+  const float* color_table = srgb ? tables.srgb_to_linear : tables.linear;
+  for (int i = 0; i < width * kNumBytesPerTexel; i += kNumBytesPerTexel) {
+    decoded[i] = color_table[row[i]];
+    decoded[i + 1] = color_table[row[i + 1]];
+    decoded[i + 2] = color_table[row[i + 2]];
+    decoded[i + 3] = tables.linear[row[i + 3]];
+  }
+}
+
+inline unsigned char EncodeLinear(const float value) {
+  return static_cast<unsigned char>(
+      std::lrint(std::min(std::max(value, 0.0f), 1.0f) * 255.0f));
+}
+
+inline unsigned char EncodeSrgb(const ChannelTables& tables,
+                                const float value) {
+  const float clamped = std::min(std::max(value, 0.0f), 1.0f);
+  int srgb = tables.srgb_buckets[std::min(
+      static_cast<int>(clamped * kNumSrgbBuckets), kNumSrgbBuckets - 1)];
+  while (tables.srgb_thresholds[srgb] <= clamped) {
+    ++srgb;
+  }
+  return static_cast<unsigned char>(srgb);
+}
+
+// Computes the texels [begin, end) of a row of the next level, clamping the
+// taps to the row.
+void FilterRowScalar(const Kernel& kernel,
+                     const float* row,
+                     const int width,
+                     const int begin,
+                     const int end,
+                     float* filtered) {
+  for (int x = begin; x < end; ++x) {
+    float sums[kNumBytesPerTexel] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int k = 0; k < kernel.num_taps; ++k) {
+      const int tap =
+          std::min(std::max(2 * x + kernel.first_tap + k, 0), width - 1);
+      for (int c = 0; c < kNumBytesPerTexel; ++c) {
+        sums[c] += kernel.weights[k] * row[tap * kNumBytesPerTexel + c];
+      }
+    }
+    for (int c = 0; c < kNumBytesPerTexel; ++c) {
+      filtered[x * kNumBytesPerTexel + c] = sums[c];
+    }
+  }
+}
+
+// Computes the sum of the rows weighted by the kernel.
+void FilterColumnsScalar(const Kernel& kernel,
+                         const float* const* rows,
+                         const int begin,
+                         const int end,
+                         float* filtered) {
+  for (int i = begin; i < end; ++i) {
+    float sum = 0.0f;
+    for (int k = 0; k < kernel.num_taps; ++k) {
+      sum += kernel.weights[k] * rows[k][i];
+    }
+    filtered[i] = sum;
+  }
+}
+
+// Converts the floats [begin, end) of a row to 8-bit channels.
+void EncodeRowScalar(const float* row,
+                     const bool srgb,
+                     const int begin,
+                     const int end,
+                     unsigned char* encoded) {
+  const ChannelTables& tables = GetChannelTables();
+  for (int i = begin; i < end; ++i) {
+    encoded[i] = srgb && (i & 3) != 3 ? EncodeSrgb(tables, row[i]) :
+        EncodeLinear(row[i]);
+  }
+}
+
+#ifdef GLUTILS_X86_SIMD
+// The SIMD kernels below compute the same sums in the same order as the
+// scalar kernels, so every instruction set produces the same levels. They
+// process the texels (or floats) from begin and return where they stopped.
+
+// Filters the texels of the row whose taps are all in the row. Every texel is
+// a register of 4 channels.
+GLUTILS_TARGET_SSE2
+int FilterRowSse2(const Kernel& kernel,
+                  const float* row,
+                  const int begin,
+                  const int end,
+                  float* filtered) {
+  for (int x = begin; x < end; ++x) {
+    const float* taps = row + (2 * x + kernel.first_tap) * kNumBytesPerTexel;
+    __m128 sum = _mm_setzero_ps();
+    for (int k = 0; k < kernel.num_taps; ++k) {
+      sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(kernel.weights[k]),
+                                       _mm_loadu_ps(taps + 4 * k)));
+    }
+    _mm_storeu_ps(filtered + x * kNumBytesPerTexel, sum);
+  }
+  return end;
+}
+
+// As above, with two texels per register.
+GLUTILS_TARGET_AVX2
+int FilterRowAvx2(const Kernel& kernel,
+                  const float* row,
+                  const int begin,
+                  const int end,
+                  float* filtered) {
+  int x = begin;
+  for (; x + 2 <= end; x += 2) {
+    const float* taps = row + (2 * x + kernel.first_tap) * kNumBytesPerTexel;
+    __m256 sum = _mm256_setzero_ps();
+    for (int k = 0; k < kernel.num_taps; ++k) {
+      // The taps of the second texel are 2 texels further.
+      const __m256 texels = _mm256_insertf128_ps(
+          _mm256_castps128_ps256(_mm_loadu_ps(taps + 4 * k)),
+          _mm_loadu_ps(taps + 4 * k + 2 * kNumBytesPerTexel), 1);
+      sum = _mm256_add_ps(sum, _mm256_mul_ps(
+          _mm256_set1_ps(kernel.weights[k]), texels));
+    }
+    _mm256_storeu_ps(filtered + x * kNumBytesPerTexel, sum);
+  }
+  return x;
+}
+
+GLUTILS_TARGET_SSE2
+int FilterColumnsSse2(const Kernel& kernel,
+                      const float* const* rows,
+                      const int end,
+                      float* filtered) {
+  int i = 0;
+  for (; i + 4 <= end; i += 4) {
+    __m128 sum = _mm_setzero_ps();
+    for (int k = 0; k < kernel.num_taps; ++k) {
+      sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(kernel.weights[k]),
+                                       _mm_loadu_ps(rows[k] + i)));
+    }
+    _mm_storeu_ps(filtered + i, sum);
+  }
+  return i;
+}
+
+GLUTILS_TARGET_AVX2
+int FilterColumnsAvx2(const Kernel& kernel,
+                      const float* const* rows,
+                      const int end,
+                      float* filtered) {
+  int i = 0;
+  for (; i + 8 <= end; i += 8) {
+    __m256 sum = _mm256_setzero_ps();
+    for (int k = 0; k < kernel.num_taps; ++k) {
+      sum = _mm256_add_ps(sum, _mm256_mul_ps(
+          _mm256_set1_ps(kernel.weights[k]), _mm256_loadu_ps(rows[k] + i)));
+    }
+    _mm256_storeu_ps(filtered + i, sum);
+  }
+  return i;
+}
+
+// Converts linear floats to 8-bit channels, 16 at a time. The conversion
+// rounds to the nearest even value, as std::lrint().
+GLUTILS_TARGET_AVX2
+int EncodeLinearRowAvx2(const float* row,
+                        const int end,
+                        unsigned char* encoded) {
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 scale = _mm256_set1_ps(255.0f);
+  int i = 0;
+  for (; i + 16 <= end; i += 16) {
+    const __m256i values0 = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_min_ps(
+        _mm256_max_ps(_mm256_loadu_ps(row + i), zero), one), scale));
+    const __m256i values1 = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_min_ps(
+        _mm256_max_ps(_mm256_loadu_ps(row + i + 8), zero), one), scale));
+    // The packs work within 128-bit lanes, so the values are reordered.
+    const __m256i words = _mm256_permute4x64_epi64(
+        _mm256_packs_epi32(values0, values1), 0xD8);
+    const __m256i bytes = _mm256_permute4x64_epi64(
+        _mm256_packus_epi16(words, words), 0x08);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(encoded + i),
+                     _mm256_castsi256_si128(bytes));
+  }
+  return i;
+}
+#endif  // GLUTILS_X86_SIMD
+
+// Computes the rows [begin, end) of the next level with the separable kernel.
+// The rows of the level that the band needs are filtered horizontally first.
+void FilterRgba8Rows(const Kernel& kernel,
+                     const bool srgb,
+                     const int width,
+                     const int height,
+                     const unsigned char* level,
+                     const int begin,
+                     const int end,
+                     unsigned char* next_level) {
+  const int next_width = MipLevelSize(width, 1);
+  const int num_floats = next_width * kNumBytesPerTexel;
+  const int first_row = 2 * begin + kernel.first_tap;
+  const int num_rows = 2 * (end - begin) + kernel.num_taps - 2;
+  std::vector<float> decoded(static_cast<size_t>(width) * kNumBytesPerTexel);
+  std::vector<float> filtered_rows(static_cast<size_t>(num_rows) * num_floats);
+  std::vector<float> filtered(num_floats);
+  // The texels whose taps are all in the row.
+  const int interior_begin = std::min((1 - kernel.first_tap) / 2, next_width);
+  const int last_tap_room = width - kernel.num_taps - kernel.first_tap;
+  const int interior_end = last_tap_room < 0 ? interior_begin :
+      std::max(std::min(last_tap_room / 2 + 1, next_width), interior_begin);
+#ifdef GLUTILS_X86_SIMD
+  const SimdLevel simd_level = GetSimdLevel();
+#endif
+  for (int j = 0; j < num_rows; ++j) {
+    const int y = std::min(std::max(first_row + j, 0), height - 1);
+    DecodeRow(level + static_cast<size_t>(y) * width * kNumBytesPerTexel,
+              width, srgb, decoded.data());
+    float* row = filtered_rows.data() + static_cast<size_t>(j) * num_floats;
+    int x = interior_begin;
+#ifdef GLUTILS_X86_SIMD
+    switch (simd_level) {
+      case SIMD_AVX2:
+        x = FilterRowAvx2(kernel, decoded.data(), x, interior_end, row);
+        break;
+      case SIMD_SSE2:
+        x = FilterRowSse2(kernel, decoded.data(), x, interior_end, row);
+        break;
+      default:
+        break;
+    }
+#endif
+    FilterRowScalar(kernel, decoded.data(), width, 0, interior_begin, row);
+    FilterRowScalar(kernel, decoded.data(), width, x, next_width, row);
+  }
+  for (int y = begin; y < end; ++y) {
+    const float* rows[kMaxNumTaps];
+    for (int k = 0; k < kernel.num_taps; ++k) {
+      rows[k] = filtered_rows.data() +
+          static_cast<size_t>(2 * (y - begin) + k) * num_floats;
+    }
+    int i = 0;
+#ifdef GLUTILS_X86_SIMD
+    switch (simd_level) {
+      case SIMD_AVX2:
+        i = FilterColumnsAvx2(kernel, rows, num_floats, filtered.data());
+        break;
+      case SIMD_SSE2:
+        i = FilterColumnsSse2(kernel, rows, num_floats, filtered.data());
+        break;
+      default:
+        break;
+    }
+#endif
+    FilterColumnsScalar(kernel, rows, i, num_floats, filtered.data());
+    unsigned char* next_row =
+        next_level + static_cast<size_t>(y) * num_floats;
+    i = 0;
+#ifdef GLUTILS_X86_SIMD
+    if (!srgb && simd_level == SIMD_AVX2) {
+      i = EncodeLinearRowAvx2(filtered.data(), num_floats, next_row);
+    }
+#endif
+    EncodeRowScalar(filtered.data(), srgb, i, num_floats, next_row);
+  }
+}
+
+// -------------------- Alpha coverage -----------------------------------------
+// Returns the fraction of texels whose alpha, scaled, is above the reference.
+float ComputeAlphaCoverage(const unsigned char* rgba,
+                           const size_t num_texels,
+                           const float reference,
+                           const float scale) {
+  const float threshold = reference * 255.0f;
+  size_t num_covered = 0;
+  for (size_t i = 0; i < num_texels; ++i) {
+    if (rgba[kNumBytesPerTexel * i + 3] * scale > threshold) {
+      ++num_covered;
+    }
+  }
+  return static_cast<float>(num_covered) / num_texels;
+}
+
+// Scales the alpha of the level so that its coverage is the closest to the
+// target coverage.
+void ScaleAlphaCoverage(const float target_coverage,
+                        const float reference,
+                        const size_t num_texels,
+                        unsigned char* rgba) {
+  // The coverage grows with the scale; bisect it.
+  float lower = 0.0f;
+  float upper = 4.0f;
+  float best_scale = 1.0f;
+  float best_difference = std::fabs(
+      ComputeAlphaCoverage(rgba, num_texels, reference, 1.0f) -
+      target_coverage);
+  for (int iteration = 0; iteration < 16 && best_difference > 0.0f;
+       ++iteration) {
+    const float scale = 0.5f * (lower + upper);
+    const float coverage =
+        ComputeAlphaCoverage(rgba, num_texels, reference, scale);
+    const float difference = std::fabs(coverage - target_coverage);
+    if (difference < best_difference) {
+      best_difference = difference;
+      best_scale = scale;
+    }
+    if (coverage < target_coverage) {
+      lower = scale;
+    } else {
+      upper = scale;
+    }
+  }
+  if (best_scale == 1.0f) {
+    return;
+  }
+  for (size_t i = 0; i < num_texels; ++i) {
+    unsigned char& alpha = rgba[kNumBytesPerTexel * i + 3];
+    alpha = static_cast<unsigned char>(
+        std::min(std::lrint(alpha * best_scale), 255L));
+  }
+}
+
+}  // namespace
+
+int NumMipLevels(const int width, const int height) {
+  int num_levels = 1;
+  for (int size = std::max(width, height); size > 1; size >>= 1) {
+    ++num_levels;
+  }
+  return num_levels;
+}
+
+size_t Rgba8MipChainSizeInBytes(const int width, const int height) {
+  size_t size_in_bytes = 0;
+  const int num_levels = NumMipLevels(width, height);
+  for (int level = 0; level < num_levels; ++level) {
+    size_in_bytes += static_cast<size_t>(MipLevelSize(width, level)) *
+        MipLevelSize(height, level) * kNumBytesPerTexel;
+  }
+  return size_in_bytes;
+}
+
+void GenerateRgba8MipChain(const int width,
+                           const int height,
+                           const MipGenerationOptions& options,
+                           unsigned char* mip_chain) {
+  const int num_levels = NumMipLevels(width, height);
+  const Kernel kernel = MakeKernel(options.filter);
+  const bool integer_box = options.filter == MIP_FILTER_BOX && !options.srgb;
+  const bool preserve_alpha_coverage = options.alpha_coverage_reference > 0.0f;
+  const float alpha_coverage = preserve_alpha_coverage ?
+      ComputeAlphaCoverage(mip_chain, static_cast<size_t>(width) * height,
+                           options.alpha_coverage_reference, 1.0f) : 0.0f;
+  unsigned char* level = mip_chain;
+  for (int i = 1; i < num_levels; ++i) {
+    const int level_width = MipLevelSize(width, i - 1);
+    const int level_height = MipLevelSize(height, i - 1);
+    unsigned char* next_level = level +
+        static_cast<size_t>(level_width) * level_height * kNumBytesPerTexel;
+    const int next_height = MipLevelSize(height, i);
+    ParallelForRowBands(next_height, options.num_threads,
+                        [&](const int begin, const int end) {
+      if (integer_box) {
+        DownsampleRgba8Rows(level_width, level_height, level, begin, end,
+                            next_level);
+      } else {
+        FilterRgba8Rows(kernel, options.srgb, level_width, level_height,
+                        level, begin, end, next_level);
+      }
+    });
+    if (preserve_alpha_coverage) {
+      ScaleAlphaCoverage(
+          alpha_coverage, options.alpha_coverage_reference,
+          static_cast<size_t>(MipLevelSize(width, i)) * next_height,
+          next_level);
+    }
+    level = next_level;
+  }
+}
+
+}  // namespace wvu
@@ -0,0 +1,100 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_MIP_GENERATOR_H_
+#define GLUTILS_MIP_GENERATOR_H_
+
+#include <cstddef>
+
+namespace wvu {
+// Returns the number of levels of the complete mip chain of a texture, i.e.,
+// until the level is 1x1.
+int NumMipLevels(const int width, const int height);
+
+// Returns the width or height of the mip level given the size of level 0.
+inline int MipLevelSize(const int size, const int level) {
+  return (size >> level) > 0 ? (size >> level) : 1;
+}
+
+// Returns the number of bytes of the complete mip chain of an RGBA8 texture.
+size_t Rgba8MipChainSizeInBytes(const int width, const int height);
+
+// Filters that compute every mip level from the previous one.
+enum MipFilter {
+  // 2x2 box filter. Fast, but slightly blurry and prone to aliasing.
+  MIP_FILTER_BOX = 0,
+  // Kaiser-windowed sinc over 3 texels of the level on each side. Sharper
+  // than the box filter with little ringing.
+  MIP_FILTER_KAISER = 1,
+  // Lanczos-windowed sinc over 3 texels of the level on each side. The
+  // sharpest of the filters; it may ring around hard edges.
+  MIP_FILTER_LANCZOS = 2
+};
+
+// Options of the generation of mip chains.
+struct MipGenerationOptions {
+  // The filter of the levels.
+  MipFilter filter = MIP_FILTER_BOX;
+  // If true, the color channels are sRGB-encoded and they are filtered in
+  // linear light, so the levels keep the brightness of level 0. The alpha is
+  // always linear.
+  bool srgb = false;
+  // If positive, the alpha of every level is scaled so that the fraction of
+  // texels with an alpha above the reference (in [0, 1]) is that of level 0.
+  // This keeps alpha-tested cutouts, e.g., foliage, from thinning out with the
+  // distance. Typically 0.5.
+  float alpha_coverage_reference = 0.0f;
+  // Number of threads; 0 uses one thread per core. It does not change the
+  // levels.
+  int num_threads = 0;
+};
+
+// Generates the mip chain of an RGBA8 texture on the CPU. The rows of every
+// level are split among threads, and the filters run with SSE2 or AVX2 when
+// the CPU supports them, see cpu_features.h. Odd sizes repeat the last row or
+// column.
+// Parameters:
+//   width, height  The size of level 0.
+//   options  The options of the generation.
+//   mip_chain  The texels of level 0 followed by room for the other levels,
+//     i.e., Rgba8MipChainSizeInBytes(width, height) bytes. The levels are
+//     stored consecutively, from level 0 to the 1x1 level.
+void GenerateRgba8MipChain(const int width,
+                           const int height,
+                           const MipGenerationOptions& options,
+                           unsigned char* mip_chain);
+
+}  // namespace wvu
+
+#endif  // GLUTILS_MIP_GENERATOR_H_
@@ -0,0 +1,241 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "program_binary_cache.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <GL/glew.h>
+
+#include <glog/logging.h>
+
+#include "hash.h"
+#include "mapped_file.h"
+
+namespace wvu {
+namespace {
+// The layout of the files:
+//   Identifier (8 bytes).
+//   Version of the layout (uint32).
+//   Format of the binary, as returned by glGetProgramBinary() (uint32).
+//   Key of the program (uint64).
+//   Time to compile and link the program from its sources in milliseconds
+//     (double).
+//   Size of the binary in bytes (uint64).
+//   Binary.
+constexpr char kIdentifier[8] = { 'W', 'V', 'U', 'P', 'B', 'I', 'N', '\0' };
+constexpr uint32_t kVersion = 1;
+constexpr size_t kHeaderSize = 40;
+
+// The files are little-endian, like the hosts this code runs on.
+template <typename T>
+void Write(const T value, std::vector<unsigned char>* bytes) {
+  const unsigned char* value_bytes =
+      reinterpret_cast<const unsigned char*>(&value);
+  bytes->insert(bytes->end(), value_bytes, value_bytes + sizeof(value));
+}
+
+template <typename T>
+T Read(const unsigned char* bytes) {
+  T value;
+  memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+// Returns the OpenGL string, or an empty string if the driver returns none.
+std::string GetGlString(const GLenum name) {
+  const GLubyte* value = glGetString(name);
+  return value != nullptr ? reinterpret_cast<const char*>(value) : "";
+}
+
+// Hashes the string with the hash of the previous strings as seed.
+uint64_t HashString(const std::string& value, const uint64_t seed) {
+  return Hash64(value.data(), value.size(), seed);
+}
+
+}  // namespace
+
+ProgramBinaryCache::ProgramBinaryCache(const std::string& directory) :
+    directory_(directory), num_hits_(0), num_misses_(0), num_rejected_(0),
+    saved_milliseconds_(0.0) {
+  if (mkdir(directory_.c_str(), 0755) != 0 && errno != EEXIST) {
+    LOG(ERROR) << "Could not create the program binary cache directory "
+               << directory_;
+  }
+}
+
+bool ProgramBinaryCache::IsSupported() {
+  if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary) {
+    return false;
+  }
+  GLint num_formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+  return num_formats > 0;
+}
+
+uint64_t ProgramBinaryCache::ComputeKey(
+    const std::string& vertex_shader_source,
+    const std::string& fragment_shader_source) {
+  uint64_t key = HashString(GetGlString(GL_VENDOR), 0);
+  key = HashString(GetGlString(GL_RENDERER), key);
+  key = HashString(GetGlString(GL_VERSION), key);
+  key = HashString(vertex_shader_source, key);
+  return HashString(fragment_shader_source, key);
+}
+
+std::string ProgramBinaryCache::ProgramBinaryFilepath(
+    const uint64_t key) const {
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.bin",
+           static_cast<unsigned long long>(key));
+  return directory_ + "/" + name;
+}
+
+GLuint ProgramBinaryCache::Load(const uint64_t key) {
+  const std::string filepath = ProgramBinaryFilepath(key);
+  MappedFile file;
+  if (!file.Open(filepath)) {
+    ++num_misses_;
+    return 0;
+  }
+  const unsigned char* bytes = file.data();
+  if (file.size() < kHeaderSize ||
+      memcmp(bytes, kIdentifier, sizeof(kIdentifier)) != 0 ||
+      Read<uint32_t>(bytes + 8) != kVersion ||
+      Read<uint64_t>(bytes + 16) != key ||
+      Read<uint64_t>(bytes + 32) != file.size() - kHeaderSize) {
+    LOG(WARNING) << "Ignoring the invalid program binary " << filepath;
+    ++num_misses_;
+    return 0;
+  }
+  const GLenum binary_format = Read<uint32_t>(bytes + 12);
+  const double compile_milliseconds = Read<double>(bytes + 24);
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  const GLuint program_id = glCreateProgram();
+  glProgramBinary(program_id, binary_format, bytes + kHeaderSize,
+                  static_cast<GLsizei>(file.size() - kHeaderSize));
+  GLint success = 0;
+  glGetProgramiv(program_id, GL_LINK_STATUS, &success);
+  if (!success) {
+    // Unsupported formats also leave GL_INVALID_ENUM behind.
+    glGetError();
+    glDeleteProgram(program_id);
+    LOG(INFO) << "The driver rejected the program binary " << filepath
+              << "; the program is compiled again.";
+    file.Close();
+    remove(filepath.c_str());
+    ++num_misses_;
+    ++num_rejected_;
+    return 0;
+  }
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  ++num_hits_;
+  saved_milliseconds_ += std::max(compile_milliseconds - elapsed.count(), 0.0);
+  VLOG(1) << "Loaded the program binary " << filepath << " in "
+          << elapsed.count() << " ms instead of compiling it in "
+          << compile_milliseconds << " ms.";
+  return program_id;
+}
+
+bool ProgramBinaryCache::Store(const uint64_t key,
+                               const GLuint program_id,
+                               const double compile_milliseconds) {
+  GLint binary_length = 0;
+  glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &binary_length);
+  if (binary_length <= 0) {
+    LOG(WARNING) << "The driver returned no binary for the program "
+                 << program_id;
+    return false;
+  }
+  std::vector<unsigned char> bytes(kHeaderSize + binary_length);
+  GLsizei written_length = 0;
+  GLenum binary_format = 0;
+  glGetProgramBinary(program_id, binary_length, &written_length,
+                     &binary_format, bytes.data() + kHeaderSize);
+  if (written_length <= 0) {
+    LOG(WARNING) << "Could not retrieve the binary of the program "
+                 << program_id;
+    return false;
+  }
+  bytes.resize(kHeaderSize + written_length);
+  std::vector<unsigned char> header(kIdentifier,
+                                    kIdentifier + sizeof(kIdentifier));
+  Write<uint32_t>(kVersion, &header);
+  Write<uint32_t>(binary_format, &header);
+  Write<uint64_t>(key, &header);
+  Write<double>(compile_milliseconds, &header);
+  Write<uint64_t>(written_length, &header);
+  std::copy(header.begin(), header.end(), bytes.begin());
+
+  // Write under a name unique to this process and thread, since several
+  // processes may share the directory, and rename it, which is atomic.
+  const std::string filepath = ProgramBinaryFilepath(key);
+  std::ostringstream temporary_filepath;
+  temporary_filepath << filepath << ".tmp" << getpid() << "."
+                     << std::hash<std::thread::id>()(
+                         std::this_thread::get_id());
+  {
+    std::ofstream file(temporary_filepath.str(),
+                       std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    if (!file) {
+      LOG(ERROR) << "Could not write the program binary " << filepath;
+      file.close();
+      remove(temporary_filepath.str().c_str());
+      return false;
+    }
+  }
+  if (rename(temporary_filepath.str().c_str(), filepath.c_str()) != 0) {
+    LOG(ERROR) << "Could not rename the program binary " << filepath;
+    remove(temporary_filepath.str().c_str());
+    return false;
+  }
+  return true;
+}
+
+}  // namespace wvu
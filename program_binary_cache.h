@@ -0,0 +1,120 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_PROGRAM_BINARY_CACHE_H_
+#define GLUTILS_PROGRAM_BINARY_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <GL/glew.h>
+
+namespace wvu {
+// This class keeps the binaries of linked shader programs on disk, as returned
+// by glGetProgramBinary(), so that the next runs create the programs with
+// glProgramBinary() instead of compiling and linking their sources. Every
+// binary is stored in a file named after its key: the hash of the shader
+// sources combined with the GL_VENDOR, GL_RENDERER and GL_VERSION strings, so
+// that a driver update or a different GPU never reads a stale binary. Drivers
+// may still reject a binary, e.g., after an update that keeps the version
+// string; the rejected binaries are deleted and the program is compiled again.
+// All the member functions must be called from the thread that owns the
+// OpenGL context.
+//
+// Example:
+//
+// wvu::ProgramBinaryCache program_binary_cache("/tmp/program_cache");
+// wvu::ShaderProgram shader_program;
+// shader_program.LoadVertexShaderFromFile("/absolute/path/to/vertex_shader");
+// shader_program.LoadFragmentShaderFromFile(
+//     "/absolute/path/to/fragment_shader");
+// std::string error_info_log;
+// if (!shader_program.Create(&program_binary_cache, &error_info_log)) {
+//   LOG(ERROR) << error_info_log;
+// }
+class ProgramBinaryCache {
+ public:
+  // Constructor. Creates the directory if it does not exist.
+  // Parameters:
+  //   directory  The directory where the program binaries are stored.
+  explicit ProgramBinaryCache(const std::string& directory);
+  ~ProgramBinaryCache() {}
+
+  // Returns true if the driver supports program binaries (OpenGL 4.1 or
+  // ARB_get_program_binary) in at least one format.
+  static bool IsSupported();
+
+  // Returns the key of the program with the sources on the current driver.
+  static uint64_t ComputeKey(const std::string& vertex_shader_source,
+                             const std::string& fragment_shader_source);
+
+  // Creates a program from the binary with the key. Returns the id of the
+  // linked program, or 0 if the binary is not in the cache or the driver
+  // rejects it.
+  GLuint Load(const uint64_t key);
+
+  // Stores the binary of the program, which must be linked with
+  // GL_PROGRAM_BINARY_RETRIEVABLE_HINT. The file is written under a
+  // temporary name and renamed, so readers never see partial files. Returns
+  // true if successful, and false otherwise.
+  // Parameters:
+  //   key  The key of the program.
+  //   program_id  The linked program.
+  //   compile_milliseconds  The time it took to compile and link the program
+  //     from its sources, which the loads of the binary report as saved.
+  bool Store(const uint64_t key,
+             const GLuint program_id,
+             const double compile_milliseconds);
+
+  // Returns the filepath of the binary with the key.
+  std::string ProgramBinaryFilepath(const uint64_t key) const;
+
+  // Statistics of Load(). The misses include the rejected binaries. The saved
+  // time is the compile time of the hits minus the time to load them.
+  size_t num_hits() const { return num_hits_; }
+  size_t num_misses() const { return num_misses_; }
+  size_t num_rejected() const { return num_rejected_; }
+  double saved_milliseconds() const { return saved_milliseconds_; }
+
+ private:
+  const std::string directory_;
+  size_t num_hits_;
+  size_t num_misses_;
+  size_t num_rejected_;
+  double saved_milliseconds_;
+};
+
+}  // namespace wvu
+
+#endif  // GLUTILS_PROGRAM_BINARY_CACHE_H_
@@ -34,12 +34,19 @@
 
 #include "shader_program.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <vector>
 #include <GL/glew.h>
 
+#include <glog/logging.h>
+
 namespace wvu {
 namespace {
 // Buffer size for the error log info.
@@ -51,13 +58,11 @@ enum ShaderType {
   FRAGMENT = 1
 };
 
-// Compiles a shader that is contained in shader_src C++ string. The shader type
-// determines what shader we should compile. This function retrieves the errors
-// in case of compilation errors and stores it into info_log. This function
-// returns the shader id if successful, otherwise it returns zero.
-GLuint CompileShader(const std::string& shader_src,
-                     const ShaderType shader_type,
-                     std::string* info_log) {
+// Submits the compilation of a shader that is contained in shader_src C++
+// string. The shader type determines what shader we should compile. This
+// function does not wait for the compilation, and returns the shader id.
+GLuint SubmitShader(const std::string& shader_src,
+                    const ShaderType shader_type) {
   // Create an id for shader using OpenGL glCreateShader().
   GLuint shader_id = 0;
   switch (shader_type) {
@@ -76,6 +81,13 @@ GLuint CompileShader(const std::string& shader_src,
   glShaderSource(shader_id, 1, &shader_src_ptr, nullptr);
   // Compile the shader.
   glCompileShader(shader_id);
+  return shader_id;
+}
+
+// Returns true if the compilation of the shader was successful, which waits for
+// it. This function retrieves the errors in case of compilation errors and
+// stores it into info_log.
+bool CheckShader(const GLuint shader_id, std::string* info_log) {
   // Verify if the compilation was successful.
   GLint success = 0;
   // Retrieve if the compilation was successful. The function returns a non-zero
@@ -88,30 +100,43 @@ GLuint CompileShader(const std::string& shader_src,
     if (info_log) {
       // Allocate the number of chars in the string.
       info_log->resize(kNumCharsInfoLog);
-      // Retrieve the error ingo log.
-      glGetShaderInfoLog(shader_id, kNumCharsInfoLog, nullptr,
+      // Retrieve the error ingo log, and drop the unused part of the buffer.
+      GLsizei length = 0;
+      glGetShaderInfoLog(shader_id, kNumCharsInfoLog, &length,
                          &info_log->front());
+      info_log->resize(length);
     }
-    return 0;
+    return false;
   }
-  return shader_id;
+  return true;
 }
 
-// Creates a shader program. This function requires the ids of the vertex and
-// fragment shaders which were successfully compiled. The function can return
-// the error info log string in case of a failure. The function returns the
-// shader program id if successfull, and returns zero otherwise.
-GLuint CreateShaderProgram(const GLuint vertex_shader,
+// Submits the creation of a shader program from the ids of the vertex and
+// fragment shaders, whose compilation may still be in progress. This function
+// does not wait for the linking, and returns the program id. When
+// binary_retrievable is true, the driver is told that the binary of the
+// program will be retrieved, which it must know before linking.
+GLuint SubmitShaderProgram(const GLuint vertex_shader,
                            const GLuint fragment_shader,
-                           std::string* info_log) {
+                           const bool binary_retrievable) {
   // Create a program id.
   const GLuint shader_program = glCreateProgram();
+  if (binary_retrievable) {
+    glProgramParameteri(shader_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                        GL_TRUE);
+  }
   // Attach to the program the vertex shader.
   glAttachShader(shader_program, vertex_shader);
   // Attach to the program the fragment shader.
   glAttachShader(shader_program, fragment_shader);
   // Link the both shaders to get a shader program.
   glLinkProgram(shader_program);
+  return shader_program;
+}
+
+// Returns true if the linking of the program was successful, which waits for
+// it. The function can return the error info log string in case of a failure.
+bool CheckShaderProgram(const GLuint shader_program, std::string* info_log) {
   // Check if the operation was successful.
   GLint success = 0;
   // Get the status of the linkage procedure. The function returns a non-zero
@@ -121,13 +146,15 @@ GLuint CreateShaderProgram(const GLuint vertex_shader,
     if (info_log) {
       // Allocate the number of chars in the string.
       info_log->resize(kNumCharsInfoLog);
-      // Retrieve the error ingo log.
-      glGetProgramInfoLog(shader_program, kNumCharsInfoLog, nullptr,
+      // Retrieve the error ingo log, and drop the unused part of the buffer.
+      GLsizei length = 0;
+      glGetProgramInfoLog(shader_program, kNumCharsInfoLog, &length,
                           &info_log->front());
+      info_log->resize(length);
     }
-    return 0;
+    return false;
   }
-  return shader_program;
+  return true;
 }
 
 // Releases the resources allocated for compilation of shaders.
@@ -161,6 +188,236 @@ bool LoadShaderFromFile(const std::string& filepath,
   return true;
 }
 
+// Removes the "[0]" suffix that OpenGL appends to the names of arrays, so the
+// arrays can be found by their names in the shader sources.
+std::string TrimArraySuffix(const std::string& name) {
+  static const std::string kArraySuffix = "[0]";
+  if (name.size() > kArraySuffix.size() &&
+      name.compare(name.size() - kArraySuffix.size(), kArraySuffix.size(),
+                   kArraySuffix) == 0) {
+    return name.substr(0, name.size() - kArraySuffix.size());
+  }
+  return name;
+}
+
+// Built-in variables such as gl_VertexID are reported as active resources but
+// cannot be set.
+bool IsBuiltInName(const std::string& name) {
+  return name.compare(0, 3, "gl_") == 0;
+}
+
+// Returns true for the types of uniforms that glUniform1i() sets: integers,
+// booleans and samplers.
+bool IsIntegerUniformType(const GLenum type) {
+  switch (type) {
+    case GL_INT:
+    case GL_BOOL:
+    case GL_SAMPLER_1D:
+    case GL_SAMPLER_2D:
+    case GL_SAMPLER_3D:
+    case GL_SAMPLER_CUBE:
+    case GL_SAMPLER_1D_SHADOW:
+    case GL_SAMPLER_2D_SHADOW:
+    case GL_SAMPLER_1D_ARRAY:
+    case GL_SAMPLER_2D_ARRAY:
+    case GL_SAMPLER_1D_ARRAY_SHADOW:
+    case GL_SAMPLER_2D_ARRAY_SHADOW:
+    case GL_SAMPLER_CUBE_SHADOW:
+    case GL_SAMPLER_2D_RECT:
+    case GL_SAMPLER_2D_RECT_SHADOW:
+    case GL_SAMPLER_BUFFER:
+    case GL_SAMPLER_2D_MULTISAMPLE:
+    case GL_SAMPLER_2D_MULTISAMPLE_ARRAY:
+    case GL_SAMPLER_CUBE_MAP_ARRAY:
+    case GL_INT_SAMPLER_2D:
+    case GL_INT_SAMPLER_3D:
+    case GL_INT_SAMPLER_CUBE:
+    case GL_INT_SAMPLER_2D_ARRAY:
+    case GL_UNSIGNED_INT_SAMPLER_2D:
+    case GL_UNSIGNED_INT_SAMPLER_3D:
+    case GL_UNSIGNED_INT_SAMPLER_CUBE:
+    case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Returns the number of bytes of an element of a uniform that the setters
+// cache, or zero if no setter accepts the type.
+size_t UniformValueSize(const GLenum type) {
+  if (IsIntegerUniformType(type)) return sizeof(GLint);
+  switch (type) {
+    case GL_FLOAT: return sizeof(GLfloat);
+    case GL_FLOAT_VEC2: return 2 * sizeof(GLfloat);
+    case GL_FLOAT_VEC3: return 3 * sizeof(GLfloat);
+    case GL_FLOAT_VEC4: return 4 * sizeof(GLfloat);
+    case GL_FLOAT_MAT4: return 16 * sizeof(GLfloat);
+    default: return 0;
+  }
+}
+
+// Returns true if the driver can enumerate the resources of a program with
+// glGetProgramResourceiv(), which reads all the properties of a resource in a
+// single call.
+bool HasProgramInterfaceQuery() {
+  return GLEW_VERSION_4_3 || GLEW_ARB_program_interface_query;
+}
+
+// Returns true if the driver supports uniform blocks.
+bool HasUniformBlocks() {
+  return GLEW_VERSION_3_1 || GLEW_ARB_uniform_buffer_object;
+}
+
+// Returns the name of a resource of the program.
+std::string GetProgramResourceName(const GLuint program,
+                                   const GLenum interface,
+                                   const GLuint index,
+                                   const GLint name_length) {
+  std::string name(std::max(name_length, 1), '\0');
+  GLsizei length = 0;
+  glGetProgramResourceName(program, interface, index, name_length, &length,
+                           &name.front());
+  name.resize(length);
+  return name;
+}
+
+// Enumerates the resources of the program with the program interface query.
+void ReflectProgramResources(const GLuint program,
+                             std::vector<UniformInfo>* uniforms,
+                             std::vector<AttributeInfo>* attributes,
+                             std::vector<UniformBlockInfo>* uniform_blocks) {
+  GLint num_resources = 0;
+  glGetProgramInterfaceiv(program, GL_UNIFORM, GL_ACTIVE_RESOURCES,
+                          &num_resources);
+  static const GLenum kUniformProperties[] = {
+    GL_NAME_LENGTH, GL_TYPE, GL_ARRAY_SIZE, GL_LOCATION, GL_BLOCK_INDEX,
+    GL_OFFSET
+  };
+  for (GLint i = 0; i < num_resources; ++i) {
+    GLint values[6];
+    glGetProgramResourceiv(program, GL_UNIFORM, i, 6, kUniformProperties, 6,
+                           nullptr, values);
+    UniformInfo uniform;
+    uniform.name = TrimArraySuffix(
+        GetProgramResourceName(program, GL_UNIFORM, i, values[0]));
+    if (IsBuiltInName(uniform.name)) continue;
+    uniform.type = values[1];
+    uniform.size = values[2];
+    uniform.location = values[3];
+    uniform.block_index = values[4];
+    uniform.offset = values[5];
+    uniforms->push_back(uniform);
+  }
+
+  glGetProgramInterfaceiv(program, GL_PROGRAM_INPUT, GL_ACTIVE_RESOURCES,
+                          &num_resources);
+  static const GLenum kAttributeProperties[] = {
+    GL_NAME_LENGTH, GL_TYPE, GL_ARRAY_SIZE, GL_LOCATION
+  };
+  for (GLint i = 0; i < num_resources; ++i) {
+    GLint values[4];
+    glGetProgramResourceiv(program, GL_PROGRAM_INPUT, i, 4,
+                           kAttributeProperties, 4, nullptr, values);
+    AttributeInfo attribute;
+    attribute.name = TrimArraySuffix(
+        GetProgramResourceName(program, GL_PROGRAM_INPUT, i, values[0]));
+    if (IsBuiltInName(attribute.name)) continue;
+    attribute.type = values[1];
+    attribute.size = values[2];
+    attribute.location = values[3];
+    attributes->push_back(attribute);
+  }
+
+  glGetProgramInterfaceiv(program, GL_UNIFORM_BLOCK, GL_ACTIVE_RESOURCES,
+                          &num_resources);
+  static const GLenum kBlockProperties[] = {
+    GL_NAME_LENGTH, GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE
+  };
+  for (GLint i = 0; i < num_resources; ++i) {
+    GLint values[3];
+    glGetProgramResourceiv(program, GL_UNIFORM_BLOCK, i, 3, kBlockProperties,
+                           3, nullptr, values);
+    UniformBlockInfo uniform_block;
+    uniform_block.name =
+        GetProgramResourceName(program, GL_UNIFORM_BLOCK, i, values[0]);
+    uniform_block.index = i;
+    uniform_block.binding = values[1];
+    uniform_block.data_size = values[2];
+    uniform_blocks->push_back(uniform_block);
+  }
+}
+
+// Enumerates the resources of the program with the queries of OpenGL 3, for
+// drivers without the program interface query.
+void ReflectActiveResources(const GLuint program,
+                            std::vector<UniformInfo>* uniforms,
+                            std::vector<AttributeInfo>* attributes,
+                            std::vector<UniformBlockInfo>* uniform_blocks) {
+  GLint num_resources = 0;
+  GLint max_name_length = 0;
+  glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &num_resources);
+  glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length);
+  std::string name(std::max(max_name_length, 1), '\0');
+  for (GLint i = 0; i < num_resources; ++i) {
+    GLsizei length = 0;
+    UniformInfo uniform;
+    glGetActiveUniform(program, i, max_name_length, &length, &uniform.size,
+                       &uniform.type, &name.front());
+    uniform.name = TrimArraySuffix(name.substr(0, length));
+    if (IsBuiltInName(uniform.name)) continue;
+    uniform.location = glGetUniformLocation(program, uniform.name.c_str());
+    uniform.block_index = -1;
+    uniform.offset = -1;
+    if (HasUniformBlocks()) {
+      const GLuint index = i;
+      glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_BLOCK_INDEX,
+                            &uniform.block_index);
+      glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_OFFSET,
+                            &uniform.offset);
+    }
+    uniforms->push_back(uniform);
+  }
+
+  glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &num_resources);
+  glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &max_name_length);
+  name.assign(std::max(max_name_length, 1), '\0');
+  for (GLint i = 0; i < num_resources; ++i) {
+    GLsizei length = 0;
+    AttributeInfo attribute;
+    glGetActiveAttrib(program, i, max_name_length, &length, &attribute.size,
+                      &attribute.type, &name.front());
+    attribute.name = TrimArraySuffix(name.substr(0, length));
+    if (IsBuiltInName(attribute.name)) continue;
+    attribute.location = glGetAttribLocation(program, attribute.name.c_str());
+    attributes->push_back(attribute);
+  }
+
+  if (!HasUniformBlocks()) return;
+  glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &num_resources);
+  glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH,
+                 &max_name_length);
+  name.assign(std::max(max_name_length, 1), '\0');
+  for (GLint i = 0; i < num_resources; ++i) {
+    GLsizei length = 0;
+    glGetActiveUniformBlockName(program, i, max_name_length, &length,
+                                &name.front());
+    UniformBlockInfo uniform_block;
+    uniform_block.name = name.substr(0, length);
+    uniform_block.index = i;
+    glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_BINDING,
+                              &uniform_block.binding);
+    glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_DATA_SIZE,
+                              &uniform_block.data_size);
+    uniform_blocks->push_back(uniform_block);
+  }
+}
+
+// Orders the uniforms by the hashes of their names.
+bool CompareUniformHashes(const UniformInfo& uniform, const uint32_t hash) {
+  return uniform.name_hash < hash;
+}
+
 }  // namespace
 
 bool ShaderProgram::LoadVertexShaderFromString(
@@ -186,49 +443,287 @@ bool ShaderProgram::LoadFragmentShaderFromFile(
 }
 
 bool ShaderProgram::Create(std::string* error_info_log) {
+  return Create(nullptr, error_info_log);
+}
+
+bool ShaderProgram::Create(ProgramBinaryCache* program_binary_cache,
+                           std::string* error_info_log) {
   // If an instance of this class already created a shader program, the Create()
   // method will report true. No need to build again. If different shader
   // sources are used, then a different instance should be called.
   if (created_) return true;
+  BeginCreate(program_binary_cache);
+  return FinishCreate(error_info_log);
+}
+
+bool ShaderProgram::IsParallelCompileSupported() {
+  return GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile;
+}
+
+void ShaderProgram::BeginCreate(ProgramBinaryCache* program_binary_cache) {
+  if (created_ || pending_) return;
+  // Try the binary of the program first.
+  binary_retrievable_ = program_binary_cache != nullptr &&
+      ProgramBinaryCache::IsSupported();
+  program_binary_cache_ = nullptr;
+  if (binary_retrievable_) {
+    program_key_ = ProgramBinaryCache::ComputeKey(vertex_shader_src_,
+                                                  fragment_shader_src_);
+    shader_program_id_ = program_binary_cache->Load(program_key_);
+    if (shader_program_id_ != 0) {
+      created_ = true;
+      ReflectProgram();
+      return;
+    }
+    program_binary_cache_ = program_binary_cache;
+  }
+  // Measure the compilation, which a program binary saves in the next runs.
+  submit_time_ = std::chrono::steady_clock::now();
+  // The status of the shaders is not queried here: the link waits for the
+  // compilation in the driver, not in the application.
+  vertex_shader_ = SubmitShader(vertex_shader_src_, VERTEX);
+  fragment_shader_ = SubmitShader(fragment_shader_src_, FRAGMENT);
+  shader_program_id_ = SubmitShaderProgram(vertex_shader_, fragment_shader_,
+                                           binary_retrievable_);
+  pending_ = true;
+}
+
+bool ShaderProgram::IsCreateComplete() const {
+  if (!pending_ || !IsParallelCompileSupported()) return true;
+  // GL_COMPLETION_STATUS_KHR and GL_COMPLETION_STATUS_ARB are the same value.
+  GLint complete = GL_FALSE;
+  glGetProgramiv(shader_program_id_, GL_COMPLETION_STATUS_KHR, &complete);
+  return complete != GL_FALSE;
+}
+
+bool ShaderProgram::FinishCreate(std::string* error_info_log) {
+  if (created_) return true;
+  if (!pending_) return false;
+  pending_ = false;
+  // The compilation errors are more useful than the linking error they cause.
   std::string info_log;
-  if (!BuildVertexShader(&info_log)) {
+  const bool success = CheckShader(vertex_shader_, &info_log) &&
+      CheckShader(fragment_shader_, &info_log) &&
+      CheckShaderProgram(shader_program_id_, &info_log);
+  ReleaseShaderResources(vertex_shader_, fragment_shader_);
+  if (!success) {
+    glDeleteProgram(shader_program_id_);
+    shader_program_id_ = 0;
     if (error_info_log) {
       *error_info_log = info_log;
     }
     return false;
   }
-  if (!BuildFragmentShader(&info_log)) {
-    if (error_info_log) {
-      *error_info_log = info_log;
+  created_ = true;
+  ReflectProgram();
+  if (program_binary_cache_ != nullptr) {
+    // With parallel compilation, the time includes the wait for the other
+    // programs, so it bounds the time that the binary saves.
+    const std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - submit_time_;
+    // A failure to store only costs compiling the program again next time.
+    program_binary_cache_->Store(program_key_, shader_program_id_,
+                                 elapsed.count());
+    program_binary_cache_ = nullptr;
+  }
+  return true;
+}
+
+void ShaderProgram::ReflectProgram() {
+  uniforms_.clear();
+  attributes_.clear();
+  uniform_blocks_.clear();
+  if (HasProgramInterfaceQuery()) {
+    ReflectProgramResources(shader_program_id_, &uniforms_, &attributes_,
+                            &uniform_blocks_);
+  } else {
+    ReflectActiveResources(shader_program_id_, &uniforms_, &attributes_,
+                           &uniform_blocks_);
+  }
+  for (UniformInfo& uniform : uniforms_) {
+    uniform.name_hash = HashUniformName(uniform.name.c_str());
+  }
+  std::sort(uniforms_.begin(), uniforms_.end(),
+            [](const UniformInfo& lhs, const UniformInfo& rhs) {
+              return lhs.name_hash < rhs.name_hash;
+            });
+  for (size_t i = 1; i < uniforms_.size(); ++i) {
+    LOG_IF(WARNING, uniforms_[i - 1].name_hash == uniforms_[i].name_hash)
+        << "Uniforms " << uniforms_[i - 1].name << " and " << uniforms_[i].name
+        << " have the same hash. Find them by name.";
+  }
+
+  // Reserve the space of the values that the setters cache.
+  uniform_value_offsets_.resize(uniforms_.size());
+  uniform_value_sizes_.assign(uniforms_.size(), 0);
+  size_t num_value_bytes = 0;
+  for (size_t i = 0; i < uniforms_.size(); ++i) {
+    uniform_value_offsets_[i] = num_value_bytes;
+    if (uniforms_[i].location >= 0) {
+      num_value_bytes += UniformValueSize(uniforms_[i].type) *
+          std::max(uniforms_[i].size, 1);
     }
+  }
+  uniform_values_.assign(num_value_bytes, 0);
+  num_skipped_uniform_uploads_ = 0;
+}
+
+UniformHandle ShaderProgram::FindUniform(const std::string& name) const {
+  const uint32_t name_hash = HashUniformName(name.c_str());
+  for (std::vector<UniformInfo>::const_iterator it =
+           std::lower_bound(uniforms_.begin(), uniforms_.end(), name_hash,
+                            CompareUniformHashes);
+       it != uniforms_.end() && it->name_hash == name_hash; ++it) {
+    if (it->name == name) return it - uniforms_.begin();
+  }
+  return kInvalidUniform;
+}
+
+UniformHandle ShaderProgram::FindUniform(const uint32_t name_hash) const {
+  const std::vector<UniformInfo>::const_iterator it =
+      std::lower_bound(uniforms_.begin(), uniforms_.end(), name_hash,
+                       CompareUniformHashes);
+  if (it == uniforms_.end() || it->name_hash != name_hash) {
+    return kInvalidUniform;
+  }
+  return it - uniforms_.begin();
+}
+
+GLint ShaderProgram::FindAttribute(const std::string& name) const {
+  for (const AttributeInfo& attribute : attributes_) {
+    if (attribute.name == name) return attribute.location;
+  }
+  return -1;
+}
+
+const UniformBlockInfo* ShaderProgram::FindUniformBlock(
+    const std::string& name) const {
+  for (const UniformBlockInfo& uniform_block : uniform_blocks_) {
+    if (uniform_block.name == name) return &uniform_block;
+  }
+  return nullptr;
+}
+
+bool ShaderProgram::BindUniformBlock(const std::string& name,
+                                     const GLuint binding) {
+  for (UniformBlockInfo& uniform_block : uniform_blocks_) {
+    if (uniform_block.name != name) continue;
+    glUniformBlockBinding(shader_program_id_, uniform_block.index, binding);
+    uniform_block.binding = binding;
+    return true;
+  }
+  return false;
+}
+
+bool ShaderProgram::IsUniformOfType(const UniformHandle handle,
+                                    const GLenum type,
+                                    const GLsizei count) const {
+  if (handle < 0 || handle >= static_cast<int>(uniforms_.size())) {
     return false;
   }
-  if (!LinkProgram(&info_log)) {
-    if (error_info_log) {
-      *error_info_log = info_log;
-    }
+  const UniformInfo& uniform = uniforms_[handle];
+  if (uniform.location < 0 || count < 1 || count > uniform.size) {
     return false;
   }
-  created_ = true;
+  if (type == GL_INT) return IsIntegerUniformType(uniform.type);
+  return uniform.type == type;
+}
+
+bool ShaderProgram::UpdateUniformValue(const UniformHandle handle,
+                                       const void* value,
+                                       const size_t value_size) {
+  unsigned char* cached_value =
+      uniform_values_.data() + uniform_value_offsets_[handle];
+  size_t& cached_size = uniform_value_sizes_[handle];
+  if (value_size <= cached_size &&
+      std::memcmp(cached_value, value, value_size) == 0) {
+    ++num_skipped_uniform_uploads_;
+    return false;
+  }
+  std::memcpy(cached_value, value, value_size);
+  cached_size = std::max(cached_size, value_size);
   return true;
 }
 
-bool ShaderProgram::BuildVertexShader(std::string* info_log) {
-  vertex_shader_ = CompileShader(vertex_shader_src_, VERTEX, info_log);
-  return vertex_shader_ != 0;
+bool ShaderProgram::SetUniform1i(const UniformHandle handle,
+                                 const GLint value) {
+  return SetUniform1iv(handle, 1, &value);
 }
 
-bool ShaderProgram::BuildFragmentShader(std::string* info_log) {
-  fragment_shader_ = CompileShader(fragment_shader_src_, FRAGMENT, info_log);
-  return fragment_shader_ != 0;
+bool ShaderProgram::SetUniform1f(const UniformHandle handle,
+                                 const GLfloat value) {
+  return SetUniform1fv(handle, 1, &value);
 }
 
-bool ShaderProgram::LinkProgram(std::string* info_log) {
-  shader_program_id_ = CreateShaderProgram(vertex_shader_,
-                                           fragment_shader_,
-                                           info_log);
-  ReleaseShaderResources(vertex_shader_, fragment_shader_);
-  return shader_program_id_ != 0;
+bool ShaderProgram::SetUniform2f(const UniformHandle handle,
+                                 const GLfloat x,
+                                 const GLfloat y) {
+  const GLfloat values[] = { x, y };
+  return SetUniform2fv(handle, 1, values);
+}
+
+bool ShaderProgram::SetUniform3f(const UniformHandle handle,
+                                 const GLfloat x,
+                                 const GLfloat y,
+                                 const GLfloat z) {
+  if (!IsUniformOfType(handle, GL_FLOAT_VEC3, 1)) return false;
+  const GLfloat values[] = { x, y, z };
+  if (UpdateUniformValue(handle, values, sizeof(values))) {
+    glUniform3fv(uniforms_[handle].location, 1, values);
+  }
+  return true;
+}
+
+bool ShaderProgram::SetUniform4f(const UniformHandle handle,
+                                 const GLfloat x,
+                                 const GLfloat y,
+                                 const GLfloat z,
+                                 const GLfloat w) {
+  if (!IsUniformOfType(handle, GL_FLOAT_VEC4, 1)) return false;
+  const GLfloat values[] = { x, y, z, w };
+  if (UpdateUniformValue(handle, values, sizeof(values))) {
+    glUniform4fv(uniforms_[handle].location, 1, values);
+  }
+  return true;
+}
+
+bool ShaderProgram::SetUniformMatrix4f(const UniformHandle handle,
+                                       const GLfloat* values) {
+  if (!IsUniformOfType(handle, GL_FLOAT_MAT4, 1)) return false;
+  if (UpdateUniformValue(handle, values, 16 * sizeof(*values))) {
+    glUniformMatrix4fv(uniforms_[handle].location, 1, GL_FALSE, values);
+  }
+  return true;
+}
+
+bool ShaderProgram::SetUniform1iv(const UniformHandle handle,
+                                  const GLsizei count,
+                                  const GLint* values) {
+  if (!IsUniformOfType(handle, GL_INT, count)) return false;
+  if (UpdateUniformValue(handle, values, count * sizeof(*values))) {
+    glUniform1iv(uniforms_[handle].location, count, values);
+  }
+  return true;
+}
+
+bool ShaderProgram::SetUniform1fv(const UniformHandle handle,
+                                  const GLsizei count,
+                                  const GLfloat* values) {
+  if (!IsUniformOfType(handle, GL_FLOAT, count)) return false;
+  if (UpdateUniformValue(handle, values, count * sizeof(*values))) {
+    glUniform1fv(uniforms_[handle].location, count, values);
+  }
+  return true;
+}
+
+bool ShaderProgram::SetUniform2fv(const UniformHandle handle,
+                                  const GLsizei count,
+                                  const GLfloat* values) {
+  if (!IsUniformOfType(handle, GL_FLOAT_VEC2, count)) return false;
+  if (UpdateUniformValue(handle, values, 2 * count * sizeof(*values))) {
+    glUniform2fv(uniforms_[handle].location, count, values);
+  }
+  return true;
 }
 
 }  // namespace wvu
@@ -35,10 +35,65 @@
 #ifndef GLUTILS_SHADER_PROGRAM_H_
 #define GLUTILS_SHADER_PROGRAM_H_
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
 #include <GL/glew.h>
 
+#include "program_binary_cache.h"
+
 namespace wvu {
+// Returns the FNV-1a hash of the name of a uniform. The hash is computed at
+// compile time for string literals, so the uniforms can be found without
+// hashing their names every frame, e.g.,
+//   constexpr uint32_t kModelUniform = wvu::HashUniformName("model");
+constexpr uint32_t HashUniformName(const char* name,
+                                   const uint32_t hash = 2166136261u) {
+  return *name == '\0' ? hash :
+      HashUniformName(name + 1,
+                      (hash ^ static_cast<unsigned char>(*name)) * 16777619u);
+}
+
+// Handle of an active uniform of a shader program: its index in the table of
+// uniforms of the program, or kInvalidUniform.
+typedef int UniformHandle;
+constexpr UniformHandle kInvalidUniform = -1;
+
+// An active uniform of a shader program.
+struct UniformInfo {
+  // The name of the uniform. The names of arrays omit the "[0]" suffix.
+  std::string name;
+  uint32_t name_hash;
+  // The location of the uniform, or -1 if it is in a uniform block.
+  GLint location;
+  // The type (e.g., GL_FLOAT_MAT4) and the number of elements of arrays.
+  GLenum type;
+  GLint size;
+  // The index of its uniform block, or -1 if it is not in a block, and its
+  // offset in bytes in the block.
+  GLint block_index;
+  GLint offset;
+};
+
+// An active vertex attribute of a shader program.
+struct AttributeInfo {
+  std::string name;
+  GLint location;
+  GLenum type;
+  GLint size;
+};
+
+// An active uniform block of a shader program.
+struct UniformBlockInfo {
+  std::string name;
+  GLuint index;
+  // The binding point of the block and the size of its data in bytes.
+  GLint binding;
+  GLint data_size;
+};
+
 // This class helps with the compilation of vertex and fragment shaders. The
 // class compiles the shaders and creates a shader program. The class keeps
 // the id of such a compiled and linked program. The class also provides a way
@@ -80,7 +135,26 @@ namespace wvu {
 //   ...
 // }
 //
-// 4) Passing uniform variables to shader example:
+// 4) Skipping the compilation in the next runs with a program binary cache:
+//
+// wvu::ProgramBinaryCache program_binary_cache("/tmp/program_cache");
+// ...
+// if (!shader_program.Create(&program_binary_cache, &error_info_log)) {
+//   LOG(ERROR) << error_info_log;
+// }
+//
+// 5) Setting uniform variables through the table of uniforms, which the class
+// builds when it creates the program. The setters skip the uploads of values
+// that did not change:
+//
+// const wvu::UniformHandle model_handle = shader_program.FindUniform("model");
+// while (...) {  // Rendering loop.
+//   shader_program.Use();
+//   shader_program.SetUniformMatrix4f(model_handle, model.data());
+//   ...
+// }
+//
+// 6) Passing uniform variables to shader example:
 // When passing values to uniform variables in the shader program, the shader
 // program id is necessary. This class provides access to this id by calling the
 // accessor method shader_program_id().
@@ -97,15 +171,27 @@ class ShaderProgram {
       // Initializing member attributes.
       vertex_shader_src_(""), fragment_shader_src_(""),
       vertex_shader_(0), fragment_shader_(0), shader_program_id_(0),
-      created_(false) {}
+      binary_retrievable_(false), created_(false), pending_(false),
+      program_binary_cache_(nullptr), program_key_(0),
+      num_skipped_uniform_uploads_(0) {}
   // Destructor. Invoked automatically once the instance goes out of scope.
   virtual ~ShaderProgram() {
-    if (created_) {
+    if (pending_) {
+      // The creation was never finished, so the shaders are still alive.
+      glDeleteShader(vertex_shader_);
+      glDeleteShader(fragment_shader_);
+    }
+    if (created_ || pending_) {
       // Once the shader program is not needed, we tell OpenGL to delete it.
       glDeleteProgram(shader_program_id_);
     }
   }
 
+  // Returns true if the driver compiles and links shaders on its own threads
+  // (GL_KHR_parallel_shader_compile or GL_ARB_parallel_shader_compile), so
+  // that the completion of the creation can be polled.
+  static bool IsParallelCompileSupported();
+
   // The accessor member returns the shader program id that OpenGL generates
   // when creating the shader program. When the shader program has not been
   // created, the shader_program_id() returns 0.
@@ -153,6 +239,107 @@ class ShaderProgram {
   //  error_info_log  A pointer to a string that holds the error log.
   bool Create(std::string* error_info_log);
 
+  // Same as Create(error_info_log), but the program is created from its
+  // binary in the cache when it is there, which skips the compilation. When
+  // it is not, the program is compiled and its binary is stored in the cache
+  // for the next runs. If the cache is null or the driver does not support
+  // program binaries, the program is always compiled.
+  //
+  // Parameters:
+  //  program_binary_cache  The cache of program binaries. It is not owned by
+  //    the shader program.
+  //  error_info_log  A pointer to a string that holds the error log.
+  bool Create(ProgramBinaryCache* program_binary_cache,
+              std::string* error_info_log);
+
+  // Non-blocking creation, which Create() performs in a single call:
+  // BeginCreate() submits the compilation of the shaders and the linking of
+  // the program to the driver without waiting for them, IsCreateComplete()
+  // polls them, and FinishCreate() waits for them and checks the results.
+  // Submitting many programs before finishing any of them lets the driver
+  // compile them concurrently; see ShaderProgramBatch. When the program is
+  // loaded from the program binary cache, BeginCreate() creates it already.
+  //
+  // Parameters:
+  //  program_binary_cache  The cache of program binaries, or null. It is not
+  //    owned by the shader program, and must outlive FinishCreate().
+  void BeginCreate(ProgramBinaryCache* program_binary_cache);
+  // Returns true if FinishCreate() will not block. Without parallel
+  // compilation support, the driver cannot tell, so it returns true.
+  bool IsCreateComplete() const;
+  // Returns true if the program was created, and false if BeginCreate() was
+  // not called or the creation failed, in which case the error log is copied
+  // into error_info_log.
+  bool FinishCreate(std::string* error_info_log);
+
+  // Returns true when the program was created successfully.
+  bool created() const { return created_; }
+
+  // The active uniforms, vertex attributes and uniform blocks of the program,
+  // which the class enumerates once the program is created. The uniforms are
+  // sorted by the hash of their names.
+  const std::vector<UniformInfo>& uniforms() const { return uniforms_; }
+  const std::vector<AttributeInfo>& attributes() const { return attributes_; }
+  const std::vector<UniformBlockInfo>& uniform_blocks() const {
+    return uniform_blocks_;
+  }
+
+  // Returns the handle of the active uniform, or kInvalidUniform if the
+  // program has no such uniform, e.g., because the compiler removed it.
+  UniformHandle FindUniform(const std::string& name) const;
+  // Same as above with the hash of the name, see HashUniformName().
+  UniformHandle FindUniform(const uint32_t name_hash) const;
+
+  // Returns the location of the vertex attribute, or -1 if it is not active.
+  GLint FindAttribute(const std::string& name) const;
+
+  // Returns the uniform block, or nullptr if the program has no such block.
+  const UniformBlockInfo* FindUniformBlock(const std::string& name) const;
+
+  // Assigns the uniform block to a binding point, from which it reads the
+  // buffer bound with glBindBufferBase(GL_UNIFORM_BUFFER, binding, ...).
+  // Returns false if the program has no such block.
+  bool BindUniformBlock(const std::string& name, const GLuint binding);
+
+  // Typed setters of the uniforms. The program must be in use (see Use()).
+  // The setters remember the last value of every uniform and skip the upload
+  // when the value does not change, so values set with glUniform*() directly
+  // must not be mixed with them. The setters return false if the handle is
+  // invalid or the type of the uniform does not match; the integer setters
+  // also set samplers and booleans.
+  bool SetUniform1i(const UniformHandle handle, const GLint value);
+  bool SetUniform1f(const UniformHandle handle, const GLfloat value);
+  bool SetUniform2f(const UniformHandle handle,
+                    const GLfloat x,
+                    const GLfloat y);
+  bool SetUniform3f(const UniformHandle handle,
+                    const GLfloat x,
+                    const GLfloat y,
+                    const GLfloat z);
+  bool SetUniform4f(const UniformHandle handle,
+                    const GLfloat x,
+                    const GLfloat y,
+                    const GLfloat z,
+                    const GLfloat w);
+  // Sets a 4x4 matrix stored in column-major order (e.g., Eigen's default).
+  bool SetUniformMatrix4f(const UniformHandle handle, const GLfloat* values);
+  // Array setters: count elements starting at the first one.
+  bool SetUniform1iv(const UniformHandle handle,
+                     const GLsizei count,
+                     const GLint* values);
+  bool SetUniform1fv(const UniformHandle handle,
+                     const GLsizei count,
+                     const GLfloat* values);
+  bool SetUniform2fv(const UniformHandle handle,
+                     const GLsizei count,
+                     const GLfloat* values);
+
+  // Number of uploads that the setters skipped because the value did not
+  // change.
+  size_t num_skipped_uniform_uploads() const {
+    return num_skipped_uniform_uploads_;
+  }
+
   // This function activates the shader as the current one in OpenGL.
   // Returns true if the function successfully activates the shader program.
   bool Use() const {
@@ -165,12 +352,9 @@ class ShaderProgram {
   }
 
  protected:
-  // Compiles the vertex shader.
-  bool BuildVertexShader(std::string* info_log);
-  // Compiles the fragment shader.
-  bool BuildFragmentShader(std::string* info_log);
-  // Links the shaders to form a shader program.
-  bool LinkProgram(std::string* info_log);
+  // Enumerates the active uniforms, attributes and uniform blocks of the
+  // created program.
+  void ReflectProgram();
 
  private:
   // Vertex shader program source.
@@ -183,9 +367,43 @@ class ShaderProgram {
   GLuint fragment_shader_;
   // Program shader id.
   GLuint shader_program_id_;
+  // True when the program is linked so that its binary can be retrieved for
+  // the program binary cache.
+  bool binary_retrievable_;
   // Created state variable. True when this shader program is created, and false
   // otherwise.
   bool created_;
+  // True between BeginCreate() and FinishCreate() while the driver compiles
+  // the shaders and links the program.
+  bool pending_;
+  // The cache that receives the binary of the program once it is created,
+  // its key in the cache, and when the compilation was submitted.
+  ProgramBinaryCache* program_binary_cache_;
+  uint64_t program_key_;
+  std::chrono::steady_clock::time_point submit_time_;
+
+  // Returns true if the handle refers to a uniform outside of a block of the
+  // given type (see the setters) that has at least count elements.
+  bool IsUniformOfType(const UniformHandle handle,
+                       const GLenum type,
+                       const GLsizei count) const;
+  // Stores the value of the uniform, and returns true if it changed and thus
+  // must be uploaded.
+  bool UpdateUniformValue(const UniformHandle handle,
+                          const void* value,
+                          const size_t value_size);
+
+  // Tables of the active uniforms, attributes and uniform blocks.
+  std::vector<UniformInfo> uniforms_;
+  std::vector<AttributeInfo> attributes_;
+  std::vector<UniformBlockInfo> uniform_blocks_;
+  // The last values set for the uniforms: the value of the uniform i is at
+  // uniform_value_offsets_[i], and it is valid if uniform_value_sizes_[i] is
+  // not zero.
+  std::vector<unsigned char> uniform_values_;
+  std::vector<size_t> uniform_value_offsets_;
+  std::vector<size_t> uniform_value_sizes_;
+  size_t num_skipped_uniform_uploads_;
 };
 
 }  // namespace wvu
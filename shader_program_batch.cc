@@ -0,0 +1,109 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "shader_program_batch.h"
+
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+
+#include <glog/logging.h>
+
+#include "shader_program.h"
+
+namespace wvu {
+namespace {
+// Lets the driver choose the number of compiler threads.
+constexpr GLuint kMaxShaderCompilerThreads = 0xFFFFFFFF;
+
+}  // namespace
+
+void ShaderProgramBatch::Add(ShaderProgram* shader_program) {
+  programs_.push_back(shader_program);
+}
+
+void ShaderProgramBatch::Submit() {
+  if (num_submitted_ == programs_.size()) return;
+  // Drivers may default to compiling on a single thread.
+  if (GLEW_KHR_parallel_shader_compile) {
+    glMaxShaderCompilerThreadsKHR(kMaxShaderCompilerThreads);
+  } else if (GLEW_ARB_parallel_shader_compile) {
+    glMaxShaderCompilerThreadsARB(kMaxShaderCompilerThreads);
+  }
+  for (; num_submitted_ < programs_.size(); ++num_submitted_) {
+    ShaderProgram* shader_program = programs_[num_submitted_];
+    shader_program->BeginCreate(program_binary_cache_);
+    if (shader_program->created()) {
+      ++num_created_;
+    } else {
+      pending_programs_.push_back(shader_program);
+    }
+  }
+}
+
+int ShaderProgramBatch::Poll(const int max_programs) {
+  int num_finished = 0;
+  for (size_t i = 0; i < pending_programs_.size() &&
+           (max_programs <= 0 || num_finished < max_programs);) {
+    if (pending_programs_[i]->IsCreateComplete()) {
+      Finish(i);
+      ++num_finished;
+    } else {
+      ++i;
+    }
+  }
+  return static_cast<int>(pending_programs_.size());
+}
+
+bool ShaderProgramBatch::Wait() {
+  Submit();
+  while (!pending_programs_.empty()) {
+    Finish(0);
+  }
+  return num_failed_ == 0;
+}
+
+void ShaderProgramBatch::Finish(const size_t index) {
+  ShaderProgram* shader_program = pending_programs_[index];
+  pending_programs_.erase(pending_programs_.begin() + index);
+  std::string error_info_log;
+  if (shader_program->FinishCreate(&error_info_log)) {
+    ++num_created_;
+  } else {
+    LOG(ERROR) << "Could not create a shader program: " << error_info_log;
+    ++num_failed_;
+  }
+}
+
+}  // namespace wvu
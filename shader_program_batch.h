@@ -0,0 +1,125 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_SHADER_PROGRAM_BATCH_H_
+#define GLUTILS_SHADER_PROGRAM_BATCH_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "program_binary_cache.h"
+#include "shader_program.h"
+
+namespace wvu {
+// This class creates many shader programs without serializing the compiler of
+// the driver. ShaderProgram::Create() waits for the status of every shader and
+// program right after submitting it, so the driver compiles one at a time.
+// The batch instead submits the compilation and linking of all its programs
+// first, and collects the results later:
+//   - With GL_KHR_parallel_shader_compile (or its ARB version), the driver
+//     compiles the programs concurrently on its own threads, and Poll()
+//     finishes the programs that are complete without blocking, so the
+//     rendering loop can start before every program is ready.
+//   - Without it, drivers that defer the compilation to the first query still
+//     overlap it with the work of the application, and Poll() finishes a
+//     bounded number of programs per call.
+// All the member functions must be called from the thread that owns the
+// OpenGL context, and the programs must outlive their creation.
+//
+// Example:
+//
+// wvu::ShaderProgramBatch batch(program_binary_cache);
+// for (wvu::ShaderProgram& program : programs) {
+//   program.LoadVertexShaderFromFile(...);
+//   program.LoadFragmentShaderFromFile(...);
+//   batch.Add(&program);
+// }
+// batch.Submit();
+// while (...) {  // Rendering loop.
+//   batch.Poll(4);
+//   ...  // Draw with the programs that are created().
+// }
+class ShaderProgramBatch {
+ public:
+  // Parameters:
+  //   program_binary_cache  The cache of program binaries, or null. It is not
+  //     owned by the batch.
+  explicit ShaderProgramBatch(ProgramBinaryCache* program_binary_cache) :
+      program_binary_cache_(program_binary_cache), num_submitted_(0),
+      num_created_(0), num_failed_(0) {}
+  ~ShaderProgramBatch() {}
+
+  // Adds a program whose shader sources are loaded. The program is not owned
+  // by the batch.
+  void Add(ShaderProgram* shader_program);
+
+  // Submits the programs added since the last call, without waiting for them.
+  // The programs found in the program binary cache are created right away.
+  void Submit();
+
+  // Finishes the submitted programs whose creation is complete, up to
+  // max_programs of them (or all if max_programs is not positive), and
+  // returns the number of programs that are still pending. The failures are
+  // logged.
+  int Poll(const int max_programs);
+
+  // Submits the programs that are not submitted yet, and finishes all the
+  // programs, waiting for them. Returns true if all the programs of the batch
+  // were created, and false otherwise.
+  bool Wait();
+
+  // Number of programs that are submitted but not finished.
+  int num_pending() const { return static_cast<int>(pending_programs_.size()); }
+  // Number of programs created, and of programs that failed to compile or
+  // link.
+  int num_created() const { return num_created_; }
+  int num_failed() const { return num_failed_; }
+
+ private:
+  // Finishes the pending program at the index, which is removed from the
+  // list of pending programs.
+  void Finish(const size_t index);
+
+  ProgramBinaryCache* program_binary_cache_;
+  std::vector<ShaderProgram*> programs_;
+  // Number of programs in programs_ that are submitted.
+  size_t num_submitted_;
+  std::vector<ShaderProgram*> pending_programs_;
+  int num_created_;
+  int num_failed_;
+};
+
+}  // namespace wvu
+
+#endif  // GLUTILS_SHADER_PROGRAM_BATCH_H_
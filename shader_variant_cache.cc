@@ -0,0 +1,311 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "shader_variant_cache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "program_binary_cache.h"
+#include "shader_program.h"
+
+namespace wvu {
+namespace {
+// The name of the variant without features in the manifests.
+const char kNoFeatures[] = "-";
+
+// Loads a shader source from a file into loaded_file. Returns true if
+// successful, otherwise false.
+bool LoadShaderFromFile(const std::string& filepath,
+                        std::string* loaded_file) {
+  std::ifstream in(filepath);
+  if (!in.is_open()) {
+    return false;
+  }
+  std::stringstream string_buffer;
+  string_buffer << in.rdbuf();
+  *loaded_file = string_buffer.str();
+  return true;
+}
+
+// Inserts the defines right after the #version line, which must be the first
+// directive of the shader. Shaders without a #version line get them first.
+std::string InjectDefines(const std::string& source,
+                          const std::string& defines) {
+  size_t position = 0;
+  while ((position = source.find("#version", position)) != std::string::npos) {
+    // The directive must start the line, so the ones in comments are skipped.
+    const size_t line_start = source.rfind('\n', position);
+    const size_t first_char = line_start == std::string::npos ?
+        0 : line_start + 1;
+    if (source.find_first_not_of(" \t", first_char) == position) break;
+    ++position;
+  }
+  if (position == std::string::npos) {
+    return defines + source;
+  }
+  const size_t line_end = source.find('\n', position);
+  if (line_end == std::string::npos) {
+    return source + "\n" + defines;
+  }
+  std::string injected_source = source;
+  injected_source.insert(line_end + 1, defines);
+  return injected_source;
+}
+
+double MillisecondsSince(const std::chrono::steady_clock::time_point& start) {
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+}  // namespace
+
+ShaderVariantCache::ShaderVariantCache(
+    const std::vector<std::string>& feature_names,
+    ProgramBinaryCache* program_binary_cache) :
+    feature_names_(feature_names), program_binary_cache_(program_binary_cache) {
+  LOG_IF(ERROR, feature_names_.size() > kMaxShaderFeatures)
+      << "Only the first " << kMaxShaderFeatures << " of "
+      << feature_names_.size() << " shader features can be enabled.";
+}
+
+bool ShaderVariantCache::LoadVertexShaderFromString(
+    const std::string& vertex_shader_source) {
+  vertex_shader_source_ = vertex_shader_source;
+  return true;
+}
+
+bool ShaderVariantCache::LoadFragmentShaderFromString(
+    const std::string& fragment_shader_source) {
+  fragment_shader_source_ = fragment_shader_source;
+  return true;
+}
+
+bool ShaderVariantCache::LoadVertexShaderFromFile(
+    const std::string& vertex_shader_path) {
+  return LoadShaderFromFile(vertex_shader_path, &vertex_shader_source_);
+}
+
+bool ShaderVariantCache::LoadFragmentShaderFromFile(
+    const std::string& fragment_shader_path) {
+  return LoadShaderFromFile(fragment_shader_path, &fragment_shader_source_);
+}
+
+ShaderFeatureMask ShaderVariantCache::FeatureMask(
+    const std::string& feature_name) const {
+  const int num_features =
+      std::min<int>(feature_names_.size(), kMaxShaderFeatures);
+  for (int i = 0; i < num_features; ++i) {
+    if (feature_names_[i] == feature_name) {
+      return static_cast<ShaderFeatureMask>(1) << i;
+    }
+  }
+  return 0;
+}
+
+bool ShaderVariantCache::ParseFeatures(const std::string& feature_names,
+                                       ShaderFeatureMask* mask) const {
+  std::string names = feature_names;
+  std::replace(names.begin(), names.end(), ',', ' ');
+  std::istringstream stream(names);
+  std::string name;
+  ShaderFeatureMask features = 0;
+  while (stream >> name) {
+    if (name == kNoFeatures) continue;
+    const ShaderFeatureMask feature = FeatureMask(name);
+    if (feature == 0) {
+      return false;
+    }
+    features |= feature;
+  }
+  *mask = features;
+  return true;
+}
+
+std::string ShaderVariantCache::FeatureNames(
+    const ShaderFeatureMask mask) const {
+  std::string names;
+  const int num_features =
+      std::min<int>(feature_names_.size(), kMaxShaderFeatures);
+  for (int i = 0; i < num_features; ++i) {
+    if ((mask >> i & 1) == 0) continue;
+    if (!names.empty()) names += " ";
+    names += feature_names_[i];
+  }
+  return names.empty() ? kNoFeatures : names;
+}
+
+ShaderProgram* ShaderVariantCache::Get(const ShaderFeatureMask features) {
+  std::unordered_map<ShaderFeatureMask, Variant>::iterator it =
+      variants_.find(features);
+  Variant* variant = nullptr;
+  if (it == variants_.end()) {
+    variant = Submit(features);
+    ++statistics_.num_compiled_on_demand;
+  } else {
+    variant = &it->second;
+  }
+  variant->used = true;
+  if (variant->pending) {
+    Finish(features, variant);
+  }
+  return variant->program->created() ? variant->program.get() : nullptr;
+}
+
+void ShaderVariantCache::Warm(const ShaderFeatureMask features) {
+  if (variants_.find(features) == variants_.end()) {
+    Submit(features);
+  }
+}
+
+bool ShaderVariantCache::WarmFromManifest(
+    const std::string& manifest_filepath) {
+  std::ifstream manifest(manifest_filepath);
+  if (!manifest.is_open()) {
+    return false;
+  }
+  std::string line;
+  while (std::getline(manifest, line)) {
+    const size_t first_char = line.find_first_not_of(" \t\r");
+    if (first_char == std::string::npos || line[first_char] == '#') continue;
+    ShaderFeatureMask features = 0;
+    if (!ParseFeatures(line, &features)) {
+      LOG(WARNING) << "Skipping the shader variant with unknown features in "
+                   << manifest_filepath << ": " << line;
+      continue;
+    }
+    Warm(features);
+  }
+  return true;
+}
+
+bool ShaderVariantCache::WriteManifest(
+    const std::string& manifest_filepath) const {
+  std::vector<ShaderFeatureMask> used_variants;
+  for (const std::pair<const ShaderFeatureMask, Variant>& entry : variants_) {
+    if (entry.second.used && entry.second.program->created()) {
+      used_variants.push_back(entry.first);
+    }
+  }
+  std::sort(used_variants.begin(), used_variants.end());
+  std::ofstream manifest(manifest_filepath);
+  if (!manifest.is_open()) {
+    LOG(ERROR) << "Could not write the shader variant manifest "
+               << manifest_filepath;
+    return false;
+  }
+  manifest << "# Shader variants used by the last run.\n";
+  for (const ShaderFeatureMask features : used_variants) {
+    manifest << FeatureNames(features) << "\n";
+  }
+  return manifest.good();
+}
+
+int ShaderVariantCache::Poll(const int max_variants) {
+  int num_finished = 0;
+  for (size_t i = 0; i < pending_variants_.size() &&
+           (max_variants <= 0 || num_finished < max_variants);) {
+    const ShaderFeatureMask features = pending_variants_[i];
+    Variant* variant = &variants_[features];
+    if (variant->program->IsCreateComplete()) {
+      // Removes the variant from pending_variants_.
+      Finish(features, variant);
+      ++num_finished;
+    } else {
+      ++i;
+    }
+  }
+  return static_cast<int>(pending_variants_.size());
+}
+
+ShaderVariantCache::Variant* ShaderVariantCache::Submit(
+    const ShaderFeatureMask features) {
+  std::string defines;
+  const int num_features =
+      std::min<int>(feature_names_.size(), kMaxShaderFeatures);
+  for (int i = 0; i < num_features; ++i) {
+    if (features >> i & 1) {
+      defines += "#define " + feature_names_[i] + " 1\n";
+    }
+  }
+  Variant* variant = &variants_[features];
+  variant->program.reset(new ShaderProgram);
+  variant->program->LoadVertexShaderFromString(
+      InjectDefines(vertex_shader_source_, defines));
+  variant->program->LoadFragmentShaderFromString(
+      InjectDefines(fragment_shader_source_, defines));
+  // The variants found in the program binary cache are created right away,
+  // and finished like the others.
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  variant->program->BeginCreate(program_binary_cache_);
+  variant->compile_milliseconds = MillisecondsSince(start);
+  variant->pending = true;
+  pending_variants_.push_back(features);
+  statistics_.num_pending = pending_variants_.size();
+  return variant;
+}
+
+void ShaderVariantCache::Finish(const ShaderFeatureMask features,
+                                Variant* variant) {
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  std::string error_info_log;
+  const bool created = variant->program->FinishCreate(&error_info_log);
+  variant->compile_milliseconds += MillisecondsSince(start);
+  variant->pending = false;
+  pending_variants_.erase(std::find(pending_variants_.begin(),
+                                    pending_variants_.end(), features));
+  statistics_.num_pending = pending_variants_.size();
+  if (!created) {
+    LOG(ERROR) << "Could not create the shader variant "
+               << FeatureNames(features) << ": " << error_info_log;
+    ++statistics_.num_failed;
+    return;
+  }
+  ++statistics_.num_variants;
+  statistics_.compile_milliseconds += variant->compile_milliseconds;
+  statistics_.max_compile_milliseconds =
+      std::max(statistics_.max_compile_milliseconds,
+               variant->compile_milliseconds);
+}
+
+}  // namespace wvu
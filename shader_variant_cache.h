@@ -0,0 +1,190 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_SHADER_VARIANT_CACHE_H_
+#define GLUTILS_SHADER_VARIANT_CACHE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "program_binary_cache.h"
+#include "shader_program.h"
+
+namespace wvu {
+// The features of a shader variant: bit i enables the i-th feature of the
+// ShaderVariantCache.
+typedef uint32_t ShaderFeatureMask;
+
+// Maximum number of features of a ShaderVariantCache.
+constexpr int kMaxShaderFeatures = 32;
+
+// This class builds the variants of a pair of shaders from a single source
+// instead of a file per combination of features. Every feature is a
+// preprocessor symbol: the variant with a feature enabled is compiled with
+// "#define <FEATURE> 1" inserted after the #version line, so the shaders
+// select their code with #ifdef (the line numbers of the compiler errors count
+// the inserted lines). The variants are keyed by the bitmask of their
+// features and shared by everything that draws with the same features.
+// A variant is compiled when it is first requested, which blocks, unless it
+// was warmed: submitted ahead of time, e.g., from a manifest of the variants
+// that a previous run used, so that the driver compiles it in the background
+// (see ShaderProgramBatch). All the member functions must be called from the
+// thread that owns the OpenGL context.
+//
+// Example:
+//
+// wvu::ShaderVariantCache variants({"TEXTURE", "VERTEX_COLOR", "ALPHA_TEST"},
+//                                  program_binary_cache);
+// variants.LoadVertexShaderFromFile("/path/to/vertex_shader.glsl");
+// variants.LoadFragmentShaderFromFile("/path/to/fragment_shader.glsl");
+// variants.WarmFromManifest("/path/to/variants.txt");
+// while (...) {  // Rendering loop.
+//   variants.Poll(2);
+//   for (const Material& material : materials) {
+//     wvu::ShaderProgram* program = variants.Get(material.features);
+//     ...
+//   }
+// }
+// variants.WriteManifest("/path/to/variants.txt");
+class ShaderVariantCache {
+ public:
+  // Counters of the cache.
+  struct Statistics {
+    // Number of variants created, that failed to compile or link, and that
+    // are still compiling.
+    int num_variants = 0;
+    int num_failed = 0;
+    int num_pending = 0;
+    // Number of variants compiled when they were first requested, which
+    // stalls the caller, rather than warmed.
+    int num_compiled_on_demand = 0;
+    // Time that the application spent creating the variants, in total and
+    // for the slowest one. The time of the warmed variants excludes the
+    // compilation in the background.
+    double compile_milliseconds = 0.0;
+    double max_compile_milliseconds = 0.0;
+  };
+
+  // Parameters:
+  //   feature_names  The names of the preprocessor symbols of the features;
+  //     the i-th name is the bit i of the masks. At most kMaxShaderFeatures.
+  //   program_binary_cache  The cache of program binaries, or null. It is not
+  //     owned by the cache.
+  ShaderVariantCache(const std::vector<std::string>& feature_names,
+                     ProgramBinaryCache* program_binary_cache);
+  ~ShaderVariantCache() {}
+
+  // Loads the sources shared by all the variants. Returns true if successful,
+  // and false otherwise. The sources must be loaded before any variant is
+  // requested.
+  bool LoadVertexShaderFromString(const std::string& vertex_shader_source);
+  bool LoadFragmentShaderFromString(const std::string& fragment_shader_source);
+  bool LoadVertexShaderFromFile(const std::string& vertex_shader_path);
+  bool LoadFragmentShaderFromFile(const std::string& fragment_shader_path);
+
+  // Returns the bit of the feature, or 0 if there is no such feature.
+  ShaderFeatureMask FeatureMask(const std::string& feature_name) const;
+
+  // Parses a list of feature names separated by commas or spaces into mask.
+  // Returns false, leaving mask untouched, if a name is not a feature.
+  bool ParseFeatures(const std::string& feature_names,
+                     ShaderFeatureMask* mask) const;
+
+  // Returns the names of the features of the mask separated by spaces, or
+  // "-" when the mask has no features.
+  std::string FeatureNames(const ShaderFeatureMask mask) const;
+
+  // Returns the program of the variant, which is compiled now if it was not
+  // warmed, or waited for if it is still compiling. Returns nullptr if the
+  // variant cannot be created; the failure is logged once and not retried.
+  ShaderProgram* Get(const ShaderFeatureMask features);
+
+  // Submits the compilation of the variant without waiting for it.
+  void Warm(const ShaderFeatureMask features);
+
+  // Warms the variants listed in the manifest: a text file with the names of
+  // the features of a variant per line (see FeatureNames()). Empty lines and
+  // lines starting with '#' are ignored. Returns false if the file cannot be
+  // read; the lines with unknown features are skipped with a warning.
+  bool WarmFromManifest(const std::string& manifest_filepath);
+
+  // Writes the manifest of the variants that were requested with Get(), so
+  // that the next run can warm them. Returns true if successful.
+  bool WriteManifest(const std::string& manifest_filepath) const;
+
+  // Finishes up to max_variants warmed variants whose compilation is
+  // complete (or all of them if max_variants is not positive), without
+  // blocking when the driver compiles in parallel. Returns the number of
+  // variants still compiling. Call it once per frame.
+  int Poll(const int max_variants);
+
+  // Accessors.
+  const std::vector<std::string>& feature_names() const {
+    return feature_names_;
+  }
+  const Statistics& statistics() const { return statistics_; }
+
+ private:
+  // A variant of the shaders.
+  struct Variant {
+    std::unique_ptr<ShaderProgram> program;
+    // True while the driver compiles it.
+    bool pending = false;
+    // True once it is requested with Get().
+    bool used = false;
+    // Time that the application spent creating it.
+    double compile_milliseconds = 0.0;
+  };
+
+  // Creates the variant and submits its compilation.
+  Variant* Submit(const ShaderFeatureMask features);
+  // Waits for the compilation of the pending variant and checks it.
+  void Finish(const ShaderFeatureMask features, Variant* variant);
+
+  const std::vector<std::string> feature_names_;
+  ProgramBinaryCache* program_binary_cache_;
+  std::string vertex_shader_source_;
+  std::string fragment_shader_source_;
+  std::unordered_map<ShaderFeatureMask, Variant> variants_;
+  // The variants that are compiling, in the order of submission.
+  std::vector<ShaderFeatureMask> pending_variants_;
+  Statistics statistics_;
+};
+
+}  // namespace wvu
+
+#endif  // GLUTILS_SHADER_VARIANT_CACHE_H_
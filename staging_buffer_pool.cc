@@ -0,0 +1,81 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "staging_buffer_pool.h"
+
+#include <mutex>
+#include <utility>
+
+namespace wvu {
+
+StagingBuffer StagingBufferPool::Acquire(const size_t num_bytes) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Find the smallest buffer that can hold num_bytes.
+    int best_index = -1;
+    for (int i = 0; i < static_cast<int>(buffers_.size()); ++i) {
+      if (buffers_[i].capacity() >= num_bytes &&
+          (best_index < 0 ||
+           buffers_[i].capacity() < buffers_[best_index].capacity())) {
+        best_index = i;
+      }
+    }
+    if (best_index >= 0) {
+      StagingBuffer buffer = std::move(buffers_[best_index]);
+      buffers_.erase(buffers_.begin() + best_index);
+      pooled_bytes_ -= buffer.capacity();
+      buffer.set_size(num_bytes);
+      return buffer;
+    }
+  }
+  return StagingBuffer(num_bytes);
+}
+
+void StagingBufferPool::Release(StagingBuffer buffer) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (buffer.capacity() == 0 ||
+      pooled_bytes_ + buffer.capacity() > max_pooled_bytes_) {
+    // The buffer is freed once it goes out of scope.
+    return;
+  }
+  pooled_bytes_ += buffer.capacity();
+  buffers_.push_back(std::move(buffer));
+}
+
+size_t StagingBufferPool::pooled_bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return pooled_bytes_;
+}
+
+}  // namespace wvu
@@ -0,0 +1,116 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_STAGING_BUFFER_POOL_H_
+#define GLUTILS_STAGING_BUFFER_POOL_H_
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace wvu {
+// Host memory that holds texels before they are sent to the GPU. The memory is
+// not initialized when allocated, so every texel is written only once: when
+// the image is decoded into the buffer.
+class StagingBuffer {
+ public:
+  // Creates an empty buffer.
+  StagingBuffer() : size_(0), capacity_(0) {}
+  // Allocates a buffer that can hold capacity bytes.
+  explicit StagingBuffer(const size_t capacity) :
+      data_(new unsigned char[capacity]), size_(capacity),
+      capacity_(capacity) {}
+
+  // Movable but not copyable.
+  StagingBuffer(StagingBuffer&& other) = default;
+  StagingBuffer& operator=(StagingBuffer&& other) = default;
+
+  // Accessors.
+  unsigned char* data() { return data_.get(); }
+  const unsigned char* data() const { return data_.get(); }
+  // Number of bytes in use.
+  size_t size() const { return size_; }
+  // Number of allocated bytes.
+  size_t capacity() const { return capacity_; }
+
+  // Sets the number of bytes in use. The size cannot exceed the capacity.
+  void set_size(const size_t size) { size_ = size; }
+
+ private:
+  std::unique_ptr<unsigned char[]> data_;
+  size_t size_;
+  size_t capacity_;
+};
+
+// This class recycles staging buffers so that loading many textures does not
+// allocate (and page-fault) a fresh buffer for every texture. The pool keeps
+// released buffers until they add up to max_pooled_bytes; larger buffers are
+// freed. The class is thread-safe.
+//
+// Example:
+//
+// wvu::StagingBufferPool pool(64 << 20);
+// wvu::StagingBuffer buffer = pool.Acquire(width * height * 4);
+// ...  // Decode and upload.
+// pool.Release(std::move(buffer));
+class StagingBufferPool {
+ public:
+  // Constructor.
+  // Parameters:
+  //   max_pooled_bytes  The maximum number of bytes kept for reuse.
+  explicit StagingBufferPool(const size_t max_pooled_bytes) :
+      max_pooled_bytes_(max_pooled_bytes), pooled_bytes_(0) {}
+  ~StagingBufferPool() {}
+
+  // Returns a buffer of num_bytes bytes. The pooled buffer with the smallest
+  // sufficient capacity is reused when available.
+  StagingBuffer Acquire(const size_t num_bytes);
+
+  // Returns the buffer to the pool.
+  void Release(StagingBuffer buffer);
+
+  // Number of bytes currently kept by the pool.
+  size_t pooled_bytes() const;
+
+ private:
+  mutable std::mutex mutex_;
+  std::vector<StagingBuffer> buffers_;
+  const size_t max_pooled_bytes_;
+  size_t pooled_bytes_;
+};
+
+}  // namespace wvu
+
+#endif  // GLUTILS_STAGING_BUFFER_POOL_H_
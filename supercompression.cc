@@ -0,0 +1,342 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "supercompression.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <glog/logging.h>
+
+#ifdef GLUTILS_USE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef GLUTILS_USE_LZ4
+#include <lz4.h>
+#include <lz4hc.h>
+#endif
+
+namespace wvu {
+namespace {
+// Size of the prefix of the LZ4 chunks, which holds their compressed size.
+constexpr size_t kLz4ChunkPrefixSize = sizeof(uint32_t);
+
+// A chunk of a payload to decompress.
+struct Chunk {
+  const unsigned char* compressed;
+  size_t compressed_size;
+  unsigned char* data;
+  size_t num_bytes;
+};
+
+// Runs function(i) for i in [0, num_items), which the threads take until there
+// are none left.
+template <typename Function>
+void ParallelFor(const size_t num_items,
+                 const int num_threads,
+                 const Function& function) {
+  std::atomic<size_t> next_item(0);
+  auto run_items = [&]() {
+    for (size_t i = next_item++; i < num_items; i = next_item++) {
+      function(i);
+    }
+  };
+  const size_t max_num_threads = num_threads > 0 ?
+      num_threads : std::max(1u, std::thread::hardware_concurrency());
+  const size_t num_workers = std::min(max_num_threads, num_items);
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < num_workers; ++i) {
+    workers.emplace_back(run_items);
+  }
+  run_items();
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+}
+
+#if defined(GLUTILS_USE_ZSTD) || defined(GLUTILS_USE_LZ4)
+// Compresses a chunk. Returns false if the compressor failed.
+bool CompressChunk(const Supercompression supercompression,
+                   const unsigned char* data,
+                   const size_t num_bytes,
+                   const int compression_level,
+                   std::vector<unsigned char>* compressed) {
+  switch (supercompression) {
+#ifdef GLUTILS_USE_ZSTD
+    case SUPERCOMPRESSION_ZSTD: {
+      compressed->resize(ZSTD_compressBound(num_bytes));
+      const size_t size = ZSTD_compress(
+          compressed->data(), compressed->size(), data, num_bytes,
+          compression_level > 0 ? compression_level : ZSTD_CLEVEL_DEFAULT);
+      if (ZSTD_isError(size)) {
+        LOG(ERROR) << "Zstandard compression failed: "
+                   << ZSTD_getErrorName(size);
+        return false;
+      }
+      compressed->resize(size);
+      return true;
+    }
+#endif
+#ifdef GLUTILS_USE_LZ4
+    case SUPERCOMPRESSION_LZ4: {
+      const int bound = LZ4_compressBound(static_cast<int>(num_bytes));
+      compressed->resize(kLz4ChunkPrefixSize + bound);
+      char* output =
+          reinterpret_cast<char*>(compressed->data() + kLz4ChunkPrefixSize);
+      const char* input = reinterpret_cast<const char*>(data);
+      const int size = compression_level > 0 ?
+          LZ4_compress_HC(input, output, static_cast<int>(num_bytes), bound,
+                          compression_level) :
+          LZ4_compress_default(input, output, static_cast<int>(num_bytes),
+                               bound);
+      if (size <= 0) {
+        LOG(ERROR) << "LZ4 compression failed.";
+        return false;
+      }
+      const uint32_t prefix = static_cast<uint32_t>(size);
+      memcpy(compressed->data(), &prefix, kLz4ChunkPrefixSize);
+      compressed->resize(kLz4ChunkPrefixSize + size);
+      return true;
+    }
+#endif
+    default:
+      return false;
+  }
+}
+#else
+// Neither compressor was found when the library was configured.
+bool CompressChunk(const Supercompression /* supercompression */,
+                   const unsigned char* /* data */,
+                   const size_t /* num_bytes */,
+                   const int /* compression_level */,
+                   std::vector<unsigned char>* /* compressed */) {
+  return false;
+}
+#endif
+
+// Splits the compressed payloads into their chunks. Returns false if a
+// payload is corrupt.
+bool SplitIntoChunks(const Supercompression supercompression,
+                     const std::vector<SupercompressedBuffer>& buffers,
+                     std::vector<Chunk>* chunks) {
+  for (const SupercompressedBuffer& buffer : buffers) {
+    size_t position = 0;
+    for (size_t offset = 0; offset < buffer.num_bytes;
+         offset += kSupercompressionChunkSize) {
+      Chunk chunk;
+      chunk.data = buffer.data + offset;
+      chunk.num_bytes =
+          std::min(kSupercompressionChunkSize, buffer.num_bytes - offset);
+      const unsigned char* compressed = buffer.compressed + position;
+      const size_t remaining_size = buffer.compressed_size - position;
+      if (supercompression == SUPERCOMPRESSION_ZSTD) {
+#ifdef GLUTILS_USE_ZSTD
+        // Every chunk is a frame.
+        chunk.compressed = compressed;
+        chunk.compressed_size =
+            ZSTD_findFrameCompressedSize(compressed, remaining_size);
+        if (ZSTD_isError(chunk.compressed_size)) {
+          return false;
+        }
+#else
+        return false;
+#endif
+      } else {
+        uint32_t size;
+        if (remaining_size < kLz4ChunkPrefixSize) {
+          return false;
+        }
+        memcpy(&size, compressed, kLz4ChunkPrefixSize);
+        if (size > remaining_size - kLz4ChunkPrefixSize) {
+          return false;
+        }
+        chunk.compressed = compressed + kLz4ChunkPrefixSize;
+        chunk.compressed_size = size;
+        position += kLz4ChunkPrefixSize;
+      }
+      position += chunk.compressed_size;
+      chunks->push_back(chunk);
+    }
+    if (position != buffer.compressed_size) {
+      return false;
+    }
+  }
+  return true;
+}
+
+#if defined(GLUTILS_USE_ZSTD) || defined(GLUTILS_USE_LZ4)
+// Decompresses a chunk. Returns false if it does not decompress to its size.
+bool DecompressChunk(const Supercompression supercompression,
+                     const Chunk& chunk) {
+  switch (supercompression) {
+#ifdef GLUTILS_USE_ZSTD
+    case SUPERCOMPRESSION_ZSTD: {
+      const size_t size = ZSTD_decompress(chunk.data, chunk.num_bytes,
+                                          chunk.compressed,
+                                          chunk.compressed_size);
+      return !ZSTD_isError(size) && size == chunk.num_bytes;
+    }
+#endif
+#ifdef GLUTILS_USE_LZ4
+    case SUPERCOMPRESSION_LZ4: {
+      const int size = LZ4_decompress_safe(
+          reinterpret_cast<const char*>(chunk.compressed),
+          reinterpret_cast<char*>(chunk.data),
+          static_cast<int>(chunk.compressed_size),
+          static_cast<int>(chunk.num_bytes));
+      return size >= 0 && static_cast<size_t>(size) == chunk.num_bytes;
+    }
+#endif
+    default:
+      return false;
+  }
+}
+#else
+// Neither compressor was found when the library was configured.
+bool DecompressChunk(const Supercompression /* supercompression */,
+                     const Chunk& /* chunk */) {
+  return false;
+}
+#endif
+
+}  // namespace
+
+bool IsSupercompressionAvailable(const Supercompression supercompression) {
+  switch (supercompression) {
+    case SUPERCOMPRESSION_NONE:
+      return true;
+    case SUPERCOMPRESSION_ZSTD:
+#ifdef GLUTILS_USE_ZSTD
+      return true;
+#else
+      return false;
+#endif
+    case SUPERCOMPRESSION_LZ4:
+#ifdef GLUTILS_USE_LZ4
+      return true;
+#else
+      return false;
+#endif
+    default:
+      return false;
+  }
+}
+
+const char* SupercompressionName(const Supercompression supercompression) {
+  switch (supercompression) {
+    case SUPERCOMPRESSION_NONE:
+      return "none";
+    case SUPERCOMPRESSION_ZSTD:
+      return "zstd";
+    case SUPERCOMPRESSION_LZ4:
+      return "lz4";
+    default:
+      return "unknown";
+  }
+}
+
+bool Supercompress(const Supercompression supercompression,
+                   const unsigned char* data,
+                   const size_t num_bytes,
+                   const int compression_level,
+                   const int num_threads,
+                   std::vector<unsigned char>* compressed) {
+  if (!IsSupercompressionAvailable(supercompression)) {
+    LOG(ERROR) << "The library was built without "
+               << SupercompressionName(supercompression) << ".";
+    return false;
+  }
+  compressed->clear();
+  if (supercompression == SUPERCOMPRESSION_NONE) {
+    compressed->assign(data, data + num_bytes);
+    return true;
+  }
+  const size_t num_chunks =
+      (num_bytes + kSupercompressionChunkSize - 1) / kSupercompressionChunkSize;
+  std::vector<std::vector<unsigned char>> compressed_chunks(num_chunks);
+  std::atomic<bool> success(true);
+  ParallelFor(num_chunks, num_threads, [&](const size_t i) {
+    const size_t offset = i * kSupercompressionChunkSize;
+    if (!CompressChunk(supercompression, data + offset,
+                       std::min(kSupercompressionChunkSize,
+                                num_bytes - offset),
+                       compression_level, &compressed_chunks[i])) {
+      success = false;
+    }
+  });
+  if (!success) {
+    return false;
+  }
+  for (const std::vector<unsigned char>& chunk : compressed_chunks) {
+    compressed->insert(compressed->end(), chunk.begin(), chunk.end());
+  }
+  return true;
+}
+
+bool DecompressSupercompressed(
+    const Supercompression supercompression,
+    const std::vector<SupercompressedBuffer>& buffers,
+    const int num_threads) {
+  if (!IsSupercompressionAvailable(supercompression)) {
+    LOG(ERROR) << "The library was built without "
+               << SupercompressionName(supercompression) << ".";
+    return false;
+  }
+  if (supercompression == SUPERCOMPRESSION_NONE) {
+    for (const SupercompressedBuffer& buffer : buffers) {
+      if (buffer.compressed_size != buffer.num_bytes) {
+        return false;
+      }
+      memcpy(buffer.data, buffer.compressed, buffer.num_bytes);
+    }
+    return true;
+  }
+  std::vector<Chunk> chunks;
+  if (!SplitIntoChunks(supercompression, buffers, &chunks)) {
+    return false;
+  }
+  std::atomic<bool> success(true);
+  ParallelFor(chunks.size(), num_threads, [&](const size_t i) {
+    if (!DecompressChunk(supercompression, chunks[i])) {
+      success = false;
+    }
+  });
+  return success;
+}
+
+}  // namespace wvu
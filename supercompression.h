@@ -0,0 +1,124 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_SUPERCOMPRESSION_H_
+#define GLUTILS_SUPERCOMPRESSION_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace wvu {
+// Lossless compression of texture payloads, e.g., BC or ETC blocks, on top of
+// their GPU format ("supercompression"). The payloads stay in their GPU format
+// once decompressed, so the compression only shrinks the files: it pays off
+// when reading the bytes costs more than decompressing them, e.g., on network
+// storage or slow disks.
+// The payloads are compressed in independent chunks of
+// kSupercompressionChunkSize bytes, so that the chunks decompress in parallel.
+// Zstandard payloads are concatenated Zstandard frames, which any Zstandard
+// decoder reads as a single stream.
+//
+// Example:
+//
+// std::vector<unsigned char> compressed;
+// if (wvu::Supercompress(wvu::SUPERCOMPRESSION_ZSTD, blocks, num_bytes, 0, 0,
+//                        &compressed)) {
+//   ...
+//   const wvu::SupercompressedBuffer buffer = {
+//     compressed.data(), compressed.size(), blocks, num_bytes
+//   };
+//   wvu::DecompressSupercompressed(wvu::SUPERCOMPRESSION_ZSTD, { buffer }, 0);
+// }
+enum Supercompression {
+  // The payloads are stored as they are.
+  SUPERCOMPRESSION_NONE = 0,
+  // Zstandard: smaller payloads than LZ4, and decompression in the order of
+  // 1 GB/s per thread. Requires building with GLUTILS_USE_ZSTD.
+  SUPERCOMPRESSION_ZSTD = 1,
+  // LZ4: larger payloads than Zstandard, but decompression several times
+  // faster. Requires building with GLUTILS_USE_LZ4.
+  SUPERCOMPRESSION_LZ4 = 2
+};
+
+// Size of the uncompressed chunks of the payloads.
+constexpr size_t kSupercompressionChunkSize = 256 << 10;
+
+// Returns true if the library was built with the compressor.
+bool IsSupercompressionAvailable(const Supercompression supercompression);
+
+// Returns the name of the supercompression, e.g., "zstd".
+const char* SupercompressionName(const Supercompression supercompression);
+
+// Compresses the bytes. Returns true if successful, and false if the
+// compressor is not available.
+// Parameters:
+//   supercompression  The compressor.
+//   data  The bytes to compress.
+//   num_bytes  The number of bytes.
+//   compression_level  The level of the compressor (1-22 for Zstandard, 1-12
+//     for the high-compression mode of LZ4); 0 uses the default level.
+//   num_threads  The number of threads that compress the chunks; 0 uses one
+//     thread per core.
+//   compressed  The compressed bytes.
+bool Supercompress(const Supercompression supercompression,
+                   const unsigned char* data,
+                   const size_t num_bytes,
+                   const int compression_level,
+                   const int num_threads,
+                   std::vector<unsigned char>* compressed);
+
+// A compressed payload and the memory where it is decompressed.
+struct SupercompressedBuffer {
+  const unsigned char* compressed;
+  size_t compressed_size;
+  unsigned char* data;
+  // The number of bytes of the decompressed payload, which data holds.
+  size_t num_bytes;
+};
+
+// Decompresses the buffers, e.g., the mip levels of a texture. The chunks of
+// all the buffers are split among threads. Returns true if successful, and
+// false if the compressor is not available or some payload is corrupt.
+// Parameters:
+//   supercompression  The compressor of the payloads.
+//   buffers  The buffers to decompress.
+//   num_threads  The number of threads; 0 uses one thread per core.
+bool DecompressSupercompressed(
+    const Supercompression supercompression,
+    const std::vector<SupercompressedBuffer>& buffers,
+    const int num_threads);
+
+}  // namespace wvu
+
+#endif  // GLUTILS_SUPERCOMPRESSION_H_
@@ -0,0 +1,421 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "texture_atlas.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "image_reader.h"
+
+namespace wvu {
+namespace {
+// A rectangle of a page in texels.
+struct Rectangle {
+  int x;
+  int y;
+  int width;
+  int height;
+};
+
+// The free space of a page as the list of its maximal free rectangles. The
+// rectangles overlap each other.
+class MaxRectsPage {
+ public:
+  MaxRectsPage(const int width, const int height) {
+    free_rectangles_.push_back({0, 0, width, height});
+  }
+
+  // Finds the free rectangle that fits the dimensions with the smallest
+  // leftover side. Returns false if none fits. The score is the shortest and
+  // then the longest leftover side; smaller is better.
+  bool FindPosition(const int width,
+                    const int height,
+                    Rectangle* placement,
+                    int* short_side_score,
+                    int* long_side_score) const {
+    bool found = false;
+    for (const Rectangle& free_rectangle : free_rectangles_) {
+      if (free_rectangle.width < width || free_rectangle.height < height) {
+        continue;
+      }
+      const int leftover_width = free_rectangle.width - width;
+      const int leftover_height = free_rectangle.height - height;
+      const int short_side = std::min(leftover_width, leftover_height);
+      const int long_side = std::max(leftover_width, leftover_height);
+      if (!found || short_side < *short_side_score ||
+          (short_side == *short_side_score && long_side < *long_side_score)) {
+        *placement = {free_rectangle.x, free_rectangle.y, width, height};
+        *short_side_score = short_side;
+        *long_side_score = long_side;
+        found = true;
+      }
+    }
+    return found;
+  }
+
+  // Removes the placed rectangle from the free space.
+  void Place(const Rectangle& placed) {
+    std::vector<Rectangle> split_rectangles;
+    for (size_t i = 0; i < free_rectangles_.size();) {
+      if (SplitFreeRectangle(free_rectangles_[i], placed, &split_rectangles)) {
+        free_rectangles_[i] = free_rectangles_.back();
+        free_rectangles_.pop_back();
+      } else {
+        ++i;
+      }
+    }
+    free_rectangles_.insert(free_rectangles_.end(), split_rectangles.begin(),
+                            split_rectangles.end());
+    PruneFreeRectangles();
+  }
+
+ private:
+  static bool Contains(const Rectangle& outer, const Rectangle& inner) {
+    return inner.x >= outer.x && inner.y >= outer.y &&
+        inner.x + inner.width <= outer.x + outer.width &&
+        inner.y + inner.height <= outer.y + outer.height;
+  }
+
+  // Adds the parts of the free rectangle that the placed rectangle does not
+  // cover. Returns false if they do not intersect.
+  static bool SplitFreeRectangle(const Rectangle& free_rectangle,
+                                 const Rectangle& placed,
+                                 std::vector<Rectangle>* split_rectangles) {
+    if (placed.x >= free_rectangle.x + free_rectangle.width ||
+        placed.x + placed.width <= free_rectangle.x ||
+        placed.y >= free_rectangle.y + free_rectangle.height ||
+        placed.y + placed.height <= free_rectangle.y) {
+      return false;
+    }
+    // Left, right, top and bottom of the placed rectangle.
+    if (placed.x > free_rectangle.x) {
+      split_rectangles->push_back({free_rectangle.x, free_rectangle.y,
+                                   placed.x - free_rectangle.x,
+                                   free_rectangle.height});
+    }
+    if (placed.x + placed.width < free_rectangle.x + free_rectangle.width) {
+      split_rectangles->push_back(
+          {placed.x + placed.width, free_rectangle.y,
+           free_rectangle.x + free_rectangle.width - placed.x - placed.width,
+           free_rectangle.height});
+    }
+    if (placed.y > free_rectangle.y) {
+      split_rectangles->push_back({free_rectangle.x, free_rectangle.y,
+                                   free_rectangle.width,
+                                   placed.y - free_rectangle.y});
+    }
+    if (placed.y + placed.height < free_rectangle.y + free_rectangle.height) {
+      split_rectangles->push_back(
+          {free_rectangle.x, placed.y + placed.height, free_rectangle.width,
+           free_rectangle.y + free_rectangle.height - placed.y -
+           placed.height});
+    }
+    return true;
+  }
+
+  // Removes the free rectangles contained in other free rectangles.
+  void PruneFreeRectangles() {
+    for (size_t i = 0; i < free_rectangles_.size(); ++i) {
+      for (size_t j = i + 1; j < free_rectangles_.size();) {
+        if (Contains(free_rectangles_[i], free_rectangles_[j])) {
+          free_rectangles_.erase(free_rectangles_.begin() + j);
+        } else if (Contains(free_rectangles_[j], free_rectangles_[i])) {
+          free_rectangles_.erase(free_rectangles_.begin() + i);
+          --i;
+          break;
+        } else {
+          ++j;
+        }
+      }
+    }
+  }
+
+  std::vector<Rectangle> free_rectangles_;
+};
+
+int RoundUp(const int value, const int multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+// Copies the image into the page and fills the gutter around it with its
+// border texels.
+void CopyWithGutter(const unsigned char* image,
+                    const TextureAtlasEntry& entry,
+                    const int gutter,
+                    const int page_width,
+                    const int page_height,
+                    unsigned char* page) {
+  const int x_begin = std::max(0, entry.x - gutter);
+  const int x_end = std::min(page_width, entry.x + entry.width + gutter);
+  const int y_begin = std::max(0, entry.y - gutter);
+  const int y_end = std::min(page_height, entry.y + entry.height + gutter);
+  const size_t image_row_size = 4 * static_cast<size_t>(entry.width);
+  for (int y = y_begin; y < y_end; ++y) {
+    const int image_y = std::min(std::max(y - entry.y, 0), entry.height - 1);
+    const unsigned char* image_row = image + image_y * image_row_size;
+    unsigned char* page_row = page + 4 * static_cast<size_t>(y) * page_width;
+    for (int x = x_begin; x < entry.x; ++x) {
+      std::memcpy(page_row + 4 * x, image_row, 4);
+    }
+    std::memcpy(page_row + 4 * entry.x, image_row, image_row_size);
+    for (int x = entry.x + entry.width; x < x_end; ++x) {
+      std::memcpy(page_row + 4 * x, image_row + image_row_size - 4, 4);
+    }
+  }
+}
+
+}  // namespace
+
+const TextureAtlasEntry* TextureAtlas::FindEntry(
+    const std::string& source_filepath) const {
+  for (const TextureAtlasEntry& entry : entries) {
+    if (entry.source_filepath == source_filepath) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+int PackTextureAtlas(const std::vector<int>& widths,
+                     const std::vector<int>& heights,
+                     const TextureAtlasOptions& options,
+                     std::vector<TextureAtlasEntry>* entries) {
+  const int alignment = 1 << options.max_mip_level;
+  const int gutter = alignment;
+  if (options.page_width % alignment != 0 ||
+      options.page_height % alignment != 0) {
+    LOG(ERROR) << "The pages of the atlas must be multiples of " << alignment
+               << " texels.";
+    return 0;
+  }
+  // The large images go first, while the pages are empty.
+  std::vector<int> order(widths.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](const int a, const int b) {
+    const int a_side = std::max(widths[a], heights[a]);
+    const int b_side = std::max(widths[b], heights[b]);
+    if (a_side != b_side) {
+      return a_side > b_side;
+    }
+    return widths[a] * heights[a] > widths[b] * heights[b];
+  });
+  entries->resize(widths.size());
+  std::vector<MaxRectsPage> pages;
+  for (const int i : order) {
+    // The padded rectangles start and end at multiples of the alignment, since
+    // the free rectangles are bounded by other padded rectangles.
+    const int padded_width = RoundUp(widths[i] + 2 * gutter, alignment);
+    const int padded_height = RoundUp(heights[i] + 2 * gutter, alignment);
+    if (padded_width > options.page_width ||
+        padded_height > options.page_height) {
+      LOG(ERROR) << "An image of " << widths[i] << "x" << heights[i]
+                 << " texels does not fit in a page of the atlas.";
+      return 0;
+    }
+    int best_page = -1;
+    Rectangle best_placement;
+    int best_short_side = std::numeric_limits<int>::max();
+    int best_long_side = std::numeric_limits<int>::max();
+    for (int page = 0; page < static_cast<int>(pages.size()); ++page) {
+      Rectangle placement;
+      int short_side;
+      int long_side;
+      if (pages[page].FindPosition(padded_width, padded_height, &placement,
+                                   &short_side, &long_side) &&
+          (short_side < best_short_side ||
+           (short_side == best_short_side && long_side < best_long_side))) {
+        best_page = page;
+        best_placement = placement;
+        best_short_side = short_side;
+        best_long_side = long_side;
+      }
+    }
+    if (best_page < 0) {
+      pages.emplace_back(options.page_width, options.page_height);
+      best_page = static_cast<int>(pages.size()) - 1;
+      best_placement = {0, 0, padded_width, padded_height};
+    }
+    pages[best_page].Place(best_placement);
+    TextureAtlasEntry& entry = (*entries)[i];
+    entry.page = best_page;
+    entry.x = best_placement.x + gutter;
+    entry.y = best_placement.y + gutter;
+    entry.width = widths[i];
+    entry.height = heights[i];
+  }
+  return static_cast<int>(pages.size());
+}
+
+bool BuildTextureAtlas(const std::vector<std::string>& source_filepaths,
+                       const TextureAtlasOptions& options,
+                       TextureAtlas* atlas,
+                       std::vector<std::vector<unsigned char>>* pages) {
+  // Read the dimensions first; the images are decoded once they are placed.
+  std::vector<int> widths;
+  std::vector<int> heights;
+  for (const std::string& source_filepath : source_filepaths) {
+    ImageReader image_reader;
+    if (!image_reader.Open(source_filepath)) {
+      LOG(ERROR) << "Could not open the image " << source_filepath;
+      return false;
+    }
+    widths.push_back(image_reader.width());
+    heights.push_back(image_reader.height());
+  }
+  std::vector<TextureAtlasEntry> entries;
+  const int num_pages = PackTextureAtlas(widths, heights, options, &entries);
+  if (num_pages == 0 && !source_filepaths.empty()) {
+    return false;
+  }
+  const size_t page_size_in_bytes =
+      4 * static_cast<size_t>(options.page_width) * options.page_height;
+  pages->assign(num_pages, std::vector<unsigned char>(page_size_in_bytes, 0));
+  std::vector<unsigned char> image;
+  for (int i = 0; i < static_cast<int>(source_filepaths.size()); ++i) {
+    entries[i].source_filepath = source_filepaths[i];
+    ImageReader image_reader;
+    if (!image_reader.Open(source_filepaths[i])) {
+      LOG(ERROR) << "Could not open the image " << source_filepaths[i];
+      return false;
+    }
+    image.resize(image_reader.rgba8_size_in_bytes());
+    if (!image_reader.ReadRgba8(image.data())) {
+      LOG(ERROR) << "Could not decode the image " << source_filepaths[i];
+      return false;
+    }
+    CopyWithGutter(image.data(), entries[i], 1 << options.max_mip_level,
+                   options.page_width, options.page_height,
+                   (*pages)[entries[i].page].data());
+  }
+  atlas->page_width = options.page_width;
+  atlas->page_height = options.page_height;
+  atlas->max_mip_level = options.max_mip_level;
+  atlas->page_filepaths.assign(num_pages, std::string());
+  atlas->entries = entries;
+  return true;
+}
+
+bool WriteTextureAtlasManifest(const std::string& manifest_filepath,
+                               const TextureAtlas& atlas) {
+  std::ofstream manifest(manifest_filepath);
+  if (!manifest) {
+    LOG(ERROR) << "Could not create the atlas manifest " << manifest_filepath;
+    return false;
+  }
+  manifest << "texture_atlas " << atlas.page_width << " " << atlas.page_height
+           << " " << atlas.max_mip_level << "\n";
+  for (const std::string& page_filepath : atlas.page_filepaths) {
+    manifest << "page " << page_filepath << "\n";
+  }
+  for (const TextureAtlasEntry& entry : atlas.entries) {
+    manifest << "entry " << entry.page << " " << entry.x << " " << entry.y
+             << " " << entry.width << " " << entry.height << " "
+             << entry.source_filepath << "\n";
+  }
+  manifest.close();
+  if (!manifest) {
+    LOG(ERROR) << "Could not write the atlas manifest " << manifest_filepath;
+    return false;
+  }
+  return true;
+}
+
+bool ReadTextureAtlasManifest(const std::string& manifest_filepath,
+                              TextureAtlas* atlas) {
+  std::ifstream manifest(manifest_filepath);
+  if (!manifest) {
+    LOG(ERROR) << "Could not open the atlas manifest " << manifest_filepath;
+    return false;
+  }
+  *atlas = TextureAtlas();
+  std::string line;
+  int line_number = 0;
+  while (std::getline(manifest, line)) {
+    ++line_number;
+    std::istringstream line_stream(line);
+    std::string keyword;
+    line_stream >> keyword;
+    bool success = true;
+    if (keyword == "texture_atlas") {
+      success = static_cast<bool>(line_stream >> atlas->page_width >>
+                                  atlas->page_height >> atlas->max_mip_level);
+    } else if (keyword == "page") {
+      std::string page_filepath;
+      success = static_cast<bool>(
+          std::getline(line_stream >> std::ws, page_filepath));
+      atlas->page_filepaths.push_back(page_filepath);
+    } else if (keyword == "entry") {
+      TextureAtlasEntry entry;
+      success = line_stream >> entry.page >> entry.x >> entry.y >>
+          entry.width >> entry.height &&
+          std::getline(line_stream >> std::ws, entry.source_filepath);
+      atlas->entries.push_back(entry);
+    } else if (!keyword.empty()) {
+      success = false;
+    }
+    if (!success) {
+      LOG(ERROR) << "Invalid line " << line_number << " in the atlas manifest "
+                 << manifest_filepath;
+      return false;
+    }
+  }
+  for (const TextureAtlasEntry& entry : atlas->entries) {
+    if (entry.page < 0 ||
+        entry.page >= static_cast<int>(atlas->page_filepaths.size())) {
+      LOG(ERROR) << "The atlas manifest " << manifest_filepath
+                 << " refers to a missing page.";
+      return false;
+    }
+  }
+  return atlas->page_width > 0 && atlas->page_height > 0;
+}
+
+void RemapAtlasTexcoord(const TextureAtlas& atlas,
+                        const TextureAtlasEntry& entry,
+                        float* s,
+                        float* t) {
+  *s = (entry.x + *s * entry.width) / atlas.page_width;
+  *t = (entry.y + *t * entry.height) / atlas.page_height;
+}
+
+}  // namespace wvu
@@ -0,0 +1,152 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_TEXTURE_ATLAS_H_
+#define GLUTILS_TEXTURE_ATLAS_H_
+
+#include <string>
+#include <vector>
+
+namespace wvu {
+// Texture atlases pack many small images into a few large pages, so the
+// objects that use them can be drawn without binding a texture per object.
+// The images are packed offline with the MaxRects algorithm (best short side
+// fit): every page keeps the list of its maximal free rectangles and every
+// image goes to the free rectangle that leaves the smallest leftover side.
+// Every page is a GL_TEXTURE_2D texture.
+// Mip levels average neighboring texels, so the images would bleed into each
+// other as the levels get smaller. Every image is surrounded by a gutter of
+// replicated border texels and placed at a multiple of 2^max_mip_level
+// texels, which keeps the levels up to max_mip_level free of bleeding; the
+// pages must be cooked without the levels above it (see
+// TextureCookingOptions::max_mip_level).
+// The texture coordinates of an object are remapped to the sub-rectangle of
+// its image with RemapAtlasTexcoord(). Only coordinates in [0, 1] map inside
+// the sub-rectangle; the atlas cannot repeat an image.
+//
+// Example:
+//
+// wvu::TextureAtlas atlas;
+// std::vector<std::vector<unsigned char>> pages;
+// if (!wvu::BuildTextureAtlas(image_filepaths, wvu::TextureAtlasOptions(),
+//                             &atlas, &pages)) {
+//   ...
+// }
+// ...  // Save the pages as images and fill atlas.page_filepaths.
+// wvu::WriteTextureAtlasManifest("/path/to/atlas.txt", atlas);
+
+// Configuration of the packer.
+struct TextureAtlasOptions {
+  // Dimensions of every page in texels. They must be multiples of
+  // 2^max_mip_level.
+  int page_width = 4096;
+  int page_height = 4096;
+  // Highest mip level that does not bleed between images. The gutter around
+  // the images is 2^max_mip_level texels wide.
+  int max_mip_level = 2;
+};
+
+// Placement of a source image in the atlas.
+struct TextureAtlasEntry {
+  std::string source_filepath;
+  // Page that holds the image.
+  int page = 0;
+  // Sub-rectangle of the page covered by the image, without the gutter.
+  int x = 0;
+  int y = 0;
+  int width = 0;
+  int height = 0;
+};
+
+// A packed atlas.
+struct TextureAtlas {
+  int page_width = 0;
+  int page_height = 0;
+  int max_mip_level = 0;
+  // Filepaths of the images of the pages. They are only known once the pages
+  // are saved.
+  std::vector<std::string> page_filepaths;
+  std::vector<TextureAtlasEntry> entries;
+
+  // Returns the entry of the source image, or null if it is not in the atlas.
+  const TextureAtlasEntry* FindEntry(const std::string& source_filepath) const;
+};
+
+// Packs rectangles into pages. Returns the number of pages, or zero if a
+// rectangle does not fit in a page.
+// Parameters:
+//   widths, heights  The dimensions of the images.
+//   options  The configuration of the packer.
+//   entries  The placements of the images, in the same order.
+int PackTextureAtlas(const std::vector<int>& widths,
+                     const std::vector<int>& heights,
+                     const TextureAtlasOptions& options,
+                     std::vector<TextureAtlasEntry>* entries);
+
+// Decodes the images and packs them into RGBA8 pages with their gutters.
+// Returns true if successful, and false otherwise.
+// Parameters:
+//   source_filepaths  The filepaths of the images.
+//   options  The configuration of the packer.
+//   atlas  The packed atlas. The filepaths of the pages are left empty.
+//   pages  The texels of every page, top to bottom.
+bool BuildTextureAtlas(const std::vector<std::string>& source_filepaths,
+                       const TextureAtlasOptions& options,
+                       TextureAtlas* atlas,
+                       std::vector<std::vector<unsigned char>>* pages);
+
+// Writes the atlas as a text manifest with one line per page and per entry.
+// The filepaths must not contain line breaks. Returns true if successful, and
+// false otherwise.
+bool WriteTextureAtlasManifest(const std::string& manifest_filepath,
+                               const TextureAtlas& atlas);
+
+// Reads an atlas written by WriteTextureAtlasManifest(). Returns true if
+// successful, and false otherwise.
+bool ReadTextureAtlasManifest(const std::string& manifest_filepath,
+                              TextureAtlas* atlas);
+
+// Maps a texture coordinate of the source image of the entry to the atlas.
+// Parameters:
+//   atlas  The atlas.
+//   entry  The entry of the image.
+//   s, t  The texture coordinates, which are in [0, 1] across the image.
+void RemapAtlasTexcoord(const TextureAtlas& atlas,
+                        const TextureAtlasEntry& entry,
+                        float* s,
+                        float* t);
+
+}  // namespace wvu
+
+#endif  // GLUTILS_TEXTURE_ATLAS_H_
@@ -0,0 +1,174 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+// Offline builder of texture atlases. The tool packs the images into pages,
+// saves the pages as PNG images and writes a manifest with the placement of
+// every image, which draw_scene reads with --texture_atlas_manifest.
+//
+// Example:
+//   ./bin/texture_atlas_builder --image_list=images.txt
+//       --output_directory=/path/to/atlas --page_size=4096
+//
+// The images are given with --image_filepaths (comma-separated) and/or
+// --image_list (a file with one filepath per line).
+
+// Use the right namespace for google flags (gflags).
+#ifdef GFLAGS_NAMESPACE_GOOGLE
+#define GLUTILS_GFLAGS_NAMESPACE google
+#else
+#define GLUTILS_GFLAGS_NAMESPACE gflags
+#endif
+
+// Include second C++-Headers.
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Include library headers.
+#include <CImg.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+// Include system headers.
+#include "texture_atlas.h"
+
+DEFINE_string(image_filepaths, "",
+              "Comma-separated list of the images to pack.");
+DEFINE_string(image_list, "",
+              "File with the filepaths of the images to pack, one per line.");
+DEFINE_string(output_directory, "",
+              "Directory where the pages (atlas_page_<n>.png) and the manifest "
+              "(atlas.txt) are written.");
+DEFINE_int32(page_size, 4096,
+             "Width and height of every page in texels.");
+DEFINE_int32(max_mip_level, 2,
+             "Highest mip level that does not bleed between the images. The "
+             "images are surrounded by gutters of 2^max_mip_level texels.");
+
+// Annonymous namespace for constants and helper functions.
+namespace {
+// Splits a comma-separated list into its elements.
+std::vector<std::string> SplitCommaSeparatedList(const std::string& list) {
+  std::vector<std::string> elements;
+  std::stringstream stream(list);
+  std::string element;
+  while (std::getline(stream, element, ',')) {
+    if (!element.empty()) {
+      elements.push_back(element);
+    }
+  }
+  return elements;
+}
+
+// Appends the non-empty lines of the file to lines. Returns true if
+// successful, and false otherwise.
+bool ReadLines(const std::string& filepath, std::vector<std::string>* lines) {
+  std::ifstream file(filepath);
+  if (!file) {
+    return false;
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    if (!line.empty()) {
+      lines->push_back(line);
+    }
+  }
+  return true;
+}
+
+// Saves the RGBA8 page as a PNG image. Returns true if successful, and false
+// otherwise.
+bool SavePage(const std::vector<unsigned char>& page,
+              const int width,
+              const int height,
+              const std::string& filepath) {
+  // CImg stores the channels as planes: the interleaved texels are read as a
+  // 4 x width x height image and the channel axis is moved last.
+  cimg_library::CImg<unsigned char> image(page.data(), 4, width, height, 1);
+  image.permute_axes("yzcx");
+  try {
+    image.save_png(filepath.c_str());
+  } catch (const cimg_library::CImgException& exception) {
+    LOG(ERROR) << "Could not write " << filepath << ": " << exception.what();
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  GLUTILS_GFLAGS_NAMESPACE::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  std::vector<std::string> image_filepaths =
+      SplitCommaSeparatedList(FLAGS_image_filepaths);
+  if (!FLAGS_image_list.empty() &&
+      !ReadLines(FLAGS_image_list, &image_filepaths)) {
+    std::cerr << "ERROR: Could not read " << FLAGS_image_list << ".\n";
+    return -1;
+  }
+  if (image_filepaths.empty() || FLAGS_output_directory.empty()) {
+    std::cerr << "ERROR: Provide --image_filepaths or --image_list, and "
+              << "--output_directory.\n";
+    return -1;
+  }
+  wvu::TextureAtlasOptions options;
+  options.page_width = FLAGS_page_size;
+  options.page_height = FLAGS_page_size;
+  options.max_mip_level = FLAGS_max_mip_level;
+  wvu::TextureAtlas atlas;
+  std::vector<std::vector<unsigned char>> pages;
+  if (!wvu::BuildTextureAtlas(image_filepaths, options, &atlas, &pages)) {
+    std::cerr << "ERROR: Could not build the atlas.\n";
+    return -1;
+  }
+  for (int i = 0; i < static_cast<int>(pages.size()); ++i) {
+    atlas.page_filepaths[i] = FLAGS_output_directory + "/atlas_page_" +
+        std::to_string(i) + ".png";
+    if (!SavePage(pages[i], atlas.page_width, atlas.page_height,
+                  atlas.page_filepaths[i])) {
+      return -1;
+    }
+  }
+  const std::string manifest_filepath = FLAGS_output_directory + "/atlas.txt";
+  if (!wvu::WriteTextureAtlasManifest(manifest_filepath, atlas)) {
+    return -1;
+  }
+  std::cout << "Packed " << atlas.entries.size() << " images into "
+            << pages.size() << " pages of " << atlas.page_width << "x"
+            << atlas.page_height << " texels: " << manifest_filepath << "\n";
+  return 0;
+}
@@ -0,0 +1,596 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+// Benchmarks for the texture loading pipeline. The benchmark reports the
+// per-texture latency of the different stages involved in loading a texture.
+//
+// Example:
+//   ./bin/texture_benchmark --image_filepaths=a.png,b.jpg --num_iterations=10
+//
+// The benchmarks to run are selected with --benchmarks. Passing
+// --synthetic_image_directory generates 4K and 8K images in that directory and
+// adds them to the images of the benchmark.
+
+// Use the right namespace for google flags (gflags).
+#ifdef GFLAGS_NAMESPACE_GOOGLE
+#define GLUTILS_GFLAGS_NAMESPACE google
+#else
+#define GLUTILS_GFLAGS_NAMESPACE gflags
+#endif
+
+// Include first C-Headers.
+#ifdef __linux__
+#include <malloc.h>
+#endif
+// Include second C++-Headers.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Include library headers.
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+// Include system headers.
+#include "channel_shuffle.h"
+#include "cpu_features.h"
+#include "half_float.h"
+#include "image_reader.h"
+#include "staging_buffer_pool.h"
+#include "texture_loader.h"
+
+DEFINE_string(image_filepaths, "",
+              "Comma-separated list of the images to use in the benchmark.");
+DEFINE_int32(num_iterations, 5,
+             "Number of times each measurement is repeated.");
+DEFINE_string(benchmarks, "decoding,staging,interleave,half",
+              "Comma-separated list of the benchmarks to run. Options: "
+              "decoding, staging, interleave, half.");
+DEFINE_string(synthetic_image_directory, "",
+              "If not empty, 4K and 8K PNG and JPEG images are generated in "
+              "this directory and added to the benchmark.");
+
+// Annonymous namespace for constants and helper functions.
+namespace {
+// Width of the columns of the reported tables.
+constexpr int kColumnWidth = 16;
+
+// Splits a comma-separated list into its elements.
+std::vector<std::string> SplitCommaSeparatedList(const std::string& list) {
+  std::vector<std::string> elements;
+  std::stringstream stream(list);
+  std::string element;
+  while (std::getline(stream, element, ',')) {
+    if (!element.empty()) {
+      elements.push_back(element);
+    }
+  }
+  return elements;
+}
+
+// Returns the time in milliseconds elapsed since start.
+double ElapsedMilliseconds(
+    const std::chrono::steady_clock::time_point& start) {
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// Measures the average time in milliseconds that CImg's external loader takes
+// to load the image. This is what CImg::load() does when it is not compiled
+// with the codecs: it calls ImageMagick or GraphicsMagick through a
+// subprocess and reads back a temporary file. Returns a negative number if the
+// external loader is not available.
+double MeasureExternalDecoding(const std::string& image_filepath) {
+  double total_milliseconds = 0.0;
+  for (int i = 0; i < FLAGS_num_iterations; ++i) {
+    cimg_library::CImg<unsigned char> image;
+    const std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    try {
+      image.load_other(image_filepath.c_str());
+    } catch (const cimg_library::CImgException&) {
+      return -1.0;
+    }
+    total_milliseconds += ElapsedMilliseconds(start);
+  }
+  return total_milliseconds / FLAGS_num_iterations;
+}
+
+// Measures the average time in milliseconds that the in-process decoders take
+// to load the image. Returns a negative number if the image cannot be loaded.
+double MeasureInProcessDecoding(const std::string& image_filepath) {
+  double total_milliseconds = 0.0;
+  for (int i = 0; i < FLAGS_num_iterations; ++i) {
+    cimg_library::CImg<unsigned char> image;
+    const std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    if (!wvu::LoadImageFromFile(image_filepath, &image)) {
+      return -1.0;
+    }
+    total_milliseconds += ElapsedMilliseconds(start);
+  }
+  return total_milliseconds / FLAGS_num_iterations;
+}
+
+// Prints a measurement or n/a when it is not available (negative).
+std::string FormatValue(const double value) {
+  if (value < 0.0) {
+    return "n/a";
+  }
+  std::stringstream stream;
+  stream << std::fixed << std::setprecision(3) << value;
+  return stream.str();
+}
+
+// Compares the per-texture decoding latency of the external converter
+// (before) against the in-process decoders (after).
+void RunDecodingBenchmark(const std::vector<std::string>& image_filepaths) {
+  std::cout << "Per-texture decoding latency (ms), "
+            << FLAGS_num_iterations << " iterations.\n";
+  std::cout << std::left << std::setw(kColumnWidth) << "external"
+            << std::setw(kColumnWidth) << "in-process"
+            << std::setw(kColumnWidth) << "speedup"
+            << "image\n";
+  double total_external_milliseconds = 0.0;
+  double total_in_process_milliseconds = 0.0;
+  for (const std::string& image_filepath : image_filepaths) {
+    const double external_milliseconds =
+        MeasureExternalDecoding(image_filepath);
+    const double in_process_milliseconds =
+        MeasureInProcessDecoding(image_filepath);
+    std::string speedup = "n/a";
+    if (external_milliseconds >= 0.0 && in_process_milliseconds > 0.0) {
+      std::stringstream stream;
+      stream << std::fixed << std::setprecision(1)
+             << external_milliseconds / in_process_milliseconds << "x";
+      speedup = stream.str();
+      total_external_milliseconds += external_milliseconds;
+      total_in_process_milliseconds += in_process_milliseconds;
+    }
+    std::cout << std::left
+              << std::setw(kColumnWidth)
+              << FormatValue(external_milliseconds)
+              << std::setw(kColumnWidth)
+              << FormatValue(in_process_milliseconds)
+              << std::setw(kColumnWidth) << speedup
+              << image_filepath << "\n";
+  }
+  std::cout << "Total (images decoded by both paths): "
+            << FormatValue(total_external_milliseconds) << " ms -> "
+            << FormatValue(total_in_process_milliseconds) << " ms\n";
+}
+
+// Generates synthetic 4K and 8K images in the directory and returns their
+// filepaths. The images contain gradients and noise so that the encoders
+// cannot compress them trivially.
+std::vector<std::string> GenerateSyntheticImages(const std::string& directory) {
+  struct Resolution {
+    const char* name;
+    int width;
+    int height;
+  };
+  static const Resolution kResolutions[] = {
+    { "4k", 3840, 2160 },
+    { "8k", 7680, 4320 }
+  };
+  std::vector<std::string> image_filepaths;
+  for (const Resolution& resolution : kResolutions) {
+    cimg_library::CImg<unsigned char> image(resolution.width,
+                                            resolution.height, 1, 3);
+    cimg_forXYC(image, x, y, c) {
+      image(x, y, c) = static_cast<unsigned char>(
+          (x * (c + 1) + y * (3 - c) + ((x ^ y) & 15)) & 255);
+    }
+    image.noise(8.0);
+    const std::string prefix = directory + "/synthetic_" + resolution.name;
+    try {
+      image.save_png((prefix + ".png").c_str());
+      image_filepaths.push_back(prefix + ".png");
+      image.save_jpeg((prefix + ".jpg").c_str(), 90);
+      image_filepaths.push_back(prefix + ".jpg");
+    } catch (const cimg_library::CImgException& exception) {
+      LOG(ERROR) << "Could not write " << prefix << ": " << exception.what();
+    }
+  }
+  return image_filepaths;
+}
+
+// Reads a field (in kB) of /proc/self/status, e.g., VmRSS or VmHWM. Returns a
+// negative number if the field is not available.
+double ReadProcessStatusMegabytes(const std::string& field) {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, field.size(), field) == 0 &&
+        line.size() > field.size() && line[field.size()] == ':') {
+      std::stringstream stream(line.substr(field.size() + 1));
+      double kilobytes = 0.0;
+      stream >> kilobytes;
+      return kilobytes / 1024.0;
+    }
+  }
+  return -1.0;
+}
+
+// Resets the high-water mark of the resident memory (VmHWM) of this process to
+// the current resident memory. Returns false if it is not supported.
+bool ResetPeakResidentMemory() {
+#ifdef __linux__
+  // Return the memory freed by previous measurements to the system, otherwise
+  // the next measurement reuses resident pages and reports a smaller peak.
+  malloc_trim(0);
+#endif
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  clear_refs << "5";
+  clear_refs.flush();
+  return clear_refs.good();
+}
+
+// Statistics of a staging measurement.
+struct StagingMeasurement {
+  // Average time to produce the interleaved texels in milliseconds.
+  double milliseconds = -1.0;
+  // Resident memory added at the peak of the load in megabytes.
+  double peak_megabytes = -1.0;
+};
+
+// Measures the load time and the memory high-water mark of the function. The
+// function must release all of its memory when it returns.
+template <class LoadFunction>
+StagingMeasurement MeasureStaging(const LoadFunction& load_function) {
+  StagingMeasurement measurement;
+  double total_milliseconds = 0.0;
+  for (int i = 0; i < FLAGS_num_iterations; ++i) {
+    const bool can_measure_memory = ResetPeakResidentMemory();
+    const double resident_megabytes = ReadProcessStatusMegabytes("VmRSS");
+    const std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    if (!load_function()) {
+      return StagingMeasurement();
+    }
+    total_milliseconds += ElapsedMilliseconds(start);
+    if (can_measure_memory && resident_megabytes >= 0.0) {
+      measurement.peak_megabytes =
+          std::max(measurement.peak_megabytes,
+                   ReadProcessStatusMegabytes("VmHWM") - resident_megabytes);
+    }
+  }
+  measurement.milliseconds = total_milliseconds / FLAGS_num_iterations;
+  return measurement;
+}
+
+// Compares the planar path (CImg decoding followed by permute_axes("cxyz"))
+// against decoding the scanlines directly into an interleaved RGBA8 staging
+// buffer. The staging buffers are not pooled here so that their allocation is
+// accounted for. Note that the planar path holds RGB (3 bytes per texel) while
+// the direct path holds RGBA8 (4 bytes per texel).
+void RunStagingBenchmark(const std::vector<std::string>& image_filepaths) {
+  std::cout << "Interleaved staging: load time (ms) and memory high-water "
+            << "mark (MB).\n";
+  std::cout << std::left << std::setw(kColumnWidth) << "resolution"
+            << std::setw(kColumnWidth) << "planar ms"
+            << std::setw(kColumnWidth) << "planar MB"
+            << std::setw(kColumnWidth) << "direct ms"
+            << std::setw(kColumnWidth) << "direct MB"
+            << "image\n";
+  for (const std::string& image_filepath : image_filepaths) {
+    int width = 0;
+    int height = 0;
+    const StagingMeasurement planar = MeasureStaging([&]() {
+      cimg_library::CImg<unsigned char> image;
+      if (!wvu::LoadImageFromFile(image_filepath, &image)) {
+        return false;
+      }
+      image.permute_axes("cxyz");
+      width = image.height();
+      height = image.depth();
+      return true;
+    });
+    const StagingMeasurement direct = MeasureStaging([&]() {
+      wvu::ImageReader image_reader;
+      if (!image_reader.Open(image_filepath)) {
+        return false;
+      }
+      width = image_reader.width();
+      height = image_reader.height();
+      wvu::StagingBuffer buffer(image_reader.rgba8_size_in_bytes());
+      return image_reader.ReadRgba8(buffer.data());
+    });
+    std::stringstream resolution;
+    resolution << width << "x" << height;
+    std::cout << std::left << std::setw(kColumnWidth) << resolution.str()
+              << std::setw(kColumnWidth)
+              << FormatValue(planar.milliseconds)
+              << std::setw(kColumnWidth)
+              << FormatValue(planar.peak_megabytes)
+              << std::setw(kColumnWidth)
+              << FormatValue(direct.milliseconds)
+              << std::setw(kColumnWidth)
+              << FormatValue(direct.peak_megabytes)
+              << image_filepath << "\n";
+  }
+}
+
+// Measures the average time in milliseconds of the function.
+template <class Function>
+double MeasureMilliseconds(const Function& function) {
+  double total_milliseconds = 0.0;
+  for (int i = 0; i < FLAGS_num_iterations; ++i) {
+    const std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    function();
+    total_milliseconds += ElapsedMilliseconds(start);
+  }
+  return total_milliseconds / FLAGS_num_iterations;
+}
+
+// Prints a row of the interleave benchmark.
+void PrintInterleaveRow(const std::string& type,
+                        const int num_channels,
+                        const std::string& kernel,
+                        const double milliseconds,
+                        const double reference_milliseconds,
+                        const bool matches_reference) {
+  std::stringstream speedup;
+  speedup << std::fixed << std::setprecision(2)
+          << reference_milliseconds / milliseconds << "x";
+  std::cout << std::left << std::setw(kColumnWidth) << type
+            << std::setw(kColumnWidth) << num_channels
+            << std::setw(kColumnWidth) << kernel
+            << std::setw(kColumnWidth) << FormatValue(milliseconds)
+            << std::setw(kColumnWidth) << speedup.str()
+            << (matches_reference ? "ok" : "MISMATCH") << "\n";
+}
+
+// Compares CImg's permute_axes("cxyz") against the channel shuffle kernels for
+// every instruction set that the CPU supports.
+template <typename T>
+void RunInterleaveBenchmark(const cimg_library::CImg<T>& image,
+                            const std::string& type) {
+  const size_t num_texels =
+      static_cast<size_t>(image.width()) * image.height();
+  const int num_channels = std::min(image.spectrum(), 4);
+  const cimg_library::CImg<T> planes =
+      image.get_channels(0, num_channels - 1);
+  cimg_library::CImg<T> reference;
+  const double permute_milliseconds = MeasureMilliseconds([&]() {
+    reference = planes.get_permute_axes("cxyz");
+  });
+  PrintInterleaveRow(type, num_channels, "permute_axes", permute_milliseconds,
+                     permute_milliseconds, true);
+  std::vector<T> interleaved(num_texels * num_channels);
+  std::vector<T> rgba(num_texels * 4);
+  // The RGBA results are compared against the scalar kernel.
+  std::vector<T> scalar_rgba;
+  const wvu::SimdLevel detected_simd_level = wvu::GetSimdLevel();
+  for (int level = wvu::SIMD_SCALAR; level <= detected_simd_level; ++level) {
+    const wvu::SimdLevel simd_level = static_cast<wvu::SimdLevel>(level);
+    wvu::SetMaxSimdLevel(simd_level);
+    const double interleave_milliseconds = MeasureMilliseconds([&]() {
+      wvu::InterleavePlanes(planes.data(), num_channels, num_texels,
+                            interleaved.data());
+    });
+    const bool matches_reference =
+        std::equal(interleaved.begin(), interleaved.end(), reference.data());
+    PrintInterleaveRow(type, num_channels, wvu::SimdLevelName(simd_level),
+                       interleave_milliseconds, permute_milliseconds,
+                       matches_reference);
+    const double rgba_milliseconds = MeasureMilliseconds([&]() {
+      wvu::InterleavePlanesToRgba(planes.data(), num_channels, num_texels,
+                                  T(255), rgba.data());
+    });
+    if (simd_level == wvu::SIMD_SCALAR) {
+      scalar_rgba = rgba;
+    }
+    PrintInterleaveRow(type, num_channels,
+                       std::string(wvu::SimdLevelName(simd_level)) + "->rgba",
+                       rgba_milliseconds, permute_milliseconds,
+                       rgba == scalar_rgba);
+  }
+  wvu::SetMaxSimdLevel(detected_simd_level);
+}
+
+// Runs the interleave benchmark with 8-bit and float versions of the images.
+void RunInterleaveBenchmark(const std::vector<std::string>& image_filepaths) {
+  std::cout << "Planar to interleaved conversion (ms), speedup against "
+            << "permute_axes(\"cxyz\").\n";
+  std::cout << std::left << std::setw(kColumnWidth) << "type"
+            << std::setw(kColumnWidth) << "channels"
+            << std::setw(kColumnWidth) << "kernel"
+            << std::setw(kColumnWidth) << "ms"
+            << std::setw(kColumnWidth) << "speedup"
+            << "result\n";
+  for (const std::string& image_filepath : image_filepaths) {
+    cimg_library::CImg<unsigned char> image;
+    if (!wvu::LoadImageFromFile(image_filepath, &image)) {
+      continue;
+    }
+    std::cout << image_filepath << " (" << image.width() << "x"
+              << image.height() << ")\n";
+    RunInterleaveBenchmark(image, "uint8");
+    RunInterleaveBenchmark(cimg_library::CImg<float>(image), "float");
+  }
+}
+
+// Prints a row of the half-float benchmark. The throughput is measured in
+// input bytes.
+void PrintHalfFloatRow(const std::string& conversion,
+                       const std::string& kernel,
+                       const double milliseconds,
+                       const double reference_milliseconds,
+                       const size_t num_input_bytes,
+                       const bool matches_reference) {
+  std::stringstream speedup;
+  speedup << std::fixed << std::setprecision(2)
+          << reference_milliseconds / milliseconds << "x";
+  const double gigabytes_per_second =
+      num_input_bytes / (1024.0 * 1024.0 * 1024.0) / (milliseconds / 1000.0);
+  std::cout << std::left << std::setw(kColumnWidth) << conversion
+            << std::setw(kColumnWidth) << kernel
+            << std::setw(kColumnWidth) << FormatValue(milliseconds)
+            << std::setw(kColumnWidth) << FormatValue(gigabytes_per_second)
+            << std::setw(kColumnWidth) << speedup.str()
+            << (matches_reference ? "ok" : "MISMATCH") << "\n";
+}
+
+// Compares the scalar conversions between floats and half floats against the
+// F16C kernels, and the packing of R11G11B10F texels against the F16C and
+// AVX2 kernels. The texels of the images are mapped to an HDR range with
+// negative values so that the conversions see normal, subnormal and
+// out-of-range values.
+void RunHalfFloatBenchmark(const std::vector<std::string>& image_filepaths) {
+  std::cout << "Float to half-float conversion (ms and GB/s of input), "
+            << "speedup against the scalar kernels.\n";
+  std::cout << std::left << std::setw(kColumnWidth) << "conversion"
+            << std::setw(kColumnWidth) << "kernel"
+            << std::setw(kColumnWidth) << "ms"
+            << std::setw(kColumnWidth) << "GB/s"
+            << std::setw(kColumnWidth) << "speedup"
+            << "result\n";
+  const wvu::SimdLevel detected_simd_level = wvu::GetSimdLevel();
+  for (const std::string& image_filepath : image_filepaths) {
+    cimg_library::CImg<unsigned char> image;
+    if (!wvu::LoadImageFromFile(image_filepath, &image)) {
+      continue;
+    }
+    std::cout << image_filepath << " (" << image.width() << "x"
+              << image.height() << ")\n";
+    const size_t num_texels =
+        static_cast<size_t>(image.width()) * image.height();
+    std::vector<float> rgba(4 * num_texels);
+    for (size_t i = 0; i < rgba.size(); ++i) {
+      const float value = image.data()[i % image.size()] / 255.0f;
+      rgba[i] = (i % 7 == 0 ? -1.0f : 1.0f) * std::pow(value, 8.0f) *
+          std::pow(2.0f, static_cast<float>(i % 41) - 20.0f);
+    }
+    std::vector<uint16_t> halves(rgba.size());
+    std::vector<float> floats(rgba.size());
+    std::vector<uint32_t> packed(num_texels);
+    std::vector<uint16_t> scalar_halves;
+    std::vector<float> scalar_floats;
+    std::vector<uint32_t> scalar_packed;
+    double scalar_milliseconds[3] = { 0.0, 0.0, 0.0 };
+    // The F16C kernels run only with AVX2 enabled.
+    const wvu::SimdLevel simd_levels[] = { wvu::SIMD_SCALAR,
+                                           detected_simd_level };
+    for (const wvu::SimdLevel simd_level : simd_levels) {
+      wvu::SetMaxSimdLevel(simd_level);
+      const bool f16c = wvu::CpuSupportsF16C();
+      if (simd_level != wvu::SIMD_SCALAR && !f16c) {
+        break;
+      }
+      const std::string kernel = f16c ? "f16c" : "scalar";
+      const double to_half_milliseconds = MeasureMilliseconds([&]() {
+        wvu::FloatsToHalves(rgba.data(), rgba.size(), halves.data());
+      });
+      const double to_float_milliseconds = MeasureMilliseconds([&]() {
+        wvu::HalvesToFloats(halves.data(), halves.size(), floats.data());
+      });
+      const double pack_milliseconds = MeasureMilliseconds([&]() {
+        wvu::RgbaFloatsToR11G11B10F(rgba.data(), num_texels, packed.data());
+      });
+      if (!f16c) {
+        scalar_halves = halves;
+        scalar_floats = floats;
+        scalar_packed = packed;
+        scalar_milliseconds[0] = to_half_milliseconds;
+        scalar_milliseconds[1] = to_float_milliseconds;
+        scalar_milliseconds[2] = pack_milliseconds;
+      }
+      PrintHalfFloatRow("float->half", kernel, to_half_milliseconds,
+                        scalar_milliseconds[0], rgba.size() * sizeof(float),
+                        halves == scalar_halves);
+      PrintHalfFloatRow("half->float", kernel, to_float_milliseconds,
+                        scalar_milliseconds[1],
+                        halves.size() * sizeof(uint16_t),
+                        floats == scalar_floats);
+      PrintHalfFloatRow("float->rg11b10", f16c ? "f16c+avx2" : "scalar",
+                        pack_milliseconds, scalar_milliseconds[2],
+                        rgba.size() * sizeof(float),
+                        packed == scalar_packed);
+    }
+    wvu::SetMaxSimdLevel(detected_simd_level);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  GLUTILS_GFLAGS_NAMESPACE::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  std::vector<std::string> image_filepaths =
+      SplitCommaSeparatedList(FLAGS_image_filepaths);
+  if (!FLAGS_synthetic_image_directory.empty()) {
+    const std::vector<std::string> synthetic_image_filepaths =
+        GenerateSyntheticImages(FLAGS_synthetic_image_directory);
+    image_filepaths.insert(image_filepaths.end(),
+                           synthetic_image_filepaths.begin(),
+                           synthetic_image_filepaths.end());
+  }
+  if (image_filepaths.empty() || FLAGS_num_iterations <= 0) {
+    std::cerr << "ERROR: Provide --image_filepaths or "
+              << "--synthetic_image_directory, and a positive "
+              << "--num_iterations.\n";
+    return -1;
+  }
+  // Keep CImg quiet; failures are reported in the tables.
+  cimg_library::cimg::exception_mode(0);
+  const std::vector<std::string> benchmarks =
+      SplitCommaSeparatedList(FLAGS_benchmarks);
+  for (const std::string& benchmark : benchmarks) {
+    if (benchmark == "decoding") {
+      RunDecodingBenchmark(image_filepaths);
+    } else if (benchmark == "staging") {
+      RunStagingBenchmark(image_filepaths);
+    } else if (benchmark == "interleave") {
+      RunInterleaveBenchmark(image_filepaths);
+    } else if (benchmark == "half") {
+      RunHalfFloatBenchmark(image_filepaths);
+    } else {
+      std::cerr << "ERROR: Unknown benchmark " << benchmark << ".\n";
+      return -1;
+    }
+    std::cout << "\n";
+  }
+  return 0;
+}
@@ -0,0 +1,462 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "texture_cache.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <GL/glew.h>
+
+#include <glog/logging.h>
+
+#include "hash.h"
+#include "mapped_file.h"
+#include "mip_generator.h"
+
+namespace wvu {
+namespace {
+// The layout of the files follows KTX2 (https://registry.khronos.org/KTX):
+//   Header (80 bytes).
+//   Level index: byte offset, byte length and uncompressed byte length of
+//     every level, from level 0 to the smallest level.
+//   Key/value data: the key of the cooked texture.
+//   Levels: from the smallest level to level 0, every level aligned to
+//     kLevelAlignment bytes, or packed when they are supercompressed.
+// The files omit the data format descriptor, which is only needed to read the
+// files with other tools.
+constexpr unsigned char kIdentifier[12] = {
+  0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+};
+constexpr size_t kHeaderSize = 80;
+constexpr size_t kLevelIndexEntrySize = 24;
+constexpr size_t kLevelAlignment = 16;
+// Values of supercompressionScheme. LZ4 has no registered value; the files
+// compressed with it use a private value, so other tools reject them.
+constexpr uint32_t kKtx2SchemeNone = 0;
+constexpr uint32_t kKtx2SchemeZstd = 2;
+constexpr uint32_t kKtx2SchemeLz4 = 0x10000;
+// Key of the key/value entry that holds the key of the cooked texture.
+constexpr char kCookingKeyName[] = "wvuCookingKey";
+
+// A GPU format that can be stored in the cache. The textures are made of
+// blocks of texels; uncompressed formats have 1x1 blocks.
+struct CachedFormat {
+  uint32_t vk_format;
+  GLenum internal_format;
+  GLenum format;
+  GLenum type;
+  int block_width;
+  int block_height;
+  int block_size_in_bytes;
+};
+
+constexpr CachedFormat kCachedFormats[] = {
+  // VK_FORMAT_R8G8B8A8_UNORM.
+  { 37, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 1, 1, 4 },
+  // VK_FORMAT_R8G8B8A8_SRGB.
+  { 43, GL_SRGB8_ALPHA8, GL_RGBA, GL_UNSIGNED_BYTE, 1, 1, 4 },
+  // VK_FORMAT_BC1_RGB_UNORM_BLOCK.
+  { 131, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 0, 0, 4, 4, 8 },
+  // VK_FORMAT_BC3_UNORM_BLOCK.
+  { 137, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 0, 0, 4, 4, 16 },
+  // VK_FORMAT_BC7_UNORM_BLOCK.
+  { 145, GL_COMPRESSED_RGBA_BPTC_UNORM, 0, 0, 4, 4, 16 },
+  // VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK.
+  { 147, GL_COMPRESSED_RGB8_ETC2, 0, 0, 4, 4, 8 },
+  // VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK.
+  { 151, GL_COMPRESSED_RGBA8_ETC2_EAC, 0, 0, 4, 4, 16 },
+  // VK_FORMAT_EAC_R11_UNORM_BLOCK.
+  { 153, GL_COMPRESSED_R11_EAC, 0, 0, 4, 4, 8 },
+  // VK_FORMAT_EAC_R11G11_UNORM_BLOCK.
+  { 155, GL_COMPRESSED_RG11_EAC, 0, 0, 4, 4, 16 },
+};
+
+const CachedFormat* FindFormatByVkFormat(const uint32_t vk_format) {
+  for (const CachedFormat& format : kCachedFormats) {
+    if (format.vk_format == vk_format) {
+      return &format;
+    }
+  }
+  return nullptr;
+}
+
+const CachedFormat* FindFormatByInternalFormat(const GLenum internal_format) {
+  for (const CachedFormat& format : kCachedFormats) {
+    if (format.internal_format == internal_format) {
+      return &format;
+    }
+  }
+  return nullptr;
+}
+
+// Returns the number of bytes of a level in the format.
+size_t LevelSizeInBytes(const CachedFormat& format,
+                        const int width,
+                        const int height) {
+  const size_t num_blocks_x =
+      (width + format.block_width - 1) / format.block_width;
+  const size_t num_blocks_y =
+      (height + format.block_height - 1) / format.block_height;
+  return num_blocks_x * num_blocks_y * format.block_size_in_bytes;
+}
+
+uint32_t ToKtx2Scheme(const Supercompression supercompression) {
+  switch (supercompression) {
+    case SUPERCOMPRESSION_ZSTD:
+      return kKtx2SchemeZstd;
+    case SUPERCOMPRESSION_LZ4:
+      return kKtx2SchemeLz4;
+    default:
+      return kKtx2SchemeNone;
+  }
+}
+
+// Returns false if the scheme is unknown.
+bool FromKtx2Scheme(const uint32_t scheme, Supercompression* supercompression) {
+  switch (scheme) {
+    case kKtx2SchemeNone:
+      *supercompression = SUPERCOMPRESSION_NONE;
+      return true;
+    case kKtx2SchemeZstd:
+      *supercompression = SUPERCOMPRESSION_ZSTD;
+      return true;
+    case kKtx2SchemeLz4:
+      *supercompression = SUPERCOMPRESSION_LZ4;
+      return true;
+    default:
+      return false;
+  }
+}
+
+size_t Align(const size_t offset, const size_t alignment) {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+// The files are little-endian, like the hosts this code runs on.
+template <typename T>
+void Write(const T value, std::vector<unsigned char>* bytes) {
+  const unsigned char* value_bytes =
+      reinterpret_cast<const unsigned char*>(&value);
+  bytes->insert(bytes->end(), value_bytes, value_bytes + sizeof(value));
+}
+
+template <typename T>
+T Read(const unsigned char* bytes) {
+  T value;
+  memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+// Size of the key/value entry that holds the cooking key, without padding.
+constexpr size_t kCookingKeyEntrySize = sizeof(kCookingKeyName) +
+    sizeof(uint64_t);
+
+}  // namespace
+
+TextureCache::TextureCache(const std::string& directory) :
+    TextureCache(directory, Options()) {}
+
+TextureCache::TextureCache(const std::string& directory,
+                           const Options& options) :
+    directory_(directory), options_(options), num_hits_(0), num_misses_(0) {
+  if (mkdir(directory_.c_str(), 0755) != 0 && errno != EEXIST) {
+    LOG(ERROR) << "Could not create the texture cache directory "
+               << directory_;
+  }
+  if (!IsSupercompressionAvailable(options_.supercompression)) {
+    LOG(WARNING) << "The library was built without "
+                 << SupercompressionName(options_.supercompression)
+                 << "; the cooked textures are stored uncompressed.";
+  }
+}
+
+bool TextureCache::ComputeKey(const std::string& source_filepath,
+                              const TextureCookingOptions& options,
+                              uint64_t* key) {
+  uint64_t source_hash;
+  if (!HashFile(source_filepath, &source_hash)) {
+    return false;
+  }
+  const uint64_t options_hash = HashTextureCookingOptions(options);
+  *key = Hash64(&options_hash, sizeof(options_hash), source_hash);
+  return true;
+}
+
+std::string TextureCache::CookedTextureFilepath(const uint64_t key) const {
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.ktx2",
+           static_cast<unsigned long long>(key));
+  return directory_ + "/" + name;
+}
+
+bool TextureCache::Find(const uint64_t key,
+                        StagingBufferPool* staging_buffer_pool,
+                        CookedTexture* cooked) const {
+  const std::string filepath = CookedTextureFilepath(key);
+  MappedFile file;
+  if (!file.Open(filepath)) {
+    return false;
+  }
+  const unsigned char* bytes = file.data();
+  if (file.size() < kHeaderSize ||
+      memcmp(bytes, kIdentifier, sizeof(kIdentifier)) != 0) {
+    LOG(WARNING) << "Ignoring the invalid cooked texture " << filepath;
+    return false;
+  }
+  const CachedFormat* format = FindFormatByVkFormat(Read<uint32_t>(bytes + 12));
+  const int width = Read<uint32_t>(bytes + 20);
+  const int height = Read<uint32_t>(bytes + 24);
+  const uint32_t num_levels = Read<uint32_t>(bytes + 40);
+  Supercompression supercompression = SUPERCOMPRESSION_NONE;
+  const bool known_scheme =
+      FromKtx2Scheme(Read<uint32_t>(bytes + 44), &supercompression);
+  const uint32_t key_value_offset = Read<uint32_t>(bytes + 56);
+  const uint32_t key_value_size = Read<uint32_t>(bytes + 60);
+  if (format == nullptr || width <= 0 || height <= 0 || num_levels == 0 ||
+      num_levels > 32 || !known_scheme ||
+      kHeaderSize + num_levels * kLevelIndexEntrySize > file.size() ||
+      key_value_size < 4 + kCookingKeyEntrySize ||
+      key_value_offset + key_value_size > file.size()) {
+    LOG(WARNING) << "Ignoring the invalid cooked texture " << filepath;
+    return false;
+  }
+  // The key protects against truncated names and collisions of file names.
+  const unsigned char* key_value = bytes + key_value_offset;
+  if (Read<uint32_t>(key_value) != kCookingKeyEntrySize ||
+      memcmp(key_value + 4, kCookingKeyName, sizeof(kCookingKeyName)) != 0 ||
+      Read<uint64_t>(key_value + 4 + sizeof(kCookingKeyName)) != key) {
+    LOG(WARNING) << "Ignoring the cooked texture " << filepath
+                 << " with a different key.";
+    return false;
+  }
+  if (!IsSupercompressionAvailable(supercompression)) {
+    LOG(WARNING) << "Ignoring the cooked texture " << filepath
+                 << " compressed with "
+                 << SupercompressionName(supercompression)
+                 << ", which the library was built without.";
+    return false;
+  }
+  std::vector<CookedTexture::Level> levels(num_levels);
+  // The payloads of the supercompressed levels, which are decompressed into
+  // consecutive levels of a staging buffer.
+  std::vector<SupercompressedBuffer> payloads(num_levels);
+  size_t num_bytes = 0;
+  for (uint32_t i = 0; i < num_levels; ++i) {
+    const unsigned char* entry =
+        bytes + kHeaderSize + i * kLevelIndexEntrySize;
+    CookedTexture::Level& level = levels[i];
+    level.width = MipLevelSize(width, i);
+    level.height = MipLevelSize(height, i);
+    level.offset = Read<uint64_t>(entry);
+    level.size_in_bytes = Read<uint64_t>(entry + 16);
+    const uint64_t payload_size = Read<uint64_t>(entry + 8);
+    if (level.size_in_bytes !=
+        LevelSizeInBytes(*format, level.width, level.height) ||
+        (supercompression == SUPERCOMPRESSION_NONE &&
+         payload_size != level.size_in_bytes) ||
+        level.offset > file.size() ||
+        payload_size > file.size() - level.offset) {
+      LOG(WARNING) << "Ignoring the truncated cooked texture " << filepath;
+      return false;
+    }
+    payloads[i].compressed = bytes + level.offset;
+    payloads[i].compressed_size = payload_size;
+    payloads[i].num_bytes = level.size_in_bytes;
+    level.offset = num_bytes;
+    num_bytes += level.size_in_bytes;
+  }
+  if (supercompression == SUPERCOMPRESSION_NONE) {
+    for (uint32_t i = 0; i < num_levels; ++i) {
+      levels[i].offset = payloads[i].compressed - bytes;
+    }
+    cooked->Assign(format->internal_format, format->format, format->type,
+                   levels, std::move(file));
+    return true;
+  }
+  StagingBuffer buffer = staging_buffer_pool->Acquire(num_bytes);
+  for (uint32_t i = 0; i < num_levels; ++i) {
+    payloads[i].data = buffer.data() + levels[i].offset;
+  }
+  if (!DecompressSupercompressed(supercompression, payloads,
+                                 options_.num_threads)) {
+    LOG(WARNING) << "Ignoring the corrupt cooked texture " << filepath;
+    staging_buffer_pool->Release(std::move(buffer));
+    return false;
+  }
+  cooked->Assign(format->internal_format, format->format, format->type,
+                 levels, std::move(buffer));
+  return true;
+}
+
+bool TextureCache::Store(const uint64_t key,
+                         const CookedTexture& cooked) const {
+  const CachedFormat* format =
+      FindFormatByInternalFormat(cooked.internal_format());
+  if (format == nullptr) {
+    LOG(ERROR) << "The format " << cooked.internal_format()
+               << " cannot be cached.";
+    return false;
+  }
+  const int num_levels = cooked.num_levels();
+  // The payloads of the levels.
+  const Supercompression supercompression =
+      IsSupercompressionAvailable(options_.supercompression) ?
+      options_.supercompression : SUPERCOMPRESSION_NONE;
+  std::vector<const unsigned char*> payloads(num_levels);
+  std::vector<size_t> payload_sizes(num_levels);
+  std::vector<std::vector<unsigned char>> compressed_levels(num_levels);
+  for (int i = 0; i < num_levels; ++i) {
+    payloads[i] = cooked.level_data(i);
+    payload_sizes[i] = cooked.level(i).size_in_bytes;
+    if (supercompression == SUPERCOMPRESSION_NONE) {
+      continue;
+    }
+    if (!Supercompress(supercompression, payloads[i], payload_sizes[i],
+                       options_.compression_level, options_.num_threads,
+                       &compressed_levels[i])) {
+      LOG(ERROR) << "Could not compress the cooked texture " << key;
+      return false;
+    }
+    payloads[i] = compressed_levels[i].data();
+    payload_sizes[i] = compressed_levels[i].size();
+  }
+  // Lay out the file. KTX2 packs the supercompressed levels.
+  const size_t level_alignment =
+      supercompression == SUPERCOMPRESSION_NONE ? kLevelAlignment : 1;
+  const size_t key_value_offset =
+      kHeaderSize + num_levels * kLevelIndexEntrySize;
+  const size_t key_value_size = Align(4 + kCookingKeyEntrySize, 4);
+  std::vector<size_t> level_offsets(num_levels);
+  size_t offset = Align(key_value_offset + key_value_size, level_alignment);
+  for (int i = num_levels - 1; i >= 0; --i) {
+    level_offsets[i] = offset;
+    offset = Align(offset + payload_sizes[i], level_alignment);
+  }
+  // Header, level index and key/value data.
+  std::vector<unsigned char> header(kIdentifier,
+                                    kIdentifier + sizeof(kIdentifier));
+  Write<uint32_t>(format->vk_format, &header);
+  Write<uint32_t>(format->block_width == 1 ? format->block_size_in_bytes : 1,
+                  &header);  // typeSize.
+  Write<uint32_t>(cooked.width(), &header);
+  Write<uint32_t>(cooked.height(), &header);
+  Write<uint32_t>(0, &header);  // pixelDepth.
+  Write<uint32_t>(0, &header);  // layerCount.
+  Write<uint32_t>(1, &header);  // faceCount.
+  Write<uint32_t>(num_levels, &header);
+  Write<uint32_t>(ToKtx2Scheme(supercompression), &header);
+  Write<uint32_t>(0, &header);  // dfdByteOffset.
+  Write<uint32_t>(0, &header);  // dfdByteLength.
+  Write<uint32_t>(key_value_offset, &header);
+  Write<uint32_t>(key_value_size, &header);
+  Write<uint64_t>(0, &header);  // sgdByteOffset.
+  Write<uint64_t>(0, &header);  // sgdByteLength.
+  for (int i = 0; i < num_levels; ++i) {
+    Write<uint64_t>(level_offsets[i], &header);
+    Write<uint64_t>(payload_sizes[i], &header);
+    Write<uint64_t>(cooked.level(i).size_in_bytes, &header);
+  }
+  Write<uint32_t>(kCookingKeyEntrySize, &header);
+  header.insert(header.end(), kCookingKeyName,
+                kCookingKeyName + sizeof(kCookingKeyName));
+  Write<uint64_t>(key, &header);
+  header.resize(key_value_offset + key_value_size, 0);
+
+  // Write under a name unique to this process and thread, since several
+  // processes may share the directory, and rename it, which is atomic.
+  const std::string filepath = CookedTextureFilepath(key);
+  std::ostringstream temporary_filepath;
+  temporary_filepath << filepath << ".tmp" << getpid() << "."
+                     << std::hash<std::thread::id>()(
+                         std::this_thread::get_id());
+  {
+    std::ofstream file(temporary_filepath.str(),
+                       std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(header.data()), header.size());
+    const char kPadding[kLevelAlignment] = {0};
+    size_t position = header.size();
+    for (int i = num_levels - 1; i >= 0; --i) {
+      file.write(kPadding, level_offsets[i] - position);
+      file.write(reinterpret_cast<const char*>(payloads[i]), payload_sizes[i]);
+      position = level_offsets[i] + payload_sizes[i];
+    }
+    if (!file) {
+      LOG(ERROR) << "Could not write the cooked texture " << filepath;
+      file.close();
+      remove(temporary_filepath.str().c_str());
+      return false;
+    }
+  }
+  if (rename(temporary_filepath.str().c_str(), filepath.c_str()) != 0) {
+    LOG(ERROR) << "Could not rename the cooked texture " << filepath;
+    remove(temporary_filepath.str().c_str());
+    return false;
+  }
+  return true;
+}
+
+bool TextureCache::FindOrCook(const std::string& source_filepath,
+                              const TextureCookingOptions& options,
+                              StagingBufferPool* staging_buffer_pool,
+                              CookedTexture* cooked) {
+  uint64_t key;
+  if (!ComputeKey(source_filepath, options, &key)) {
+    LOG(ERROR) << "Could not read " << source_filepath;
+    return false;
+  }
+  if (Find(key, staging_buffer_pool, cooked)) {
+    ++num_hits_;
+    return true;
+  }
+  ++num_misses_;
+  if (!CookTexture(source_filepath, options, staging_buffer_pool, cooked)) {
+    return false;
+  }
+  // A failure to store only costs cooking the texture again next time.
+  Store(key, *cooked);
+  return true;
+}
+
+}  // namespace wvu
@@ -0,0 +1,147 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_TEXTURE_CACHE_H_
+#define GLUTILS_TEXTURE_CACHE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "staging_buffer_pool.h"
+#include "supercompression.h"
+#include "texture_cooker.h"
+
+namespace wvu {
+// This class keeps cooked textures on disk so that the images are decoded and
+// their mip chains computed only once. Every cooked texture is stored in a
+// KTX2 container named after its key: the hash of the bytes of the source
+// image combined with the hash of the cooking options. When the source image
+// or the options change, the key changes and the texture is cooked again; the
+// stale entries are never read.
+// Cached textures are memory-mapped, so a warm load is a mapping of the file
+// followed by the upload of its levels. The levels can also be supercompressed
+// with Zstandard or LZ4 (see supercompression.h); those files are smaller and
+// faster to read from slow storage, and their levels are decompressed in
+// parallel into a staging buffer instead of mapped. The class is thread-safe.
+//
+// Example:
+//
+// wvu::TextureCache texture_cache("/tmp/texture_cache");
+// wvu::CookedTexture cooked;
+// if (texture_cache.FindOrCook("texture.png", options, &staging_buffer_pool,
+//                              &cooked)) {
+//   for (int level = 0; level < cooked.num_levels(); ++level) {
+//     ...  // glTexImage2D(..., cooked.level_data(level));
+//   }
+// }
+class TextureCache {
+ public:
+  // Configuration of the cache.
+  struct Options {
+    // How the levels of the stored textures are compressed. The textures are
+    // read with any compression the library was built with.
+    Supercompression supercompression = SUPERCOMPRESSION_NONE;
+    // The level of the compressor; 0 uses its default level.
+    int compression_level = 0;
+    // Number of threads that compress and decompress the chunks of the
+    // levels, including the calling thread; 0 uses one thread per core.
+    // The cache is mostly called from the threads of the loaders, which
+    // already decode several textures at once, so by default the chunks are
+    // decompressed on the calling thread instead of on new threads.
+    int num_threads = 1;
+  };
+
+  // Constructor. Creates the directory if it does not exist.
+  // Parameters:
+  //   directory  The directory where the cooked textures are stored.
+  explicit TextureCache(const std::string& directory);
+  TextureCache(const std::string& directory, const Options& options);
+  ~TextureCache() {}
+
+  // Computes the key of the texture cooked from the source image with the
+  // options. Returns true if successful, and false otherwise.
+  static bool ComputeKey(const std::string& source_filepath,
+                         const TextureCookingOptions& options,
+                         uint64_t* key);
+
+  // Maps the cooked texture with the key, or decompresses it if its levels are
+  // supercompressed. Returns true if it is in the cache and valid, and false
+  // otherwise.
+  // Parameters:
+  //   key  The key of the cooked texture.
+  //   staging_buffer_pool  The pool that provides the memory of the
+  //     decompressed levels.
+  //   cooked  The cooked texture.
+  bool Find(const uint64_t key,
+            StagingBufferPool* staging_buffer_pool,
+            CookedTexture* cooked) const;
+
+  // Stores the cooked texture with the key, supercompressed as the options
+  // say. The file is written under a temporary name and renamed, so readers
+  // never see partial files. Returns true if successful, and false otherwise.
+  bool Store(const uint64_t key, const CookedTexture& cooked) const;
+
+  // Returns the cooked texture from the cache, or cooks it and stores it in
+  // the cache if it is not there. Returns true if successful, and false
+  // otherwise.
+  // Parameters:
+  //   source_filepath  The filepath of the image.
+  //   options  The cooking options.
+  //   staging_buffer_pool  The pool that provides the memory of the levels
+  //     when the texture is cooked.
+  //   cooked  The cooked texture.
+  bool FindOrCook(const std::string& source_filepath,
+                  const TextureCookingOptions& options,
+                  StagingBufferPool* staging_buffer_pool,
+                  CookedTexture* cooked);
+
+  // Returns the filepath of the cooked texture with the key.
+  std::string CookedTextureFilepath(const uint64_t key) const;
+
+  // Statistics of FindOrCook().
+  size_t num_hits() const { return num_hits_; }
+  size_t num_misses() const { return num_misses_; }
+
+ private:
+  const std::string directory_;
+  const Options options_;
+  std::atomic<size_t> num_hits_;
+  std::atomic<size_t> num_misses_;
+};
+
+}  // namespace wvu
+
+#endif  // GLUTILS_TEXTURE_CACHE_H_
@@ -0,0 +1,784 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+// Benchmark of the quality and the cost of the texture formats. Every image of
+// the corpus goes through each path (a GPU format, or RGBA8 at half the
+// resolution) and the benchmark reports the time to encode the mip chain, the
+// time to upload it, the bytes that it occupies in VRAM, and the PSNR and SSIM
+// of level 0 decoded back against the source. The results are printed as a
+// table and, optionally, written as JSON to set the format of every class of
+// assets.
+//
+// Example:
+//   ./bin/texture_codec_benchmark --image_filepaths=albedo.png,normal.png
+//     --json_output_filepath=codecs.json
+//
+// With --supercompression, the levels are also compressed as in the texture
+// cache, and the benchmark reports their size on disk and the time to
+// decompress them; --rdo_lambda trades the quality of BC1 and BC3 for smaller
+// compressed levels.
+//
+// The bc6h path converts the images into floats and cooks them as HDR textures
+// (see CookBc6hTexture()), so its PSNR measures the float path on the same
+// corpus; its decoded floats are clamped to [0, 1] before the comparison.
+//
+// The PSNR and SSIM compare the channels that the format stores: BC1, BC6H and
+// ETC2 RGB drop the alpha. The PSNR of lossless paths is infinite in the table
+// and null in the JSON. The uploads of the formats that the GPU does not
+// support are skipped, but their encode time and quality are still reported.
+
+// Use the right namespace for google flags (gflags).
+#ifdef GFLAGS_NAMESPACE_GOOGLE
+#define GLUTILS_GFLAGS_NAMESPACE google
+#else
+#define GLUTILS_GFLAGS_NAMESPACE gflags
+#endif
+
+// Include second C++-Headers.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Include library headers.
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+// Include system headers.
+#include "bc_encoder.h"
+#include "bptc_encoder.h"
+#include "cpu_features.h"
+#include "etc_encoder.h"
+#include "half_float.h"
+#include "hdr_texture.h"
+#include "image_metrics.h"
+#include "image_reader.h"
+#include "staging_buffer_pool.h"
+#include "supercompression.h"
+#include "texture_cooker.h"
+
+DEFINE_string(image_filepaths, "",
+              "Comma-separated list of the images to use in the benchmark.");
+DEFINE_string(paths,
+              "rgba8,bc1,bc3,bc7,etc2_rgb,etc2_rgba,half,bc6h,downscaled",
+              "Comma-separated list of the paths to run. Options: rgba8, "
+              "bc1, bc3, bc7, etc2_rgb, etc2_rgba, half, bc6h, downscaled.");
+DEFINE_string(compression_quality, "normal",
+              "Quality of the block compression: fast, normal or high.");
+DEFINE_string(supercompression, "none",
+              "Compression of the levels on disk: none, zstd or lz4.");
+DEFINE_double(rdo_lambda, 0.0,
+              "If positive, the bc1 and bc3 blocks are rate-distortion "
+              "optimized with this lambda.");
+DEFINE_int32(num_iterations, 3,
+             "Number of times each encode and upload is repeated.");
+DEFINE_string(json_output_filepath, "",
+              "If not empty, the results are also written to this file as "
+              "JSON.");
+
+// Annonymous namespace for constants and helper functions.
+namespace {
+// Width of the columns of the reported table.
+constexpr int kColumnWidth = 12;
+
+// Size in bytes of the staging buffers kept by the pool between iterations.
+constexpr size_t kMaxPooledBytes = 512 << 20;
+
+// A path through which the images are encoded.
+struct CodecPath {
+  const char* name;
+  wvu::TextureCompression compression;
+  // If true, the RGBA8 levels are converted into half floats.
+  bool half_float;
+  // If true, the image is converted into floats and cooked into BC6H.
+  bool bc6h;
+  // If true, level 0 is dropped and the texture starts at level 1.
+  bool downscaled;
+};
+
+const CodecPath kCodecPaths[] = {
+  { "rgba8", wvu::TEXTURE_COMPRESSION_NONE, false, false, false },
+  { "bc1", wvu::TEXTURE_COMPRESSION_BC1, false, false, false },
+  { "bc3", wvu::TEXTURE_COMPRESSION_BC3, false, false, false },
+  { "bc7", wvu::TEXTURE_COMPRESSION_BC7, false, false, false },
+  { "etc2_rgb", wvu::TEXTURE_COMPRESSION_ETC2_RGB8, false, false, false },
+  { "etc2_rgba", wvu::TEXTURE_COMPRESSION_ETC2_RGBA8, false, false, false },
+  { "half", wvu::TEXTURE_COMPRESSION_NONE, true, false, false },
+  { "bc6h", wvu::TEXTURE_COMPRESSION_NONE, false, true, false },
+  { "downscaled", wvu::TEXTURE_COMPRESSION_NONE, false, false, true }
+};
+
+// The measurements of an image through a path. Negative times are not
+// available.
+struct CodecResult {
+  std::string image_filepath;
+  std::string path;
+  int width = 0;
+  int height = 0;
+  double encode_milliseconds = -1.0;
+  double upload_milliseconds = -1.0;
+  size_t vram_bytes = 0;
+  size_t disk_bytes = 0;
+  double decompress_milliseconds = -1.0;
+  double psnr = 0.0;
+  double ssim = 0.0;
+};
+
+// A mip level ready to be uploaded.
+struct UploadLevel {
+  int width;
+  int height;
+  size_t size_in_bytes;
+  const void* data;
+};
+
+// The levels of a texture and the formats to upload them. The format and type
+// of compressed textures are zero.
+struct UploadTexture {
+  GLenum internal_format = 0;
+  GLenum format = 0;
+  GLenum type = 0;
+  std::vector<UploadLevel> levels;
+};
+
+// Splits a comma-separated list into its elements.
+std::vector<std::string> SplitCommaSeparatedList(const std::string& list) {
+  std::vector<std::string> elements;
+  std::stringstream stream(list);
+  std::string element;
+  while (std::getline(stream, element, ',')) {
+    if (!element.empty()) {
+      elements.push_back(element);
+    }
+  }
+  return elements;
+}
+
+// Returns the time in milliseconds elapsed since start.
+double ElapsedMilliseconds(
+    const std::chrono::steady_clock::time_point& start) {
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// Prints a measurement with the precision or n/a when it is not available
+// (negative).
+std::string FormatValue(const double value, const int precision) {
+  if (value < 0.0) {
+    return "n/a";
+  }
+  std::stringstream stream;
+  stream << std::fixed << std::setprecision(precision) << value;
+  return stream.str();
+}
+
+// Parses the quality of the block compression.
+bool ParseCompressionQuality(const std::string& name,
+                             wvu::BcQuality* quality) {
+  if (name == "fast") {
+    *quality = wvu::BC_QUALITY_FAST;
+  } else if (name == "normal") {
+    *quality = wvu::BC_QUALITY_NORMAL;
+  } else if (name == "high") {
+    *quality = wvu::BC_QUALITY_HIGH;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Parses the supercompression.
+bool ParseSupercompression(const std::string& name,
+                           wvu::Supercompression* supercompression) {
+  if (name == "none") {
+    *supercompression = wvu::SUPERCOMPRESSION_NONE;
+  } else if (name == "zstd") {
+    *supercompression = wvu::SUPERCOMPRESSION_ZSTD;
+  } else if (name == "lz4") {
+    *supercompression = wvu::SUPERCOMPRESSION_LZ4;
+  } else {
+    return false;
+  }
+  return wvu::IsSupercompressionAvailable(*supercompression);
+}
+
+// Returns true if the GPU can sample textures in the internal format.
+bool GpuSupportsInternalFormat(const GLenum internal_format) {
+  switch (internal_format) {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+      return GLEW_EXT_texture_compression_s3tc;
+    case GL_COMPRESSED_RGBA_BPTC_UNORM:
+    case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT:
+      return GLEW_ARB_texture_compression_bptc;
+    case GL_COMPRESSED_RGB8_ETC2:
+    case GL_COMPRESSED_RGBA8_ETC2_EAC:
+      // ETC2 is core in OpenGL 4.3.
+      return GLEW_VERSION_4_3 || GLEW_ARB_ES3_compatibility;
+    default:
+      return true;
+  }
+}
+
+// Returns the number of channels that the internal format stores.
+int NumStoredChannels(const GLenum internal_format) {
+  switch (internal_format) {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT:
+    case GL_COMPRESSED_RGB8_ETC2:
+      return 3;
+    default:
+      return 4;
+  }
+}
+
+// Decodes level 0 of the cooked texture into RGBA8. Returns false if the
+// format has no decoder.
+bool DecodeLevel0(const wvu::CookedTexture& cooked, unsigned char* rgba) {
+  const int width = cooked.level(0).width;
+  const int height = cooked.level(0).height;
+  const unsigned char* data = cooked.level_data(0);
+  switch (cooked.internal_format()) {
+    case GL_RGBA8:
+      std::memcpy(rgba, data, cooked.level(0).size_in_bytes);
+      return true;
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+      wvu::DecodeBc(data, width, height, wvu::BC1_FORMAT, rgba);
+      return true;
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+      wvu::DecodeBc(data, width, height, wvu::BC3_FORMAT, rgba);
+      return true;
+    case GL_COMPRESSED_RGBA_BPTC_UNORM:
+      wvu::DecodeBc7(data, width, height, rgba);
+      return true;
+    case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT: {
+      std::vector<float> values(4 * static_cast<size_t>(width) * height);
+      wvu::DecodeBc6h(data, width, height, values.data());
+      for (size_t i = 0; i < values.size(); ++i) {
+        rgba[i] = static_cast<unsigned char>(
+            std::min(std::max(values[i], 0.0f), 1.0f) * 255.0f + 0.5f);
+      }
+      return true;
+    }
+    case GL_COMPRESSED_RGB8_ETC2:
+      wvu::DecodeEtc(data, width, height, wvu::ETC2_RGB8_FORMAT, rgba);
+      return true;
+    case GL_COMPRESSED_RGBA8_ETC2_EAC:
+      wvu::DecodeEtc(data, width, height, wvu::ETC2_RGBA8_FORMAT, rgba);
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Upsamples an RGBA8 image bilinearly, so that a downscaled texture can be
+// compared against its source as the GPU would magnify it.
+void UpsampleBilinear(const unsigned char* source,
+                      const int source_width,
+                      const int source_height,
+                      const int width,
+                      const int height,
+                      unsigned char* rgba) {
+  const float scale_x = static_cast<float>(source_width) / width;
+  const float scale_y = static_cast<float>(source_height) / height;
+  for (int y = 0; y < height; ++y) {
+    const float source_y =
+        std::max((y + 0.5f) * scale_y - 0.5f, 0.0f);
+    const int y0 = std::min(static_cast<int>(source_y), source_height - 1);
+    const int y1 = std::min(y0 + 1, source_height - 1);
+    const float weight_y = source_y - y0;
+    for (int x = 0; x < width; ++x) {
+      const float source_x =
+          std::max((x + 0.5f) * scale_x - 0.5f, 0.0f);
+      const int x0 = std::min(static_cast<int>(source_x), source_width - 1);
+      const int x1 = std::min(x0 + 1, source_width - 1);
+      const float weight_x = source_x - x0;
+      for (int c = 0; c < 4; ++c) {
+        const float top =
+            source[4 * (y0 * source_width + x0) + c] * (1.0f - weight_x) +
+            source[4 * (y0 * source_width + x1) + c] * weight_x;
+        const float bottom =
+            source[4 * (y1 * source_width + x0) + c] * (1.0f - weight_x) +
+            source[4 * (y1 * source_width + x1) + c] * weight_x;
+        rgba[4 * (y * width + x) + c] = static_cast<unsigned char>(
+            top * (1.0f - weight_y) + bottom * weight_y + 0.5f);
+      }
+    }
+  }
+}
+
+// Cooks the RGBA8 image with the compression and returns the time it took in
+// milliseconds. The time includes the generation of the mip chain.
+double CookImage(const std::vector<unsigned char>& rgba,
+                 const int width,
+                 const int height,
+                 const wvu::TextureCookingOptions& options,
+                 wvu::StagingBufferPool* staging_buffer_pool,
+                 wvu::CookedTexture* cooked) {
+  wvu::StagingBuffer buffer = staging_buffer_pool->Acquire(
+      wvu::Rgba8MipChainSizeInBytes(width, height, options));
+  std::memcpy(buffer.data(), rgba.data(), rgba.size());
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  wvu::CookDecodedTexture("", width, height, options, std::move(buffer),
+                          staging_buffer_pool, cooked);
+  return ElapsedMilliseconds(start);
+}
+
+// Converts the RGBA8 image into floats and cooks it into BC6H. Returns the time
+// it took in milliseconds, including the conversion and the mip chain.
+double CookBc6hImage(const std::vector<unsigned char>& rgba,
+                     const int width,
+                     const int height,
+                     const wvu::BcQuality quality,
+                     wvu::CookedTexture* cooked) {
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  std::vector<float> values(rgba.size());
+  for (size_t i = 0; i < rgba.size(); ++i) {
+    values[i] = rgba[i] / 255.0f;
+  }
+  wvu::BptcEncodingOptions options;
+  options.quality = quality;
+  wvu::CookBc6hTexture(values.data(), width, height, options, cooked);
+  return ElapsedMilliseconds(start);
+}
+
+// Converts the RGBA8 levels of the cooked texture into half floats.
+void ConvertLevelsToHalves(const wvu::CookedTexture& cooked,
+                           std::vector<uint16_t>* halves) {
+  size_t num_values = 0;
+  for (int i = 0; i < cooked.num_levels(); ++i) {
+    num_values += cooked.level(i).size_in_bytes;
+  }
+  halves->resize(num_values);
+  std::vector<float> values;
+  uint16_t* level_halves = halves->data();
+  for (int i = 0; i < cooked.num_levels(); ++i) {
+    const size_t level_num_values = cooked.level(i).size_in_bytes;
+    const unsigned char* texels = cooked.level_data(i);
+    values.resize(level_num_values);
+    for (size_t j = 0; j < level_num_values; ++j) {
+      values[j] = texels[j] / 255.0f;
+    }
+    wvu::FloatsToHalves(values.data(), level_num_values, level_halves);
+    level_halves += level_num_values;
+  }
+}
+
+// Measures the average time in milliseconds to create the texture and upload
+// its levels. glFinish() waits for the driver to consume the texels. Returns
+// -1 if the GPU does not support the format or the upload fails.
+double MeasureUpload(const UploadTexture& texture) {
+  if (!GpuSupportsInternalFormat(texture.internal_format)) {
+    return -1.0;
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  double total_milliseconds = 0.0;
+  for (int i = 0; i < FLAGS_num_iterations; ++i) {
+    const std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    GLuint texture_id;
+    glGenTextures(1, &texture_id);
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+                    static_cast<GLint>(texture.levels.size()) - 1);
+    for (size_t level = 0; level < texture.levels.size(); ++level) {
+      const UploadLevel& upload_level = texture.levels[level];
+      if (texture.format == 0) {
+        glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level),
+                               texture.internal_format, upload_level.width,
+                               upload_level.height, 0,
+                               static_cast<GLsizei>(upload_level.size_in_bytes),
+                               upload_level.data);
+      } else {
+        glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level),
+                     texture.internal_format, upload_level.width,
+                     upload_level.height, 0, texture.format, texture.type,
+                     upload_level.data);
+      }
+    }
+    glFinish();
+    total_milliseconds += ElapsedMilliseconds(start);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDeleteTextures(1, &texture_id);
+  }
+  const GLenum error = glGetError();
+  if (error != GL_NO_ERROR) {
+    LOG(ERROR) << "OpenGL error 0x" << std::hex << error << std::dec
+               << " uploading internal format 0x" << std::hex
+               << texture.internal_format << std::dec;
+    return -1.0;
+  }
+  return total_milliseconds / FLAGS_num_iterations;
+}
+
+// Compresses the levels of the texture, and measures the size of the payloads
+// and the average time in milliseconds to decompress them.
+void MeasureSupercompression(const wvu::Supercompression supercompression,
+                             const UploadTexture& texture,
+                             CodecResult* result) {
+  std::vector<std::vector<unsigned char>> payloads(texture.levels.size());
+  std::vector<wvu::SupercompressedBuffer> buffers(texture.levels.size());
+  size_t num_bytes = 0;
+  result->disk_bytes = 0;
+  for (size_t i = 0; i < texture.levels.size(); ++i) {
+    const UploadLevel& level = texture.levels[i];
+    wvu::Supercompress(supercompression,
+                       static_cast<const unsigned char*>(level.data),
+                       level.size_in_bytes, 0, 0, &payloads[i]);
+    result->disk_bytes += payloads[i].size();
+    buffers[i].compressed = payloads[i].data();
+    buffers[i].compressed_size = payloads[i].size();
+    buffers[i].num_bytes = level.size_in_bytes;
+    num_bytes += level.size_in_bytes;
+  }
+  std::vector<unsigned char> levels(num_bytes);
+  size_t offset = 0;
+  for (wvu::SupercompressedBuffer& buffer : buffers) {
+    buffer.data = levels.data() + offset;
+    offset += buffer.num_bytes;
+  }
+  double total_milliseconds = 0.0;
+  for (int i = 0; i < FLAGS_num_iterations; ++i) {
+    const std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    if (!wvu::DecompressSupercompressed(supercompression, buffers, 0)) {
+      LOG(ERROR) << "Could not decompress the levels.";
+      return;
+    }
+    total_milliseconds += ElapsedMilliseconds(start);
+  }
+  result->decompress_milliseconds = total_milliseconds / FLAGS_num_iterations;
+}
+
+// Runs the image through the path and measures it.
+CodecResult RunCodecPath(const std::string& image_filepath,
+                         const std::vector<unsigned char>& rgba,
+                         const int width,
+                         const int height,
+                         const CodecPath& path,
+                         const wvu::BcQuality quality,
+                         const wvu::Supercompression supercompression,
+                         wvu::StagingBufferPool* staging_buffer_pool) {
+  CodecResult result;
+  result.image_filepath = image_filepath;
+  result.path = path.name;
+  result.width = width;
+  result.height = height;
+
+  wvu::TextureCookingOptions options;
+  options.compression = path.compression;
+  options.compression_quality = quality;
+  options.compression_rdo_lambda = static_cast<float>(FLAGS_rdo_lambda);
+  wvu::CookedTexture cooked;
+  std::vector<uint16_t> halves;
+  double total_milliseconds = 0.0;
+  for (int i = 0; i < FLAGS_num_iterations; ++i) {
+    staging_buffer_pool->Release(cooked.Release());
+    if (path.bc6h) {
+      total_milliseconds +=
+          CookBc6hImage(rgba, width, height, quality, &cooked);
+      continue;
+    }
+    total_milliseconds += CookImage(rgba, width, height, options,
+                                    staging_buffer_pool, &cooked);
+    if (path.half_float) {
+      const std::chrono::steady_clock::time_point start =
+          std::chrono::steady_clock::now();
+      ConvertLevelsToHalves(cooked, &halves);
+      total_milliseconds += ElapsedMilliseconds(start);
+    }
+  }
+  result.encode_milliseconds = total_milliseconds / FLAGS_num_iterations;
+
+  // The levels to upload.
+  UploadTexture texture;
+  texture.internal_format = cooked.internal_format();
+  texture.format = cooked.format();
+  texture.type = cooked.type();
+  const int first_level = path.downscaled && cooked.num_levels() > 1 ? 1 : 0;
+  const uint16_t* level_halves = halves.data();
+  for (int i = 0; i < cooked.num_levels(); ++i) {
+    const wvu::CookedTexture::Level& level = cooked.level(i);
+    UploadLevel upload_level = { level.width, level.height,
+                                 level.size_in_bytes, cooked.level_data(i) };
+    if (path.half_float) {
+      upload_level.size_in_bytes = level.size_in_bytes * sizeof(uint16_t);
+      upload_level.data = level_halves;
+      level_halves += level.size_in_bytes;
+    }
+    if (i >= first_level) {
+      texture.levels.push_back(upload_level);
+      result.vram_bytes += upload_level.size_in_bytes;
+    }
+  }
+  if (path.half_float) {
+    texture.internal_format = GL_RGBA16F;
+    texture.type = GL_HALF_FLOAT;
+  }
+  result.upload_milliseconds = MeasureUpload(texture);
+  result.disk_bytes = result.vram_bytes;
+  if (supercompression != wvu::SUPERCOMPRESSION_NONE) {
+    MeasureSupercompression(supercompression, texture, &result);
+  }
+
+  // Level 0 as the GPU would sample it.
+  const size_t num_texels = static_cast<size_t>(width) * height;
+  std::vector<unsigned char> decoded(4 * num_texels);
+  if (path.half_float) {
+    std::vector<float> values(4 * num_texels);
+    wvu::HalvesToFloats(halves.data(), values.size(), values.data());
+    for (size_t i = 0; i < values.size(); ++i) {
+      decoded[i] = static_cast<unsigned char>(
+          std::min(std::max(values[i], 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+  } else if (first_level > 0) {
+    UpsampleBilinear(cooked.level_data(1), cooked.level(1).width,
+                     cooked.level(1).height, width, height, decoded.data());
+  } else if (!DecodeLevel0(cooked, decoded.data())) {
+    LOG(ERROR) << "No decoder for the internal format 0x" << std::hex
+               << cooked.internal_format();
+  }
+  const int num_channels = NumStoredChannels(cooked.internal_format());
+  result.psnr =
+      wvu::ComputePsnr(rgba.data(), decoded.data(), num_texels, num_channels);
+  result.ssim = wvu::ComputeSsim(rgba.data(), decoded.data(), width, height,
+                                 num_channels);
+  staging_buffer_pool->Release(cooked.Release());
+  return result;
+}
+
+// Escapes the string for JSON.
+std::string EscapeJsonString(const std::string& value) {
+  std::string escaped;
+  for (const char character : value) {
+    if (character == '"' || character == '\\') {
+      escaped += '\\';
+      escaped += character;
+    } else if (static_cast<unsigned char>(character) < 0x20) {
+      std::stringstream stream;
+      stream << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+             << static_cast<int>(character);
+      escaped += stream.str();
+    } else {
+      escaped += character;
+    }
+  }
+  return escaped;
+}
+
+// Returns the measurement as a JSON number, or null if it is not available.
+std::string JsonNumber(const double value) {
+  if (value < 0.0 || !std::isfinite(value)) {
+    return "null";
+  }
+  std::stringstream stream;
+  stream << std::setprecision(8) << value;
+  return stream.str();
+}
+
+// Writes the results as JSON. Returns false if the file cannot be written.
+bool WriteJson(const std::string& filepath,
+               const std::vector<CodecResult>& results) {
+  std::ofstream file(filepath);
+  if (!file) {
+    return false;
+  }
+  file << "{\n"
+       << "  \"simd\": \"" << wvu::SimdLevelName(wvu::GetSimdLevel())
+       << "\",\n"
+       << "  \"compression_quality\": \""
+       << EscapeJsonString(FLAGS_compression_quality) << "\",\n"
+       << "  \"supercompression\": \"" << FLAGS_supercompression << "\",\n"
+       << "  \"rdo_lambda\": " << FLAGS_rdo_lambda << ",\n"
+       << "  \"num_iterations\": " << FLAGS_num_iterations << ",\n"
+       << "  \"results\": [";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const CodecResult& result = results[i];
+    file << (i == 0 ? "\n" : ",\n")
+         << "    {\"image\": \"" << EscapeJsonString(result.image_filepath)
+         << "\", \"path\": \"" << result.path
+         << "\", \"width\": " << result.width
+         << ", \"height\": " << result.height
+         << ", \"encode_ms\": " << JsonNumber(result.encode_milliseconds)
+         << ", \"upload_ms\": " << JsonNumber(result.upload_milliseconds)
+         << ", \"vram_bytes\": " << result.vram_bytes
+         << ", \"disk_bytes\": " << result.disk_bytes
+         << ", \"decompress_ms\": "
+         << JsonNumber(result.decompress_milliseconds)
+         << ", \"psnr\": " << JsonNumber(result.psnr)
+         << ", \"ssim\": " << JsonNumber(result.ssim) << "}";
+  }
+  file << "\n  ]\n}\n";
+  return static_cast<bool>(file);
+}
+
+// Prints the results of an image as a row per path.
+void PrintCodecRow(const CodecResult& result) {
+  const std::string psnr = std::isinf(result.psnr) ?
+      std::string("inf") : FormatValue(result.psnr, 2);
+  std::cout << std::left << std::setw(kColumnWidth) << result.path
+            << std::setw(kColumnWidth)
+            << FormatValue(result.encode_milliseconds, 2)
+            << std::setw(kColumnWidth)
+            << FormatValue(result.upload_milliseconds, 3)
+            << std::setw(kColumnWidth)
+            << FormatValue(result.vram_bytes / (1024.0 * 1024.0), 2)
+            << std::setw(kColumnWidth)
+            << FormatValue(result.disk_bytes / (1024.0 * 1024.0), 2)
+            << std::setw(kColumnWidth)
+            << FormatValue(result.decompress_milliseconds, 3)
+            << std::setw(kColumnWidth) << psnr
+            << FormatValue(result.ssim, 4) << "\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  GLUTILS_GFLAGS_NAMESPACE::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  const std::vector<std::string> image_filepaths =
+      SplitCommaSeparatedList(FLAGS_image_filepaths);
+  wvu::BcQuality quality;
+  if (image_filepaths.empty() || FLAGS_num_iterations <= 0 ||
+      !ParseCompressionQuality(FLAGS_compression_quality, &quality)) {
+    std::cerr << "ERROR: Provide --image_filepaths, a positive "
+              << "--num_iterations and a --compression_quality of fast, "
+              << "normal or high.\n";
+    return -1;
+  }
+  wvu::Supercompression supercompression;
+  if (!ParseSupercompression(FLAGS_supercompression, &supercompression)) {
+    std::cerr << "ERROR: Unknown or unavailable supercompression "
+              << FLAGS_supercompression << ".\n";
+    return -1;
+  }
+  std::vector<CodecPath> paths;
+  for (const std::string& name : SplitCommaSeparatedList(FLAGS_paths)) {
+    const CodecPath* path = std::find_if(
+        std::begin(kCodecPaths), std::end(kCodecPaths),
+        [&name](const CodecPath& codec_path) {
+          return name == codec_path.name;
+        });
+    if (path == std::end(kCodecPaths)) {
+      std::cerr << "ERROR: Unknown path " << name << ".\n";
+      return -1;
+    }
+    paths.push_back(*path);
+  }
+
+  // The uploads need an OpenGL context, which comes with an invisible window.
+  if (!glfwInit()) {
+    return -1;
+  }
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+  glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+  GLFWwindow* window = glfwCreateWindow(64, 64, "texture_codec_benchmark",
+                                        nullptr, nullptr);
+  if (!window) {
+    glfwTerminate();
+    return -1;
+  }
+  glfwMakeContextCurrent(window);
+  glewExperimental = GL_TRUE;
+  if (glewInit() != GLEW_OK) {
+    std::cerr << "ERROR: GLEW did not initialize properly.\n";
+    glfwTerminate();
+    return -1;
+  }
+  // glewInit() may leave an error behind in core profiles.
+  glGetError();
+
+  std::cout << "Texture formats with the " << FLAGS_compression_quality
+            << " quality, " << FLAGS_num_iterations << " iterations, "
+            << wvu::SimdLevelName(wvu::GetSimdLevel()) << " metrics.\n";
+  wvu::StagingBufferPool staging_buffer_pool(kMaxPooledBytes);
+  std::vector<CodecResult> results;
+  for (const std::string& image_filepath : image_filepaths) {
+    wvu::ImageReader reader;
+    if (!reader.Open(image_filepath)) {
+      std::cerr << "ERROR: Could not open " << image_filepath << ".\n";
+      continue;
+    }
+    std::vector<unsigned char> rgba(4 * static_cast<size_t>(reader.width()) *
+                                    reader.height());
+    if (!reader.ReadRgba8(rgba.data())) {
+      std::cerr << "ERROR: Could not read " << image_filepath << ".\n";
+      continue;
+    }
+    std::cout << "\n" << image_filepath << " (" << reader.width() << "x"
+              << reader.height() << ")\n";
+    std::cout << std::left << std::setw(kColumnWidth) << "path"
+              << std::setw(kColumnWidth) << "encode ms"
+              << std::setw(kColumnWidth) << "upload ms"
+              << std::setw(kColumnWidth) << "VRAM MB"
+              << std::setw(kColumnWidth) << "disk MB"
+              << std::setw(kColumnWidth) << "inflate ms"
+              << std::setw(kColumnWidth) << "PSNR dB"
+              << "SSIM\n";
+    for (const CodecPath& path : paths) {
+      results.push_back(RunCodecPath(image_filepath, rgba, reader.width(),
+                                     reader.height(), path, quality,
+                                     supercompression,
+                                     &staging_buffer_pool));
+      PrintCodecRow(results.back());
+    }
+  }
+  glfwDestroyWindow(window);
+  glfwTerminate();
+
+  if (!FLAGS_json_output_filepath.empty() &&
+      !WriteJson(FLAGS_json_output_filepath, results)) {
+    std::cerr << "ERROR: Could not write " << FLAGS_json_output_filepath
+              << ".\n";
+    return -1;
+  }
+  return results.empty() ? -1 : 0;
+}
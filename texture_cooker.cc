@@ -0,0 +1,402 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "texture_cooker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include <GL/glew.h>
+#include <glog/logging.h>
+
+#include "bc_encoder.h"
+#include "bptc_encoder.h"
+#include "etc_encoder.h"
+#include "hash.h"
+#include "image_metrics.h"
+#include "image_reader.h"
+#include "mip_generator.h"
+
+namespace wvu {
+namespace {
+// Version of the cooking code. Bump it when the cooked texels change for the
+// same options, so that the cached textures are cooked again.
+constexpr uint32_t kCookerVersion = 1;
+
+// Number of bytes per texel of RGBA8 textures.
+constexpr int kNumBytesPerTexel = 4;
+
+// Returns true if some texel of the RGBA8 image is not opaque.
+bool HasTransparentTexels(const unsigned char* rgba, const size_t num_texels) {
+  for (size_t i = 0; i < num_texels; ++i) {
+    if (rgba[4 * i + 3] != 255) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Returns the compressed format of the texture, choosing between the formats
+// with and without alpha for the automatic compressions.
+TextureCompression ResolveCompression(const TextureCompression compression,
+                                      const CookedTexture& cooked) {
+  if (compression != TEXTURE_COMPRESSION_BC_AUTO &&
+      compression != TEXTURE_COMPRESSION_ETC2_AUTO) {
+    return compression;
+  }
+  const bool transparent = HasTransparentTexels(
+      cooked.level_data(0),
+      static_cast<size_t>(cooked.width()) * cooked.height());
+  if (compression == TEXTURE_COMPRESSION_BC_AUTO) {
+    return transparent ? TEXTURE_COMPRESSION_BC3 : TEXTURE_COMPRESSION_BC1;
+  }
+  return transparent ? TEXTURE_COMPRESSION_ETC2_RGBA8 :
+      TEXTURE_COMPRESSION_ETC2_RGB8;
+}
+
+// Returns the internal format of a resolved compression.
+GLenum CompressedInternalFormat(const TextureCompression compression) {
+  switch (compression) {
+    case TEXTURE_COMPRESSION_BC1:
+      return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case TEXTURE_COMPRESSION_BC3:
+      return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case TEXTURE_COMPRESSION_BC7:
+      return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    case TEXTURE_COMPRESSION_ETC2_RGB8:
+      return GL_COMPRESSED_RGB8_ETC2;
+    case TEXTURE_COMPRESSION_ETC2_RGBA8:
+      return GL_COMPRESSED_RGBA8_ETC2_EAC;
+    case TEXTURE_COMPRESSION_EAC_R11:
+      return GL_COMPRESSED_R11_EAC;
+    case TEXTURE_COMPRESSION_EAC_RG11:
+      return GL_COMPRESSED_RG11_EAC;
+    default:
+      return GL_RGBA8;
+  }
+}
+
+// Returns the number of channels, from red, that a resolved compression
+// stores.
+int NumCompressedChannels(const TextureCompression compression) {
+  switch (compression) {
+    case TEXTURE_COMPRESSION_BC1:
+    case TEXTURE_COMPRESSION_ETC2_RGB8:
+      return 3;
+    case TEXTURE_COMPRESSION_EAC_R11:
+      return 1;
+    case TEXTURE_COMPRESSION_EAC_RG11:
+      return 2;
+    default:
+      return 4;
+  }
+}
+
+bool IsBcCompression(const TextureCompression compression) {
+  return compression == TEXTURE_COMPRESSION_BC1 ||
+      compression == TEXTURE_COMPRESSION_BC3;
+}
+
+BcFormat ToBcFormat(const TextureCompression compression) {
+  return compression == TEXTURE_COMPRESSION_BC1 ? BC1_FORMAT : BC3_FORMAT;
+}
+
+EtcFormat ToEtcFormat(const TextureCompression compression) {
+  switch (compression) {
+    case TEXTURE_COMPRESSION_ETC2_RGBA8:
+      return ETC2_RGBA8_FORMAT;
+    case TEXTURE_COMPRESSION_EAC_R11:
+      return EAC_R11_FORMAT;
+    case TEXTURE_COMPRESSION_EAC_RG11:
+      return EAC_RG11_FORMAT;
+    default:
+      return ETC2_RGB8_FORMAT;
+  }
+}
+
+// Returns the number of bytes of a level in a resolved compression.
+size_t CompressedLevelSizeInBytes(const TextureCompression compression,
+                                  const int width,
+                                  const int height) {
+  if (compression == TEXTURE_COMPRESSION_BC7) {
+    return BptcCompressedSizeInBytes(width, height);
+  }
+  if (IsBcCompression(compression)) {
+    return BcCompressedSizeInBytes(ToBcFormat(compression), width, height);
+  }
+  return EtcCompressedSizeInBytes(ToEtcFormat(compression), width, height);
+}
+
+// Decodes a level in a resolved compression into RGBA8.
+void DecodeCompressedLevel(const TextureCompression compression,
+                           const unsigned char* blocks,
+                           const int width,
+                           const int height,
+                           unsigned char* rgba) {
+  if (compression == TEXTURE_COMPRESSION_BC7) {
+    DecodeBc7(blocks, width, height, rgba);
+  } else if (IsBcCompression(compression)) {
+    DecodeBc(blocks, width, height, ToBcFormat(compression), rgba);
+  } else {
+    DecodeEtc(blocks, width, height, ToEtcFormat(compression), rgba);
+  }
+}
+
+// Compresses the RGBA8 levels of the cooked texture into blocks. If level 0
+// decodes back below the minimum PSNR, the texture is kept in RGBA8.
+void CompressCookedTexture(const std::string& source_filepath,
+                           const TextureCookingOptions& options,
+                           StagingBufferPool* staging_buffer_pool,
+                           CookedTexture* cooked) {
+  typedef std::chrono::steady_clock Clock;
+  const Clock::time_point start = Clock::now();
+  const TextureCompression compression =
+      ResolveCompression(options.compression, *cooked);
+  std::vector<CookedTexture::Level> levels(cooked->num_levels());
+  size_t offset = 0;
+  for (int i = 0; i < cooked->num_levels(); ++i) {
+    levels[i].width = cooked->level(i).width;
+    levels[i].height = cooked->level(i).height;
+    levels[i].offset = offset;
+    levels[i].size_in_bytes = CompressedLevelSizeInBytes(
+        compression, levels[i].width, levels[i].height);
+    offset += levels[i].size_in_bytes;
+  }
+  StagingBuffer buffer = staging_buffer_pool->Acquire(offset);
+  size_t num_fast_blocks = 0;
+  for (int i = 0; i < cooked->num_levels(); ++i) {
+    unsigned char* blocks = buffer.data() + levels[i].offset;
+    if (IsBcCompression(compression)) {
+      EncodeBc(cooked->level_data(i), levels[i].width, levels[i].height,
+               ToBcFormat(compression), options.compression_quality,
+               options.num_compression_threads,
+               options.compression_rdo_lambda, blocks);
+      continue;
+    }
+    if (compression != TEXTURE_COMPRESSION_BC7) {
+      EncodeEtc(cooked->level_data(i), levels[i].width, levels[i].height,
+                ToEtcFormat(compression), options.compression_quality,
+                options.num_compression_threads, blocks);
+      continue;
+    }
+    // Every level gets what remains of the time budget of the texture.
+    BptcEncodingOptions bptc_options;
+    bptc_options.quality = options.compression_quality;
+    bptc_options.num_threads = options.num_compression_threads;
+    bool budget_spent = false;
+    if (options.compression_time_budget_seconds > 0.0) {
+      bptc_options.time_budget_seconds =
+          options.compression_time_budget_seconds -
+          std::chrono::duration<double>(Clock::now() - start).count();
+      if (bptc_options.time_budget_seconds <= 0.0) {
+        budget_spent = bptc_options.quality != BC_QUALITY_FAST;
+        bptc_options.quality = BC_QUALITY_FAST;
+      }
+    }
+    BptcEncodingStatistics statistics;
+    EncodeBc7(cooked->level_data(i), levels[i].width, levels[i].height,
+              bptc_options, blocks, &statistics);
+    num_fast_blocks +=
+        budget_spent ? statistics.num_blocks : statistics.num_fast_blocks;
+  }
+  if (options.report_compression || options.min_compression_psnr > 0.0) {
+    // Verify level 0 by decoding it back.
+    const double seconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    const size_t num_texels =
+        static_cast<size_t>(levels[0].width) * levels[0].height;
+    std::vector<unsigned char> decoded(num_texels * kNumBytesPerTexel);
+    DecodeCompressedLevel(compression, buffer.data(), levels[0].width,
+                          levels[0].height, decoded.data());
+    const double psnr =
+        ComputePsnr(cooked->level_data(0), decoded.data(), num_texels,
+                    NumCompressedChannels(compression));
+    if (options.report_compression) {
+      LOG(INFO) << "Compressed " << source_filepath << " ("
+                << levels[0].width << "x" << levels[0].height << ", "
+                << levels.size() << " levels) in " << seconds
+                << " s; level 0 PSNR: " << psnr << " dB; blocks compressed "
+                << "with the fast quality after the time budget: "
+                << num_fast_blocks;
+    }
+    if (psnr < options.min_compression_psnr) {
+      LOG(WARNING) << "The compressed level 0 of " << source_filepath
+                   << " has a PSNR of " << psnr << " dB, below the minimum of "
+                   << options.min_compression_psnr
+                   << " dB; the texture is not compressed.";
+      staging_buffer_pool->Release(std::move(buffer));
+      return;
+    }
+  }
+  staging_buffer_pool->Release(cooked->Release());
+  cooked->Assign(CompressedInternalFormat(compression), 0, 0, levels,
+                 std::move(buffer));
+}
+
+}  // namespace
+
+uint64_t HashTextureCookingOptions(const TextureCookingOptions& options) {
+  // Hash the fields one by one; hashing the struct would include padding.
+  const uint32_t fields[] = {
+    kCookerVersion,
+    options.generate_mipmaps ? 1u : 0u,
+    static_cast<uint32_t>(options.max_mip_level),
+    static_cast<uint32_t>(options.mip_generation.filter),
+    options.mip_generation.srgb ? 1u : 0u,
+    static_cast<uint32_t>(
+        std::lround(options.mip_generation.alpha_coverage_reference * 1000.0f)),
+    static_cast<uint32_t>(options.compression),
+    static_cast<uint32_t>(options.compression_quality),
+    static_cast<uint32_t>(
+        std::lround(options.compression_time_budget_seconds * 1000.0)),
+    static_cast<uint32_t>(std::lround(options.min_compression_psnr * 100.0)),
+    static_cast<uint32_t>(
+        std::lround(options.compression_rdo_lambda * 1000.0f))
+  };
+  return Hash64(fields, sizeof(fields), 0);
+}
+
+void CookedTexture::Assign(const GLenum internal_format,
+                           const GLenum format,
+                           const GLenum type,
+                           const std::vector<Level>& levels,
+                           StagingBuffer buffer) {
+  mapped_file_.Close();
+  internal_format_ = internal_format;
+  format_ = format;
+  type_ = type;
+  levels_ = levels;
+  buffer_ = std::move(buffer);
+  data_ = buffer_.data();
+}
+
+void CookedTexture::Assign(const GLenum internal_format,
+                           const GLenum format,
+                           const GLenum type,
+                           const std::vector<Level>& levels,
+                           MappedFile mapped_file) {
+  buffer_ = StagingBuffer();
+  internal_format_ = internal_format;
+  format_ = format;
+  type_ = type;
+  levels_ = levels;
+  mapped_file_ = std::move(mapped_file);
+  data_ = mapped_file_.data();
+}
+
+StagingBuffer CookedTexture::Release() {
+  levels_.clear();
+  mapped_file_.Close();
+  data_ = nullptr;
+  return std::move(buffer_);
+}
+
+size_t Rgba8MipChainSizeInBytes(const int width,
+                                const int height,
+                                const TextureCookingOptions& options) {
+  const int num_levels =
+      options.generate_mipmaps ? NumMipLevels(width, height) : 1;
+  size_t size_in_bytes = 0;
+  for (int i = 0; i < num_levels; ++i) {
+    size_in_bytes += static_cast<size_t>(MipLevelSize(width, i)) *
+        MipLevelSize(height, i) * kNumBytesPerTexel;
+  }
+  return size_in_bytes;
+}
+
+void CookDecodedTexture(const std::string& source_filepath,
+                        const int width,
+                        const int height,
+                        const TextureCookingOptions& options,
+                        StagingBuffer buffer,
+                        StagingBufferPool* staging_buffer_pool,
+                        CookedTexture* cooked) {
+  int num_levels = options.generate_mipmaps ? NumMipLevels(width, height) : 1;
+  // The whole chain is generated, and only the levels up to max_mip_level are
+  // kept.
+  if (options.max_mip_level >= 0) {
+    num_levels = std::min(num_levels, options.max_mip_level + 1);
+  }
+  // Level 0 is at the start of the buffer and the other levels follow it, so
+  // the whole chain is a single allocation.
+  std::vector<CookedTexture::Level> levels(num_levels);
+  size_t offset = 0;
+  for (int i = 0; i < num_levels; ++i) {
+    levels[i].width = MipLevelSize(width, i);
+    levels[i].height = MipLevelSize(height, i);
+    levels[i].offset = offset;
+    levels[i].size_in_bytes = static_cast<size_t>(levels[i].width) *
+        levels[i].height * kNumBytesPerTexel;
+    offset += levels[i].size_in_bytes;
+  }
+  if (num_levels > 1) {
+    GenerateRgba8MipChain(width, height, options.mip_generation,
+                          buffer.data());
+  }
+  cooked->Assign(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, levels,
+                 std::move(buffer));
+  // The blocks are encoded from the RGBA8 levels, so every level is compressed
+  // from a full-quality mip rather than from a compressed one.
+  if (options.compression != TEXTURE_COMPRESSION_NONE) {
+    CompressCookedTexture(source_filepath, options, staging_buffer_pool,
+                          cooked);
+  }
+}
+
+bool CookTexture(const std::string& source_filepath,
+                 const TextureCookingOptions& options,
+                 StagingBufferPool* staging_buffer_pool,
+                 CookedTexture* cooked) {
+  ImageReader image_reader;
+  if (!image_reader.Open(source_filepath)) {
+    return false;
+  }
+  const int width = image_reader.width();
+  const int height = image_reader.height();
+  StagingBuffer buffer = staging_buffer_pool->Acquire(
+      Rgba8MipChainSizeInBytes(width, height, options));
+  if (!image_reader.ReadRgba8(buffer.data())) {
+    staging_buffer_pool->Release(std::move(buffer));
+    return false;
+  }
+  CookDecodedTexture(source_filepath, width, height, options,
+                     std::move(buffer), staging_buffer_pool, cooked);
+  return true;
+}
+
+}  // namespace wvu
@@ -0,0 +1,225 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_TEXTURE_COOKER_H_
+#define GLUTILS_TEXTURE_COOKER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+
+#include "bc_encoder.h"
+#include "mapped_file.h"
+#include "mip_generator.h"
+#include "staging_buffer_pool.h"
+
+namespace wvu {
+// GPU formats in which the textures can be cooked.
+enum TextureCompression {
+  // Uncompressed RGBA8.
+  TEXTURE_COMPRESSION_NONE = 0,
+  // BC1 (GL_COMPRESSED_RGB_S3TC_DXT1_EXT); the alpha is dropped.
+  TEXTURE_COMPRESSION_BC1 = 1,
+  // BC3 (GL_COMPRESSED_RGBA_S3TC_DXT5_EXT).
+  TEXTURE_COMPRESSION_BC3 = 2,
+  // BC3 for textures with transparent texels, and BC1 otherwise.
+  TEXTURE_COMPRESSION_BC_AUTO = 3,
+  // BC7 (GL_COMPRESSED_RGBA_BPTC_UNORM): higher quality than BC1 and BC3 at
+  // the size of BC3, but slower to encode.
+  TEXTURE_COMPRESSION_BC7 = 4,
+  // ETC2 RGB (GL_COMPRESSED_RGB8_ETC2); the alpha is dropped. The ETC2 and EAC
+  // formats are part of OpenGL 4.3 and OpenGL ES 3.0.
+  TEXTURE_COMPRESSION_ETC2_RGB8 = 5,
+  // ETC2 RGB with EAC alpha (GL_COMPRESSED_RGBA8_ETC2_EAC).
+  TEXTURE_COMPRESSION_ETC2_RGBA8 = 6,
+  // ETC2 RGBA8 for textures with transparent texels, and ETC2 RGB otherwise.
+  TEXTURE_COMPRESSION_ETC2_AUTO = 7,
+  // The red channel in EAC (GL_COMPRESSED_R11_EAC).
+  TEXTURE_COMPRESSION_EAC_R11 = 8,
+  // The red and green channels in EAC (GL_COMPRESSED_RG11_EAC).
+  TEXTURE_COMPRESSION_EAC_RG11 = 9
+};
+
+// Parameters that determine how a texture is cooked. Every parameter is part
+// of the key of the cooked texture in the cache, so changing any of them cooks
+// the texture again.
+struct TextureCookingOptions {
+  // If true, the complete mip chain is precomputed.
+  bool generate_mipmaps = true;
+  // If not negative, the levels after this one are dropped from the mip chain,
+  // e.g., for the pages of a texture atlas, whose images bleed into each other
+  // above the level that their gutters cover (see texture_atlas.h).
+  int max_mip_level = -1;
+  // How the mip chain is generated. The number of threads does not change the
+  // levels, so it is not part of the key.
+  MipGenerationOptions mip_generation;
+  // The GPU format of the texture.
+  TextureCompression compression = TEXTURE_COMPRESSION_NONE;
+  // The quality of the block compression.
+  BcQuality compression_quality = BC_QUALITY_NORMAL;
+  // Maximum time to compress all the levels of a BC7 texture in seconds; once
+  // it is spent, the remaining blocks are compressed with the fast quality. 0
+  // for no limit. It is part of the key with millisecond precision.
+  double compression_time_budget_seconds = 0.0;
+  // Minimum PSNR in dB of the channels that the format stores, measured on
+  // level 0 decoded back; the textures below it are cooked in RGBA8 instead.
+  // 0 to skip the verification.
+  double min_compression_psnr = 0.0;
+  // If positive, the BC1 and BC3 blocks are rate-distortion optimized with
+  // this lambda so that the supercompression of the cache (see
+  // texture_cache.h) shrinks them further, at the cost of some quality. See
+  // EncodeBc(). It is part of the key with a precision of 0.001.
+  float compression_rdo_lambda = 0.0f;
+  // Number of threads that compress every level; 0 uses one thread per core.
+  // It does not change the cooked texels, so it is not part of the key.
+  int num_compression_threads = 0;
+  // If true, the PSNR of level 0 and the compression time of every
+  // compressed texture are logged. It is not part of the key.
+  bool report_compression = false;
+};
+
+// Returns the hash of the cooking options.
+uint64_t HashTextureCookingOptions(const TextureCookingOptions& options);
+
+// A texture in its final GPU format: every mip level is ready to be passed to
+// glTexImage2D(), or to glCompressedTexImage2D() for compressed formats. The
+// levels are either in host memory (a freshly cooked
+// texture) or in a memory-mapped file (a texture from the cache).
+class CookedTexture {
+ public:
+  // A mip level of the texture.
+  struct Level {
+    int width;
+    int height;
+    // Offset of the texels of the level from the start of the storage.
+    size_t offset;
+    size_t size_in_bytes;
+  };
+
+  CookedTexture() :
+      internal_format_(0), format_(0), type_(0), data_(nullptr) {}
+
+  // Movable but not copyable.
+  CookedTexture(CookedTexture&& other) = default;
+  CookedTexture& operator=(CookedTexture&& other) = default;
+
+  // Sets the levels of the texture, which are stored in the buffer.
+  void Assign(const GLenum internal_format,
+              const GLenum format,
+              const GLenum type,
+              const std::vector<Level>& levels,
+              StagingBuffer buffer);
+  // Sets the levels of the texture, which are stored in the mapped file.
+  void Assign(const GLenum internal_format,
+              const GLenum format,
+              const GLenum type,
+              const std::vector<Level>& levels,
+              MappedFile mapped_file);
+
+  // Releases the storage of the texture and returns the buffer that held the
+  // levels, if any, so that it can be returned to its pool.
+  StagingBuffer Release();
+
+  // The internal format, format and type of the texels, as in glTexImage2D().
+  // The format and type of compressed formats are zero.
+  GLenum internal_format() const { return internal_format_; }
+  GLenum format() const { return format_; }
+  GLenum type() const { return type_; }
+  bool compressed() const { return format_ == 0; }
+  // Size of the blocks of texels that the format stores together.
+  int block_width() const { return compressed() ? 4 : 1; }
+  int block_height() const { return compressed() ? 4 : 1; }
+
+  // Accessors of the levels.
+  int num_levels() const { return static_cast<int>(levels_.size()); }
+  const Level& level(const int i) const { return levels_[i]; }
+  const std::vector<Level>& levels() const { return levels_; }
+  const unsigned char* level_data(const int i) const {
+    return data_ + levels_[i].offset;
+  }
+  int width() const { return levels_.empty() ? 0 : levels_[0].width; }
+  int height() const { return levels_.empty() ? 0 : levels_[0].height; }
+
+ private:
+  GLenum internal_format_;
+  GLenum format_;
+  GLenum type_;
+  std::vector<Level> levels_;
+  StagingBuffer buffer_;
+  MappedFile mapped_file_;
+  const unsigned char* data_;
+};
+
+// Returns the number of bytes of the RGBA8 mip chain of an image with the
+// cooking options, which is the buffer that CookDecodedTexture() needs.
+size_t Rgba8MipChainSizeInBytes(const int width,
+                                const int height,
+                                const TextureCookingOptions& options);
+
+// Cooks an image that is already decoded, e.g., to inspect its texels before
+// cooking it.
+// Parameters:
+//   source_filepath  The filepath of the image, used in the messages.
+//   width, height  The dimensions of the image.
+//   options  The cooking options.
+//   buffer  A buffer of Rgba8MipChainSizeInBytes() bytes that holds the image
+//     in RGBA8 at its start, as written by ImageReader::ReadRgba8().
+//   staging_buffer_pool  The pool that provides the memory of the compressed
+//     levels.
+//   cooked  The cooked texture.
+void CookDecodedTexture(const std::string& source_filepath,
+                        const int width,
+                        const int height,
+                        const TextureCookingOptions& options,
+                        StagingBuffer buffer,
+                        StagingBufferPool* staging_buffer_pool,
+                        CookedTexture* cooked);
+
+// Decodes the image and cooks it into a texture. Returns true if successful,
+// and false otherwise.
+// Parameters:
+//   source_filepath  The filepath of the image.
+//   options  The cooking options.
+//   staging_buffer_pool  The pool that provides the memory of the levels.
+//   cooked  The cooked texture.
+bool CookTexture(const std::string& source_filepath,
+                 const TextureCookingOptions& options,
+                 StagingBufferPool* staging_buffer_pool,
+                 CookedTexture* cooked);
+
+}  // namespace wvu
+
+#endif  // GLUTILS_TEXTURE_COOKER_H_
@@ -0,0 +1,187 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "texture_format.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <GL/glew.h>
+
+namespace wvu {
+namespace {
+// Formats of the textures indexed by the number of channels minus one.
+constexpr GLenum kFormats[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+constexpr GLenum kInternalFormats8[] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+constexpr GLenum kInternalFormats16[] = {
+  GL_R16, GL_RG16, GL_RGB16, GL_RGBA16
+};
+
+// Returns true if the driver can sample GL_R8 and GL_RG8 textures as gray
+// and gray-alpha (OpenGL 3.3 or GL_ARB_texture_swizzle).
+bool SupportsTextureSwizzle() {
+  return GLEW_VERSION_3_3 || GLEW_ARB_texture_swizzle;
+}
+
+}  // namespace
+
+TextureUploadFormat NegotiateTextureUploadFormat(const int num_channels,
+                                                 const int bytes_per_channel) {
+  TextureUploadFormat upload_format;
+  const int channel_index = std::min(std::max(num_channels, 1), 4) - 1;
+  upload_format.num_channels = channel_index + 1;
+  upload_format.bytes_per_channel = bytes_per_channel == 2 ? 2 : 1;
+  upload_format.format = kFormats[channel_index];
+  if (upload_format.bytes_per_channel == 2) {
+    upload_format.internal_format = kInternalFormats16[channel_index];
+    upload_format.type = GL_UNSIGNED_SHORT;
+  } else {
+    upload_format.internal_format = kInternalFormats8[channel_index];
+    upload_format.type = GL_UNSIGNED_BYTE;
+  }
+  QueryPreferredUploadFormat(upload_format.internal_format,
+                             &upload_format.preferred_format,
+                             &upload_format.preferred_type);
+  // The RGBA8 fast path: the texels are expanded once while they are decoded
+  // instead of being converted by the driver on every upload. RGB8 texels
+  // are only kept when the driver asks for exactly that layout; the other
+  // layouts are kept unless the driver converts them but not RGBA8 texels
+  // (some drivers prefer floats for every format). Without swizzles, gray
+  // textures would be sampled as red, so they are expanded too.
+  TextureUploadFormat rgba8_upload_format;
+  QueryPreferredUploadFormat(rgba8_upload_format.internal_format,
+                             &rgba8_upload_format.preferred_format,
+                             &rgba8_upload_format.preferred_type);
+  const bool is_rgb8 = upload_format.internal_format == GL_RGB8;
+  const bool is_gray = upload_format.num_channels <= 2;
+  if ((is_rgb8 && (upload_format.preferred_format == 0 ||
+                   upload_format.driver_converts())) ||
+      (upload_format.driver_converts() &&
+       !rgba8_upload_format.driver_converts()) ||
+      (is_gray && !SupportsTextureSwizzle())) {
+    return rgba8_upload_format;
+  }
+  return upload_format;
+}
+
+bool FindTextureUploadFormat(const GLenum internal_format,
+                             TextureUploadFormat* upload_format) {
+  for (int channel_index = 0; channel_index < 4; ++channel_index) {
+    const bool is_8_bit = kInternalFormats8[channel_index] == internal_format;
+    if (!is_8_bit && kInternalFormats16[channel_index] != internal_format) {
+      continue;
+    }
+    upload_format->internal_format = internal_format;
+    upload_format->format = kFormats[channel_index];
+    upload_format->type = is_8_bit ? GL_UNSIGNED_BYTE : GL_UNSIGNED_SHORT;
+    upload_format->num_channels = channel_index + 1;
+    upload_format->bytes_per_channel = is_8_bit ? 1 : 2;
+    QueryPreferredUploadFormat(internal_format,
+                               &upload_format->preferred_format,
+                               &upload_format->preferred_type);
+    return true;
+  }
+  return false;
+}
+
+bool QueryPreferredUploadFormat(const GLenum internal_format,
+                                GLenum* format,
+                                GLenum* type) {
+  if (!(GLEW_VERSION_4_3 || GLEW_ARB_internalformat_query2)) {
+    return false;
+  }
+  GLint preferred_format = 0;
+  GLint preferred_type = 0;
+  glGetInternalformativ(GL_TEXTURE_2D, internal_format,
+                        GL_TEXTURE_IMAGE_FORMAT, 1, &preferred_format);
+  glGetInternalformativ(GL_TEXTURE_2D, internal_format,
+                        GL_TEXTURE_IMAGE_TYPE, 1, &preferred_type);
+  // Drivers answer zero (GL_NONE) when they have no preference.
+  if (preferred_format == 0 || preferred_type == 0) {
+    return false;
+  }
+  *format = preferred_format;
+  *type = preferred_type;
+  return true;
+}
+
+GLint ComputeUnpackAlignment(const size_t row_size_in_bytes) {
+  for (GLint alignment = 8; alignment > 1; alignment /= 2) {
+    if (row_size_in_bytes % alignment == 0) {
+      return alignment;
+    }
+  }
+  return 1;
+}
+
+int ComputeNumMipLevels(const int width, const int height) {
+  int num_levels = 1;
+  for (int size = std::max(width, height); size > 1; size /= 2) {
+    ++num_levels;
+  }
+  return num_levels;
+}
+
+GLint ComputeMinFilter(const int num_levels) {
+  return num_levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR;
+}
+
+void AllocateTextureStorage(const GLenum target,
+                            const int num_levels,
+                            const TextureUploadFormat& upload_format,
+                            const int width,
+                            const int height) {
+  if (GLEW_VERSION_4_2 || GLEW_ARB_texture_storage) {
+    glTexStorage2D(target, num_levels, upload_format.internal_format, width,
+                   height);
+    return;
+  }
+  for (int level = 0; level < num_levels; ++level) {
+    glTexImage2D(target, level, upload_format.internal_format,
+                 std::max(width >> level, 1), std::max(height >> level, 1), 0,
+                 upload_format.format, upload_format.type, nullptr);
+  }
+  glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, num_levels - 1);
+}
+
+void SetTextureSwizzle(const GLenum target,
+                       const TextureUploadFormat& upload_format) {
+  if (upload_format.num_channels > 2 || !SupportsTextureSwizzle()) {
+    return;
+  }
+  const GLint alpha = upload_format.num_channels == 2 ? GL_GREEN : GL_ONE;
+  const GLint swizzle[] = { GL_RED, GL_RED, GL_RED, alpha };
+  glTexParameteriv(target, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+}
+
+}  // namespace wvu
@@ -0,0 +1,143 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_TEXTURE_FORMAT_H_
+#define GLUTILS_TEXTURE_FORMAT_H_
+
+#include <cstddef>
+#include <GL/glew.h>
+
+namespace wvu {
+// Formats of a texture upload: the internal format of the texture and the
+// format and type of the texels sent with glTexSubImage2D().
+struct TextureUploadFormat {
+  GLenum internal_format = GL_RGBA8;
+  GLenum format = GL_RGBA;
+  GLenum type = GL_UNSIGNED_BYTE;
+  // Layout of the source texels.
+  int num_channels = 4;
+  int bytes_per_channel = 1;
+  // The format and type that the driver prefers for the internal format
+  // (GL_TEXTURE_IMAGE_FORMAT and GL_TEXTURE_IMAGE_TYPE), or zero if the driver
+  // cannot be queried.
+  GLenum preferred_format = 0;
+  GLenum preferred_type = 0;
+
+  // Returns the size of a source texel in bytes.
+  size_t texel_size_in_bytes() const {
+    return static_cast<size_t>(num_channels) * bytes_per_channel;
+  }
+
+  // Returns true if the driver is known to convert the texels, i.e., its
+  // preferred format or type differs from the uploaded ones.
+  bool driver_converts() const {
+    return preferred_format != 0 &&
+        (preferred_format != format || preferred_type != type);
+  }
+};
+
+// Chooses the formats of the upload of texels with the given layout (1 to 4
+// channels of 8 or 16 bits) so that the driver does not convert them:
+// gray and gray-alpha texels are uploaded to GL_R8 and GL_RG8 textures (see
+// SetTextureSwizzle()), and 16-bit texels to GL_R16 to GL_RGBA16 textures.
+// Drivers usually store GL_RGB8 textures with four channels and convert RGB
+// texels on every upload, so 8-bit RGB texels are uploaded as RGBA8 unless the
+// driver prefers GL_RGB and GL_UNSIGNED_BYTE. The other layouts fall back to
+// RGBA8 when the driver is known to convert them but not RGBA8 texels (see
+// driver_converts()), which drops the precision of 16-bit texels, and gray
+// layouts also do when the driver has no swizzles. The format is then GL_RGBA8
+// with 4 channels of 8 bits, so that the caller expands the texels (e.g., with
+// ImageReader::ReadRgba8()).
+// Parameters:
+//   num_channels  The number of channels of the source texels.
+//   bytes_per_channel  The size of a channel of the source texels (1 or 2).
+TextureUploadFormat NegotiateTextureUploadFormat(const int num_channels,
+                                                 const int bytes_per_channel);
+
+// Finds the formats of the uploads to a texture whose internal format was
+// chosen by NegotiateTextureUploadFormat() (GL_R8 to GL_RGBA8, or GL_R16 to
+// GL_RGBA16). Returns false for other internal formats, e.g., compressed ones.
+// Parameters:
+//   internal_format  The internal format of the texture.
+//   upload_format  The formats of the uploads to the texture.
+bool FindTextureUploadFormat(const GLenum internal_format,
+                             TextureUploadFormat* upload_format);
+
+// Queries the format and type that the driver prefers to receive for the
+// internal format. Returns false if the driver does not support the query
+// (OpenGL 4.3 or GL_ARB_internalformat_query2).
+bool QueryPreferredUploadFormat(const GLenum internal_format,
+                                GLenum* format,
+                                GLenum* type);
+
+// Returns the largest unpack alignment (8, 4, 2 or 1) that rows of
+// row_size_in_bytes bytes satisfy. OpenGL assumes 4 by default, which breaks
+// the uploads of tightly packed rows such as odd-width RGB images.
+GLint ComputeUnpackAlignment(const size_t row_size_in_bytes);
+
+// Returns the number of levels of the full mip chain of a texture.
+int ComputeNumMipLevels(const int width, const int height);
+
+// Returns the minification filter of a texture with num_levels levels. With a
+// mip chain it is trilinear (GL_LINEAR_MIPMAP_LINEAR), since GL_LINEAR only
+// samples level 0 and the chain would never be used.
+GLint ComputeMinFilter(const int num_levels);
+
+// Allocates the levels of the texture bound to target. The storage is
+// immutable (glTexStorage2D) when the driver supports it, which spares the
+// driver from validating the levels when the texture is used; otherwise every
+// level is allocated with glTexImage2D.
+// Parameters:
+//   target  The target where the texture is bound (e.g., GL_TEXTURE_2D).
+//   num_levels  The number of mipmap levels.
+//   upload_format  The formats of the texture.
+//   width, height  The dimensions of level 0.
+void AllocateTextureStorage(const GLenum target,
+                            const int num_levels,
+                            const TextureUploadFormat& upload_format,
+                            const int width,
+                            const int height);
+
+// Sets the swizzle of the texture bound to target so that GL_R8/GL_R16
+// textures are sampled as gray (r, r, r, 1) and GL_RG8/GL_RG16 textures as
+// gray-alpha (r, r, r, g). Other formats are left as they are, and so is
+// every texture when the driver has no swizzles (OpenGL 3.3 or
+// GL_ARB_texture_swizzle); NegotiateTextureUploadFormat() does not choose
+// gray formats then.
+void SetTextureSwizzle(const GLenum target,
+                       const TextureUploadFormat& upload_format);
+
+}  // namespace wvu
+
+#endif  // GLUTILS_TEXTURE_FORMAT_H_
@@ -0,0 +1,275 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "texture_hot_reloader.h"
+
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <GL/glew.h>
+
+#include <glog/logging.h>
+
+#include "image_reader.h"
+
+namespace wvu {
+
+TextureHotReloader::TextureHotReloader(const Options& options) :
+    options_(options),
+    staging_buffer_pool_(options.max_pooled_staging_bytes),
+    stop_(false) {
+  worker_ = std::thread(&TextureHotReloader::CookLoop, this);
+}
+
+TextureHotReloader::~TextureHotReloader() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cook_condition_.notify_all();
+  worker_.join();
+}
+
+bool TextureHotReloader::Watch(const std::string& texture_filepath,
+                               const GLuint texture_id) {
+  // The storage is queried once; afterwards the reloads keep track of it.
+  WatchedTexture texture;
+  texture.texture_id = texture_id;
+  glBindTexture(GL_TEXTURE_2D, texture_id);
+  glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &texture.width);
+  glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT,
+                           &texture.height);
+  glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT,
+                           &texture.internal_format);
+  GLint immutable = GL_FALSE;
+  glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_IMMUTABLE_FORMAT, &immutable);
+  texture.immutable = immutable == GL_TRUE;
+  glBindTexture(GL_TEXTURE_2D, 0);
+  if (options_.gpu_mipmaps &&
+      !FindTextureUploadFormat(texture.internal_format,
+                               &texture.upload_format)) {
+    LOG(ERROR) << "The texture of " << texture_filepath << " has an internal "
+               << "format that cannot be reloaded with GPU mipmaps.";
+    return false;
+  }
+  if (!file_watcher_.Watch(texture_filepath)) {
+    return false;
+  }
+  textures_[texture_filepath] = texture;
+  return true;
+}
+
+int TextureHotReloader::ProcessReloads() {
+  std::vector<std::string> changed_filepaths;
+  file_watcher_.Poll(&changed_filepaths);
+  std::vector<ReloadedTexture> reloaded_textures;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // A file that changes again before the worker reaches it is cooked once.
+    for (const std::string& changed_filepath : changed_filepaths) {
+      const auto is_queued = [&changed_filepath](const CookRequest& request) {
+        return request.texture_filepath == changed_filepath;
+      };
+      if (std::none_of(cook_queue_.begin(), cook_queue_.end(), is_queued)) {
+        CookRequest request;
+        request.texture_filepath = changed_filepath;
+        request.upload_format = textures_[changed_filepath].upload_format;
+        cook_queue_.push_back(request);
+      }
+    }
+    while (!reloaded_queue_.empty() &&
+           static_cast<int>(reloaded_textures.size()) <
+           options_.max_reloads_per_call) {
+      reloaded_textures.push_back(std::move(reloaded_queue_.front()));
+      reloaded_queue_.pop_front();
+    }
+  }
+  if (!changed_filepaths.empty()) {
+    cook_condition_.notify_one();
+  }
+  int num_reloads = 0;
+  for (ReloadedTexture& reloaded : reloaded_textures) {
+    if (!reloaded.success) {
+      LOG(WARNING) << "Could not reload the texture "
+                   << reloaded.texture_filepath << "; keeping the old one.";
+      ++statistics_.num_failures;
+      continue;
+    }
+    WatchedTexture& texture = textures_[reloaded.texture_filepath];
+    // With GPU mipmaps, level 0 is decoded in the format of the texture.
+    const int width = options_.gpu_mipmaps ?
+        reloaded.width : reloaded.cooked.width();
+    const int height = options_.gpu_mipmaps ?
+        reloaded.height : reloaded.cooked.height();
+    const GLint internal_format = options_.gpu_mipmaps ?
+        texture.internal_format :
+        static_cast<GLint>(reloaded.cooked.internal_format());
+    const bool reallocate = texture.width != width ||
+        texture.height != height || texture.internal_format != internal_format;
+    if (reallocate && texture.immutable) {
+      LOG(WARNING) << "The texture " << reloaded.texture_filepath
+                   << " has immutable storage and cannot change its "
+                   << "dimensions or format; keeping the old one.";
+      staging_buffer_pool_.Release(reloaded.cooked.Release());
+      staging_buffer_pool_.Release(std::move(reloaded.texels));
+      ++statistics_.num_failures;
+      continue;
+    }
+    UpdateTexture(reloaded, reallocate, texture);
+    texture.width = width;
+    texture.height = height;
+    texture.internal_format = internal_format;
+    staging_buffer_pool_.Release(reloaded.cooked.Release());
+    staging_buffer_pool_.Release(std::move(reloaded.texels));
+    ++statistics_.num_reloads;
+    if (reallocate) {
+      ++statistics_.num_reallocations;
+    }
+    ++num_reloads;
+    VLOG(1) << "Reloaded the texture " << reloaded.texture_filepath;
+  }
+  return num_reloads;
+}
+
+void TextureHotReloader::CookLoop() {
+  while (true) {
+    CookRequest request;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cook_condition_.wait(lock, [this]() {
+        return stop_ || !cook_queue_.empty();
+      });
+      if (stop_) {
+        return;
+      }
+      request = cook_queue_.front();
+      cook_queue_.pop_front();
+    }
+    // Decode and cook outside of the lock.
+    const std::string& texture_filepath = request.texture_filepath;
+    ReloadedTexture reloaded;
+    reloaded.texture_filepath = texture_filepath;
+    if (options_.gpu_mipmaps) {
+      reloaded.success = DecodeLevel0(request, &reloaded);
+    } else if (options_.texture_cache != nullptr) {
+      reloaded.success = options_.texture_cache->FindOrCook(
+          texture_filepath, options_.cooking_options, &staging_buffer_pool_,
+          &reloaded.cooked);
+    } else {
+      reloaded.success = CookTexture(texture_filepath,
+                                     options_.cooking_options,
+                                     &staging_buffer_pool_, &reloaded.cooked);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    reloaded_queue_.push_back(std::move(reloaded));
+  }
+}
+
+bool TextureHotReloader::DecodeLevel0(const CookRequest& request,
+                                      ReloadedTexture* reloaded) {
+  ImageReader image_reader;
+  if (!image_reader.Open(request.texture_filepath)) {
+    return false;
+  }
+  // The layout was negotiated for the file when the texture was loaded, so
+  // the texels are decoded as they are stored unless they were expanded to
+  // RGBA8 (e.g., 8-bit RGB images).
+  const TextureUploadFormat& upload_format = request.upload_format;
+  const bool read_native =
+      image_reader.native_num_channels() == upload_format.num_channels &&
+      image_reader.native_bytes_per_channel() ==
+      upload_format.bytes_per_channel;
+  if (!read_native && upload_format.internal_format != GL_RGBA8) {
+    LOG(WARNING) << "The image " << request.texture_filepath << " no longer "
+                 << "has the channels of its texture.";
+    return false;
+  }
+  reloaded->width = image_reader.width();
+  reloaded->height = image_reader.height();
+  reloaded->texels = staging_buffer_pool_.Acquire(
+      upload_format.texel_size_in_bytes() * reloaded->width *
+      reloaded->height);
+  if (!(read_native ? image_reader.ReadNative(reloaded->texels.data()) :
+        image_reader.ReadRgba8(reloaded->texels.data()))) {
+    staging_buffer_pool_.Release(std::move(reloaded->texels));
+    return false;
+  }
+  return true;
+}
+
+void TextureHotReloader::UpdateTexture(const ReloadedTexture& reloaded,
+                                       const bool reallocate,
+                                       const WatchedTexture& texture) {
+  if (!options_.gpu_mipmaps) {
+    UpdateCookedTexture(reloaded.cooked, 0, reallocate, texture.texture_id,
+                        options_.texture_uploader);
+    return;
+  }
+  const TextureUploadFormat& upload_format = texture.upload_format;
+  const size_t row_size_in_bytes =
+      upload_format.texel_size_in_bytes() * reloaded.width;
+  glBindTexture(GL_TEXTURE_2D, texture.texture_id);
+  if (reallocate) {
+    // Only mutable storage gets here, so it is allocated again level by level.
+    const int num_levels = ComputeNumMipLevels(reloaded.width,
+                                               reloaded.height);
+    for (int level = 0; level < num_levels; ++level) {
+      glTexImage2D(GL_TEXTURE_2D, level, upload_format.internal_format,
+                   std::max(reloaded.width >> level, 1),
+                   std::max(reloaded.height >> level, 1), 0,
+                   upload_format.format, upload_format.type, nullptr);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                    ComputeMinFilter(num_levels));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, num_levels - 1);
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, ComputeUnpackAlignment(row_size_in_bytes));
+  if (options_.texture_uploader != nullptr) {
+    options_.texture_uploader->Upload(GL_TEXTURE_2D, 0, 0, 0, reloaded.width,
+                                      reloaded.height, upload_format.format,
+                                      upload_format.type, row_size_in_bytes,
+                                      reloaded.texels.data());
+  } else {
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, reloaded.width, reloaded.height,
+                    upload_format.format, upload_format.type,
+                    reloaded.texels.data());
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glGenerateMipmap(GL_TEXTURE_2D);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+}  // namespace wvu
@@ -0,0 +1,196 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_TEXTURE_HOT_RELOADER_H_
+#define GLUTILS_TEXTURE_HOT_RELOADER_H_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <GL/glew.h>
+
+#include "file_watcher.h"
+#include "staging_buffer_pool.h"
+#include "texture_cache.h"
+#include "texture_cooker.h"
+#include "texture_format.h"
+#include "texture_uploader.h"
+
+namespace wvu {
+// This class reloads textures when their files change on disk, so textures
+// can be edited while the scene is running. A FileWatcher reports the changed
+// files, a worker thread decodes and cooks only those files, and
+// ProcessReloads() replaces the texels of the existing texture objects. The
+// texture ids do not change, so nothing that refers to them needs updating.
+// The levels are replaced in place with glTexSubImage2D() (through the PBOs
+// of the uploader, if any) and only reallocated when the dimensions or the
+// format of the texture changed, which requires mutable storage (see
+// TextureRegistry::Options::mutable_storage). Textures whose mip chain is
+// generated by the GPU (see Options::gpu_mipmaps) are reloaded in the layout
+// of their storage, e.g., GL_R8 for gray images, and keep their immutable
+// storage while the dimensions do not change. The rendering loop never waits
+// for the worker; a file that cannot be decoded, e.g., because it is saved
+// halfway, leaves its texture as it was.
+// All the member functions must be called from the thread that owns the
+// OpenGL context.
+//
+// Example:
+//
+// wvu::TextureHotReloader texture_reloader(options);
+// texture_reloader.Watch("/path/to/image.png", texture_id);
+// while (...) {  // Rendering loop.
+//   texture_reloader.ProcessReloads();
+//   ...
+// }
+class TextureHotReloader {
+ public:
+  // Configuration of the reloader.
+  struct Options {
+    // Maximum number of textures replaced per call to ProcessReloads().
+    int max_reloads_per_call = 1;
+    // Maximum number of bytes of decoding memory kept for reuse.
+    size_t max_pooled_staging_bytes = 64 << 20;
+    // Uploader that transfers the texels through PBOs. It is not owned by the
+    // reloader and must outlive it. If null, the texels are transferred from
+    // client memory.
+    TextureUploader* texture_uploader = nullptr;
+    // Cache of cooked textures. It is not owned by the reloader and must
+    // outlive it. If null, the textures are cooked every time.
+    TextureCache* texture_cache = nullptr;
+    // How the textures are cooked; it should match how they were loaded.
+    TextureCookingOptions cooking_options;
+    // If true, only level 0 is decoded, in the layout of the texture (e.g.,
+    // gray or 16-bit texels), and the mip chain is generated by the GPU. It
+    // should match how the textures were loaded (see
+    // TextureRegistry::Options::gpu_mipmaps). The cache and the cooking
+    // options are not used.
+    bool gpu_mipmaps = false;
+  };
+
+  // Counters of the reloader.
+  struct Statistics {
+    // Number of textures replaced, and how many of them were reallocated.
+    size_t num_reloads = 0;
+    size_t num_reallocations = 0;
+    // Number of changed files that could not be decoded.
+    size_t num_failures = 0;
+  };
+
+  // Starts the worker thread.
+  explicit TextureHotReloader(const Options& options);
+  // Stops the worker thread. The textures are not deleted.
+  ~TextureHotReloader();
+
+  // Reloads the texture whenever the file changes. Returns true if
+  // successful, and false if the file cannot be watched or, with GPU mipmaps,
+  // the internal format of the texture cannot be uploaded.
+  // Parameters:
+  //   texture_filepath  The filepath of the image of the texture.
+  //   texture_id  The texture, a GL_TEXTURE_2D. It is not owned by the
+  //     reloader and must outlive it.
+  bool Watch(const std::string& texture_filepath, const GLuint texture_id);
+
+  // Requests the changed files from the worker and replaces the textures
+  // whose files are cooked. Call it once per frame. Returns the number of
+  // textures replaced.
+  int ProcessReloads();
+
+  const Statistics& statistics() const { return statistics_; }
+
+ private:
+  // A watched texture and the dimensions and format of its storage.
+  struct WatchedTexture {
+    GLuint texture_id;
+    int width;
+    int height;
+    GLint internal_format;
+    // Textures with immutable storage (glTexStorage2D) cannot be reallocated.
+    bool immutable;
+    // The formats of the uploads of level 0 with GPU mipmaps.
+    TextureUploadFormat upload_format;
+  };
+
+  // A changed file waiting for the worker.
+  struct CookRequest {
+    std::string texture_filepath;
+    // The layout in which level 0 is decoded with GPU mipmaps.
+    TextureUploadFormat upload_format;
+  };
+
+  // A cooked texture waiting to replace its texture. With GPU mipmaps, only
+  // level 0 is decoded, into texels.
+  struct ReloadedTexture {
+    std::string texture_filepath;
+    bool success;
+    CookedTexture cooked;
+    int width;
+    int height;
+    StagingBuffer texels;
+  };
+
+  // Loop executed by the worker thread.
+  void CookLoop();
+
+  // Decodes level 0 of the image in the layout of the request. Returns true
+  // if successful, and false if the image cannot be read or its layout no
+  // longer fits the texture.
+  bool DecodeLevel0(const CookRequest& request, ReloadedTexture* reloaded);
+
+  // Replaces the texels of the texture with the reloaded ones.
+  void UpdateTexture(const ReloadedTexture& reloaded,
+                     const bool reallocate,
+                     const WatchedTexture& texture);
+
+  const Options options_;
+  FileWatcher file_watcher_;
+  StagingBufferPool staging_buffer_pool_;
+  // Only the OpenGL thread accesses the watched textures.
+  std::unordered_map<std::string, WatchedTexture> textures_;
+  Statistics statistics_;
+
+  // The members below are shared with the worker and guarded by mutex_.
+  std::mutex mutex_;
+  std::condition_variable cook_condition_;
+  std::deque<CookRequest> cook_queue_;
+  std::deque<ReloadedTexture> reloaded_queue_;
+  bool stop_;
+  std::thread worker_;
+};
+
+}  // namespace wvu
+
+#endif  // GLUTILS_TEXTURE_HOT_RELOADER_H_
@@ -0,0 +1,146 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "texture_loader.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <glog/logging.h>
+
+namespace wvu {
+namespace {
+// Number of bytes necessary to identify the supported image formats.
+constexpr int kNumSignatureBytes = 4;
+
+// Decodes the image with the library linked for its format. Returns false when
+// no library is available for the format, in which case the caller has to use
+// the generic (external) loader.
+bool LoadImageInProcess(const std::string& image_filepath,
+                        const ImageFormat format,
+                        cimg_library::CImg<unsigned char>* image) {
+  switch (format) {
+#ifdef cimg_use_png
+    case PNG_IMAGE_FORMAT:
+      image->load_png(image_filepath.c_str());
+      return true;
+#endif
+#ifdef cimg_use_jpeg
+    case JPEG_IMAGE_FORMAT:
+      image->load_jpeg(image_filepath.c_str());
+      return true;
+#endif
+#ifdef cimg_use_tiff
+    case TIFF_IMAGE_FORMAT:
+      image->load_tiff(image_filepath.c_str());
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
+ImageFormat IdentifyImageFormat(const std::string& image_filepath) {
+  std::FILE* file = std::fopen(image_filepath.c_str(), "rb");
+  if (file == nullptr) {
+    return UNKNOWN_IMAGE_FORMAT;
+  }
+  unsigned char signature[kNumSignatureBytes];
+  const size_t num_read_bytes =
+      std::fread(signature, 1, kNumSignatureBytes, file);
+  std::fclose(file);
+  if (num_read_bytes != kNumSignatureBytes) {
+    return UNKNOWN_IMAGE_FORMAT;
+  }
+  static const unsigned char kPngSignature[] = { 0x89, 'P', 'N', 'G' };
+  static const unsigned char kJpegSignature[] = { 0xFF, 0xD8, 0xFF };
+  static const unsigned char kTiffLittleEndianSignature[] = { 'I', 'I', 42, 0 };
+  static const unsigned char kTiffBigEndianSignature[] = { 'M', 'M', 0, 42 };
+  static const unsigned char kRadianceHdrSignature[] = { '#', '?' };
+  static const unsigned char kExrSignature[] = { 0x76, 0x2F, 0x31, 0x01 };
+  if (std::memcmp(signature, kPngSignature, sizeof(kPngSignature)) == 0) {
+    return PNG_IMAGE_FORMAT;
+  }
+  if (std::memcmp(signature, kJpegSignature, sizeof(kJpegSignature)) == 0) {
+    return JPEG_IMAGE_FORMAT;
+  }
+  if (std::memcmp(signature, kTiffLittleEndianSignature,
+                  sizeof(kTiffLittleEndianSignature)) == 0 ||
+      std::memcmp(signature, kTiffBigEndianSignature,
+                  sizeof(kTiffBigEndianSignature)) == 0) {
+    return TIFF_IMAGE_FORMAT;
+  }
+  // The PFM header starts with "PF" (RGB) or "Pf" (grayscale) and a newline.
+  if (signature[0] == 'P' && (signature[1] == 'F' || signature[1] == 'f') &&
+      std::isspace(signature[2])) {
+    return PFM_IMAGE_FORMAT;
+  }
+  if (std::memcmp(signature, kRadianceHdrSignature,
+                  sizeof(kRadianceHdrSignature)) == 0) {
+    return RADIANCE_HDR_IMAGE_FORMAT;
+  }
+  if (std::memcmp(signature, kExrSignature, sizeof(kExrSignature)) == 0) {
+    return EXR_IMAGE_FORMAT;
+  }
+  return UNKNOWN_IMAGE_FORMAT;
+}
+
+bool LoadImageFromFile(const std::string& image_filepath,
+                       cimg_library::CImg<unsigned char>* image) {
+  if (image == nullptr) {
+    return false;
+  }
+  // CImg reports its errors by throwing exceptions. We catch them here so that
+  // the callers only have to check the returned value.
+  try {
+    const ImageFormat format = IdentifyImageFormat(image_filepath);
+    if (!LoadImageInProcess(image_filepath, format, image)) {
+      VLOG(1) << "No codec library for " << image_filepath
+              << ". Using CImg's generic loader, which may call an external "
+              << "converter.";
+      image->load(image_filepath.c_str());
+    }
+  } catch (const cimg_library::CImgException& exception) {
+    LOG(ERROR) << "Could not load " << image_filepath << ": "
+               << exception.what();
+    return false;
+  }
+  return !image->is_empty();
+}
+
+}  // namespace wvu
@@ -0,0 +1,80 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_TEXTURE_LOADER_H_
+#define GLUTILS_TEXTURE_LOADER_H_
+
+#include <string>
+
+// The macro below disables the capabilities of displaying images in CImg.
+#ifndef cimg_display
+#define cimg_display 0
+#endif
+#include <CImg.h>
+
+namespace wvu {
+// Image formats that can be identified by their signature.
+enum ImageFormat {
+  UNKNOWN_IMAGE_FORMAT = 0,
+  PNG_IMAGE_FORMAT = 1,
+  JPEG_IMAGE_FORMAT = 2,
+  TIFF_IMAGE_FORMAT = 3,
+  // Floating-point (HDR) formats, which are loaded by LoadHdrImageFromFile().
+  PFM_IMAGE_FORMAT = 4,
+  RADIANCE_HDR_IMAGE_FORMAT = 5,
+  EXR_IMAGE_FORMAT = 6
+};
+
+// Reads the first bytes of the file and identifies the format of the image.
+// Returns UNKNOWN_IMAGE_FORMAT if the file cannot be read or the signature is
+// not recognized.
+ImageFormat IdentifyImageFormat(const std::string& image_filepath);
+
+// Loads the image stored in image_filepath into image. The function decodes
+// PNG, JPEG and TIFF files in-process with libpng, libjpeg and libtiff,
+// respectively, whenever CImg is compiled with cimg_use_png, cimg_use_jpeg or
+// cimg_use_tiff. The codec is chosen by the signature (magic bytes) of the
+// file rather than its extension. Any other format falls back to CImg's
+// generic loader, which spawns an external converter (ImageMagick or
+// GraphicsMagick) and is considerably slower. Returns true if successful, and
+// false otherwise.
+// Parameters:
+//   image_filepath  The filepath of the image to load.
+//   image  The CImg instance that holds the decoded image.
+bool LoadImageFromFile(const std::string& image_filepath,
+                       cimg_library::CImg<unsigned char>* image);
+
+}  // namespace wvu
+
+#endif  // GLUTILS_TEXTURE_LOADER_H_
@@ -0,0 +1,305 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "texture_registry.h"
+
+#include <stdlib.h>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+#include <GL/glew.h>
+
+#include <glog/logging.h>
+
+#include "hash.h"
+#include "image_reader.h"
+#include "texture_format.h"
+
+namespace wvu {
+namespace {
+// Minimum number of entries by path between two prunings.
+constexpr size_t kMinPruneSize = 64;
+
+// Returns the canonical form of the path, which resolves the symbolic links
+// and the relative components, or the path itself if it does not exist.
+std::string CanonicalPath(const std::string& path) {
+  char* canonical_path = realpath(path.c_str(), nullptr);
+  if (canonical_path == nullptr) {
+    return path;
+  }
+  const std::string result(canonical_path);
+  free(canonical_path);
+  return result;
+}
+
+// Returns the hash of the RGBA8 texels of an image.
+uint64_t HashRgba8Image(const int width,
+                        const int height,
+                        const unsigned char* rgba) {
+  const int32_t dimensions[] = { width, height };
+  const uint64_t seed = Hash64(dimensions, sizeof(dimensions), 0);
+  return Hash64(rgba, static_cast<size_t>(width) * height * 4, seed);
+}
+
+// Returns the hash of level 0 of an image in the layout of its upload. The
+// formats are part of the hash, so the texels of a gray image never match the
+// texels of an RGBA8 image with the same bytes.
+uint64_t HashUploadedImage(const int width,
+                           const int height,
+                           const TextureUploadFormat& upload_format,
+                           const unsigned char* texels) {
+  const uint32_t fields[] = {
+    upload_format.internal_format,
+    upload_format.format,
+    upload_format.type,
+    static_cast<uint32_t>(width),
+    static_cast<uint32_t>(height)
+  };
+  const uint64_t seed = Hash64(fields, sizeof(fields), 0);
+  return Hash64(texels,
+                upload_format.texel_size_in_bytes() * width * height, seed);
+}
+
+// Returns the hash of the format and the levels of the cooked texture.
+uint64_t HashCookedTexture(const CookedTexture& cooked) {
+  const uint32_t fields[] = {
+    cooked.internal_format(),
+    static_cast<uint32_t>(cooked.width()),
+    static_cast<uint32_t>(cooked.height()),
+    static_cast<uint32_t>(cooked.num_levels())
+  };
+  uint64_t hash = Hash64(fields, sizeof(fields), 0);
+  for (int i = 0; i < cooked.num_levels(); ++i) {
+    hash = Hash64(cooked.level_data(i), cooked.level(i).size_in_bytes, hash);
+  }
+  return hash;
+}
+
+}  // namespace
+
+SharedTexture::~SharedTexture() {
+  glDeleteTextures(1, &texture_id_);
+}
+
+TextureRegistry::TextureRegistry(const Options& options) :
+    options_(options),
+    staging_buffer_pool_(options.max_pooled_staging_bytes),
+    next_prune_size_(kMinPruneSize) {}
+
+SharedTextureHandle TextureRegistry::Load(
+    const std::string& texture_filepath) {
+  ++statistics_.num_loads;
+  // Equivalent paths (e.g., a.png and ./a.png) share the entry.
+  const std::string canonical_path = CanonicalPath(texture_filepath);
+  const auto path_entry = textures_by_path_.find(canonical_path);
+  if (path_entry != textures_by_path_.end()) {
+    SharedTextureHandle texture = path_entry->second.lock();
+    if (texture) {
+      ++statistics_.num_path_hits;
+      statistics_.num_saved_bytes += texture->size_in_bytes();
+      return texture;
+    }
+  }
+  const SharedTextureHandle texture = options_.gpu_mipmaps ?
+      LoadWithGpuMipmaps(texture_filepath) : LoadCooked(texture_filepath);
+  if (!texture) {
+    LOG(ERROR) << "Could not load the texture " << texture_filepath;
+    return nullptr;
+  }
+  textures_by_path_[canonical_path] = texture;
+  if (textures_by_path_.size() >= next_prune_size_) {
+    PruneExpiredEntries();
+    next_prune_size_ = 2 * textures_by_path_.size() + kMinPruneSize;
+  }
+  return texture;
+}
+
+SharedTextureHandle TextureRegistry::FindByContent(
+    const uint64_t content_hash) const {
+  const auto content_entry = textures_by_content_.find(content_hash);
+  return content_entry != textures_by_content_.end() ?
+      content_entry->second.lock() : SharedTextureHandle();
+}
+
+SharedTextureHandle TextureRegistry::LoadCooked(
+    const std::string& texture_filepath) {
+  CookedTexture cooked;
+  uint64_t content_hash;
+  SharedTextureHandle texture;
+  if (options_.texture_cache != nullptr) {
+    if (!options_.texture_cache->FindOrCook(texture_filepath,
+                                            options_.cooking_options,
+                                            &staging_buffer_pool_, &cooked)) {
+      return nullptr;
+    }
+    content_hash = HashCookedTexture(cooked);
+    texture = FindByContent(content_hash);
+  } else {
+    ImageReader image_reader;
+    if (!image_reader.Open(texture_filepath)) {
+      return nullptr;
+    }
+    const int width = image_reader.width();
+    const int height = image_reader.height();
+    StagingBuffer buffer = staging_buffer_pool_.Acquire(
+        Rgba8MipChainSizeInBytes(width, height, options_.cooking_options));
+    if (!image_reader.ReadRgba8(buffer.data())) {
+      staging_buffer_pool_.Release(std::move(buffer));
+      return nullptr;
+    }
+    // Duplicates are found before the mip chain and the compression.
+    content_hash = HashRgba8Image(width, height, buffer.data());
+    texture = FindByContent(content_hash);
+    if (texture) {
+      staging_buffer_pool_.Release(std::move(buffer));
+    } else {
+      CookDecodedTexture(texture_filepath, width, height,
+                         options_.cooking_options, std::move(buffer),
+                         &staging_buffer_pool_, &cooked);
+    }
+  }
+  if (texture) {
+    ++statistics_.num_content_hits;
+    statistics_.num_saved_bytes += texture->size_in_bytes();
+  } else {
+    size_t size_in_bytes = 0;
+    for (int i = 0; i < cooked.num_levels(); ++i) {
+      size_in_bytes += cooked.level(i).size_in_bytes;
+    }
+    const GLuint texture_id = UploadCookedTexture(
+        cooked, 0, options_.mutable_storage, options_.texture_uploader);
+    texture = std::make_shared<const SharedTexture>(texture_id, content_hash,
+                                                    size_in_bytes);
+    textures_by_content_[content_hash] = texture;
+  }
+  staging_buffer_pool_.Release(cooked.Release());
+  return texture;
+}
+
+SharedTextureHandle TextureRegistry::LoadWithGpuMipmaps(
+    const std::string& texture_filepath) {
+  ImageReader image_reader;
+  if (!image_reader.Open(texture_filepath)) {
+    return nullptr;
+  }
+  const int width = image_reader.width();
+  const int height = image_reader.height();
+  // The texels are uploaded in the layout of the file (e.g., gray or 16-bit)
+  // unless the driver would convert them; then they are expanded to RGBA8 by
+  // the decoder.
+  const TextureUploadFormat upload_format = NegotiateTextureUploadFormat(
+      image_reader.native_num_channels(),
+      image_reader.native_bytes_per_channel());
+  const bool read_native =
+      upload_format.num_channels == image_reader.native_num_channels() &&
+      upload_format.bytes_per_channel ==
+      image_reader.native_bytes_per_channel();
+  const size_t row_size_in_bytes =
+      upload_format.texel_size_in_bytes() * static_cast<size_t>(width);
+  const size_t size_in_bytes = row_size_in_bytes * height;
+  // The texels are hashed before the upload, so they are decoded into host
+  // memory rather than into a write-only pixel buffer object.
+  StagingBuffer buffer = staging_buffer_pool_.Acquire(size_in_bytes);
+  if (!(read_native ? image_reader.ReadNative(buffer.data()) :
+        image_reader.ReadRgba8(buffer.data()))) {
+    staging_buffer_pool_.Release(std::move(buffer));
+    return nullptr;
+  }
+  const uint64_t content_hash =
+      HashUploadedImage(width, height, upload_format, buffer.data());
+  SharedTextureHandle texture = FindByContent(content_hash);
+  if (texture) {
+    ++statistics_.num_content_hits;
+    statistics_.num_saved_bytes += texture->size_in_bytes();
+    staging_buffer_pool_.Release(std::move(buffer));
+    return texture;
+  }
+  GLuint texture_id;
+  glGenTextures(1, &texture_id);
+  glBindTexture(GL_TEXTURE_2D, texture_id);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  const int num_levels = ComputeNumMipLevels(width, height);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                  ComputeMinFilter(num_levels));
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  AllocateTextureStorage(GL_TEXTURE_2D, num_levels, upload_format, width,
+                         height);
+  SetTextureSwizzle(GL_TEXTURE_2D, upload_format);
+  // The rows are tightly packed, so odd-width gray or RGB rows are not
+  // multiples of the default unpack alignment (4).
+  glPixelStorei(GL_UNPACK_ALIGNMENT, ComputeUnpackAlignment(row_size_in_bytes));
+  if (options_.texture_uploader != nullptr) {
+    options_.texture_uploader->Upload(GL_TEXTURE_2D, 0, 0, 0, width, height,
+                                      upload_format.format,
+                                      upload_format.type, row_size_in_bytes,
+                                      buffer.data());
+  } else {
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height,
+                    upload_format.format, upload_format.type, buffer.data());
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  staging_buffer_pool_.Release(std::move(buffer));
+  glGenerateMipmap(GL_TEXTURE_2D);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  // The mip chain adds a third of level 0.
+  texture = std::make_shared<const SharedTexture>(texture_id, content_hash,
+                                                  size_in_bytes * 4 / 3);
+  textures_by_content_[content_hash] = texture;
+  return texture;
+}
+
+int TextureRegistry::num_live_textures() const {
+  int num_live_textures = 0;
+  for (const auto& content_entry : textures_by_content_) {
+    if (!content_entry.second.expired()) {
+      ++num_live_textures;
+    }
+  }
+  return num_live_textures;
+}
+
+void TextureRegistry::PruneExpiredEntries() {
+  for (auto it = textures_by_path_.begin(); it != textures_by_path_.end();) {
+    it = it->second.expired() ? textures_by_path_.erase(it) : std::next(it);
+  }
+  for (auto it = textures_by_content_.begin();
+       it != textures_by_content_.end();) {
+    it = it->second.expired() ? textures_by_content_.erase(it) : std::next(it);
+  }
+}
+
+}  // namespace wvu
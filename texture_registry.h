@@ -0,0 +1,182 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_TEXTURE_REGISTRY_H_
+#define GLUTILS_TEXTURE_REGISTRY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <GL/glew.h>
+
+#include "staging_buffer_pool.h"
+#include "texture_cache.h"
+#include "texture_cooker.h"
+#include "texture_uploader.h"
+
+namespace wvu {
+// A texture shared by every handle loaded from the same file or from files
+// with the same texels. The texture is deleted when the last handle goes away,
+// so the handles must be released on the thread that owns the OpenGL context.
+class SharedTexture {
+ public:
+  SharedTexture(const GLuint texture_id,
+                const uint64_t content_hash,
+                const size_t size_in_bytes) :
+      texture_id_(texture_id),
+      content_hash_(content_hash),
+      size_in_bytes_(size_in_bytes) {}
+  // Deletes the texture.
+  ~SharedTexture();
+
+  // Not copyable: the texture belongs to a single object.
+  SharedTexture(const SharedTexture&) = delete;
+  SharedTexture& operator=(const SharedTexture&) = delete;
+
+  GLuint texture_id() const { return texture_id_; }
+  // Hash of the texels of the texture.
+  uint64_t content_hash() const { return content_hash_; }
+  // Number of bytes of all the levels of the texture.
+  size_t size_in_bytes() const { return size_in_bytes_; }
+
+ private:
+  const GLuint texture_id_;
+  const uint64_t content_hash_;
+  const size_t size_in_bytes_;
+};
+
+// Reference-counted handle of a shared texture. It is null if the texture
+// could not be loaded.
+typedef std::shared_ptr<const SharedTexture> SharedTextureHandle;
+
+// This class loads every texture once. The textures are found by the
+// canonical path of their files and by a hash (XXH64) of their texels, so a
+// file that is loaded again, or a copy of it, returns a handle of the texture
+// already on the GPU instead of creating a new one. Without a cache, the hash
+// covers the decoded RGBA8 texels and is computed before the mip chain and the
+// compression, so duplicates skip most of the cooking. With a cache of cooked
+// textures, the hash covers the cooked levels, which are equal for equal
+// texels and cooking options. When the GPU generates the mip chains, the hash
+// covers level 0 in the layout of its upload (e.g., gray or 16-bit texels).
+// The registry does not own the textures: they live while a handle refers to
+// them. All the member functions must be called from the thread that owns the
+// OpenGL context.
+//
+// Example:
+//
+// wvu::TextureRegistry texture_registry(wvu::TextureRegistry::Options());
+// const wvu::SharedTextureHandle a = texture_registry.Load("a.png");
+// const wvu::SharedTextureHandle b = texture_registry.Load("copy_of_a.png");
+// // a->texture_id() == b->texture_id().
+class TextureRegistry {
+ public:
+  // Configuration of the registry.
+  struct Options {
+    // Maximum number of bytes of decoding memory kept for reuse.
+    size_t max_pooled_staging_bytes = 256 << 20;
+    // Uploader that transfers the texels through PBOs. It is not owned by the
+    // registry and must outlive it. If null, the texels are transferred from
+    // client memory.
+    TextureUploader* texture_uploader = nullptr;
+    // Cache of cooked textures. It is not owned by the registry and must
+    // outlive it. If null, the textures are cooked every time they are loaded.
+    TextureCache* texture_cache = nullptr;
+    // How the textures are cooked.
+    TextureCookingOptions cooking_options;
+    // If true, the cooked textures are allocated with mutable storage, so that
+    // a TextureHotReloader can reallocate them when their files change their
+    // dimensions or format.
+    bool mutable_storage = false;
+    // If true, only level 0 is decoded, in the layout of the file when the
+    // driver does not convert it, and the mip chain is generated by the GPU
+    // (glGenerateMipmap). The cache and the cooking options are not used.
+    bool gpu_mipmaps = false;
+  };
+
+  // Counters of the registry.
+  struct Statistics {
+    // Number of calls to Load().
+    size_t num_loads = 0;
+    // Number of loads resolved by the path, without reading the file.
+    size_t num_path_hits = 0;
+    // Number of loads of a different file with the texels of a live texture.
+    size_t num_content_hits = 0;
+    // Number of bytes of GPU memory that the hits did not allocate.
+    size_t num_saved_bytes = 0;
+  };
+
+  explicit TextureRegistry(const Options& options);
+
+  // Returns the handle of the texture of the image, loading it if no live
+  // texture has the same path or texels.
+  // Parameters:
+  //   texture_filepath  The filepath of the image to use as texture.
+  SharedTextureHandle Load(const std::string& texture_filepath);
+
+  // Number of textures that are still referenced by a handle.
+  int num_live_textures() const;
+
+  const Statistics& statistics() const { return statistics_; }
+
+ private:
+  // Returns the live texture with the hash, or null if there is none.
+  SharedTextureHandle FindByContent(const uint64_t content_hash) const;
+
+  // Returns the texture with the cooked levels of the image, or null if the
+  // image cannot be read.
+  SharedTextureHandle LoadCooked(const std::string& texture_filepath);
+
+  // Returns the texture with level 0 of the image and a mip chain generated by
+  // the GPU, or null if the image cannot be read.
+  SharedTextureHandle LoadWithGpuMipmaps(const std::string& texture_filepath);
+
+  // Removes the entries of the textures without handles.
+  void PruneExpiredEntries();
+
+  const Options options_;
+  StagingBufferPool staging_buffer_pool_;
+  std::unordered_map<std::string, std::weak_ptr<const SharedTexture>>
+      textures_by_path_;
+  std::unordered_map<uint64_t, std::weak_ptr<const SharedTexture>>
+      textures_by_content_;
+  // Number of entries by path that triggers the next pruning.
+  size_t next_prune_size_;
+  Statistics statistics_;
+};
+
+}  // namespace wvu
+
+#endif  // GLUTILS_TEXTURE_REGISTRY_H_
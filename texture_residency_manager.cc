@@ -0,0 +1,387 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "texture_residency_manager.h"
+
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <GL/glew.h>
+
+#include <glog/logging.h>
+
+#include "texture_format.h"
+
+namespace wvu {
+
+TextureResidencyManager::TextureResidencyManager(const Options& options) :
+    options_(options),
+    staging_buffer_pool_(options.max_pooled_staging_bytes),
+    copy_image_supported_(GLEW_VERSION_4_3 || GLEW_ARB_copy_image),
+    frame_(0),
+    resident_bytes_(0),
+    peak_resident_bytes_(0),
+    num_dropped_levels_(0),
+    num_evictions_(0),
+    num_restores_(0),
+    num_pending_restores_(0),
+    over_budget_warned_(false),
+    stop_(false) {
+  const int num_restore_threads = std::max(1, options_.num_restore_threads);
+  for (int i = 0; i < num_restore_threads; ++i) {
+    workers_.emplace_back(&TextureResidencyManager::RestoreLoop, this);
+  }
+}
+
+TextureResidencyManager::~TextureResidencyManager() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  restore_condition_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+  for (const TextureEntry& texture : textures_) {
+    if (texture.texture_id != 0) {
+      glDeleteTextures(1, &texture.texture_id);
+    }
+  }
+}
+
+TextureHandle TextureResidencyManager::Add(
+    const std::string& texture_filepath) {
+  const TextureHandle handle = textures_.size();
+  textures_.emplace_back();
+  TextureEntry& texture = textures_.back();
+  texture.texture_filepath = texture_filepath;
+  CookedTexture cooked;
+  if (!LoadCookedTexture(texture_filepath, &cooked)) {
+    texture.failed = true;
+    return handle;
+  }
+  MakeResident(&cooked, &texture);
+  EnforceBudget(handle);
+  return handle;
+}
+
+void TextureResidencyManager::Remove(const TextureHandle handle) {
+  TextureEntry& texture = textures_[handle];
+  if (texture.texture_id != 0) {
+    glDeleteTextures(1, &texture.texture_id);
+    texture.texture_id = 0;
+    resident_bytes_ -= LevelsSizeInBytes(texture, texture.num_dropped_levels);
+  }
+  texture.levels.clear();
+  texture.removed = true;
+}
+
+void TextureResidencyManager::BeginFrame() {
+  // The textures bound in the frame that ends are still protected from the
+  // budget while the restores are uploaded.
+  ProcessRestores();
+  ++frame_;
+}
+
+GLuint TextureResidencyManager::Bind(const TextureHandle handle) {
+  TextureEntry& texture = textures_[handle];
+  if (texture.failed || texture.removed) {
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return 0;
+  }
+  texture.last_bound_frame = frame_;
+  if ((texture.texture_id == 0 || texture.num_dropped_levels > 0) &&
+      !texture.restore_pending) {
+    texture.restore_pending = true;
+    ++num_pending_restores_;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      RestoreRequest request;
+      request.handle = handle;
+      request.texture_filepath = texture.texture_filepath;
+      restore_queue_.push_back(request);
+    }
+    restore_condition_.notify_one();
+  }
+  glBindTexture(GL_TEXTURE_2D, texture.texture_id);
+  return texture.texture_id;
+}
+
+GLuint TextureResidencyManager::texture_id(const TextureHandle handle) const {
+  return textures_[handle].texture_id;
+}
+
+TextureResidencyManager::TextureResidency TextureResidencyManager::residency(
+    const TextureHandle handle) const {
+  const TextureEntry& texture = textures_[handle];
+  TextureResidency residency;
+  residency.resident = texture.texture_id != 0;
+  residency.num_levels = static_cast<int>(texture.levels.size());
+  residency.num_dropped_levels = texture.num_dropped_levels;
+  residency.resident_bytes = residency.resident ?
+      LevelsSizeInBytes(texture, texture.num_dropped_levels) : 0;
+  residency.size_in_bytes = LevelsSizeInBytes(texture, 0);
+  return residency;
+}
+
+TextureResidencyManager::Statistics
+TextureResidencyManager::statistics() const {
+  Statistics statistics;
+  statistics.budget_bytes = options_.budget_bytes;
+  statistics.resident_bytes = resident_bytes_;
+  statistics.peak_resident_bytes = peak_resident_bytes_;
+  for (const TextureEntry& texture : textures_) {
+    if (texture.removed) {
+      continue;
+    }
+    ++statistics.num_textures;
+    statistics.total_bytes += LevelsSizeInBytes(texture, 0);
+    if (texture.texture_id != 0) {
+      ++statistics.num_resident_textures;
+      if (texture.num_dropped_levels > 0) {
+        ++statistics.num_degraded_textures;
+      }
+    }
+  }
+  statistics.num_dropped_levels = num_dropped_levels_;
+  statistics.num_evictions = num_evictions_;
+  statistics.num_restores = num_restores_;
+  statistics.num_pending_restores = num_pending_restores_;
+  return statistics;
+}
+
+size_t TextureResidencyManager::LevelsSizeInBytes(const TextureEntry& entry,
+                                                  const int first_level) {
+  size_t size_in_bytes = 0;
+  for (int level = first_level; level < static_cast<int>(entry.levels.size());
+       ++level) {
+    size_in_bytes += entry.levels[level].size_in_bytes;
+  }
+  return size_in_bytes;
+}
+
+bool TextureResidencyManager::LoadCookedTexture(
+    const std::string& texture_filepath, CookedTexture* cooked) {
+  const bool success = options_.texture_cache != nullptr ?
+      options_.texture_cache->FindOrCook(texture_filepath,
+                                         options_.cooking_options,
+                                         &staging_buffer_pool_, cooked) :
+      CookTexture(texture_filepath, options_.cooking_options,
+                  &staging_buffer_pool_, cooked);
+  if (!success) {
+    LOG(ERROR) << "Could not load the texture " << texture_filepath;
+  }
+  return success;
+}
+
+void TextureResidencyManager::MakeResident(CookedTexture* cooked,
+                                           TextureEntry* entry) {
+  if (entry->texture_id != 0) {
+    glDeleteTextures(1, &entry->texture_id);
+    resident_bytes_ -= LevelsSizeInBytes(*entry, entry->num_dropped_levels);
+  }
+  entry->internal_format = cooked->internal_format();
+  entry->format = cooked->format();
+  entry->type = cooked->type();
+  entry->levels.clear();
+  for (int level = 0; level < cooked->num_levels(); ++level) {
+    entry->levels.push_back(cooked->level(level));
+  }
+  entry->num_dropped_levels = 0;
+  entry->texture_id =
+      UploadCookedTexture(*cooked, 0, false, options_.texture_uploader);
+  staging_buffer_pool_.Release(cooked->Release());
+  resident_bytes_ += LevelsSizeInBytes(*entry, 0);
+  peak_resident_bytes_ = std::max(peak_resident_bytes_, resident_bytes_);
+}
+
+void TextureResidencyManager::RestoreLoop() {
+  while (true) {
+    RestoreRequest request;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      restore_condition_.wait(lock, [this]() {
+        return stop_ || !restore_queue_.empty();
+      });
+      if (stop_) {
+        return;
+      }
+      request = restore_queue_.front();
+      restore_queue_.pop_front();
+    }
+    // Load outside of the lock: this is where the cache is read or the
+    // texture is cooked again.
+    RestoredTexture restored;
+    restored.handle = request.handle;
+    restored.success =
+        LoadCookedTexture(request.texture_filepath, &restored.cooked);
+    std::lock_guard<std::mutex> lock(mutex_);
+    restored_queue_.push_back(std::move(restored));
+  }
+}
+
+void TextureResidencyManager::ProcessRestores() {
+  size_t num_uploaded_bytes = 0;
+  bool first = true;
+  while (first || num_uploaded_bytes < options_.restore_budget_bytes) {
+    RestoredTexture restored;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (restored_queue_.empty()) {
+        return;
+      }
+      restored = std::move(restored_queue_.front());
+      restored_queue_.pop_front();
+    }
+    first = false;
+    TextureEntry& texture = textures_[restored.handle];
+    texture.restore_pending = false;
+    --num_pending_restores_;
+    if (texture.removed) {
+      if (restored.success) {
+        staging_buffer_pool_.Release(restored.cooked.Release());
+      }
+      continue;
+    }
+    if (!restored.success) {
+      texture.failed = true;
+      continue;
+    }
+    MakeResident(&restored.cooked, &texture);
+    num_uploaded_bytes += LevelsSizeInBytes(texture, 0);
+    ++num_restores_;
+    EnforceBudget(restored.handle);
+  }
+}
+
+void TextureResidencyManager::DropTopLevel(TextureEntry* entry) {
+  const int first_level = entry->num_dropped_levels + 1;
+  const int num_levels = static_cast<int>(entry->levels.size());
+  GLuint texture_id;
+  if (copy_image_supported_) {
+    // The remaining levels are already on the GPU; copy them into a smaller
+    // texture instead of transferring them again.
+    glGenTextures(1, &texture_id);
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                    ComputeMinFilter(num_levels - first_level));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+                    num_levels - first_level - 1);
+    AllocateCookedTextureStorage(entry->internal_format, entry->format,
+                                 entry->type, entry->levels, first_level);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    for (int level = first_level; level < num_levels; ++level) {
+      const CookedTexture::Level& level_info = entry->levels[level];
+      glCopyImageSubData(entry->texture_id, GL_TEXTURE_2D,
+                         level - entry->num_dropped_levels, 0, 0, 0,
+                         texture_id, GL_TEXTURE_2D, level - first_level,
+                         0, 0, 0, level_info.width, level_info.height, 1);
+    }
+  } else {
+    CookedTexture cooked;
+    if (!LoadCookedTexture(entry->texture_filepath, &cooked) ||
+        cooked.num_levels() != num_levels) {
+      // The source changed or disappeared; free the memory anyway.
+      Evict(entry);
+      return;
+    }
+    texture_id = UploadCookedTexture(cooked, first_level, false,
+                                     options_.texture_uploader);
+    staging_buffer_pool_.Release(cooked.Release());
+  }
+  glDeleteTextures(1, &entry->texture_id);
+  entry->texture_id = texture_id;
+  resident_bytes_ -= entry->levels[entry->num_dropped_levels].size_in_bytes;
+  entry->num_dropped_levels = first_level;
+  ++num_dropped_levels_;
+}
+
+void TextureResidencyManager::Evict(TextureEntry* entry) {
+  glDeleteTextures(1, &entry->texture_id);
+  entry->texture_id = 0;
+  resident_bytes_ -= LevelsSizeInBytes(*entry, entry->num_dropped_levels);
+  entry->num_dropped_levels = 0;
+  ++num_evictions_;
+}
+
+void TextureResidencyManager::EnforceBudget(
+    const TextureHandle protected_handle) {
+  while (resident_bytes_ > options_.budget_bytes) {
+    // Find the least recently bound texture that can drop a level, and the
+    // least recently bound texture overall. A linear scan is enough for the
+    // number of textures of a scene.
+    TextureEntry* drop_candidate = nullptr;
+    TextureEntry* evict_candidate = nullptr;
+    for (int i = 0; i < static_cast<int>(textures_.size()); ++i) {
+      TextureEntry& texture = textures_[i];
+      if (texture.texture_id == 0 || i == protected_handle ||
+          texture.last_bound_frame == frame_) {
+        continue;
+      }
+      if (evict_candidate == nullptr ||
+          texture.last_bound_frame < evict_candidate->last_bound_frame) {
+        evict_candidate = &texture;
+      }
+      const int num_resident_levels =
+          static_cast<int>(texture.levels.size()) - texture.num_dropped_levels;
+      if (texture.num_dropped_levels < options_.max_dropped_levels &&
+          num_resident_levels > 1 &&
+          (drop_candidate == nullptr ||
+           texture.last_bound_frame < drop_candidate->last_bound_frame)) {
+        drop_candidate = &texture;
+      }
+    }
+    if (drop_candidate != nullptr) {
+      DropTopLevel(drop_candidate);
+    } else if (evict_candidate != nullptr) {
+      Evict(evict_candidate);
+    } else {
+      // Everything left is in use; the budget is exceeded until the textures
+      // are bound less.
+      if (!over_budget_warned_) {
+        LOG(WARNING) << "The textures in use need " << resident_bytes_
+                     << " bytes, which exceeds the budget of "
+                     << options_.budget_bytes << " bytes.";
+        over_budget_warned_ = true;
+      }
+      break;
+    }
+  }
+}
+
+}  // namespace wvu
@@ -0,0 +1,275 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_TEXTURE_RESIDENCY_MANAGER_H_
+#define GLUTILS_TEXTURE_RESIDENCY_MANAGER_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <GL/glew.h>
+
+#include "async_texture_loader.h"
+#include "staging_buffer_pool.h"
+#include "texture_cache.h"
+#include "texture_cooker.h"
+#include "texture_uploader.h"
+
+namespace wvu {
+// This class keeps the textures within a budget of GPU memory. It accounts the
+// bytes of every mip level of every texture and, when the resident textures
+// exceed the budget, it frees memory from the textures that were bound least
+// recently (LRU). Cold textures degrade gracefully: their top (largest) mip
+// levels are dropped first, which frees about three quarters of a texture per
+// level, and they are only evicted once they cannot drop more levels. The
+// textures bound in the current frame are never degraded nor evicted.
+// Binding a degraded or evicted texture requests its complete mip chain from
+// a worker thread, which maps it from the cache of cooked textures or cooks
+// it again. Meanwhile, a degraded texture is drawn with its remaining levels
+// and an evicted one resolves to texture id zero. The restored textures are
+// uploaded by BeginFrame() within a budget of bytes per frame.
+// Dropping a level copies the remaining levels into a smaller texture on the
+// GPU (glCopyImageSubData()) when the driver supports it, so the texture id of
+// a handle changes over time; use the id returned by Bind() or texture_id().
+// All the member functions must be called from the thread that owns the
+// OpenGL context.
+//
+// Example:
+//
+// wvu::TextureResidencyManager::Options options;
+// options.budget_bytes = 256 << 20;
+// wvu::TextureResidencyManager texture_manager(options);
+// const wvu::TextureHandle handle = texture_manager.Add("/path/to/image.png");
+// while (...) {  // Rendering loop.
+//   texture_manager.BeginFrame();
+//   texture_manager.Bind(handle);
+//   ...
+// }
+class TextureResidencyManager {
+ public:
+  // Configuration of the manager.
+  struct Options {
+    // Maximum number of bytes of the resident textures.
+    size_t budget_bytes = 256 << 20;
+    // Maximum number of top levels dropped from a texture before it is
+    // evicted. The smallest level of a texture is never dropped.
+    int max_dropped_levels = 2;
+    // Maximum number of bytes of decoding memory kept for reuse.
+    size_t max_pooled_staging_bytes = 256 << 20;
+    // Number of threads that load the textures to restore.
+    int num_restore_threads = 1;
+    // Maximum number of bytes of restored textures uploaded per call to
+    // BeginFrame(). At least one texture is uploaded per call.
+    size_t restore_budget_bytes = 16 << 20;
+    // Uploader that transfers the texels through PBOs. It is not owned by the
+    // manager and must outlive it. If null, the texels are transferred from
+    // client memory.
+    TextureUploader* texture_uploader = nullptr;
+    // Cache of cooked textures. It is not owned by the manager and must
+    // outlive it. If null, the textures are cooked every time they are loaded.
+    TextureCache* texture_cache = nullptr;
+    // How the textures are cooked.
+    TextureCookingOptions cooking_options;
+  };
+
+  // Residency of a texture.
+  struct TextureResidency {
+    // True if the texture is in GPU memory.
+    bool resident = false;
+    // Number of levels of the complete mip chain.
+    int num_levels = 0;
+    // Number of top levels dropped; level 0 of the texture is this level of
+    // the complete mip chain.
+    int num_dropped_levels = 0;
+    // Number of bytes in GPU memory.
+    size_t resident_bytes = 0;
+    // Number of bytes of the complete mip chain.
+    size_t size_in_bytes = 0;
+  };
+
+  // Residency statistics.
+  struct Statistics {
+    size_t budget_bytes = 0;
+    // Number of bytes of the resident textures.
+    size_t resident_bytes = 0;
+    // Maximum number of resident bytes, including the moments in which a
+    // texture was loaded before the budget was enforced.
+    size_t peak_resident_bytes = 0;
+    // Number of bytes of the complete mip chains of all the textures.
+    size_t total_bytes = 0;
+    int num_textures = 0;
+    int num_resident_textures = 0;
+    // Number of resident textures with dropped levels.
+    int num_degraded_textures = 0;
+    // Number of levels dropped, textures evicted and textures restored since
+    // the manager was created.
+    size_t num_dropped_levels = 0;
+    size_t num_evictions = 0;
+    size_t num_restores = 0;
+    // Number of textures being restored.
+    int num_pending_restores = 0;
+  };
+
+  // Starts the restore threads.
+  explicit TextureResidencyManager(const Options& options);
+  // Stops the restore threads and deletes the textures.
+  ~TextureResidencyManager();
+
+  // Loads the texture with its complete mip chain and returns its handle. The
+  // handle is valid even if the texture could not be loaded; it then resolves
+  // to texture id zero.
+  // Parameters:
+  //   texture_filepath  The filepath of the image to use as texture.
+  TextureHandle Add(const std::string& texture_filepath);
+
+  // Deletes the texture of the handle. The handle must not be used again.
+  void Remove(const TextureHandle handle);
+
+  // Uploads the restored textures within the restore budget, then starts a
+  // new frame. The textures bound in the previous frames can be degraded or
+  // evicted again.
+  void BeginFrame();
+
+  // Binds the texture to GL_TEXTURE_2D and marks it as used in the current
+  // frame. The restore of a degraded or evicted texture is requested, and
+  // the texture is bound as it is until the restore is uploaded. Returns the
+  // texture id, or zero if the texture is evicted or could not be loaded.
+  GLuint Bind(const TextureHandle handle);
+
+  // Returns the texture id of the handle, which is zero while the texture is
+  // evicted.
+  GLuint texture_id(const TextureHandle handle) const;
+
+  // Returns the residency of the texture.
+  TextureResidency residency(const TextureHandle handle) const;
+
+  // Returns the current statistics.
+  Statistics statistics() const;
+
+ private:
+  // Bookkeeping of a texture.
+  struct TextureEntry {
+    std::string texture_filepath;
+    // Format of the levels and their sizes, as cooked.
+    GLenum internal_format = 0;
+    GLenum format = 0;
+    GLenum type = 0;
+    std::vector<CookedTexture::Level> levels;
+    // Zero while the texture is evicted.
+    GLuint texture_id = 0;
+    int num_dropped_levels = 0;
+    // The frame in which the texture was bound last, or -1.
+    int64_t last_bound_frame = -1;
+    // True while the restore threads load the texture.
+    bool restore_pending = false;
+    bool failed = false;
+    bool removed = false;
+  };
+
+  // A texture to restore.
+  struct RestoreRequest {
+    TextureHandle handle;
+    std::string texture_filepath;
+  };
+
+  // A texture loaded by the restore threads.
+  struct RestoredTexture {
+    TextureHandle handle;
+    bool success;
+    CookedTexture cooked;
+  };
+
+  // Returns the number of bytes of the levels of the texture from first_level
+  // on.
+  static size_t LevelsSizeInBytes(const TextureEntry& entry,
+                                  const int first_level);
+
+  // Loads the cooked texture. Returns true if successful, and false
+  // otherwise. The function is thread-safe.
+  bool LoadCookedTexture(const std::string& texture_filepath,
+                         CookedTexture* cooked);
+
+  // Uploads the complete mip chain of the texture, replacing its current
+  // texture, and releases the texels of the cooked texture.
+  void MakeResident(CookedTexture* cooked, TextureEntry* entry);
+
+  // Loop executed by the restore threads.
+  void RestoreLoop();
+
+  // Uploads the restored textures until the restore budget is spent.
+  void ProcessRestores();
+
+  // Replaces the texture with one without its top level.
+  void DropTopLevel(TextureEntry* entry);
+
+  // Deletes the texture.
+  void Evict(TextureEntry* entry);
+
+  // Drops levels and evicts textures, least recently bound first, until the
+  // resident textures fit in the budget or only the textures bound in the
+  // current frame and the protected texture are left.
+  void EnforceBudget(const TextureHandle protected_handle);
+
+  const Options options_;
+  StagingBufferPool staging_buffer_pool_;
+  // True if the driver copies between textures (GL_ARB_copy_image).
+  const bool copy_image_supported_;
+  std::vector<TextureEntry> textures_;
+  int64_t frame_;
+  size_t resident_bytes_;
+  size_t peak_resident_bytes_;
+  size_t num_dropped_levels_;
+  size_t num_evictions_;
+  size_t num_restores_;
+  int num_pending_restores_;
+  bool over_budget_warned_;
+
+  // The members below are shared with the restore threads and guarded by
+  // mutex_.
+  std::mutex mutex_;
+  std::condition_variable restore_condition_;
+  std::deque<RestoreRequest> restore_queue_;
+  std::deque<RestoredTexture> restored_queue_;
+  bool stop_;
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace wvu
+
+#endif  // GLUTILS_TEXTURE_RESIDENCY_MANAGER_H_
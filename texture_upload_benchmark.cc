@@ -0,0 +1,288 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+
+// Benchmark of the cost of uploading textures in every source layout (gray,
+// gray-alpha, RGB and RGBA with 8-bit or 16-bit channels). For every layout
+// it reports the formats chosen by NegotiateTextureUploadFormat(), whether
+// the driver still converts the texels (according to GL_TEXTURE_IMAGE_FORMAT
+// and GL_TEXTURE_IMAGE_TYPE), and the time to allocate and fill a texture
+// with mutable (glTexImage2D) and immutable (glTexStorage2D) storage.
+//
+// Example:
+//   ./bin/texture_upload_benchmark --width=2049 --height=2048
+//
+// The default width is odd so that the rows of the gray and RGB layouts are
+// not multiples of the default unpack alignment.
+
+// Use the right namespace for google flags (gflags).
+#ifdef GFLAGS_NAMESPACE_GOOGLE
+#define GLUTILS_GFLAGS_NAMESPACE google
+#else
+#define GLUTILS_GFLAGS_NAMESPACE gflags
+#endif
+
+// Include second C++-Headers.
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Include library headers.
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+// Include system headers.
+#include "texture_format.h"
+
+DEFINE_int32(width, 2049, "Width of the uploaded textures.");
+DEFINE_int32(height, 2048, "Height of the uploaded textures.");
+DEFINE_int32(num_iterations, 10,
+             "Number of times each measurement is repeated.");
+
+// Annonymous namespace for constants and helper functions.
+namespace {
+// Width of the columns of the reported table.
+constexpr int kColumnWidth = 14;
+
+// A source layout of the benchmark.
+struct UploadCase {
+  const char* name;
+  int num_channels;
+  int bytes_per_channel;
+  // If false, the texels are uploaded in their layout even when the driver
+  // converts them.
+  bool negotiate;
+};
+
+// Returns the name of the formats and types reported by the benchmark.
+std::string FormatName(const GLenum value) {
+  switch (value) {
+    case GL_RED: return "RED";
+    case GL_RG: return "RG";
+    case GL_RGB: return "RGB";
+    case GL_RGBA: return "RGBA";
+    case GL_BGRA: return "BGRA";
+    case GL_R8: return "R8";
+    case GL_RG8: return "RG8";
+    case GL_RGB8: return "RGB8";
+    case GL_RGBA8: return "RGBA8";
+    case GL_R16: return "R16";
+    case GL_RG16: return "RG16";
+    case GL_RGB16: return "RGB16";
+    case GL_RGBA16: return "RGBA16";
+    case GL_UNSIGNED_BYTE: return "UBYTE";
+    case GL_UNSIGNED_SHORT: return "USHORT";
+    case GL_UNSIGNED_INT_8_8_8_8_REV: return "UINT_8888_REV";
+    case GL_FLOAT: return "FLOAT";
+    case 0: return "n/a";
+    default: {
+      std::stringstream stream;
+      stream << "0x" << std::hex << value;
+      return stream.str();
+    }
+  }
+}
+
+// Returns the time in milliseconds elapsed since start.
+double ElapsedMilliseconds(
+    const std::chrono::steady_clock::time_point& start) {
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// Measures the average time in milliseconds to create a texture, allocate its
+// level 0 and transfer the texels. glFinish() waits for the driver to consume
+// the texels, including any conversion.
+double MeasureUpload(const wvu::TextureUploadFormat& upload_format,
+                     const bool immutable,
+                     const std::vector<unsigned char>& texels) {
+  const size_t row_size_in_bytes =
+      upload_format.texel_size_in_bytes() * FLAGS_width;
+  glPixelStorei(GL_UNPACK_ALIGNMENT,
+                wvu::ComputeUnpackAlignment(row_size_in_bytes));
+  double total_milliseconds = 0.0;
+  for (int i = 0; i < FLAGS_num_iterations; ++i) {
+    const std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    GLuint texture_id;
+    glGenTextures(1, &texture_id);
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    if (immutable) {
+      wvu::AllocateTextureStorage(GL_TEXTURE_2D, 1, upload_format,
+                                  FLAGS_width, FLAGS_height);
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, FLAGS_width, FLAGS_height,
+                      upload_format.format, upload_format.type,
+                      texels.data());
+    } else {
+      glTexImage2D(GL_TEXTURE_2D, 0, upload_format.internal_format,
+                   FLAGS_width, FLAGS_height, 0, upload_format.format,
+                   upload_format.type, texels.data());
+    }
+    glFinish();
+    total_milliseconds += ElapsedMilliseconds(start);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDeleteTextures(1, &texture_id);
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  const GLenum error = glGetError();
+  if (error != GL_NO_ERROR) {
+    LOG(ERROR) << "OpenGL error 0x" << std::hex << error << " uploading "
+               << FormatName(upload_format.internal_format);
+    return -1.0;
+  }
+  return total_milliseconds / FLAGS_num_iterations;
+}
+
+// Prints a measurement or n/a when it is not available (negative).
+std::string FormatValue(const double value) {
+  if (value < 0.0) {
+    return "n/a";
+  }
+  std::stringstream stream;
+  stream << std::fixed << std::setprecision(3) << value;
+  return stream.str();
+}
+
+void RunUploadBenchmark() {
+  static const UploadCase kUploadCases[] = {
+    { "gray8", 1, 1, true },
+    { "gray_alpha8", 2, 1, true },
+    { "rgb8", 3, 1, false },
+    { "rgb8->rgba8", 3, 1, true },
+    { "rgba8", 4, 1, true },
+    { "gray16", 1, 2, true },
+    { "gray_alpha16", 2, 2, true },
+    { "rgb16", 3, 2, true },
+    { "rgba16", 4, 2, true }
+  };
+  std::cout << "Upload of a " << FLAGS_width << "x" << FLAGS_height
+            << " texture (ms), " << FLAGS_num_iterations << " iterations.\n";
+  std::cout << std::left << std::setw(kColumnWidth) << "source"
+            << std::setw(kColumnWidth) << "internal"
+            << std::setw(kColumnWidth) << "upload"
+            << std::setw(kColumnWidth) << "driver"
+            << std::setw(kColumnWidth) << "mutable ms"
+            << std::setw(kColumnWidth) << "storage ms"
+            << "MB/s\n";
+  std::mt19937 random_engine(7);
+  for (const UploadCase& upload_case : kUploadCases) {
+    wvu::TextureUploadFormat upload_format =
+        wvu::NegotiateTextureUploadFormat(upload_case.num_channels,
+                                          upload_case.bytes_per_channel);
+    if (!upload_case.negotiate &&
+        upload_format.num_channels != upload_case.num_channels) {
+      upload_format.internal_format = GL_RGB8;
+      upload_format.format = GL_RGB;
+      upload_format.num_channels = upload_case.num_channels;
+      wvu::QueryPreferredUploadFormat(upload_format.internal_format,
+                                      &upload_format.preferred_format,
+                                      &upload_format.preferred_type);
+    }
+    // The texels are random so that the driver cannot take shortcuts.
+    std::vector<unsigned char> texels(upload_format.texel_size_in_bytes() *
+                                      FLAGS_width * FLAGS_height);
+    for (unsigned char& texel : texels) {
+      texel = static_cast<unsigned char>(random_engine());
+    }
+    const double mutable_milliseconds =
+        MeasureUpload(upload_format, false, texels);
+    const double immutable_milliseconds =
+        MeasureUpload(upload_format, true, texels);
+    const double megabytes_per_second = immutable_milliseconds > 0.0 ?
+        texels.size() / (1024.0 * 1024.0) / (immutable_milliseconds / 1000.0) :
+        -1.0;
+    const std::string upload = FormatName(upload_format.format) + "/" +
+        FormatName(upload_format.type);
+    const std::string driver = upload_format.driver_converts() ?
+        FormatName(upload_format.preferred_format) + "/" +
+        FormatName(upload_format.preferred_type) : "same";
+    std::cout << std::left << std::setw(kColumnWidth) << upload_case.name
+              << std::setw(kColumnWidth)
+              << FormatName(upload_format.internal_format)
+              << std::setw(kColumnWidth) << upload
+              << std::setw(kColumnWidth) << driver
+              << std::setw(kColumnWidth) << FormatValue(mutable_milliseconds)
+              << std::setw(kColumnWidth)
+              << FormatValue(immutable_milliseconds)
+              << FormatValue(megabytes_per_second) << "\n";
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  GLUTILS_GFLAGS_NAMESPACE::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  if (FLAGS_width <= 0 || FLAGS_height <= 0 || FLAGS_num_iterations <= 0) {
+    std::cerr << "ERROR: Provide a positive --width, --height and "
+              << "--num_iterations.\n";
+    return -1;
+  }
+  // The uploads need an OpenGL context, which comes with an invisible window.
+  if (!glfwInit()) {
+    return -1;
+  }
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+  glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+  GLFWwindow* window = glfwCreateWindow(64, 64, "texture_upload_benchmark",
+                                        nullptr, nullptr);
+  if (!window) {
+    glfwTerminate();
+    return -1;
+  }
+  glfwMakeContextCurrent(window);
+  glewExperimental = GL_TRUE;
+  if (glewInit() != GLEW_OK) {
+    std::cerr << "ERROR: GLEW did not initialize properly.\n";
+    glfwTerminate();
+    return -1;
+  }
+  // glewInit() may leave an error behind in core profiles.
+  glGetError();
+  RunUploadBenchmark();
+  glfwDestroyWindow(window);
+  glfwTerminate();
+  return 0;
+}
@@ -0,0 +1,389 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "texture_uploader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <GL/glew.h>
+
+#include <glog/logging.h>
+
+#include "texture_format.h"
+
+namespace wvu {
+namespace {
+// Maximum time to wait for a fence per call to glClientWaitSync in ns.
+constexpr GLuint64 kFenceTimeoutNs = 100000000;
+
+// Returns the seconds elapsed since start.
+double SecondsSince(const std::chrono::steady_clock::time_point& start) {
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+TextureUploader::TextureUploader(const Options& options) :
+    options_(options),
+    slots_(std::max(1, options.num_slots)),
+    next_slot_(0),
+    persistently_mapped_(GLEW_ARB_buffer_storage != 0),
+    slot_mapped_(false),
+    mapped_num_bytes_(0) {
+  // Persistent and coherent mappings let the CPU write into the PBOs while
+  // the GPU reads other PBOs, without mapping and unmapping every time. The
+  // fences guarantee that the CPU does not overwrite texels being read.
+  constexpr GLbitfield kPersistentFlags =
+      GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  for (Slot& slot : slots_) {
+    glGenBuffers(1, &slot.buffer_id);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer_id);
+    slot.fence = nullptr;
+    slot.persistent_pointer = nullptr;
+    if (persistently_mapped_) {
+      glBufferStorage(GL_PIXEL_UNPACK_BUFFER, options_.slot_size_in_bytes,
+                      nullptr, kPersistentFlags);
+      slot.persistent_pointer =
+          glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0,
+                           options_.slot_size_in_bytes, kPersistentFlags);
+    } else {
+      glBufferData(GL_PIXEL_UNPACK_BUFFER, options_.slot_size_in_bytes,
+                   nullptr, GL_STREAM_DRAW);
+    }
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+TextureUploader::~TextureUploader() {
+  for (Slot& slot : slots_) {
+    if (slot.fence != nullptr) {
+      glDeleteSync(slot.fence);
+    }
+    if (slot.persistent_pointer != nullptr) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer_id);
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+    glDeleteBuffers(1, &slot.buffer_id);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void TextureUploader::Upload(const GLenum target,
+                             const GLint level,
+                             const GLint x,
+                             const GLint y,
+                             const GLsizei width,
+                             const GLsizei height,
+                             const GLenum format,
+                             const GLenum type,
+                             const size_t row_size_in_bytes,
+                             const void* pixels) {
+  UploadRows(target, level, x, y, width, height, format, type, 1,
+             row_size_in_bytes, pixels);
+}
+
+void TextureUploader::UploadCompressed(const GLenum target,
+                                       const GLint level,
+                                       const GLint x,
+                                       const GLint y,
+                                       const GLsizei width,
+                                       const GLsizei height,
+                                       const GLenum internal_format,
+                                       const int block_height,
+                                       const size_t block_row_size_in_bytes,
+                                       const void* blocks) {
+  UploadRows(target, level, x, y, width, height, internal_format, 0,
+             block_height, block_row_size_in_bytes, blocks);
+}
+
+void TextureUploader::UploadRows(const GLenum target,
+                                 const GLint level,
+                                 const GLint x,
+                                 const GLint y,
+                                 const GLsizei width,
+                                 const GLsizei height,
+                                 const GLenum format,
+                                 const GLenum type,
+                                 const int row_height,
+                                 const size_t row_size_in_bytes,
+                                 const void* rows) {
+  const auto start = std::chrono::steady_clock::now();
+  const unsigned char* row_bytes = static_cast<const unsigned char*>(rows);
+  const int num_rows = (height + row_height - 1) / row_height;
+  if (row_size_in_bytes > options_.slot_size_in_bytes) {
+    // A single row does not fit in a PBO; transfer from client memory.
+    LOG(WARNING) << "Rows of " << row_size_in_bytes << " bytes do not fit in "
+                 << "the PBOs of " << options_.slot_size_in_bytes << " bytes.";
+    if (type == 0) {
+      glCompressedTexSubImage2D(target, level, x, y, width, height, format,
+                                num_rows * row_size_in_bytes, row_bytes);
+    } else {
+      glTexSubImage2D(target, level, x, y, width, height, format, type,
+                      row_bytes);
+    }
+  } else {
+    const int rows_per_slot =
+        static_cast<int>(options_.slot_size_in_bytes / row_size_in_bytes);
+    for (int row = 0; row < num_rows; row += rows_per_slot) {
+      const int num_band_rows = std::min(rows_per_slot, num_rows - row);
+      const size_t num_bytes = num_band_rows * row_size_in_bytes;
+      void* slot_pointer = AcquireSlot(num_bytes);
+      memcpy(slot_pointer, row_bytes + row * row_size_in_bytes, num_bytes);
+      // The last band of blocks may cover fewer texel rows than its blocks.
+      const int band_y = row * row_height;
+      const int band_height =
+          std::min(num_band_rows * row_height, height - band_y);
+      ReleaseSlot(target, level, x, y + band_y, width, band_height, format,
+                  type, num_bytes);
+    }
+  }
+  statistics_.upload_seconds += SecondsSince(start);
+}
+
+void* TextureUploader::MapSlot(const size_t num_bytes) {
+  CHECK(!slot_mapped_) << "A PBO is already mapped.";
+  if (num_bytes > options_.slot_size_in_bytes) {
+    return nullptr;
+  }
+  const auto start = std::chrono::steady_clock::now();
+  void* slot_pointer = AcquireSlot(num_bytes);
+  slot_mapped_ = true;
+  mapped_num_bytes_ = num_bytes;
+  statistics_.upload_seconds += SecondsSince(start);
+  return slot_pointer;
+}
+
+void TextureUploader::UploadMappedSlot(const GLenum target,
+                                       const GLint level,
+                                       const GLint x,
+                                       const GLint y,
+                                       const GLsizei width,
+                                       const GLsizei height,
+                                       const GLenum format,
+                                       const GLenum type) {
+  CHECK(slot_mapped_) << "No PBO is mapped.";
+  const auto start = std::chrono::steady_clock::now();
+  slot_mapped_ = false;
+  ReleaseSlot(target, level, x, y, width, height, format, type,
+              mapped_num_bytes_);
+  statistics_.upload_seconds += SecondsSince(start);
+}
+
+void TextureUploader::DiscardMappedSlot() {
+  CHECK(slot_mapped_) << "No PBO is mapped.";
+  slot_mapped_ = false;
+  if (!persistently_mapped_) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slots_[next_slot_].buffer_id);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  }
+}
+
+void* TextureUploader::AcquireSlot(const size_t num_bytes) {
+  Slot& slot = slots_[next_slot_];
+  if (slot.fence != nullptr) {
+    // Poll the fence first: a signaled fence is not a stall.
+    GLenum status = glClientWaitSync(slot.fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED) {
+      const auto start = std::chrono::steady_clock::now();
+      ++statistics_.num_stalls;
+      do {
+        status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                  kFenceTimeoutNs);
+      } while (status == GL_TIMEOUT_EXPIRED);
+      statistics_.stall_seconds += SecondsSince(start);
+    }
+    if (status == GL_WAIT_FAILED) {
+      LOG(ERROR) << "Could not wait for the fence of a PBO.";
+      glFinish();
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+  }
+  if (persistently_mapped_) {
+    return slot.persistent_pointer;
+  }
+  // The fence already guarantees that the GPU is done with the PBO, so the
+  // driver does not need to synchronize the mapping.
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer_id);
+  void* slot_pointer = glMapBufferRange(
+      GL_PIXEL_UNPACK_BUFFER, 0, num_bytes,
+      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT |
+      GL_MAP_UNSYNCHRONIZED_BIT);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  return slot_pointer;
+}
+
+void TextureUploader::ReleaseSlot(const GLenum target,
+                                  const GLint level,
+                                  const GLint x,
+                                  const GLint y,
+                                  const GLsizei width,
+                                  const GLsizei height,
+                                  const GLenum format,
+                                  const GLenum type,
+                                  const size_t num_bytes) {
+  Slot& slot = slots_[next_slot_];
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer_id);
+  if (!persistently_mapped_) {
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+  }
+  // With a PBO bound, the last argument is an offset into the PBO.
+  if (type == 0) {
+    glCompressedTexSubImage2D(target, level, x, y, width, height, format,
+                              num_bytes, nullptr);
+  } else {
+    glTexSubImage2D(target, level, x, y, width, height, format, type, nullptr);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  next_slot_ = (next_slot_ + 1) % static_cast<int>(slots_.size());
+  ++statistics_.num_transfers;
+  statistics_.num_transferred_bytes += num_bytes;
+}
+
+void AllocateCookedTextureStorage(
+    const GLenum internal_format,
+    const GLenum format,
+    const GLenum type,
+    const std::vector<CookedTexture::Level>& levels,
+    const int first_level) {
+  const int num_levels = static_cast<int>(levels.size()) - first_level;
+  if (GLEW_VERSION_4_2 || GLEW_ARB_texture_storage) {
+    glTexStorage2D(GL_TEXTURE_2D, num_levels, internal_format,
+                   levels[first_level].width, levels[first_level].height);
+    return;
+  }
+  for (int level = 0; level < num_levels; ++level) {
+    const CookedTexture::Level& level_info = levels[first_level + level];
+    if (format == 0) {
+      glCompressedTexImage2D(GL_TEXTURE_2D, level, internal_format,
+                             level_info.width, level_info.height, 0,
+                             level_info.size_in_bytes, nullptr);
+    } else {
+      glTexImage2D(GL_TEXTURE_2D, level, internal_format, level_info.width,
+                   level_info.height, 0, format, type, nullptr);
+    }
+  }
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, num_levels - 1);
+}
+
+GLuint UploadCookedTexture(const CookedTexture& cooked,
+                           const int first_level,
+                           const bool mutable_storage,
+                           TextureUploader* texture_uploader) {
+  GLuint texture_id;
+  glGenTextures(1, &texture_id);
+  glBindTexture(GL_TEXTURE_2D, texture_id);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  // Mutable storage is allocated while the texels are transferred below.
+  if (!mutable_storage) {
+    AllocateCookedTextureStorage(cooked.internal_format(), cooked.format(),
+                                 cooked.type(), cooked.levels(), first_level);
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+  UpdateCookedTexture(cooked, first_level, mutable_storage, texture_id,
+                      texture_uploader);
+  return texture_id;
+}
+
+void UpdateCookedTexture(const CookedTexture& cooked,
+                         const int first_level,
+                         const bool reallocate,
+                         const GLuint texture_id,
+                         TextureUploader* texture_uploader) {
+  glBindTexture(GL_TEXTURE_2D, texture_id);
+  // The mip chain is precomputed, so there is no need for glGenerateMipmap.
+  // The filter follows the number of levels, which a reload may change.
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                  ComputeMinFilter(cooked.num_levels() - first_level));
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+                  cooked.num_levels() - first_level - 1);
+  for (int level = first_level; level < cooked.num_levels(); ++level) {
+    const CookedTexture::Level& level_info = cooked.level(level);
+    const GLint texture_level = level - first_level;
+    if (cooked.compressed()) {
+      // The blocks are sent as they are; the GPU samples them directly.
+      const int num_block_rows =
+          (level_info.height + cooked.block_height() - 1) /
+          cooked.block_height();
+      const unsigned char* blocks = texture_uploader != nullptr ?
+          nullptr : cooked.level_data(level);
+      if (reallocate) {
+        glCompressedTexImage2D(GL_TEXTURE_2D, texture_level,
+                               cooked.internal_format(), level_info.width,
+                               level_info.height, 0, level_info.size_in_bytes,
+                               blocks);
+      } else if (blocks != nullptr) {
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, texture_level, 0, 0,
+                                  level_info.width, level_info.height,
+                                  cooked.internal_format(),
+                                  level_info.size_in_bytes, blocks);
+      }
+      if (texture_uploader != nullptr) {
+        texture_uploader->UploadCompressed(
+            GL_TEXTURE_2D, texture_level, 0, 0, level_info.width,
+            level_info.height, cooked.internal_format(),
+            cooked.block_height(), level_info.size_in_bytes / num_block_rows,
+            cooked.level_data(level));
+      }
+    } else if (texture_uploader != nullptr) {
+      if (reallocate) {
+        glTexImage2D(GL_TEXTURE_2D, texture_level, cooked.internal_format(),
+                     level_info.width, level_info.height, 0, cooked.format(),
+                     cooked.type(), nullptr);
+      }
+      texture_uploader->Upload(GL_TEXTURE_2D, texture_level, 0, 0,
+                               level_info.width, level_info.height,
+                               cooked.format(), cooked.type(),
+                               level_info.size_in_bytes / level_info.height,
+                               cooked.level_data(level));
+    } else if (reallocate) {
+      glTexImage2D(GL_TEXTURE_2D, texture_level, cooked.internal_format(),
+                   level_info.width, level_info.height, 0, cooked.format(),
+                   cooked.type(), cooked.level_data(level));
+    } else {
+      glTexSubImage2D(GL_TEXTURE_2D, texture_level, 0, 0, level_info.width,
+                      level_info.height, cooked.format(), cooked.type(),
+                      cooked.level_data(level));
+    }
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+}  // namespace wvu
@@ -0,0 +1,281 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_TEXTURE_UPLOADER_H_
+#define GLUTILS_TEXTURE_UPLOADER_H_
+
+#include <cstddef>
+#include <vector>
+#include <GL/glew.h>
+
+#include "texture_cooker.h"
+
+namespace wvu {
+// This class transfers texels to textures through a ring of pixel unpack
+// buffer objects (PBOs). Calling glTexSubImage2D() with a pointer to client
+// memory forces the driver to copy the texels before the call returns. Instead,
+// the uploader copies the texels into the next PBO of the ring and issues
+// glTexSubImage2D() from the PBO, which lets the driver transfer the texels
+// asynchronously. A fence (glFenceSync()) is inserted after every transfer and
+// a PBO is only reused once its fence is signaled (glClientWaitSync()). When
+// the driver supports persistent mapping (GL_ARB_buffer_storage), the PBOs are
+// mapped once at creation.
+// The uploader keeps statistics to help sizing the ring: the throughput in
+// MB/s and the time spent waiting for PBOs (stalls). If the stall time is
+// large, the ring needs more or larger slots.
+// All the member functions must be called from the thread that owns the
+// OpenGL context.
+//
+// Example:
+//
+// wvu::TextureUploader::Options options;
+// wvu::TextureUploader texture_uploader(options);
+// glBindTexture(GL_TEXTURE_2D, texture_id);
+// texture_uploader.Upload(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA,
+//                         GL_UNSIGNED_BYTE, 4 * width, pixels);
+//
+// The texels can also be written directly into a PBO (e.g., by a decoder):
+//
+// void* slot = texture_uploader.MapSlot(4 * width * height);
+// if (slot != nullptr) {
+//   ...  // Write the texels into slot.
+//   texture_uploader.UploadMappedSlot(GL_TEXTURE_2D, 0, 0, 0, width, height,
+//                                     GL_RGBA, GL_UNSIGNED_BYTE);
+// }
+class TextureUploader {
+ public:
+  // Configuration of the ring.
+  struct Options {
+    // Number of PBOs in the ring.
+    int num_slots = 4;
+    // Size of every PBO in bytes.
+    size_t slot_size_in_bytes = 8 << 20;
+  };
+
+  // Transfer statistics.
+  struct Statistics {
+    // Number of calls to glTexSubImage2D() issued.
+    size_t num_transfers = 0;
+    // Number of bytes transferred.
+    size_t num_transferred_bytes = 0;
+    // Time spent in the uploader, including the stalls, in seconds.
+    double upload_seconds = 0.0;
+    // Number of times a PBO was still in use by the GPU when it was needed.
+    size_t num_stalls = 0;
+    // Time spent waiting for PBOs in seconds.
+    double stall_seconds = 0.0;
+
+    // Returns the throughput of the uploader in MB/s.
+    double megabytes_per_second() const {
+      return upload_seconds > 0.0 ?
+          num_transferred_bytes / (1024.0 * 1024.0) / upload_seconds : 0.0;
+    }
+  };
+
+  // Creates the PBOs of the ring.
+  explicit TextureUploader(const Options& options);
+  // Deletes the PBOs of the ring.
+  ~TextureUploader();
+
+  // Transfers a region of the texture bound to target. The rows of pixels are
+  // row_size_in_bytes apart and must follow the current GL_UNPACK_ALIGNMENT.
+  // Regions larger than a PBO are transferred in bands of rows.
+  // Parameters:
+  //   target  The target where the texture is bound (e.g., GL_TEXTURE_2D).
+  //   level  The mipmap level.
+  //   x, y, width, height  The region of the level to update.
+  //   format, type  The format and type of the texels, as in glTexSubImage2D.
+  //   row_size_in_bytes  The size of every row of pixels.
+  //   pixels  The texels of the region.
+  void Upload(const GLenum target,
+              const GLint level,
+              const GLint x,
+              const GLint y,
+              const GLsizei width,
+              const GLsizei height,
+              const GLenum format,
+              const GLenum type,
+              const size_t row_size_in_bytes,
+              const void* pixels);
+
+  // Transfers a region of the compressed texture bound to target. The region
+  // is made of rows of blocks that are block_row_size_in_bytes apart; x and y
+  // must be multiples of the block size. Regions larger than a PBO are
+  // transferred in bands of rows of blocks.
+  // Parameters:
+  //   target  The target where the texture is bound (e.g., GL_TEXTURE_2D).
+  //   level  The mipmap level.
+  //   x, y, width, height  The region of the level to update, in texels.
+  //   internal_format  The compressed format of the texture.
+  //   block_height  The height of the blocks in texels.
+  //   block_row_size_in_bytes  The size of every row of blocks.
+  //   blocks  The blocks of the region.
+  void UploadCompressed(const GLenum target,
+                        const GLint level,
+                        const GLint x,
+                        const GLint y,
+                        const GLsizei width,
+                        const GLsizei height,
+                        const GLenum internal_format,
+                        const int block_height,
+                        const size_t block_row_size_in_bytes,
+                        const void* blocks);
+
+  // Maps the next PBO of the ring so that the caller writes the texels
+  // directly into it. Returns nullptr if num_bytes does not fit in a PBO.
+  // The caller must call UploadMappedSlot() or DiscardMappedSlot() afterwards.
+  void* MapSlot(const size_t num_bytes);
+
+  // Transfers the texels written into the mapped PBO to the region of the
+  // texture bound to target. The parameters follow Upload().
+  void UploadMappedSlot(const GLenum target,
+                        const GLint level,
+                        const GLint x,
+                        const GLint y,
+                        const GLsizei width,
+                        const GLsizei height,
+                        const GLenum format,
+                        const GLenum type);
+
+  // Releases the mapped PBO without transferring it.
+  void DiscardMappedSlot();
+
+  // Accessors.
+  size_t slot_size_in_bytes() const { return options_.slot_size_in_bytes; }
+  bool persistently_mapped() const { return persistently_mapped_; }
+  const Statistics& statistics() const { return statistics_; }
+
+  // Resets the statistics.
+  void ResetStatistics() { statistics_ = Statistics(); }
+
+ private:
+  // A PBO of the ring.
+  struct Slot {
+    GLuint buffer_id;
+    // Fence of the last transfer that read from the PBO.
+    GLsync fence;
+    // Pointer to the PBO when it is persistently mapped.
+    void* persistent_pointer;
+  };
+
+  // Transfers the region in bands of rows that fit in the PBOs. A row is a row
+  // of texels, or a row of blocks for compressed formats (type is zero).
+  void UploadRows(const GLenum target,
+                  const GLint level,
+                  const GLint x,
+                  const GLint y,
+                  const GLsizei width,
+                  const GLsizei height,
+                  const GLenum format,
+                  const GLenum type,
+                  const int row_height,
+                  const size_t row_size_in_bytes,
+                  const void* rows);
+  // Waits until the GPU stops reading the next PBO and maps it.
+  void* AcquireSlot(const size_t num_bytes);
+  // Issues the transfer from the mapped PBO and moves to the next PBO. The
+  // transfer is compressed if type is zero; format is then the internal
+  // format.
+  void ReleaseSlot(const GLenum target,
+                   const GLint level,
+                   const GLint x,
+                   const GLint y,
+                   const GLsizei width,
+                   const GLsizei height,
+                   const GLenum format,
+                   const GLenum type,
+                   const size_t num_bytes);
+
+  const Options options_;
+  std::vector<Slot> slots_;
+  int next_slot_;
+  bool persistently_mapped_;
+  bool slot_mapped_;
+  size_t mapped_num_bytes_;
+  Statistics statistics_;
+};
+
+// Allocates the levels of the texture bound to GL_TEXTURE_2D for the cooked
+// levels from first_level on; first_level becomes level 0 of the texture. As
+// in AllocateTextureStorage(), the storage is immutable (glTexStorage2D) when
+// the driver supports it, and compressed formats are allocated too.
+// Parameters:
+//   internal_format, format, type  The formats of the cooked levels, as in
+//     CookedTexture; the format and type of compressed formats are zero.
+//   levels  The cooked levels.
+//   first_level  The first cooked level to allocate.
+void AllocateCookedTextureStorage(
+    const GLenum internal_format,
+    const GLenum format,
+    const GLenum type,
+    const std::vector<CookedTexture::Level>& levels,
+    const int first_level);
+
+// Creates a texture with the levels of the cooked texture from first_level on;
+// first_level becomes level 0 of the texture. Returns the texture id.
+// Parameters:
+//   cooked  The cooked texture.
+//   first_level  The first level of the cooked texture to upload.
+//   mutable_storage  If true, the levels are allocated with glTexImage2D() so
+//     that UpdateCookedTexture() can reallocate them, e.g., for the textures
+//     of a TextureHotReloader. Otherwise, the storage is immutable when the
+//     driver supports it.
+//   texture_uploader  The uploader that transfers the texels through PBOs. If
+//     null, the texels are transferred from client memory.
+GLuint UploadCookedTexture(const CookedTexture& cooked,
+                           const int first_level,
+                           const bool mutable_storage,
+                           TextureUploader* texture_uploader);
+
+// Replaces the levels of a texture with the levels of the cooked texture from
+// first_level on. Without reallocation the texels are replaced in place with
+// glTexSubImage2D(), which requires the texture to have the dimensions and
+// the internal format of the cooked levels.
+// Parameters:
+//   cooked  The cooked texture.
+//   first_level  The first level of the cooked texture to upload.
+//   reallocate  If true, the storage of the levels is allocated again, e.g.,
+//     because the dimensions or the format changed.
+//   texture_id  The texture to update.
+//   texture_uploader  The uploader that transfers the texels through PBOs. If
+//     null, the texels are transferred from client memory.
+void UpdateCookedTexture(const CookedTexture& cooked,
+                         const int first_level,
+                         const bool reallocate,
+                         const GLuint texture_id,
+                         TextureUploader* texture_uploader);
+
+}  // namespace wvu
+
+#endif  // GLUTILS_TEXTURE_UPLOADER_H_
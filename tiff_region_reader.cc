@@ -0,0 +1,356 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "tiff_region_reader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+
+#ifdef cimg_use_tiff
+#include <tiffio.h>
+#endif
+
+#include <glog/logging.h>
+
+namespace wvu {
+namespace {
+// Returns the key of a block in the cache.
+uint64_t BlockKey(const int level, const int block_x, const int block_y) {
+  return (static_cast<uint64_t>(level) << 48) |
+      (static_cast<uint64_t>(block_y) << 24) |
+      static_cast<uint64_t>(block_x);
+}
+
+}  // namespace
+
+TiffRegionReader::TiffRegionReader(const Options& options) :
+    options_(options),
+    tiff_(nullptr),
+    current_directory_offset_(0),
+    cached_bytes_(0) {}
+
+TiffRegionReader::~TiffRegionReader() {
+  Close();
+}
+
+bool TiffRegionReader::Open(const std::string& image_filepath) {
+  Close();
+#ifdef cimg_use_tiff
+  tiff_ = TIFFOpen(image_filepath.c_str(), "r");
+  if (tiff_ == nullptr) {
+    LOG(ERROR) << "Could not open " << image_filepath;
+    return false;
+  }
+  AddCurrentDirectory();
+  if (levels_.empty()) {
+    Close();
+    return false;
+  }
+  // Lower resolutions are either SubIFDs of the first directory or
+  // reduced-resolution directories after it.
+  std::vector<uint64_t> directory_offsets;
+  uint16_t num_sub_directories = 0;
+  uint64_t* sub_directory_offsets = nullptr;
+  if (TIFFGetField(tiff_, TIFFTAG_SUBIFD, &num_sub_directories,
+                   &sub_directory_offsets)) {
+    directory_offsets.assign(sub_directory_offsets,
+                             sub_directory_offsets + num_sub_directories);
+  }
+  while (TIFFReadDirectory(tiff_)) {
+    uint32_t subfile_type = 0;
+    TIFFGetField(tiff_, TIFFTAG_SUBFILETYPE, &subfile_type);
+    if ((subfile_type & FILETYPE_REDUCEDIMAGE) != 0) {
+      directory_offsets.push_back(TIFFCurrentDirOffset(tiff_));
+    }
+  }
+  for (const uint64_t directory_offset : directory_offsets) {
+    if (TIFFSetSubDirectory(tiff_, directory_offset)) {
+      AddCurrentDirectory();
+    }
+  }
+  current_directory_offset_ = 0;
+  std::stable_sort(levels_.begin(), levels_.end(),
+                   [](const Level& a, const Level& b) {
+    return a.width > b.width;
+  });
+  return true;
+#else
+  LOG(ERROR) << "Could not open " << image_filepath
+             << ": built without libtiff.";
+  return false;
+#endif  // cimg_use_tiff
+}
+
+void TiffRegionReader::Close() {
+#ifdef cimg_use_tiff
+  if (tiff_ != nullptr) {
+    TIFFClose(tiff_);
+  }
+#endif  // cimg_use_tiff
+  tiff_ = nullptr;
+  levels_.clear();
+  current_directory_offset_ = 0;
+  blocks_.clear();
+  block_index_.clear();
+  cached_bytes_ = 0;
+}
+
+int TiffRegionReader::FindLevel(const int min_width) const {
+  for (int level = num_levels() - 1; level > 0; --level) {
+    if (levels_[level].width >= min_width) {
+      return level;
+    }
+  }
+  return 0;
+}
+
+bool TiffRegionReader::ReadRegion(const int level,
+                                  const int x,
+                                  const int y,
+                                  const int width,
+                                  const int height,
+                                  const size_t row_stride,
+                                  unsigned char* pixels) {
+  return ForEachBlock(level, x, y, width, height,
+                      [&](const Block& block,
+                          const int overlap_x,
+                          const int overlap_y,
+                          const int overlap_width,
+                          const int overlap_height) {
+    for (int row = 0; row < overlap_height; ++row) {
+      const unsigned char* source = block.texels.data() + 4 *
+          (static_cast<size_t>(overlap_y - block.y + row) * block.row_length +
+           overlap_x - block.x);
+      unsigned char* destination = pixels +
+          static_cast<size_t>(overlap_y - y + row) * row_stride +
+          4 * static_cast<size_t>(overlap_x - x);
+      std::memcpy(destination, source, 4 * overlap_width);
+    }
+    return true;
+  });
+}
+
+bool TiffRegionReader::UploadRegion(const int level,
+                                    const int x,
+                                    const int y,
+                                    const int width,
+                                    const int height,
+                                    const GLenum target,
+                                    const GLint mip_level,
+                                    const GLint x_offset,
+                                    const GLint y_offset) {
+  // The unpack parameters select the overlap inside the cached block, so the
+  // texels go from the cache to the driver without another copy.
+  const bool uploaded = ForEachBlock(level, x, y, width, height,
+                                     [&](const Block& block,
+                                         const int overlap_x,
+                                         const int overlap_y,
+                                         const int overlap_width,
+                                         const int overlap_height) {
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, block.row_length);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, overlap_x - block.x);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, overlap_y - block.y);
+    glTexSubImage2D(target, mip_level, x_offset + overlap_x - x,
+                    y_offset + overlap_y - y, overlap_width, overlap_height,
+                    GL_RGBA, GL_UNSIGNED_BYTE, block.texels.data());
+    return true;
+  });
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+  glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+  return uploaded;
+}
+
+bool TiffRegionReader::ForEachBlock(const int level,
+                                    const int x,
+                                    const int y,
+                                    const int width,
+                                    const int height,
+                                    const BlockFunction& function) {
+  if (level < 0 || level >= num_levels() || x < 0 || y < 0 || width <= 0 ||
+      height <= 0 || x + width > levels_[level].width ||
+      y + height > levels_[level].height) {
+    LOG(ERROR) << "The region (" << x << ", " << y << ", " << width << ", "
+               << height << ") is not inside level " << level << ".";
+    return false;
+  }
+  const Level& region_level = levels_[level];
+  for (int block_y = y / region_level.block_height;
+       block_y <= (y + height - 1) / region_level.block_height; ++block_y) {
+    for (int block_x = x / region_level.block_width;
+         block_x <= (x + width - 1) / region_level.block_width; ++block_x) {
+      const Block* block = GetBlock(level, block_x, block_y);
+      if (block == nullptr) {
+        return false;
+      }
+      const int overlap_x = std::max(x, block->x);
+      const int overlap_y = std::max(y, block->y);
+      const int overlap_width =
+          std::min(x + width, block->x + block->width) - overlap_x;
+      const int overlap_height =
+          std::min(y + height, block->y + block->height) - overlap_y;
+      if (!function(*block, overlap_x, overlap_y, overlap_width,
+                    overlap_height)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+const TiffRegionReader::Block* TiffRegionReader::GetBlock(const int level,
+                                                          const int block_x,
+                                                          const int block_y) {
+  const uint64_t key = BlockKey(level, block_x, block_y);
+  const auto cached_block = block_index_.find(key);
+  if (cached_block != block_index_.end()) {
+    blocks_.splice(blocks_.begin(), blocks_, cached_block->second);
+    ++statistics_.num_cache_hits;
+    return &blocks_.front();
+  }
+#ifdef cimg_use_tiff
+  const Level& block_level = levels_[level];
+  if (current_directory_offset_ != block_level.directory_offset) {
+    if (!TIFFSetSubDirectory(tiff_, block_level.directory_offset)) {
+      LOG(ERROR) << "Could not read the directory of level " << level << ".";
+      return nullptr;
+    }
+    current_directory_offset_ = block_level.directory_offset;
+  }
+  Block block;
+  block.key = key;
+  block.x = block_x * block_level.block_width;
+  block.y = block_y * block_level.block_height;
+  block.width = std::min(block_level.block_width,
+                         block_level.width - block.x);
+  block.height = std::min(block_level.block_height,
+                          block_level.height - block.y);
+  block.row_length = block_level.block_width;
+  block.texels.resize(4 * static_cast<size_t>(block_level.block_width) *
+                      block_level.block_height);
+  // libtiff packs every texel as A << 24 | B << 16 | G << 8 | R, which is
+  // laid out as R, G, B, A in little-endian memory, and stores the rows
+  // bottom to top: a tile fills all its rows, while the last strip only
+  // fills the rows of the image.
+  uint32_t* raster = reinterpret_cast<uint32_t*>(block.texels.data());
+  int num_flipped_rows;
+  if (block_level.tiled) {
+    if (!TIFFReadRGBATile(tiff_, block.x, block.y, raster)) {
+      LOG(ERROR) << "Could not decode the tile at (" << block.x << ", "
+                 << block.y << ") of level " << level << ".";
+      return nullptr;
+    }
+    num_flipped_rows = block_level.block_height;
+  } else {
+    if (!TIFFReadRGBAStrip(tiff_, block.y, raster)) {
+      LOG(ERROR) << "Could not decode the strip at row " << block.y
+                 << " of level " << level << ".";
+      return nullptr;
+    }
+    num_flipped_rows = block.height;
+  }
+  for (int row = 0; row < num_flipped_rows / 2; ++row) {
+    std::swap_ranges(raster + row * block.row_length,
+                     raster + (row + 1) * block.row_length,
+                     raster + (num_flipped_rows - 1 - row) * block.row_length);
+  }
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  TIFFSwabArrayOfLong(raster, static_cast<tmsize_t>(block.row_length) *
+                      block.height);
+#endif
+  // The rows below the image are not kept.
+  block.texels.resize(4 * static_cast<size_t>(block.row_length) *
+                      block.height);
+  block.texels.shrink_to_fit();
+  ++statistics_.num_decoded_blocks;
+  statistics_.num_decoded_bytes += block.texels.size();
+  cached_bytes_ += block.texels.size();
+  blocks_.push_front(std::move(block));
+  block_index_[key] = blocks_.begin();
+  // The block just decoded is kept even if it exceeds the budget on its own.
+  while (cached_bytes_ > options_.max_cached_bytes && blocks_.size() > 1) {
+    cached_bytes_ -= blocks_.back().texels.size();
+    block_index_.erase(blocks_.back().key);
+    blocks_.pop_back();
+  }
+  return &blocks_.front();
+#else
+  return nullptr;
+#endif  // cimg_use_tiff
+}
+
+void TiffRegionReader::AddCurrentDirectory() {
+#ifdef cimg_use_tiff
+  char message[1024];
+  if (!TIFFRGBAImageOK(tiff_, message)) {
+    LOG(WARNING) << "Skipping a TIFF directory: " << message;
+    return;
+  }
+  Level level;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  TIFFGetField(tiff_, TIFFTAG_IMAGEWIDTH, &width);
+  TIFFGetField(tiff_, TIFFTAG_IMAGELENGTH, &height);
+  level.width = width;
+  level.height = height;
+  level.tiled = TIFFIsTiled(tiff_) != 0;
+  if (level.tiled) {
+    uint32_t tile_width = 0;
+    uint32_t tile_height = 0;
+    TIFFGetField(tiff_, TIFFTAG_TILEWIDTH, &tile_width);
+    TIFFGetField(tiff_, TIFFTAG_TILELENGTH, &tile_height);
+    level.block_width = tile_width;
+    level.block_height = tile_height;
+  } else {
+    // A file without strips is a single strip as tall as the image.
+    uint32_t rows_per_strip = height;
+    TIFFGetFieldDefaulted(tiff_, TIFFTAG_ROWSPERSTRIP, &rows_per_strip);
+    level.block_width = width;
+    level.block_height = std::min(rows_per_strip, height);
+  }
+  level.directory_offset = TIFFCurrentDirOffset(tiff_);
+  if (level.width <= 0 || level.height <= 0 || level.block_width <= 0 ||
+      level.block_height <= 0) {
+    LOG(WARNING) << "Skipping a TIFF directory without valid dimensions.";
+    return;
+  }
+  levels_.push_back(level);
+#endif  // cimg_use_tiff
+}
+
+}  // namespace wvu
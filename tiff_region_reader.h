@@ -0,0 +1,208 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_TIFF_REGION_READER_H_
+#define GLUTILS_TIFF_REGION_READER_H_
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <GL/glew.h>
+
+// Handle of an open TIFF file in libtiff.
+struct tiff;
+
+namespace wvu {
+// This class reads rectangular regions of tiled or stripped TIFF images on
+// demand. Only the tiles (or strips) that overlap a region are decoded, so a
+// region of a gigapixel image costs about as much as the region itself. The
+// decoded tiles are kept in a small LRU cache, since neighboring regions share
+// tiles. Pyramidal TIFFs store lower resolutions of the image in additional
+// directories, either reduced-resolution images after the first directory or
+// SubIFDs of the first directory; every directory is a level of the reader,
+// sorted from the largest to the smallest.
+// The regions can be copied into memory or uploaded with glTexSubImage2D()
+// straight from the cached tiles, without assembling the region first. The
+// texels are RGBA8 with the rows stored top to bottom, like ImageReader.
+// The class is not thread-safe. Without libtiff (cimg_use_tiff), Open() fails.
+//
+// Example:
+//
+// wvu::TiffRegionReader reader(wvu::TiffRegionReader::Options());
+// if (!reader.Open("/path/to/image.tif")) {
+//   ...
+// }
+// const int level = reader.FindLevel(viewport_width);
+// reader.UploadRegion(level, x, y, width, height, GL_TEXTURE_2D, 0, 0, 0);
+class TiffRegionReader {
+ public:
+  // Configuration of the reader.
+  struct Options {
+    // Maximum number of bytes of decoded tiles kept for reuse.
+    size_t max_cached_bytes = 64 << 20;
+  };
+
+  // A resolution of the image: a directory of the TIFF file.
+  struct Level {
+    int width = 0;
+    int height = 0;
+    // Size of the tiles, or the width of the image and the rows of the strips
+    // for stripped directories.
+    int block_width = 0;
+    int block_height = 0;
+    bool tiled = false;
+    // Offset of the directory in the file.
+    uint64_t directory_offset = 0;
+  };
+
+  // Counters of the reader.
+  struct Statistics {
+    size_t num_decoded_blocks = 0;
+    size_t num_decoded_bytes = 0;
+    size_t num_cache_hits = 0;
+  };
+
+  explicit TiffRegionReader(const Options& options);
+  ~TiffRegionReader();
+
+  // Opens the image and reads its directories. Returns true if successful,
+  // and false otherwise.
+  // Parameters:
+  //   image_filepath  The filepath of the TIFF image.
+  bool Open(const std::string& image_filepath);
+
+  // Closes the image and clears the cache.
+  void Close();
+
+  int num_levels() const { return static_cast<int>(levels_.size()); }
+  const Level& level(const int index) const { return levels_[index]; }
+
+  // Returns the smallest level that is at least min_width texels wide, or
+  // level 0 if none is.
+  int FindLevel(const int min_width) const;
+
+  // Copies a region of a level into pixels. The region must be inside the
+  // level. Returns true if successful, and false otherwise.
+  // Parameters:
+  //   level  The level of the region.
+  //   x, y, width, height  The region in texels of the level.
+  //   row_stride  Bytes between the rows of pixels; at least 4 * width.
+  //   pixels  The RGBA8 texels of the region.
+  bool ReadRegion(const int level,
+                  const int x,
+                  const int y,
+                  const int width,
+                  const int height,
+                  const size_t row_stride,
+                  unsigned char* pixels);
+
+  // Uploads a region of a level into the texture bound to the target with
+  // one glTexSubImage2D() per tile. The region must be inside the level.
+  // Returns true if successful, and false otherwise.
+  // Parameters:
+  //   level  The level of the region.
+  //   x, y, width, height  The region in texels of the level.
+  //   target  The texture target, e.g., GL_TEXTURE_2D.
+  //   mip_level  The mip level of the texture.
+  //   x_offset, y_offset  The position of the region in the texture.
+  bool UploadRegion(const int level,
+                    const int x,
+                    const int y,
+                    const int width,
+                    const int height,
+                    const GLenum target,
+                    const GLint mip_level,
+                    const GLint x_offset,
+                    const GLint y_offset);
+
+  const Statistics& statistics() const { return statistics_; }
+
+ private:
+  // A decoded tile or strip.
+  struct Block {
+    uint64_t key;
+    // Texels of the image covered by the block; blocks on the right and
+    // bottom edges are cropped.
+    int x;
+    int y;
+    int width;
+    int height;
+    // RGBA8 texels, top to bottom, with a stride of row_length texels.
+    int row_length;
+    std::vector<unsigned char> texels;
+  };
+
+  // Function called with every block that overlaps a region and the overlap
+  // (x, y, width, height) in texels of the level.
+  typedef std::function<bool(const Block& block,
+                             const int x,
+                             const int y,
+                             const int width,
+                             const int height)> BlockFunction;
+
+  // Calls the function with every block that overlaps the region, decoding
+  // the blocks that are not cached. Returns false if a block cannot be
+  // decoded or the function fails.
+  bool ForEachBlock(const int level,
+                    const int x,
+                    const int y,
+                    const int width,
+                    const int height,
+                    const BlockFunction& function);
+
+  // Returns the decoded block at (block_x, block_y) of the level, or nullptr
+  // if it cannot be decoded. The block stays valid until the next call.
+  const Block* GetBlock(const int level, const int block_x, const int block_y);
+
+  // Adds the directory that libtiff is positioned at to the levels.
+  void AddCurrentDirectory();
+
+  const Options options_;
+  struct tiff* tiff_;
+  std::vector<Level> levels_;
+  // Offset of the directory that libtiff is positioned at.
+  uint64_t current_directory_offset_;
+  // Cached blocks, from the most to the least recently used.
+  std::list<Block> blocks_;
+  std::unordered_map<uint64_t, std::list<Block>::iterator> block_index_;
+  size_t cached_bytes_;
+  Statistics statistics_;
+};
+
+}  // namespace wvu
+
+#endif  // GLUTILS_TIFF_REGION_READER_H_
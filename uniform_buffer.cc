@@ -0,0 +1,372 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "uniform_buffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+
+#include <glog/logging.h>
+
+#include "shader_program.h"
+
+namespace wvu {
+namespace {
+// The std140 rules round the alignment of arrays and matrices, and their
+// strides, up to the alignment of a vec4.
+constexpr size_t kVec4Alignment = 16;
+
+size_t RoundUp(const size_t value, const size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+// Returns the size in bytes of a column of the type; the other types than
+// matrices have a single column.
+size_t ColumnSize(const Std140Type type) {
+  switch (type) {
+    case STD140_INT: return sizeof(GLint);
+    case STD140_FLOAT: return sizeof(GLfloat);
+    case STD140_VEC2: return 2 * sizeof(GLfloat);
+    case STD140_VEC3: return 3 * sizeof(GLfloat);
+    case STD140_VEC4: return 4 * sizeof(GLfloat);
+    case STD140_MAT3: return 3 * sizeof(GLfloat);
+    case STD140_MAT4: return 4 * sizeof(GLfloat);
+  }
+  return 0;
+}
+
+int NumColumns(const Std140Type type) {
+  switch (type) {
+    case STD140_MAT3: return 3;
+    case STD140_MAT4: return 4;
+    default: return 1;
+  }
+}
+
+// Returns the base alignment of the type when it is not in an array.
+size_t BaseAlignment(const Std140Type type) {
+  switch (type) {
+    case STD140_INT:
+    case STD140_FLOAT: return 4;
+    case STD140_VEC2: return 8;
+    default: return kVec4Alignment;
+  }
+}
+
+const char* GlslTypeName(const Std140Type type) {
+  switch (type) {
+    case STD140_INT: return "int";
+    case STD140_FLOAT: return "float";
+    case STD140_VEC2: return "vec2";
+    case STD140_VEC3: return "vec3";
+    case STD140_VEC4: return "vec4";
+    case STD140_MAT3: return "mat3";
+    case STD140_MAT4: return "mat4";
+  }
+  return "";
+}
+
+GLenum GlType(const Std140Type type) {
+  switch (type) {
+    case STD140_INT: return GL_INT;
+    case STD140_FLOAT: return GL_FLOAT;
+    case STD140_VEC2: return GL_FLOAT_VEC2;
+    case STD140_VEC3: return GL_FLOAT_VEC3;
+    case STD140_VEC4: return GL_FLOAT_VEC4;
+    case STD140_MAT3: return GL_FLOAT_MAT3;
+    case STD140_MAT4: return GL_FLOAT_MAT4;
+  }
+  return GL_NONE;
+}
+
+}  // namespace
+
+int UniformBlockLayout::AddMember(const std::string& name,
+                                  const Std140Type type,
+                                  const int array_size) {
+  Member member;
+  member.name = name;
+  member.type = type;
+  member.array_size = std::max(array_size, 1);
+  // The columns of matrices are aligned as vec4s, and so are the elements of
+  // arrays.
+  const int num_columns = NumColumns(type);
+  member.matrix_stride = num_columns > 1 ? kVec4Alignment : 0;
+  const size_t element_size = num_columns > 1 ?
+      num_columns * kVec4Alignment : ColumnSize(type);
+  size_t alignment = BaseAlignment(type);
+  if (array_size > 1) {
+    alignment = kVec4Alignment;
+    member.array_stride = RoundUp(element_size, kVec4Alignment);
+  } else {
+    member.array_stride = element_size;
+  }
+  member.offset = RoundUp(end_offset_, alignment);
+  const size_t member_size = member.array_size > 1 ?
+      member.array_stride * member.array_size : element_size;
+  end_offset_ = member.offset + member_size;
+  // The block is aligned as a vec4, so its size is rounded up like the size of
+  // a structure.
+  size_ = RoundUp(end_offset_, kVec4Alignment);
+  members_.push_back(member);
+  return members_.size() - 1;
+}
+
+int UniformBlockLayout::FindMember(const std::string& name) const {
+  for (int i = 0; i < static_cast<int>(members_.size()); ++i) {
+    if (members_[i].name == name) return i;
+  }
+  return -1;
+}
+
+std::string UniformBlockLayout::GlslDeclaration(
+    const std::string& instance_name) const {
+  std::stringstream declaration;
+  declaration << "layout(std140) uniform " << block_name_ << " {\n";
+  for (const Member& member : members_) {
+    declaration << "  " << GlslTypeName(member.type) << " " << member.name;
+    if (member.array_size > 1) {
+      declaration << "[" << member.array_size << "]";
+    }
+    declaration << ";\n";
+  }
+  declaration << "}";
+  if (!instance_name.empty()) {
+    declaration << " " << instance_name;
+  }
+  declaration << ";\n";
+  return declaration.str();
+}
+
+bool UniformBlockLayout::Matches(const ShaderProgram& program,
+                                 std::string* mismatch) const {
+  std::stringstream difference;
+  const UniformBlockInfo* uniform_block =
+      program.FindUniformBlock(block_name_);
+  if (uniform_block == nullptr) {
+    difference << "The program has no uniform block " << block_name_ << ".";
+  } else if (uniform_block->data_size != static_cast<GLint>(size_)) {
+    difference << "The uniform block " << block_name_ << " has "
+               << uniform_block->data_size << " bytes instead of " << size_
+               << ".";
+  } else {
+    for (const Member& member : members_) {
+      // The members of blocks with an instance name are prefixed by the name
+      // of the block.
+      UniformHandle handle = program.FindUniform(block_name_ + "." +
+                                                 member.name);
+      if (handle == kInvalidUniform) {
+        handle = program.FindUniform(member.name);
+      }
+      // The compiler may remove the members that the shaders do not read.
+      if (handle == kInvalidUniform) continue;
+      const UniformInfo& uniform = program.uniforms()[handle];
+      if (uniform.block_index != static_cast<GLint>(uniform_block->index) ||
+          uniform.type != GlType(member.type) ||
+          uniform.size != member.array_size ||
+          uniform.offset != static_cast<GLint>(member.offset)) {
+        difference << "The member " << member.name << " of the uniform block "
+                   << block_name_ << " is at offset " << uniform.offset
+                   << " instead of " << member.offset
+                   << ", or its type differs.";
+        break;
+      }
+    }
+  }
+  if (difference.str().empty()) return true;
+  if (mismatch) {
+    *mismatch = difference.str();
+  }
+  return false;
+}
+
+UniformBlockLayout CameraBlockLayout() {
+  UniformBlockLayout layout("Camera");
+  layout.AddMember("view", STD140_MAT4);
+  layout.AddMember("projection", STD140_MAT4);
+  layout.AddMember("view_projection", STD140_MAT4);
+  layout.AddMember("position", STD140_VEC4);
+  return layout;
+}
+
+UniformBlockLayout ObjectBlockLayout() {
+  UniformBlockLayout layout("Object");
+  layout.AddMember("model_view_projection", STD140_MAT4);
+  layout.AddMember("model", STD140_MAT4);
+  layout.AddMember("normal_matrix", STD140_MAT3);
+  return layout;
+}
+
+UniformBuffer::UniformBuffer(const UniformBlockLayout& layout) :
+    layout_(layout), data_(layout.size(), 0),
+    buffer_id_(0), binding_(0), dirty_begin_(0), dirty_end_(0),
+    num_uploads_(0) {}
+
+UniformBuffer::~UniformBuffer() {
+  if (buffer_id_ != 0) {
+    glDeleteBuffers(1, &buffer_id_);
+  }
+}
+
+bool UniformBuffer::Create(const GLuint binding) {
+  if (buffer_id_ != 0) return true;
+  GLint max_block_size = 0;
+  glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &max_block_size);
+  if (data_.size() > static_cast<size_t>(max_block_size)) {
+    LOG(ERROR) << "The uniform block " << layout_.block_name() << " has "
+               << data_.size() << " bytes, and the driver supports up to "
+               << max_block_size << ".";
+    return false;
+  }
+  glGenBuffers(1, &buffer_id_);
+  glBindBuffer(GL_UNIFORM_BUFFER, buffer_id_);
+  glBufferData(GL_UNIFORM_BUFFER, data_.size(), data_.data(), GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer_id_);
+  binding_ = binding;
+  dirty_begin_ = dirty_end_ = 0;
+  return true;
+}
+
+void UniformBuffer::CopyElement(const UniformBlockLayout::Member& member,
+                                const int element,
+                                const void* values,
+                                const size_t num_column_bytes,
+                                const int num_columns) {
+  const unsigned char* source = static_cast<const unsigned char*>(values);
+  for (int i = 0; i < num_columns; ++i) {
+    const size_t offset = member.offset + element * member.array_stride +
+        i * member.matrix_stride;
+    if (std::memcmp(&data_[offset], source, num_column_bytes) == 0) {
+      source += num_column_bytes;
+      continue;
+    }
+    std::memcpy(&data_[offset], source, num_column_bytes);
+    source += num_column_bytes;
+    if (dirty_begin_ == dirty_end_) {
+      dirty_begin_ = offset;
+      dirty_end_ = offset + num_column_bytes;
+    } else {
+      dirty_begin_ = std::min(dirty_begin_, offset);
+      dirty_end_ = std::max(dirty_end_, offset + num_column_bytes);
+    }
+  }
+}
+
+bool UniformBuffer::SetInt(const int member, const GLint value) {
+  if (member < 0 || member >= static_cast<int>(layout_.members().size()) ||
+      layout_.members()[member].type != STD140_INT) {
+    return false;
+  }
+  CopyElement(layout_.members()[member], 0, &value, sizeof(value), 1);
+  return true;
+}
+
+bool UniformBuffer::SetFloat(const int member, const GLfloat value) {
+  if (member < 0 || member >= static_cast<int>(layout_.members().size()) ||
+      layout_.members()[member].type != STD140_FLOAT) {
+    return false;
+  }
+  return SetFloatArray(member, 0, 1, &value);
+}
+
+bool UniformBuffer::SetVector(const int member, const GLfloat* values) {
+  if (member < 0 || member >= static_cast<int>(layout_.members().size())) {
+    return false;
+  }
+  const Std140Type type = layout_.members()[member].type;
+  if (type != STD140_VEC2 && type != STD140_VEC3 && type != STD140_VEC4) {
+    return false;
+  }
+  return SetFloatArray(member, 0, 1, values);
+}
+
+bool UniformBuffer::SetMatrix3f(const int member, const GLfloat* values) {
+  if (member < 0 || member >= static_cast<int>(layout_.members().size()) ||
+      layout_.members()[member].type != STD140_MAT3) {
+    return false;
+  }
+  CopyElement(layout_.members()[member], 0, values, ColumnSize(STD140_MAT3),
+              3);
+  return true;
+}
+
+bool UniformBuffer::SetMatrix4f(const int member, const GLfloat* values) {
+  if (member < 0 || member >= static_cast<int>(layout_.members().size()) ||
+      layout_.members()[member].type != STD140_MAT4) {
+    return false;
+  }
+  CopyElement(layout_.members()[member], 0, values, ColumnSize(STD140_MAT4),
+              4);
+  return true;
+}
+
+bool UniformBuffer::SetFloatArray(const int member,
+                                  const int first_element,
+                                  const int count,
+                                  const GLfloat* values) {
+  if (member < 0 || member >= static_cast<int>(layout_.members().size())) {
+    return false;
+  }
+  const UniformBlockLayout::Member& block_member = layout_.members()[member];
+  if (block_member.type == STD140_INT || NumColumns(block_member.type) > 1 ||
+      first_element < 0 || count < 0 ||
+      first_element + count > block_member.array_size) {
+    return false;
+  }
+  const size_t num_element_bytes = ColumnSize(block_member.type);
+  for (int i = 0; i < count; ++i) {
+    CopyElement(block_member, first_element + i,
+                reinterpret_cast<const unsigned char*>(values) +
+                    i * num_element_bytes,
+                num_element_bytes, 1);
+  }
+  return true;
+}
+
+void UniformBuffer::Upload() {
+  if (buffer_id_ == 0 || dirty_begin_ == dirty_end_) return;
+  glBindBuffer(GL_UNIFORM_BUFFER, buffer_id_);
+  glBufferSubData(GL_UNIFORM_BUFFER, dirty_begin_, dirty_end_ - dirty_begin_,
+                  &data_[dirty_begin_]);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  dirty_begin_ = dirty_end_ = 0;
+  ++num_uploads_;
+}
+
+}  // namespace wvu
@@ -0,0 +1,232 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_UNIFORM_BUFFER_H_
+#define GLUTILS_UNIFORM_BUFFER_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+
+#include "shader_program.h"
+
+namespace wvu {
+// Types of the members of a uniform block.
+enum Std140Type {
+  STD140_INT = 0,
+  STD140_FLOAT = 1,
+  STD140_VEC2 = 2,
+  STD140_VEC3 = 3,
+  STD140_VEC4 = 4,
+  STD140_MAT3 = 5,
+  STD140_MAT4 = 6
+};
+
+// Binding points of the uniform blocks that all the programs share.
+constexpr GLuint kCameraBlockBinding = 0;
+constexpr GLuint kObjectBlockBinding = 1;
+
+// This class describes a uniform block and packs it with the std140 rules of
+// the GLSL specification, so the offsets do not depend on the driver and one
+// buffer serves every program that declares the block. The class also
+// generates the GLSL declaration of the block, and checks the block that a
+// program declares against it.
+//
+// Example:
+//
+// wvu::UniformBlockLayout layout("Camera");
+// const int view_member = layout.AddMember("view", wvu::STD140_MAT4);
+// const int position_member = layout.AddMember("position", wvu::STD140_VEC4);
+// // Prints "layout(std140) uniform Camera { mat4 view; vec4 position; }
+// // camera;" with a member per line.
+// std::cout << layout.GlslDeclaration("camera");
+class UniformBlockLayout {
+ public:
+  // A member of the block.
+  struct Member {
+    std::string name;
+    Std140Type type;
+    // Number of elements; 1 for members that are not arrays.
+    int array_size;
+    // Offset of the member in bytes, and the number of bytes between the
+    // elements of arrays and between the columns of matrices.
+    size_t offset;
+    size_t array_stride;
+    size_t matrix_stride;
+  };
+
+  explicit UniformBlockLayout(const std::string& block_name) :
+      block_name_(block_name), end_offset_(0), size_(0) {}
+  ~UniformBlockLayout() {}
+
+  // Appends a member to the block and returns its index.
+  // Parameters:
+  //   name  The name of the member in GLSL.
+  //   type  The type of the member.
+  //   array_size  The number of elements of arrays, or 1.
+  int AddMember(const std::string& name,
+                const Std140Type type,
+                const int array_size = 1);
+
+  // Returns the index of the member, or -1 if the block has no such member.
+  int FindMember(const std::string& name) const;
+
+  // Returns the declaration of the block in GLSL, e.g., to prepend it to the
+  // sources of the shaders. The members are referred to as
+  // instance_name.member in the shaders, or just by their names if
+  // instance_name is empty.
+  std::string GlslDeclaration(const std::string& instance_name) const;
+
+  // Returns true if the program declares the block with the same members at
+  // the same offsets. Otherwise, returns false and describes the first
+  // difference in mismatch.
+  bool Matches(const ShaderProgram& program, std::string* mismatch) const;
+
+  // Accessors.
+  const std::string& block_name() const { return block_name_; }
+  const std::vector<Member>& members() const { return members_; }
+  // Size of the block in bytes, a multiple of 16 bytes.
+  size_t size() const { return size_; }
+
+ private:
+  const std::string block_name_;
+  std::vector<Member> members_;
+  // The offset after the last member, where the next member goes.
+  size_t end_offset_;
+  size_t size_;
+};
+
+// The members of the block of the camera, in the order of the layout.
+enum CameraBlockMember {
+  CAMERA_VIEW = 0,  // mat4 view.
+  CAMERA_PROJECTION = 1,  // mat4 projection.
+  CAMERA_VIEW_PROJECTION = 2,  // mat4 view_projection.
+  CAMERA_POSITION = 3  // vec4 position, in world coordinates.
+};
+
+// The members of the block of the object, in the order of the layout.
+enum ObjectBlockMember {
+  OBJECT_MODEL_VIEW_PROJECTION = 0,  // mat4 model_view_projection.
+  OBJECT_MODEL = 1,  // mat4 model.
+  // mat3 normal_matrix: the inverse transpose of the upper 3x3 of model.
+  OBJECT_NORMAL_MATRIX = 2
+};
+
+// The block "Camera" with the data of the camera, which changes at most once
+// per frame. See CameraBlockMember.
+UniformBlockLayout CameraBlockLayout();
+
+// The block "Object" with the data of the object being drawn. The matrices
+// are combined on the CPU, so the vertex shaders transform every vertex with a
+// single matrix. See ObjectBlockMember.
+UniformBlockLayout ObjectBlockLayout();
+
+// This class holds the data of a uniform block in host memory with the std140
+// packing of its layout, and uploads the bytes that changed to a uniform
+// buffer object. All the member functions, except for the setters, must be
+// called from the thread that owns the OpenGL context.
+//
+// Example:
+//
+// wvu::UniformBuffer camera_buffer(wvu::CameraBlockLayout());
+// camera_buffer.Create(wvu::kCameraBlockBinding);
+// shader_program.BindUniformBlock("Camera", wvu::kCameraBlockBinding);
+// const int view_member = camera_buffer.layout().FindMember("view");
+// while (...) {  // Rendering loop.
+//   camera_buffer.SetMatrix4f(view_member, view.data());
+//   camera_buffer.Upload();
+//   ...  // Draw the objects.
+// }
+class UniformBuffer {
+ public:
+  explicit UniformBuffer(const UniformBlockLayout& layout);
+  // Deletes the buffer object.
+  ~UniformBuffer();
+
+  // Creates the buffer object and binds it to the binding point. Returns true
+  // if successful, and false otherwise.
+  bool Create(const GLuint binding);
+
+  // Setters of the members. The matrices are in column-major order (e.g.,
+  // Eigen's default), and the setters of arrays set count elements starting
+  // at first_element. The setters return false if the member does not exist
+  // or its type does not match.
+  bool SetInt(const int member, const GLint value);
+  bool SetFloat(const int member, const GLfloat value);
+  bool SetVector(const int member, const GLfloat* values);
+  bool SetMatrix3f(const int member, const GLfloat* values);
+  bool SetMatrix4f(const int member, const GLfloat* values);
+  bool SetFloatArray(const int member,
+                     const int first_element,
+                     const int count,
+                     const GLfloat* values);
+
+  // Uploads the bytes that changed since the last upload, if any.
+  void Upload();
+
+  // Accessors.
+  const UniformBlockLayout& layout() const { return layout_; }
+  GLuint buffer_id() const { return buffer_id_; }
+  GLuint binding() const { return binding_; }
+  // The packed data of the block.
+  const std::vector<unsigned char>& data() const { return data_; }
+  // Number of uploads, for the statistics of the application.
+  size_t num_uploads() const { return num_uploads_; }
+
+ private:
+  UniformBuffer(const UniformBuffer&) = delete;
+  UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+  // Copies the columns of the element into the block, and extends the range
+  // of bytes to upload if they changed.
+  void CopyElement(const UniformBlockLayout::Member& member,
+                   const int element,
+                   const void* values,
+                   const size_t num_column_bytes,
+                   const int num_columns);
+
+  const UniformBlockLayout layout_;
+  std::vector<unsigned char> data_;
+  GLuint buffer_id_;
+  GLuint binding_;
+  // The range of bytes that changed since the last upload: [begin, end).
+  size_t dirty_begin_;
+  size_t dirty_end_;
+  size_t num_uploads_;
+};
+
+}  // namespace wvu
+
+#endif  // GLUTILS_UNIFORM_BUFFER_H_
@@ -0,0 +1,157 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+
+#include "uniform_buffer.h"
+
+#include <cstring>
+#include <vector>
+#include <GL/glew.h>
+
+#include <gtest/gtest.h>
+
+namespace wvu {
+namespace {
+
+// Reads the float at the offset of the packed data of the buffer.
+GLfloat FloatAt(const UniformBuffer& buffer, const size_t offset) {
+  GLfloat value;
+  std::memcpy(&value, &buffer.data()[offset], sizeof(value));
+  return value;
+}
+
+TEST(UniformBlockLayoutTest, PacksCameraBlockWithStd140Rules) {
+  const UniformBlockLayout layout = CameraBlockLayout();
+  const std::vector<UniformBlockLayout::Member>& members = layout.members();
+  ASSERT_EQ(members.size(), 4);
+  EXPECT_EQ(members[CAMERA_VIEW].offset, 0);
+  EXPECT_EQ(members[CAMERA_PROJECTION].offset, 64);
+  EXPECT_EQ(members[CAMERA_VIEW_PROJECTION].offset, 128);
+  EXPECT_EQ(members[CAMERA_POSITION].offset, 192);
+  EXPECT_EQ(members[CAMERA_VIEW].matrix_stride, 16);
+  EXPECT_EQ(members[CAMERA_VIEW].array_stride, 64);
+  EXPECT_EQ(members[CAMERA_POSITION].array_stride, 16);
+  EXPECT_EQ(layout.size(), 208);
+}
+
+TEST(UniformBlockLayoutTest, PacksObjectBlockWithStd140Rules) {
+  const UniformBlockLayout layout = ObjectBlockLayout();
+  const std::vector<UniformBlockLayout::Member>& members = layout.members();
+  ASSERT_EQ(members.size(), 3);
+  EXPECT_EQ(members[OBJECT_MODEL_VIEW_PROJECTION].offset, 0);
+  EXPECT_EQ(members[OBJECT_MODEL].offset, 64);
+  EXPECT_EQ(members[OBJECT_NORMAL_MATRIX].offset, 128);
+  // The columns of a mat3 are aligned as vec4s.
+  EXPECT_EQ(members[OBJECT_NORMAL_MATRIX].matrix_stride, 16);
+  EXPECT_EQ(members[OBJECT_NORMAL_MATRIX].array_stride, 48);
+  EXPECT_EQ(layout.size(), 176);
+}
+
+TEST(UniformBlockLayoutTest, AlignsScalarsVectorsAndArrays) {
+  UniformBlockLayout layout("Block");
+  const int scalar = layout.AddMember("scalar", STD140_FLOAT);
+  const int vec3 = layout.AddMember("vec3_member", STD140_VEC3);
+  const int tail = layout.AddMember("tail", STD140_FLOAT);
+  const int vec2 = layout.AddMember("vec2_member", STD140_VEC2);
+  const int array = layout.AddMember("array", STD140_FLOAT, 3);
+  const std::vector<UniformBlockLayout::Member>& members = layout.members();
+  EXPECT_EQ(members[scalar].offset, 0);
+  EXPECT_EQ(members[vec3].offset, 16);
+  // A float fits in the padding after a vec3.
+  EXPECT_EQ(members[tail].offset, 28);
+  EXPECT_EQ(members[vec2].offset, 32);
+  // The elements of arrays are aligned as vec4s.
+  EXPECT_EQ(members[array].offset, 48);
+  EXPECT_EQ(members[array].array_stride, 16);
+  EXPECT_EQ(layout.size(), 96);
+}
+
+TEST(UniformBufferTest, SettersRejectTypeMismatches) {
+  UniformBlockLayout layout("Block");
+  const int int_member = layout.AddMember("int_member", STD140_INT);
+  const int float_member = layout.AddMember("float_member", STD140_FLOAT);
+  const int vec4_member = layout.AddMember("vec4_member", STD140_VEC4);
+  const int mat3_member = layout.AddMember("mat3_member", STD140_MAT3);
+  const int mat4_member = layout.AddMember("mat4_member", STD140_MAT4);
+  UniformBuffer buffer(layout);
+  const GLfloat values[16] = { 0.0f };
+
+  EXPECT_FALSE(buffer.SetFloat(vec4_member, 1.0f));
+  EXPECT_FALSE(buffer.SetFloat(int_member, 1.0f));
+  EXPECT_FALSE(buffer.SetFloat(mat4_member, 1.0f));
+  EXPECT_FALSE(buffer.SetVector(float_member, values));
+  EXPECT_FALSE(buffer.SetVector(int_member, values));
+  EXPECT_FALSE(buffer.SetVector(mat3_member, values));
+  EXPECT_FALSE(buffer.SetInt(float_member, 1));
+  EXPECT_FALSE(buffer.SetMatrix3f(mat4_member, values));
+  EXPECT_FALSE(buffer.SetMatrix4f(mat3_member, values));
+  EXPECT_FALSE(buffer.SetFloatArray(int_member, 0, 1, values));
+  EXPECT_FALSE(buffer.SetFloatArray(mat4_member, 0, 1, values));
+  EXPECT_FALSE(buffer.SetFloatArray(float_member, 0, 2, values));
+  EXPECT_FALSE(buffer.SetFloat(-1, 1.0f));
+  EXPECT_FALSE(buffer.SetVector(5, values));
+}
+
+TEST(UniformBufferTest, SettersPackMatchingTypes) {
+  UniformBlockLayout layout("Block");
+  const int float_member = layout.AddMember("float_member", STD140_FLOAT);
+  const int vec3_member = layout.AddMember("vec3_member", STD140_VEC3);
+  const int mat3_member = layout.AddMember("mat3_member", STD140_MAT3);
+  UniformBuffer buffer(layout);
+  const GLfloat vector[3] = { 1.0f, 2.0f, 3.0f };
+  const GLfloat matrix[9] = { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f,
+                              7.0f, 8.0f, 9.0f };
+
+  EXPECT_TRUE(buffer.SetFloat(float_member, 0.5f));
+  EXPECT_TRUE(buffer.SetVector(vec3_member, vector));
+  EXPECT_TRUE(buffer.SetMatrix3f(mat3_member, matrix));
+  const std::vector<UniformBlockLayout::Member>& members =
+      layout.members();
+  EXPECT_EQ(FloatAt(buffer, members[float_member].offset), 0.5f);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(FloatAt(buffer, members[vec3_member].offset + 4 * i),
+              vector[i]);
+  }
+  // Each column of the mat3 starts at a multiple of 16 bytes.
+  for (int column = 0; column < 3; ++column) {
+    for (int row = 0; row < 3; ++row) {
+      EXPECT_EQ(FloatAt(buffer, members[mat3_member].offset + 16 * column +
+                        4 * row),
+                matrix[3 * column + row]);
+    }
+  }
+}
+
+}  // namespace
+}  // namespace wvu
@@ -49,16 +49,28 @@ layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 passed_color;
 layout (location = 2) in vec2 passed_texel;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// The uniform blocks are shared by all the programs through uniform buffers.
+// Their layout must match CameraBlockLayout() and ObjectBlockLayout(), whose
+// GlslDeclaration() generates these declarations.
+layout(std140) uniform Camera {
+  mat4 view;
+  mat4 projection;
+  mat4 view_projection;
+  vec4 position;
+} camera;
+
+layout(std140) uniform Object {
+  mat4 model_view_projection;
+  mat4 model;
+  mat3 normal_matrix;
+} object;
 // Passing variables from shader to shader.
 out vec4 vertex_color;
 out vec2 texel;
 
 void main() {
-  // Compute MVP.
-  gl_Position = projection * view * model * vec4(position, 1.0f);
+  // The MVP matrix is combined on the CPU.
+  gl_Position = object.model_view_projection * vec4(position, 1.0f);
   // This was an example on how to pass variables from shader to shader.
   // vertex_color = vec4(1.0f, 0.5f, 0.2f, 1.0f);
   vertex_color = vec4(passed_color, 1.0f);
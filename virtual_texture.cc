@@ -0,0 +1,477 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "virtual_texture.h"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <GL/glew.h>
+
+#include <glog/logging.h>
+
+#include "texture_format.h"
+
+namespace wvu {
+namespace {
+// Maximum number of levels of the pyramid; it matches the size of the uniform
+// arrays of the shaders.
+constexpr int kMaxNumLevels = 16;
+// Alpha of the feedback pixels without a page; it is the alpha of the clear
+// color of the scene.
+constexpr unsigned char kNoFeedback = 255;
+// The feedback encodes the page coordinates in 12 bits.
+constexpr int kMaxNumPagesPerSide = 4096;
+// Hashes of the names of the uniforms of the shaders.
+constexpr uint32_t kPhysicalTextureUniform =
+    HashUniformName("physical_texture");
+constexpr uint32_t kPageTableUniform = HashUniformName("page_table");
+constexpr uint32_t kNumLevelsUniform = HashUniformName("num_levels");
+constexpr uint32_t kLevelSizesUniform = HashUniformName("level_sizes");
+constexpr uint32_t kPageTableRowsUniform = HashUniformName("page_table_rows");
+constexpr uint32_t kPageSizeUniform = HashUniformName("page_size");
+constexpr uint32_t kPageBorderUniform = HashUniformName("page_border");
+constexpr uint32_t kPhysicalSizeUniform = HashUniformName("physical_size");
+constexpr uint32_t kLodBiasUniform = HashUniformName("lod_bias");
+
+}  // namespace
+
+VirtualTexture::VirtualTexture(const Options& options) :
+    options_(options),
+    frame_(0),
+    num_physical_pages_per_side_(0),
+    physical_texture_id_(0),
+    page_table_texture_id_(0),
+    feedback_framebuffer_id_(0),
+    feedback_color_texture_id_(0),
+    feedback_depth_renderbuffer_id_(0),
+    feedback_width_(0),
+    feedback_height_(0),
+    feedback_buffer_ids_{0, 0},
+    feedback_fences_{nullptr, nullptr},
+    feedback_pixel_counts_{0, 0},
+    next_feedback_buffer_(0),
+    saved_viewport_{0, 0, 0, 0},
+    stop_(false) {}
+
+VirtualTexture::~VirtualTexture() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  load_condition_.notify_all();
+  for (std::thread& loader : loaders_) {
+    loader.join();
+  }
+  for (int i = 0; i < 2; ++i) {
+    if (feedback_fences_[i] != nullptr) {
+      glDeleteSync(feedback_fences_[i]);
+    }
+  }
+  if (feedback_buffer_ids_[0] != 0) {
+    glDeleteBuffers(2, feedback_buffer_ids_);
+  }
+  if (feedback_framebuffer_id_ != 0) {
+    glDeleteFramebuffers(1, &feedback_framebuffer_id_);
+    glDeleteTextures(1, &feedback_color_texture_id_);
+    glDeleteRenderbuffers(1, &feedback_depth_renderbuffer_id_);
+  }
+  if (physical_texture_id_ != 0) {
+    glDeleteTextures(1, &physical_texture_id_);
+    glDeleteTextures(1, &page_table_texture_id_);
+  }
+}
+
+bool VirtualTexture::Open(const std::string& virtual_texture_filepath) {
+  if (!file_.Open(virtual_texture_filepath)) {
+    return false;
+  }
+  const int num_levels = file_.num_levels();
+  if (num_levels > kMaxNumLevels) {
+    LOG(ERROR) << "The virtual texture " << virtual_texture_filepath
+               << " has more than " << kMaxNumLevels << " levels.";
+    return false;
+  }
+  if (file_.num_pages_x(0) > kMaxNumPagesPerSide ||
+      file_.num_pages_y(0) > kMaxNumPagesPerSide) {
+    LOG(ERROR) << "The virtual texture " << virtual_texture_filepath
+               << " has more than " << kMaxNumPagesPerSide
+               << " pages per side.";
+    return false;
+  }
+  GLint max_texture_size;
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+  // The page table stores the slots in 8 bits per axis.
+  num_physical_pages_per_side_ = std::max(1, std::min(
+      {options_.num_physical_pages_per_side, 256,
+       max_texture_size / file_.stored_page_size()}));
+  std::vector<int> num_pages_x, num_pages_y;
+  int num_page_table_rows = 0;
+  level_sizes_.clear();
+  for (int level = 0; level < num_levels; ++level) {
+    num_pages_x.push_back(file_.num_pages_x(level));
+    num_pages_y.push_back(file_.num_pages_y(level));
+    level_sizes_.push_back(file_.level_width(level));
+    level_sizes_.push_back(file_.level_height(level));
+    num_page_table_rows += file_.num_pages_y(level);
+  }
+  if (file_.num_pages_x(0) > max_texture_size ||
+      num_page_table_rows > max_texture_size) {
+    LOG(ERROR) << "The page table of the virtual texture "
+               << virtual_texture_filepath << " exceeds GL_MAX_TEXTURE_SIZE.";
+    return false;
+  }
+  staging_buffer_pool_.reset(new StagingBufferPool(
+      2 * options_.scheduler.max_pages_in_flight * file_.page_size_in_bytes()));
+
+  // The physical page cache is filtered bilinearly; the borders of the pages
+  // hide the seams between slots.
+  const int physical_size =
+      num_physical_pages_per_side_ * file_.stored_page_size();
+  glGenTextures(1, &physical_texture_id_);
+  glBindTexture(GL_TEXTURE_2D, physical_texture_id_);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  AllocateTextureStorage(GL_TEXTURE_2D, 1, TextureUploadFormat(),
+                         physical_size, physical_size);
+  // The entries of the page table are integers read with texelFetch().
+  glGenTextures(1, &page_table_texture_id_);
+  glBindTexture(GL_TEXTURE_2D, page_table_texture_id_);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  TextureUploadFormat page_table_format;
+  page_table_format.internal_format = GL_RGBA8UI;
+  page_table_format.format = GL_RGBA_INTEGER;
+  AllocateTextureStorage(GL_TEXTURE_2D, 1, page_table_format,
+                         file_.num_pages_x(0), num_page_table_rows);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  page_table_.reset(new VirtualTexturePageTable(
+      num_pages_x, num_pages_y, num_physical_pages_per_side_));
+
+  page_cache_.reset(new VirtualTexturePageCache(
+      num_physical_pages_per_side_ * num_physical_pages_per_side_));
+  scheduler_.reset(new VirtualTextureTileScheduler(num_pages_x, num_pages_y,
+                                                   options_.scheduler));
+  // The coarsest level is a single page that is the fallback of every page.
+  const VirtualPageId coarsest_page = { num_levels - 1, 0, 0 };
+  VirtualPageId evicted_page;
+  bool evicted;
+  const int slot = page_cache_->Insert(coarsest_page, frame_, true,
+                                       &evicted_page, &evicted);
+  UploadPage(slot, file_.page_data(coarsest_page));
+  page_table_->Rebuild(*page_cache_);
+  UploadPageTable();
+
+  const int num_loader_threads = std::max(1, options_.num_loader_threads);
+  for (int i = 0; i < num_loader_threads; ++i) {
+    loaders_.emplace_back(&VirtualTexture::LoadLoop, this);
+  }
+  return true;
+}
+
+void VirtualTexture::BeginFeedback(const int framebuffer_width,
+                                   const int framebuffer_height) {
+  const int scale = std::max(1, options_.feedback_scale);
+  const int width = std::max(1, framebuffer_width / scale);
+  const int height = std::max(1, framebuffer_height / scale);
+  if (width != feedback_width_ || height != feedback_height_) {
+    // (Re)create the framebuffer and the buffers; pending read backs are
+    // discarded.
+    if (feedback_framebuffer_id_ == 0) {
+      glGenFramebuffers(1, &feedback_framebuffer_id_);
+      glGenTextures(1, &feedback_color_texture_id_);
+      glGenRenderbuffers(1, &feedback_depth_renderbuffer_id_);
+      glGenBuffers(2, feedback_buffer_ids_);
+    }
+    feedback_width_ = width;
+    feedback_height_ = height;
+    glBindTexture(GL_TEXTURE_2D, feedback_color_texture_id_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindRenderbuffer(GL_RENDERBUFFER, feedback_depth_renderbuffer_id_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width,
+                          height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, feedback_framebuffer_id_);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                           GL_TEXTURE_2D, feedback_color_texture_id_, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                              GL_RENDERBUFFER,
+                              feedback_depth_renderbuffer_id_);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    for (int i = 0; i < 2; ++i) {
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, feedback_buffer_ids_[i]);
+      glBufferData(GL_PIXEL_PACK_BUFFER, 4 * width * height, nullptr,
+                   GL_STREAM_READ);
+      if (feedback_fences_[i] != nullptr) {
+        glDeleteSync(feedback_fences_[i]);
+        feedback_fences_[i] = nullptr;
+      }
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  }
+  glGetIntegerv(GL_VIEWPORT, saved_viewport_);
+  glBindFramebuffer(GL_FRAMEBUFFER, feedback_framebuffer_id_);
+  glViewport(0, 0, width, height);
+}
+
+void VirtualTexture::EndFeedback() {
+  const int buffer = next_feedback_buffer_;
+  if (feedback_fences_[buffer] != nullptr) {
+    // The previous read back into this buffer was never parsed; drop it.
+    glDeleteSync(feedback_fences_[buffer]);
+  }
+  // With a pixel pack buffer bound, glReadPixels() returns immediately and
+  // the pixels are copied when the GPU is done with the frame.
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, feedback_buffer_ids_[buffer]);
+  glReadPixels(0, 0, feedback_width_, feedback_height_, GL_RGBA,
+               GL_UNSIGNED_BYTE, nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  feedback_fences_[buffer] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  feedback_pixel_counts_[buffer] = feedback_width_ * feedback_height_;
+  next_feedback_buffer_ = 1 - buffer;
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glViewport(saved_viewport_[0], saved_viewport_[1], saved_viewport_[2],
+             saved_viewport_[3]);
+}
+
+void VirtualTexture::Update() {
+  ++frame_;
+  // Parse the read backs that the GPU finished, oldest first; the CPU never
+  // waits for the GPU.
+  for (int i = 0; i < 2; ++i) {
+    const int buffer = (next_feedback_buffer_ + i) % 2;
+    if (feedback_fences_[buffer] == nullptr) {
+      continue;
+    }
+    const GLenum status = glClientWaitSync(feedback_fences_[buffer], 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+      continue;
+    }
+    glDeleteSync(feedback_fences_[buffer]);
+    feedback_fences_[buffer] = nullptr;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, feedback_buffer_ids_[buffer]);
+    const void* pixels = glMapBufferRange(
+        GL_PIXEL_PACK_BUFFER, 0, 4 * feedback_pixel_counts_[buffer],
+        GL_MAP_READ_BIT);
+    if (pixels != nullptr) {
+      ParseFeedback(static_cast<const unsigned char*>(pixels),
+                    feedback_pixel_counts_[buffer]);
+      glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  }
+  const std::vector<VirtualPageId> requested_pages =
+      scheduler_->Schedule(frame_, page_cache_.get());
+  if (!requested_pages.empty()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      load_queue_.insert(load_queue_.end(), requested_pages.begin(),
+                         requested_pages.end());
+    }
+    load_condition_.notify_all();
+    statistics_.num_requested_pages += requested_pages.size();
+  }
+  // Upload the pages that the loaders finished, within the budget.
+  std::vector<LoadedPage> loaded_pages;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (!loaded_queue_.empty() &&
+           static_cast<int>(loaded_pages.size()) <
+           options_.max_uploads_per_frame) {
+      loaded_pages.push_back(std::move(loaded_queue_.front()));
+      loaded_queue_.pop_front();
+    }
+  }
+  for (LoadedPage& loaded_page : loaded_pages) {
+    VirtualPageId evicted_page;
+    bool evicted;
+    const int slot = page_cache_->Insert(loaded_page.page, frame_, false,
+                                         &evicted_page, &evicted);
+    if (slot >= 0) {
+      UploadPage(slot, loaded_page.texels.data());
+      ++statistics_.num_uploaded_pages;
+      if (evicted) {
+        page_table_->Update(*page_cache_, evicted_page);
+        ++statistics_.num_evicted_pages;
+      }
+      page_table_->Update(*page_cache_, loaded_page.page);
+    } else {
+      // Every slot holds a page of this frame; the page is requested again
+      // if it is still needed.
+      ++statistics_.num_dropped_pages;
+    }
+    scheduler_->OnPageLoaded(loaded_page.page);
+    staging_buffer_pool_->Release(std::move(loaded_page.texels));
+  }
+  UploadPageTable();
+}
+
+void VirtualTexture::SetUniforms(ShaderProgram* shader_program,
+                                 const bool feedback) const {
+  shader_program->Use();
+  // The feedback program only declares some of the uniforms; the setters
+  // ignore the others.
+  const int num_levels = file_.num_levels();
+  const GLfloat physical_size = static_cast<GLfloat>(
+      num_physical_pages_per_side_ * file_.stored_page_size());
+  shader_program->SetUniform1i(
+      shader_program->FindUniform(kPhysicalTextureUniform), 0);
+  shader_program->SetUniform1i(
+      shader_program->FindUniform(kPageTableUniform), 1);
+  shader_program->SetUniform1i(
+      shader_program->FindUniform(kNumLevelsUniform), num_levels);
+  shader_program->SetUniform2fv(
+      shader_program->FindUniform(kLevelSizesUniform), num_levels,
+      level_sizes_.data());
+  shader_program->SetUniform1iv(
+      shader_program->FindUniform(kPageTableRowsUniform), num_levels,
+      page_table_->level_rows().data());
+  shader_program->SetUniform1f(
+      shader_program->FindUniform(kPageSizeUniform), file_.page_size());
+  shader_program->SetUniform1f(
+      shader_program->FindUniform(kPageBorderUniform), file_.page_border());
+  shader_program->SetUniform1f(
+      shader_program->FindUniform(kPhysicalSizeUniform), physical_size);
+  // The feedback is rendered at a lower resolution, which increases the
+  // derivatives of the texture coordinates by the scale.
+  shader_program->SetUniform1f(
+      shader_program->FindUniform(kLodBiasUniform),
+      feedback ?
+      -std::log2(static_cast<float>(std::max(1, options_.feedback_scale))) :
+      0.0f);
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, page_table_texture_id_);
+  glActiveTexture(GL_TEXTURE0);
+}
+
+VirtualTexture::Statistics VirtualTexture::statistics() const {
+  Statistics statistics = statistics_;
+  statistics.num_resident_pages =
+      page_cache_ ? page_cache_->num_resident_pages() : 0;
+  return statistics;
+}
+
+void VirtualTexture::LoadLoop() {
+  while (true) {
+    VirtualPageId page;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      load_condition_.wait(lock, [this]() {
+        return stop_ || !load_queue_.empty();
+      });
+      if (stop_) {
+        return;
+      }
+      page = load_queue_.front();
+      load_queue_.pop_front();
+    }
+    // Reading the mapping is where the operating system loads the page from
+    // disk, outside of the rendering thread.
+    LoadedPage loaded_page;
+    loaded_page.page = page;
+    loaded_page.texels =
+        staging_buffer_pool_->Acquire(file_.page_size_in_bytes());
+    std::copy(file_.page_data(page),
+              file_.page_data(page) + file_.page_size_in_bytes(),
+              loaded_page.texels.data());
+    std::lock_guard<std::mutex> lock(mutex_);
+    loaded_queue_.push_back(std::move(loaded_page));
+  }
+}
+
+void VirtualTexture::UploadPage(const int slot, const unsigned char* texels) {
+  const int stored_page_size = file_.stored_page_size();
+  glBindTexture(GL_TEXTURE_2D, physical_texture_id_);
+  glTexSubImage2D(GL_TEXTURE_2D, 0,
+                  (slot % num_physical_pages_per_side_) * stored_page_size,
+                  (slot / num_physical_pages_per_side_) * stored_page_size,
+                  stored_page_size, stored_page_size, GL_RGBA,
+                  GL_UNSIGNED_BYTE, texels);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void VirtualTexture::ParseFeedback(const unsigned char* pixels,
+                                   const int num_pixels) {
+  // Neighboring pixels usually need the same page.
+  uint32_t previous_pixel = 0;
+  for (int i = 0; i < num_pixels; ++i) {
+    const unsigned char* pixel = pixels + 4 * i;
+    const uint32_t packed_pixel = pixel[0] | (pixel[1] << 8) |
+        (pixel[2] << 16) | (static_cast<uint32_t>(pixel[3]) << 24);
+    if (pixel[3] == kNoFeedback || packed_pixel == previous_pixel) {
+      continue;
+    }
+    previous_pixel = packed_pixel;
+    // The shader writes the low bits of x and y in red and green, and their
+    // high bits in blue.
+    VirtualPageId page;
+    page.level = pixel[3];
+    page.x = pixel[0] | ((pixel[2] & 15) << 8);
+    page.y = pixel[1] | ((pixel[2] >> 4) << 8);
+    if (page.level < file_.num_levels() &&
+        page.x < file_.num_pages_x(page.level) &&
+        page.y < file_.num_pages_y(page.level)) {
+      scheduler_->AddFeedback(page);
+    }
+  }
+}
+
+void VirtualTexture::UploadPageTable() {
+  const std::vector<VirtualTexturePageTable::RowRange> dirty_rows =
+      page_table_->dirty_rows();
+  if (dirty_rows.empty()) {
+    return;
+  }
+  const int width = page_table_->width();
+  glBindTexture(GL_TEXTURE_2D, page_table_texture_id_);
+  for (const VirtualTexturePageTable::RowRange& rows : dirty_rows) {
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, rows.begin, width,
+                    rows.end - rows.begin, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE,
+                    page_table_->data() + 4 * static_cast<size_t>(width) *
+                    rows.begin);
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+  page_table_->ClearDirtyRows();
+}
+
+}  // namespace wvu
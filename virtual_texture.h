@@ -0,0 +1,216 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_VIRTUAL_TEXTURE_H_
+#define GLUTILS_VIRTUAL_TEXTURE_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <GL/glew.h>
+
+#include "shader_program.h"
+#include "staging_buffer_pool.h"
+#include "virtual_texture_file.h"
+#include "virtual_texture_page_cache.h"
+
+namespace wvu {
+// This class displays images larger than GL_MAX_TEXTURE_SIZE, or larger than
+// the memory, with sparse virtual texturing. The image is pre-tiled offline
+// into the pages of its mip pyramid (see BuildVirtualTextureFile()) and only
+// the pages that the visible pixels need are kept on the GPU:
+//   - The physical page cache is a texture with a fixed number of page slots.
+//   - The page table is a texture with an entry per page of every level
+//     (the levels are stacked vertically). Every entry holds the slot and the
+//     level of the page that is sampled for it: the page itself when it is
+//     resident, and its closest resident ancestor otherwise.
+//   - The feedback pass renders the scene at a low resolution with a shader
+//     that writes the page that every pixel needs. The pixels are read back
+//     asynchronously through pixel buffer objects and turned into requests by
+//     a VirtualTextureTileScheduler.
+//   - Loader threads read the requested pages from the mapped file; Update()
+//     uploads them into the slots of a VirtualTexturePageCache, which evicts
+//     the least recently used pages.
+// The coarsest level is a single page that is always resident, so every pixel
+// has something to sample. The shaders virtual_texture_fragment_shader.glsl
+// and virtual_texture_feedback_shader.glsl implement the lookups; their
+// uniforms are set by SetUniforms().
+// All the member functions must be called from the thread that owns the
+// OpenGL context.
+//
+// Example:
+//
+// wvu::VirtualTexture virtual_texture(wvu::VirtualTexture::Options());
+// if (!virtual_texture.Open("/path/to/image.vtex")) {
+//   ...
+// }
+// while (...) {  // Rendering loop.
+//   virtual_texture.SetUniforms(&feedback_shader_program, true);
+//   virtual_texture.BeginFeedback(framebuffer_width, framebuffer_height);
+//   ...  // Draw the scene with the feedback program.
+//   virtual_texture.EndFeedback();
+//   virtual_texture.Update();
+//   virtual_texture.SetUniforms(&shader_program, false);
+//   ...  // Draw the scene.
+// }
+class VirtualTexture {
+ public:
+  // Configuration of the virtual texture.
+  struct Options {
+    // Number of page slots per side of the physical page cache; at most 256.
+    // When the visible pages do not fit, the pixels sample coarser levels.
+    int num_physical_pages_per_side = 32;
+    // The feedback is rendered at 1/feedback_scale of the framebuffer size.
+    int feedback_scale = 8;
+    // Maximum number of pages uploaded per call to Update().
+    int max_uploads_per_frame = 16;
+    // Number of threads that read the pages.
+    int num_loader_threads = 1;
+    // Configuration of the requests.
+    VirtualTextureTileScheduler::Options scheduler;
+  };
+
+  // Counters of the virtual texture.
+  struct Statistics {
+    int num_resident_pages = 0;
+    // Number of pages requested, uploaded, and evicted from the physical page
+    // cache since the texture was opened.
+    size_t num_requested_pages = 0;
+    size_t num_uploaded_pages = 0;
+    size_t num_evicted_pages = 0;
+    // Number of loaded pages discarded because every slot was in use.
+    size_t num_dropped_pages = 0;
+  };
+
+  explicit VirtualTexture(const Options& options);
+  // Stops the loader threads and deletes the textures and buffers.
+  ~VirtualTexture();
+
+  // Maps the virtual texture file, creates the textures and uploads the
+  // coarsest level. Returns true if successful, and false otherwise.
+  bool Open(const std::string& virtual_texture_filepath);
+
+  // Binds the feedback framebuffer. The scene is then drawn with the feedback
+  // program, whose output must not be blended.
+  // Parameters:
+  //   framebuffer_width, framebuffer_height  The size of the framebuffer of
+  //     the scene.
+  void BeginFeedback(const int framebuffer_width, const int framebuffer_height);
+
+  // Starts the read back of the feedback and restores the framebuffer.
+  void EndFeedback();
+
+  // Turns the feedback of a previous frame into requests, uploads the loaded
+  // pages and updates the page table. Call it once per frame.
+  void Update();
+
+  // Sets the uniforms of the program and binds the page table to texture
+  // unit 1. The physical page cache is sampled from texture unit 0. The
+  // uniforms are set through the setters of the program, which skip the
+  // values that did not change since the previous call.
+  // Parameters:
+  //   shader_program  The program, which becomes the current program.
+  //   feedback  True for the feedback program.
+  void SetUniforms(ShaderProgram* shader_program, const bool feedback) const;
+
+  // The texture of the physical page cache.
+  GLuint physical_texture_id() const { return physical_texture_id_; }
+
+  Statistics statistics() const;
+
+ private:
+  // A page read by a loader thread.
+  struct LoadedPage {
+    VirtualPageId page;
+    StagingBuffer texels;
+  };
+
+  // Loop executed by the loader threads.
+  void LoadLoop();
+
+  // Uploads the texels of the page into the slot of the physical page cache.
+  void UploadPage(const int slot, const unsigned char* texels);
+
+  // Reads the pixels of the feedback and adds their pages to the scheduler.
+  void ParseFeedback(const unsigned char* pixels, const int num_pixels);
+
+  // Uploads the rows of the page table that changed since the last upload.
+  void UploadPageTable();
+
+  const Options options_;
+  VirtualTextureFile file_;
+  std::unique_ptr<VirtualTexturePageCache> page_cache_;
+  std::unique_ptr<VirtualTextureTileScheduler> scheduler_;
+  std::unique_ptr<StagingBufferPool> staging_buffer_pool_;
+  int64_t frame_;
+  Statistics statistics_;
+
+  // Textures and their CPU copy of the page table.
+  int num_physical_pages_per_side_;
+  GLuint physical_texture_id_;
+  GLuint page_table_texture_id_;
+  std::unique_ptr<VirtualTexturePageTable> page_table_;
+  // Width and height of every level, as the shaders read them.
+  std::vector<GLfloat> level_sizes_;
+
+  // Feedback framebuffer and the two pixel buffer objects that receive it,
+  // each with the fence of its read back.
+  GLuint feedback_framebuffer_id_;
+  GLuint feedback_color_texture_id_;
+  GLuint feedback_depth_renderbuffer_id_;
+  int feedback_width_;
+  int feedback_height_;
+  GLuint feedback_buffer_ids_[2];
+  GLsync feedback_fences_[2];
+  int feedback_pixel_counts_[2];
+  int next_feedback_buffer_;
+  GLint saved_viewport_[4];
+
+  // The members below are shared with the loaders and guarded by mutex_.
+  std::mutex mutex_;
+  std::condition_variable load_condition_;
+  std::deque<VirtualPageId> load_queue_;
+  std::deque<LoadedPage> loaded_queue_;
+  bool stop_;
+  std::vector<std::thread> loaders_;
+};
+
+}  // namespace wvu
+
+#endif  // GLUTILS_VIRTUAL_TEXTURE_H_
@@ -0,0 +1,115 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+// Offline builder of virtual textures. The tool tiles an image into the pages
+// of its mip pyramid and writes them to a virtual texture file, which
+// draw_scene displays with --virtual_texture_filepath.
+//
+// Example:
+//   ./bin/virtual_texture_builder --image_filepath=/path/to/image.png
+//       --output_filepath=/path/to/image.vtex --page_size=128
+
+// Use the right namespace for google flags (gflags).
+#ifdef GFLAGS_NAMESPACE_GOOGLE
+#define GLUTILS_GFLAGS_NAMESPACE google
+#else
+#define GLUTILS_GFLAGS_NAMESPACE gflags
+#endif
+
+// Include second C++-Headers.
+#include <iostream>
+#include <string>
+
+// Include library headers.
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+// Include system headers.
+#include "mip_generator.h"
+#include "virtual_texture_file.h"
+
+DEFINE_string(image_filepath, "", "Filepath of the image to tile.");
+DEFINE_string(output_filepath, "", "Filepath of the virtual texture file.");
+DEFINE_int32(page_size, 128,
+             "Width and height of the texels of the image in every page.");
+DEFINE_int32(page_border, 4,
+             "Texels of the neighboring pages replicated around every page.");
+DEFINE_string(mip_filter, "box",
+              "Filter of the mip levels: box, kaiser or lanczos.");
+DEFINE_bool(srgb_mipmaps, false,
+            "Filter the color channels of the mip levels in linear light.");
+
+int main(int argc, char** argv) {
+  GLUTILS_GFLAGS_NAMESPACE::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  if (FLAGS_image_filepath.empty() || FLAGS_output_filepath.empty()) {
+    std::cerr << "ERROR: Provide --image_filepath and --output_filepath.\n";
+    return -1;
+  }
+  if (FLAGS_page_size <= 0 || FLAGS_page_border < 0) {
+    std::cerr << "ERROR: Invalid page size or border.\n";
+    return -1;
+  }
+  wvu::VirtualTextureBuildOptions options;
+  options.page_size = FLAGS_page_size;
+  options.page_border = FLAGS_page_border;
+  if (FLAGS_mip_filter == "box") {
+    options.mip_generation.filter = wvu::MIP_FILTER_BOX;
+  } else if (FLAGS_mip_filter == "kaiser") {
+    options.mip_generation.filter = wvu::MIP_FILTER_KAISER;
+  } else if (FLAGS_mip_filter == "lanczos") {
+    options.mip_generation.filter = wvu::MIP_FILTER_LANCZOS;
+  } else {
+    std::cerr << "ERROR: Unknown mip filter " << FLAGS_mip_filter << "\n";
+    return -1;
+  }
+  options.mip_generation.srgb = FLAGS_srgb_mipmaps;
+  if (!wvu::BuildVirtualTextureFile(FLAGS_image_filepath, options,
+                                    FLAGS_output_filepath)) {
+    std::cerr << "ERROR: Could not build the virtual texture.\n";
+    return -1;
+  }
+  wvu::VirtualTextureFile file;
+  if (!file.Open(FLAGS_output_filepath)) {
+    return -1;
+  }
+  int num_pages = 0;
+  for (int level = 0; level < file.num_levels(); ++level) {
+    num_pages += file.num_pages_x(level) * file.num_pages_y(level);
+  }
+  std::cout << "Tiled " << file.width() << "x" << file.height() << " texels "
+            << "into " << num_pages << " pages over " << file.num_levels()
+            << " levels: " << FLAGS_output_filepath << "\n";
+  return 0;
+}
@@ -0,0 +1,72 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+// Feedback shader of a virtual texture (see virtual_texture.h).
+// The shader writes the page that the pixel needs, which VirtualTexture reads
+// back to request the missing pages. The page is encoded in 8 bits per
+// channel: the low 8 bits of x and y in red and green, their high 4 bits in
+// blue, and the level in alpha. The clear color of the scene has an alpha of
+// 1, i.e., 255, which marks the pixels without a page.
+
+#version 330 core
+
+in vec4 vertex_color;
+out vec4 color;
+in vec2 texel;
+
+uniform int num_levels;
+uniform vec2 level_sizes[16];
+uniform float page_size;
+uniform float lod_bias;
+
+// Returns the mip level that the pixel needs. The feedback is rendered at a
+// lower resolution; lod_bias compensates the larger derivatives.
+int ComputeLevel(vec2 uv) {
+  vec2 pixel = uv * level_sizes[0];
+  vec2 dx = dFdx(pixel);
+  vec2 dy = dFdy(pixel);
+  float lod = 0.5f * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8f));
+  return int(clamp(lod + lod_bias, 0.0f, float(num_levels - 1)));
+}
+
+void main() {
+  vec2 uv = clamp(texel, 0.0f, 1.0f);
+  int level = ComputeLevel(uv);
+  ivec2 num_pages = ivec2(ceil(level_sizes[level] / page_size));
+  ivec2 page = clamp(ivec2(uv * level_sizes[level] / page_size),
+                     ivec2(0), num_pages - 1);
+  color = vec4(float(page.x & 255), float(page.y & 255),
+               float((page.x >> 8) | ((page.y >> 8) << 4)), float(level)) /
+      255.0f;
+}
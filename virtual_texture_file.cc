@@ -0,0 +1,258 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "virtual_texture_file.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "image_reader.h"
+#include "mapped_file.h"
+#include "mip_generator.h"
+
+namespace wvu {
+namespace {
+// The layout of the files is:
+//   Header (32 bytes): identifier, version, width, height, page size, page
+//     border and number of levels.
+//   Pages: level 0 first, and the pages of every level row by row. Every page
+//     holds (page size + 2 * border)^2 RGBA8 texels, top to bottom.
+constexpr unsigned char kIdentifier[8] = {
+  0xAB, 0x56, 0x54, 0x45, 0x58, 0xBB, 0x0D, 0x0A
+};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kHeaderSize = 32;
+
+// A level of the pyramid, as laid out in the file.
+struct LevelLayout {
+  int width;
+  int height;
+  int num_pages_x;
+  int num_pages_y;
+};
+
+// Returns the levels of the pyramid of an image: the levels until the first
+// one that fits in a single page.
+std::vector<LevelLayout> ComputeLevelLayouts(const int width,
+                                             const int height,
+                                             const int page_size) {
+  std::vector<LevelLayout> levels;
+  for (int level = 0;; ++level) {
+    LevelLayout layout;
+    layout.width = MipLevelSize(width, level);
+    layout.height = MipLevelSize(height, level);
+    layout.num_pages_x = (layout.width + page_size - 1) / page_size;
+    layout.num_pages_y = (layout.height + page_size - 1) / page_size;
+    levels.push_back(layout);
+    if (layout.num_pages_x == 1 && layout.num_pages_y == 1) {
+      return levels;
+    }
+  }
+}
+
+// The files are little-endian, like the hosts this code runs on.
+template <typename T>
+T Read(const unsigned char* bytes) {
+  T value;
+  memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+// Copies a page of the level, with its border, into page. The texels outside
+// of the level replicate its edges.
+void ExtractPage(const unsigned char* level_texels,
+                 const LevelLayout& level,
+                 const int page_x,
+                 const int page_y,
+                 const VirtualTextureBuildOptions& options,
+                 unsigned char* page) {
+  const int stored_page_size = options.page_size + 2 * options.page_border;
+  const int x_begin = page_x * options.page_size - options.page_border;
+  const int y_begin = page_y * options.page_size - options.page_border;
+  // Columns of the page that map inside of the level.
+  const int inside_begin = std::min(std::max(-x_begin, 0), stored_page_size);
+  const int inside_end =
+      std::max(std::min(level.width - x_begin, stored_page_size),
+               inside_begin);
+  for (int row = 0; row < stored_page_size; ++row) {
+    const int y = std::min(std::max(y_begin + row, 0), level.height - 1);
+    const unsigned char* level_row =
+        level_texels + 4 * static_cast<size_t>(y) * level.width;
+    unsigned char* page_row = page + 4 * static_cast<size_t>(row) *
+        stored_page_size;
+    for (int column = 0; column < inside_begin; ++column) {
+      memcpy(page_row + 4 * column, level_row, 4);
+    }
+    memcpy(page_row + 4 * inside_begin,
+           level_row + 4 * (x_begin + inside_begin),
+           4 * static_cast<size_t>(inside_end - inside_begin));
+    for (int column = inside_end; column < stored_page_size; ++column) {
+      memcpy(page_row + 4 * column,
+             level_row + 4 * static_cast<size_t>(level.width - 1), 4);
+    }
+  }
+}
+
+}  // namespace
+
+bool BuildVirtualTextureFile(const std::string& source_filepath,
+                             const VirtualTextureBuildOptions& options,
+                             const std::string& virtual_texture_filepath) {
+  ImageReader image_reader;
+  if (!image_reader.Open(source_filepath)) {
+    return false;
+  }
+  const int width = image_reader.width();
+  const int height = image_reader.height();
+  // The complete mip chain is generated; only the levels of the pyramid are
+  // written.
+  const int num_mip_levels = NumMipLevels(width, height);
+  std::vector<size_t> level_offsets(num_mip_levels);
+  size_t chain_size_in_bytes = 0;
+  for (int level = 0; level < num_mip_levels; ++level) {
+    level_offsets[level] = chain_size_in_bytes;
+    chain_size_in_bytes += 4 * static_cast<size_t>(MipLevelSize(width, level)) *
+        MipLevelSize(height, level);
+  }
+  std::vector<unsigned char> chain(chain_size_in_bytes);
+  if (!image_reader.ReadRgba8(chain.data())) {
+    return false;
+  }
+  GenerateRgba8MipChain(width, height, options.mip_generation, chain.data());
+
+  const std::vector<LevelLayout> levels =
+      ComputeLevelLayouts(width, height, options.page_size);
+  std::vector<unsigned char> header(kIdentifier,
+                                    kIdentifier + sizeof(kIdentifier));
+  for (const uint32_t field : { kVersion, static_cast<uint32_t>(width),
+                                static_cast<uint32_t>(height),
+                                static_cast<uint32_t>(options.page_size),
+                                static_cast<uint32_t>(options.page_border),
+                                static_cast<uint32_t>(levels.size()) }) {
+    const unsigned char* field_bytes =
+        reinterpret_cast<const unsigned char*>(&field);
+    header.insert(header.end(), field_bytes, field_bytes + sizeof(field));
+  }
+  // Write under a temporary name and rename it, which is atomic.
+  const std::string temporary_filepath = virtual_texture_filepath + ".tmp";
+  {
+    std::ofstream file(temporary_filepath, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(header.data()), header.size());
+    const int stored_page_size = options.page_size + 2 * options.page_border;
+    std::vector<unsigned char> page(
+        4 * static_cast<size_t>(stored_page_size) * stored_page_size);
+    for (int level = 0; level < static_cast<int>(levels.size()); ++level) {
+      for (int page_y = 0; page_y < levels[level].num_pages_y; ++page_y) {
+        for (int page_x = 0; page_x < levels[level].num_pages_x; ++page_x) {
+          ExtractPage(chain.data() + level_offsets[level], levels[level],
+                      page_x, page_y, options, page.data());
+          file.write(reinterpret_cast<const char*>(page.data()), page.size());
+        }
+      }
+    }
+    if (!file) {
+      LOG(ERROR) << "Could not write the virtual texture "
+                 << virtual_texture_filepath;
+      file.close();
+      remove(temporary_filepath.c_str());
+      return false;
+    }
+  }
+  if (rename(temporary_filepath.c_str(),
+             virtual_texture_filepath.c_str()) != 0) {
+    LOG(ERROR) << "Could not rename the virtual texture "
+               << virtual_texture_filepath;
+    remove(temporary_filepath.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool VirtualTextureFile::Open(const std::string& virtual_texture_filepath) {
+  if (!file_.Open(virtual_texture_filepath)) {
+    return false;
+  }
+  const unsigned char* bytes = file_.data();
+  if (file_.size() < kHeaderSize ||
+      memcmp(bytes, kIdentifier, sizeof(kIdentifier)) != 0 ||
+      Read<uint32_t>(bytes + 8) != kVersion) {
+    LOG(ERROR) << "Invalid virtual texture " << virtual_texture_filepath;
+    file_.Close();
+    return false;
+  }
+  width_ = Read<uint32_t>(bytes + 12);
+  height_ = Read<uint32_t>(bytes + 16);
+  page_size_ = Read<uint32_t>(bytes + 20);
+  page_border_ = Read<uint32_t>(bytes + 24);
+  const uint32_t num_levels = Read<uint32_t>(bytes + 28);
+  if (width_ <= 0 || height_ <= 0 || page_size_ <= 0 || page_border_ < 0) {
+    LOG(ERROR) << "Invalid virtual texture " << virtual_texture_filepath;
+    file_.Close();
+    return false;
+  }
+  const std::vector<LevelLayout> layouts =
+      ComputeLevelLayouts(width_, height_, page_size_);
+  levels_.clear();
+  size_t num_pages = 0;
+  for (const LevelLayout& layout : layouts) {
+    levels_.push_back({ layout.width, layout.height, layout.num_pages_x,
+                        layout.num_pages_y, num_pages });
+    num_pages += static_cast<size_t>(layout.num_pages_x) * layout.num_pages_y;
+  }
+  pages_offset_ = kHeaderSize;
+  if (num_levels != levels_.size() ||
+      file_.size() < pages_offset_ + num_pages * page_size_in_bytes()) {
+    LOG(ERROR) << "Truncated virtual texture " << virtual_texture_filepath;
+    file_.Close();
+    return false;
+  }
+  return true;
+}
+
+const unsigned char* VirtualTextureFile::page_data(
+    const VirtualPageId& page) const {
+  const Level& level = levels_[page.level];
+  const size_t index = level.first_page +
+      static_cast<size_t>(page.y) * level.num_pages_x + page.x;
+  return file_.data() + pages_offset_ + index * page_size_in_bytes();
+}
+
+}  // namespace wvu
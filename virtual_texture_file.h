@@ -0,0 +1,135 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_VIRTUAL_TEXTURE_FILE_H_
+#define GLUTILS_VIRTUAL_TEXTURE_FILE_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+#include "mip_generator.h"
+#include "virtual_texture_page_cache.h"
+
+namespace wvu {
+// Configuration of the tiling of a virtual texture.
+struct VirtualTextureBuildOptions {
+  // Width and height of the texels of the image covered by every page.
+  int page_size = 128;
+  // Texels of the neighboring pages replicated around every page, so the
+  // pages can be filtered bilinearly in the physical page cache.
+  int page_border = 4;
+  // How the levels of the pyramid are generated.
+  MipGenerationOptions mip_generation;
+};
+
+// Tiles the image into the pages of its mip pyramid and writes them to a
+// virtual texture file. The pyramid stops at the first level that fits in a
+// single page. The image is decoded in memory, so this is an offline step.
+// Returns true if successful, and false otherwise.
+// Parameters:
+//   source_filepath  The filepath of the image.
+//   options  The configuration of the tiling.
+//   virtual_texture_filepath  The filepath of the virtual texture file.
+bool BuildVirtualTextureFile(const std::string& source_filepath,
+                             const VirtualTextureBuildOptions& options,
+                             const std::string& virtual_texture_filepath);
+
+// This class maps a virtual texture file. Every page is stored in RGBA8 with
+// its border, so reading a page is a single copy from the mapping and the
+// operating system only loads the pages that are read. The class does not use
+// OpenGL.
+//
+// Example:
+//
+// wvu::VirtualTextureFile file;
+// if (file.Open("/path/to/image.vtex")) {
+//   const unsigned char* texels = file.page_data({ level, x, y });
+//   ...  // file.page_size_in_bytes() bytes.
+// }
+class VirtualTextureFile {
+ public:
+  VirtualTextureFile() :
+      width_(0), height_(0), page_size_(0), page_border_(0),
+      pages_offset_(0) {}
+
+  // Maps the file. Returns true if successful, and false otherwise.
+  bool Open(const std::string& virtual_texture_filepath);
+
+  // Dimensions of level 0.
+  int width() const { return width_; }
+  int height() const { return height_; }
+  // Texels of the image covered by every page.
+  int page_size() const { return page_size_; }
+  int page_border() const { return page_border_; }
+  // Width and height of every stored page, including the border.
+  int stored_page_size() const { return page_size_ + 2 * page_border_; }
+  size_t page_size_in_bytes() const {
+    return 4 * static_cast<size_t>(stored_page_size()) * stored_page_size();
+  }
+  int num_levels() const { return static_cast<int>(levels_.size()); }
+  // Dimensions of the level in texels and in pages.
+  int level_width(const int level) const { return levels_[level].width; }
+  int level_height(const int level) const { return levels_[level].height; }
+  int num_pages_x(const int level) const { return levels_[level].num_pages_x; }
+  int num_pages_y(const int level) const { return levels_[level].num_pages_y; }
+
+  // Returns the texels of the page, top to bottom with the border.
+  const unsigned char* page_data(const VirtualPageId& page) const;
+
+ private:
+  // A level of the pyramid.
+  struct Level {
+    int width;
+    int height;
+    int num_pages_x;
+    int num_pages_y;
+    // Index of the first page of the level in the file.
+    size_t first_page;
+  };
+
+  MappedFile file_;
+  int width_;
+  int height_;
+  int page_size_;
+  int page_border_;
+  std::vector<Level> levels_;
+  // Offset of the first page in the file.
+  size_t pages_offset_;
+};
+
+}  // namespace wvu
+
+#endif  // GLUTILS_VIRTUAL_TEXTURE_FILE_H_
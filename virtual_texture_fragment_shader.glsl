@@ -0,0 +1,96 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+// Fragment shader of a virtual texture (see virtual_texture.h).
+// The shader selects the mip level from the screen space derivatives of the
+// texture coordinates, finds the entry of the page table for the page of that
+// level, and samples the page that the entry points to in the physical page
+// cache. The entry points to the page itself when it is resident, and to its
+// closest resident ancestor otherwise, so the image is always displayed,
+// blurry at first.
+
+#version 330 core
+
+in vec4 vertex_color;
+out vec4 color;
+in vec2 texel;
+
+uniform sampler2D physical_texture;
+uniform usampler2D page_table;
+uniform int num_levels;
+uniform vec2 level_sizes[16];
+uniform int page_table_rows[16];
+uniform float page_size;
+uniform float page_border;
+uniform float physical_size;
+uniform float lod_bias;
+
+// Returns the mip level that the pixel needs.
+int ComputeLevel(vec2 uv) {
+  vec2 pixel = uv * level_sizes[0];
+  vec2 dx = dFdx(pixel);
+  vec2 dy = dFdy(pixel);
+  float lod = 0.5f * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8f));
+  return int(clamp(lod + lod_bias, 0.0f, float(num_levels - 1)));
+}
+
+// Returns the number of pages of the level.
+ivec2 ComputeNumPages(int level) {
+  return ivec2(ceil(level_sizes[level] / page_size));
+}
+
+// Returns the page of the level that contains the texture coordinates.
+ivec2 ComputePage(vec2 uv, int level) {
+  return clamp(ivec2(uv * level_sizes[level] / page_size),
+               ivec2(0), ComputeNumPages(level) - 1);
+}
+
+void main() {
+  vec2 uv = clamp(texel, 0.0f, 1.0f);
+  int level = ComputeLevel(uv);
+  ivec2 page = ComputePage(uv, level);
+  uvec4 entry =
+      texelFetch(page_table, ivec2(page.x, page_table_rows[level] + page.y), 0);
+  // Position of the pixel inside the resident page, plus its border. The
+  // resident page is the ancestor that the page table assigned; the rounding
+  // of the level sizes may put the pixel a fraction of a texel outside of it,
+  // i.e., in its border.
+  int resident_level = int(entry.z);
+  vec2 resident_pixel = uv * level_sizes[resident_level];
+  ivec2 resident_page = min(page >> (resident_level - level),
+                            ComputeNumPages(resident_level) - 1);
+  vec2 position = resident_pixel - vec2(resident_page) * page_size +
+      page_border + vec2(entry.xy) * (page_size + 2.0f * page_border);
+  color = textureLod(physical_texture, position / physical_size, 0.0f);
+}
@@ -0,0 +1,274 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "virtual_texture_page_cache.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace wvu {
+
+VirtualTexturePageCache::VirtualTexturePageCache(const int num_slots) :
+    num_slots_(num_slots), num_used_slots_(0) {}
+
+int VirtualTexturePageCache::Find(const VirtualPageId& page) const {
+  const auto resident_page = resident_pages_.find(page.key());
+  return resident_page != resident_pages_.end() ?
+      resident_page->second.slot : -1;
+}
+
+void VirtualTexturePageCache::Touch(const VirtualPageId& page,
+                                    const int64_t frame) {
+  const auto resident_page = resident_pages_.find(page.key());
+  if (resident_page == resident_pages_.end()) {
+    return;
+  }
+  ResidentPage& entry = resident_page->second;
+  entry.last_used_frame = frame;
+  if (!entry.pinned) {
+    lru_pages_.splice(lru_pages_.begin(), lru_pages_, entry.lru_position);
+  }
+}
+
+int VirtualTexturePageCache::Insert(const VirtualPageId& page,
+                                    const int64_t frame,
+                                    const bool pinned,
+                                    VirtualPageId* evicted_page,
+                                    bool* evicted) {
+  *evicted = false;
+  int slot;
+  if (num_used_slots_ < num_slots_) {
+    slot = num_used_slots_++;
+  } else {
+    // The pages at the back of the list are the least recently used.
+    if (lru_pages_.empty()) {
+      return -1;
+    }
+    const auto victim = resident_pages_.find(lru_pages_.back());
+    if (victim->second.last_used_frame >= frame) {
+      return -1;
+    }
+    slot = victim->second.slot;
+    *evicted_page = victim->second.page;
+    *evicted = true;
+    resident_pages_.erase(victim);
+    lru_pages_.pop_back();
+  }
+  ResidentPage& entry = resident_pages_[page.key()];
+  entry.page = page;
+  entry.slot = slot;
+  entry.last_used_frame = frame;
+  entry.pinned = pinned;
+  if (!pinned) {
+    lru_pages_.push_front(page.key());
+    entry.lru_position = lru_pages_.begin();
+  }
+  return slot;
+}
+
+VirtualTexturePageTable::VirtualTexturePageTable(
+    const std::vector<int>& num_pages_x,
+    const std::vector<int>& num_pages_y,
+    const int num_slots_per_side) :
+    num_pages_x_(num_pages_x),
+    num_pages_y_(num_pages_y),
+    num_slots_per_side_(num_slots_per_side),
+    num_rows_(0) {
+  for (const int level_num_pages_y : num_pages_y_) {
+    level_rows_.push_back(num_rows_);
+    num_rows_ += level_num_pages_y;
+  }
+  entries_.assign(4 * static_cast<size_t>(width()) * num_rows_, 0);
+  level_dirty_rows_.assign(num_pages_y_.size(), RowRange{ 0, 0 });
+}
+
+void VirtualTexturePageTable::Rebuild(
+    const VirtualTexturePageCache& page_cache) {
+  const int num_levels = static_cast<int>(num_pages_x_.size());
+  // From the coarsest level down, so the entry of the parent is final when
+  // its children copy it.
+  for (int level = num_levels - 1; level >= 0; --level) {
+    UpdateEntries(page_cache, level, 0, 0, num_pages_x_[level],
+                  num_pages_y_[level]);
+  }
+}
+
+void VirtualTexturePageTable::Update(
+    const VirtualTexturePageCache& page_cache, const VirtualPageId& page) {
+  int begin_x = page.x, begin_y = page.y;
+  int end_x = page.x + 1, end_y = page.y + 1;
+  for (int level = page.level; level >= 0; --level) {
+    UpdateEntries(page_cache, level, begin_x, begin_y, end_x, end_y);
+    if (level == 0) {
+      break;
+    }
+    // The children of the pages, including the ones that the clamping of
+    // odd levels assigns to the last row and column.
+    end_x = end_x == num_pages_x_[level] ? num_pages_x_[level - 1] :
+            std::min(2 * end_x, num_pages_x_[level - 1]);
+    end_y = end_y == num_pages_y_[level] ? num_pages_y_[level - 1] :
+            std::min(2 * end_y, num_pages_y_[level - 1]);
+    begin_x = std::min(2 * begin_x, end_x);
+    begin_y = std::min(2 * begin_y, end_y);
+  }
+}
+
+std::vector<VirtualTexturePageTable::RowRange>
+VirtualTexturePageTable::dirty_rows() const {
+  // The levels are stored from the finest one, so the ranges are sorted.
+  std::vector<RowRange> dirty_rows;
+  for (size_t level = 0; level < level_dirty_rows_.size(); ++level) {
+    const RowRange& level_rows = level_dirty_rows_[level];
+    if (level_rows.begin >= level_rows.end) {
+      continue;
+    }
+    const RowRange rows = { level_rows_[level] + level_rows.begin,
+                            level_rows_[level] + level_rows.end };
+    if (!dirty_rows.empty() && dirty_rows.back().end == rows.begin) {
+      dirty_rows.back().end = rows.end;
+    } else {
+      dirty_rows.push_back(rows);
+    }
+  }
+  return dirty_rows;
+}
+
+void VirtualTexturePageTable::ClearDirtyRows() {
+  level_dirty_rows_.assign(num_pages_y_.size(), RowRange{ 0, 0 });
+}
+
+void VirtualTexturePageTable::UpdateEntries(
+    const VirtualTexturePageCache& page_cache,
+    const int level,
+    const int begin_x,
+    const int begin_y,
+    const int end_x,
+    const int end_y) {
+  if (begin_x >= end_x || begin_y >= end_y) {
+    return;
+  }
+  const int num_levels = static_cast<int>(num_pages_x_.size());
+  for (int y = begin_y; y < end_y; ++y) {
+    for (int x = begin_x; x < end_x; ++x) {
+      unsigned char* entry = &entries_[EntryOffset(level, x, y)];
+      const int slot = page_cache.Find({ level, x, y });
+      if (slot >= 0) {
+        entry[0] = slot % num_slots_per_side_;
+        entry[1] = slot / num_slots_per_side_;
+        entry[2] = level;
+        entry[3] = 255;
+      } else if (level + 1 < num_levels) {
+        const int parent_x = std::min(x / 2, num_pages_x_[level + 1] - 1);
+        const int parent_y = std::min(y / 2, num_pages_y_[level + 1] - 1);
+        const unsigned char* parent_entry =
+            &entries_[EntryOffset(level + 1, parent_x, parent_y)];
+        std::copy(parent_entry, parent_entry + 4, entry);
+      }
+    }
+  }
+  RowRange& dirty_rows = level_dirty_rows_[level];
+  if (dirty_rows.begin >= dirty_rows.end) {
+    dirty_rows = { begin_y, end_y };
+  } else {
+    dirty_rows.begin = std::min(dirty_rows.begin, begin_y);
+    dirty_rows.end = std::max(dirty_rows.end, end_y);
+  }
+}
+
+VirtualTextureTileScheduler::VirtualTextureTileScheduler(
+    const std::vector<int>& num_pages_x,
+    const std::vector<int>& num_pages_y,
+    const Options& options) :
+    num_pages_x_(num_pages_x), num_pages_y_(num_pages_y), options_(options) {}
+
+void VirtualTextureTileScheduler::AddFeedback(const VirtualPageId& page) {
+  Request& request = requests_[page.key()];
+  if (request.num_pixels == 0) {
+    request.page = page;
+  }
+  ++request.num_pixels;
+}
+
+std::vector<VirtualPageId> VirtualTextureTileScheduler::Schedule(
+    const int64_t frame, VirtualTexturePageCache* page_cache) {
+  // Every ancestor is needed by the pixels of its descendants.
+  std::unordered_map<uint64_t, Request> needed_pages = requests_;
+  for (const auto& request : requests_) {
+    VirtualPageId page = request.second.page;
+    while (page.level + 1 < static_cast<int>(num_pages_x_.size())) {
+      page = page.parent();
+      page.x = std::min(page.x, num_pages_x_[page.level] - 1);
+      page.y = std::min(page.y, num_pages_y_[page.level] - 1);
+      Request& ancestor = needed_pages[page.key()];
+      ancestor.page = page;
+      ancestor.num_pixels += request.second.num_pixels;
+    }
+  }
+  requests_.clear();
+  std::vector<Request> missing_pages;
+  for (const auto& needed_page : needed_pages) {
+    const VirtualPageId& page = needed_page.second.page;
+    if (page_cache->Find(page) >= 0) {
+      page_cache->Touch(page, frame);
+    } else if (pages_in_flight_.count(page.key()) == 0) {
+      missing_pages.push_back(needed_page.second);
+    }
+  }
+  // Coarser levels first, then the pages that cover more pixels.
+  std::sort(missing_pages.begin(), missing_pages.end(),
+            [](const Request& a, const Request& b) {
+    if (a.page.level != b.page.level) {
+      return a.page.level > b.page.level;
+    }
+    return a.num_pixels > b.num_pixels;
+  });
+  const int num_requests = std::max(0, std::min(
+      {static_cast<int>(missing_pages.size()), options_.max_requests_per_frame,
+       options_.max_pages_in_flight - num_pages_in_flight()}));
+  std::vector<VirtualPageId> pages(num_requests);
+  for (int i = 0; i < num_requests; ++i) {
+    pages[i] = missing_pages[i].page;
+    pages_in_flight_.insert(pages[i].key());
+  }
+  return pages;
+}
+
+void VirtualTextureTileScheduler::OnPageLoaded(const VirtualPageId& page) {
+  pages_in_flight_.erase(page.key());
+}
+
+}  // namespace wvu
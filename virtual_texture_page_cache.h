@@ -0,0 +1,291 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#ifndef GLUTILS_VIRTUAL_TEXTURE_PAGE_CACHE_H_
+#define GLUTILS_VIRTUAL_TEXTURE_PAGE_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace wvu {
+// A page of a virtual texture: a tile of one of the levels of its mip pyramid.
+struct VirtualPageId {
+  int level;
+  int x;
+  int y;
+
+  // Returns a key that identifies the page.
+  uint64_t key() const {
+    return (static_cast<uint64_t>(level) << 48) |
+        (static_cast<uint64_t>(y) << 24) | static_cast<uint64_t>(x);
+  }
+  // Returns the page of the next (coarser) level that covers this page. The
+  // sizes of the levels are rounded down, so the parent of a page on the last
+  // row or column may be outside of the coarser level and must be clamped.
+  VirtualPageId parent() const { return { level + 1, x / 2, y / 2 }; }
+
+  bool operator==(const VirtualPageId& other) const {
+    return level == other.level && x == other.x && y == other.y;
+  }
+};
+
+// This class assigns the slots of the physical page cache (the texture that
+// holds the resident pages) to pages. When the slots are exhausted, the least
+// recently used page is replaced, except pages used in the current frame and
+// pinned pages. The class does not use OpenGL, so it can be exercised without
+// a GPU.
+//
+// Example:
+//
+// wvu::VirtualTexturePageCache page_cache(1024);
+// int slot = page_cache.Find(page);
+// if (slot < 0) {
+//   VirtualPageId evicted_page;
+//   bool evicted;
+//   slot = page_cache.Insert(page, frame, false, &evicted_page, &evicted);
+//   ...  // Upload the page into the slot.
+// } else {
+//   page_cache.Touch(page, frame);
+// }
+class VirtualTexturePageCache {
+ public:
+  explicit VirtualTexturePageCache(const int num_slots);
+
+  // Returns the slot of the page, or -1 if the page is not resident.
+  int Find(const VirtualPageId& page) const;
+
+  // Marks the resident page as used in the frame.
+  void Touch(const VirtualPageId& page, const int64_t frame);
+
+  // Assigns a slot to the page and returns it. The page must not be resident.
+  // If no slot is free, the least recently used page is evicted; evicted is
+  // then set to true and evicted_page to that page. Returns -1 if every slot
+  // holds a pinned page or a page used in the frame.
+  // Parameters:
+  //   page  The page to insert.
+  //   frame  The current frame.
+  //   pinned  If true, the page is never evicted.
+  //   evicted_page  The evicted page, if any.
+  //   evicted  True if a page was evicted.
+  int Insert(const VirtualPageId& page,
+             const int64_t frame,
+             const bool pinned,
+             VirtualPageId* evicted_page,
+             bool* evicted);
+
+  int num_slots() const { return num_slots_; }
+  int num_resident_pages() const {
+    return static_cast<int>(resident_pages_.size());
+  }
+
+ private:
+  // A page that holds a slot.
+  struct ResidentPage {
+    VirtualPageId page;
+    int slot;
+    int64_t last_used_frame;
+    bool pinned;
+    // Position in the LRU list; unused for pinned pages.
+    std::list<uint64_t>::iterator lru_position;
+  };
+
+  const int num_slots_;
+  int num_used_slots_;
+  std::unordered_map<uint64_t, ResidentPage> resident_pages_;
+  // Keys of the unpinned resident pages, most recently used first.
+  std::list<uint64_t> lru_pages_;
+};
+
+// This class keeps the CPU copy of the page table of a virtual texture: an
+// entry of four bytes per page of every level, with the levels stacked
+// vertically. Every entry holds the slot of the page that is sampled for it
+// (its x and y in the physical page cache), the level of that page, and 255:
+// the page itself when it is resident, and its closest resident ancestor
+// otherwise. The class does not use OpenGL.
+//
+// Example:
+//
+// wvu::VirtualTexturePageTable page_table(num_pages_x, num_pages_y,
+//                                         num_slots_per_side);
+// page_table.Rebuild(page_cache);
+// glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, page_table.width(),
+//                 page_table.num_rows(), GL_RGBA_INTEGER, GL_UNSIGNED_BYTE,
+//                 page_table.data());
+class VirtualTexturePageTable {
+ public:
+  // Parameters:
+  //   num_pages_x, num_pages_y  The number of pages of every level.
+  //   num_slots_per_side  The number of slots per side of the physical page
+  //     cache.
+  VirtualTexturePageTable(const std::vector<int>& num_pages_x,
+                          const std::vector<int>& num_pages_y,
+                          const int num_slots_per_side);
+
+  // A range of rows of the table that changed since ClearDirtyRows().
+  struct RowRange {
+    int begin;
+    int end;
+  };
+
+  // Points every entry to its page or to its closest resident ancestor.
+  // Entries without a resident page nor ancestor are left as they are.
+  // Every row becomes dirty.
+  void Rebuild(const VirtualTexturePageCache& page_cache);
+
+  // Same as above, only for the entry of the page and the entries of the
+  // finer levels that fall back to it. Call it for every page that was
+  // mapped or evicted; only the rows of those entries become dirty.
+  void Update(const VirtualTexturePageCache& page_cache,
+              const VirtualPageId& page);
+
+  // Returns the sorted, disjoint ranges of the dirty rows.
+  std::vector<RowRange> dirty_rows() const;
+  void ClearDirtyRows();
+
+  // Returns the four bytes of the entry of the page.
+  const unsigned char* entry(const VirtualPageId& page) const {
+    return &entries_[EntryOffset(page.level, page.x, page.y)];
+  }
+
+  // The table is width() entries wide (the pages of level 0) and num_rows()
+  // rows high.
+  int width() const { return num_pages_x_.empty() ? 0 : num_pages_x_[0]; }
+  int num_rows() const { return num_rows_; }
+  const unsigned char* data() const { return entries_.data(); }
+  // Row of the table where every level starts.
+  const std::vector<int>& level_rows() const { return level_rows_; }
+
+ private:
+  // Returns the offset of the entry of the page in entries_.
+  size_t EntryOffset(const int level, const int x, const int y) const {
+    return 4 * ((static_cast<size_t>(level_rows_[level]) + y) * width() + x);
+  }
+
+  // Points the entries of the pages from (begin_x, begin_y) to (end_x, end_y),
+  // exclusive, of the level to their pages or to their parents.
+  void UpdateEntries(const VirtualTexturePageCache& page_cache,
+                     const int level,
+                     const int begin_x,
+                     const int begin_y,
+                     const int end_x,
+                     const int end_y);
+
+  const std::vector<int> num_pages_x_;
+  const std::vector<int> num_pages_y_;
+  const int num_slots_per_side_;
+  std::vector<int> level_rows_;
+  int num_rows_;
+  std::vector<unsigned char> entries_;
+  // The dirty rows of every level, relative to the level; empty if begin is
+  // not less than end.
+  std::vector<RowRange> level_dirty_rows_;
+};
+
+// This class turns the feedback of the frames (the pages that the visible
+// pixels need) into requests for the loader. The pages of the coarser levels
+// go first: they cover more pixels and are the fallback of the finer pages.
+// The ancestors of every needed page are requested too, so the chain of
+// fallbacks is resident. Pages already resident are only marked as used, and
+// pages in flight are not requested twice. The class does not use OpenGL.
+//
+// Example:
+//
+// wvu::VirtualTextureTileScheduler scheduler(num_pages_x, num_pages_y,
+//                                           options);
+// for (...) {  // Every page in the feedback of the frame.
+//   scheduler.AddFeedback(page);
+// }
+// for (const wvu::VirtualPageId& page :
+//      scheduler.Schedule(frame, &page_cache)) {
+//   ...  // Ask the loader for the page.
+// }
+// ...  // Once the page is uploaded or dropped:
+// scheduler.OnPageLoaded(page);
+class VirtualTextureTileScheduler {
+ public:
+  // Configuration of the scheduler.
+  struct Options {
+    // Maximum number of pages requested per frame.
+    int max_requests_per_frame = 32;
+    // Maximum number of pages requested but not loaded yet.
+    int max_pages_in_flight = 128;
+  };
+
+  // Parameters:
+  //   num_pages_x, num_pages_y  The number of pages of every level.
+  //   options  The configuration of the scheduler.
+  VirtualTextureTileScheduler(const std::vector<int>& num_pages_x,
+                              const std::vector<int>& num_pages_y,
+                              const Options& options);
+
+  // Records a page that a pixel of the current frame needs.
+  void AddFeedback(const VirtualPageId& page);
+
+  // Marks the resident pages of the feedback as used, returns the missing
+  // pages to load, and clears the feedback.
+  // Parameters:
+  //   frame  The current frame.
+  //   page_cache  The cache of resident pages.
+  std::vector<VirtualPageId> Schedule(const int64_t frame,
+                                      VirtualTexturePageCache* page_cache);
+
+  // Marks a requested page as loaded (or dropped), so it can be requested
+  // again.
+  void OnPageLoaded(const VirtualPageId& page);
+
+  int num_pages_in_flight() const {
+    return static_cast<int>(pages_in_flight_.size());
+  }
+
+ private:
+  // A page of the feedback and the number of pixels that need it.
+  struct Request {
+    VirtualPageId page;
+    int num_pixels;
+  };
+
+  const std::vector<int> num_pages_x_;
+  const std::vector<int> num_pages_y_;
+  const Options options_;
+  std::unordered_map<uint64_t, Request> requests_;
+  std::unordered_set<uint64_t> pages_in_flight_;
+};
+
+}  // namespace wvu
+
+#endif  // GLUTILS_VIRTUAL_TEXTURE_PAGE_CACHE_H_
@@ -0,0 +1,351 @@
+// Copyright (C) 2016 West Virginia University.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials provided
+//       with the distribution.
+//
+//     * Neither the name of West Virginia University nor the
+//       names of its contributors may be used to endorse or promote products
+//       derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+// Please contact the author of this library if you have any questions.
+// Author: Victor Fragoso (victor.fragoso@mail.wvu.edu)
+
+#include "virtual_texture_page_cache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace wvu {
+namespace {
+
+// Inserts the page and expects it not to evict any page.
+int InsertWithoutEviction(const VirtualPageId& page,
+                          const int64_t frame,
+                          const bool pinned,
+                          VirtualTexturePageCache* page_cache) {
+  VirtualPageId evicted_page;
+  bool evicted;
+  const int slot =
+      page_cache->Insert(page, frame, pinned, &evicted_page, &evicted);
+  EXPECT_FALSE(evicted);
+  return slot;
+}
+
+TEST(VirtualTexturePageCacheTest, AssignsFreeSlotsFirst) {
+  VirtualTexturePageCache page_cache(3);
+  EXPECT_EQ(InsertWithoutEviction({ 0, 0, 0 }, 1, false, &page_cache), 0);
+  EXPECT_EQ(InsertWithoutEviction({ 0, 1, 0 }, 1, false, &page_cache), 1);
+  EXPECT_EQ(InsertWithoutEviction({ 1, 0, 0 }, 1, false, &page_cache), 2);
+  EXPECT_EQ(page_cache.num_resident_pages(), 3);
+  EXPECT_EQ(page_cache.Find({ 0, 1, 0 }), 1);
+  EXPECT_EQ(page_cache.Find({ 0, 0, 1 }), -1);
+}
+
+TEST(VirtualTexturePageCacheTest, EvictsLeastRecentlyUsedPage) {
+  VirtualTexturePageCache page_cache(2);
+  const VirtualPageId a = { 0, 0, 0 };
+  const VirtualPageId b = { 0, 1, 0 };
+  const VirtualPageId c = { 0, 2, 0 };
+  const int slot_a = InsertWithoutEviction(a, 1, false, &page_cache);
+  const int slot_b = InsertWithoutEviction(b, 2, false, &page_cache);
+  // Touching a makes b the least recently used page.
+  page_cache.Touch(a, 3);
+  VirtualPageId evicted_page;
+  bool evicted;
+  EXPECT_EQ(page_cache.Insert(c, 4, false, &evicted_page, &evicted), slot_b);
+  EXPECT_TRUE(evicted);
+  EXPECT_EQ(evicted_page, b);
+  EXPECT_EQ(page_cache.Find(b), -1);
+  EXPECT_EQ(page_cache.Find(a), slot_a);
+  EXPECT_EQ(page_cache.Find(c), slot_b);
+}
+
+TEST(VirtualTexturePageCacheTest, KeepsPagesUsedInTheFrame) {
+  VirtualTexturePageCache page_cache(1);
+  InsertWithoutEviction({ 0, 0, 0 }, 5, false, &page_cache);
+  VirtualPageId evicted_page;
+  bool evicted;
+  EXPECT_EQ(page_cache.Insert({ 0, 1, 0 }, 5, false, &evicted_page, &evicted),
+            -1);
+  EXPECT_FALSE(evicted);
+  EXPECT_EQ(page_cache.Find({ 0, 0, 0 }), 0);
+}
+
+TEST(VirtualTexturePageCacheTest, NeverEvictsPinnedPages) {
+  VirtualTexturePageCache page_cache(2);
+  const VirtualPageId pinned_page = { 2, 0, 0 };
+  const int pinned_slot =
+      InsertWithoutEviction(pinned_page, 1, true, &page_cache);
+  InsertWithoutEviction({ 0, 0, 0 }, 2, false, &page_cache);
+  VirtualPageId evicted_page;
+  bool evicted;
+  // The pinned page is the oldest, but the unpinned page is evicted.
+  EXPECT_NE(page_cache.Insert({ 0, 1, 0 }, 3, false, &evicted_page,
+                              &evicted), pinned_slot);
+  EXPECT_TRUE(evicted);
+  EXPECT_EQ(evicted_page, (VirtualPageId{ 0, 0, 0 }));
+  // The only unpinned page is used in the frame.
+  EXPECT_EQ(page_cache.Insert({ 0, 2, 0 }, 3, false, &evicted_page,
+                              &evicted), -1);
+  EXPECT_EQ(page_cache.Find(pinned_page), pinned_slot);
+}
+
+TEST(VirtualTexturePageCacheTest, FailsWhenEveryPageIsPinned) {
+  VirtualTexturePageCache page_cache(1);
+  InsertWithoutEviction({ 1, 0, 0 }, 1, true, &page_cache);
+  VirtualPageId evicted_page;
+  bool evicted;
+  EXPECT_EQ(page_cache.Insert({ 0, 0, 0 }, 2, false, &evicted_page, &evicted),
+            -1);
+  EXPECT_FALSE(evicted);
+}
+
+// A pyramid of 4x4, 2x2 and 1x1 pages.
+class VirtualTextureTileSchedulerTest : public ::testing::Test {
+ protected:
+  VirtualTextureTileSchedulerTest() :
+      num_pages_x_({ 4, 2, 1 }), num_pages_y_({ 4, 2, 1 }), page_cache_(64) {}
+
+  const std::vector<int> num_pages_x_;
+  const std::vector<int> num_pages_y_;
+  VirtualTexturePageCache page_cache_;
+};
+
+TEST_F(VirtualTextureTileSchedulerTest, RequestsCoarserLevelsFirst) {
+  VirtualTextureTileScheduler scheduler(num_pages_x_, num_pages_y_,
+                                        VirtualTextureTileScheduler::Options());
+  scheduler.AddFeedback({ 0, 3, 3 });
+  const std::vector<VirtualPageId> pages = scheduler.Schedule(1, &page_cache_);
+  // The page and its ancestors, from the coarsest level down.
+  ASSERT_EQ(pages.size(), 3);
+  EXPECT_EQ(pages[0], (VirtualPageId{ 2, 0, 0 }));
+  EXPECT_EQ(pages[1], (VirtualPageId{ 1, 1, 1 }));
+  EXPECT_EQ(pages[2], (VirtualPageId{ 0, 3, 3 }));
+}
+
+TEST_F(VirtualTextureTileSchedulerTest, RequestsPagesWithMorePixelsFirst) {
+  InsertWithoutEviction({ 2, 0, 0 }, 0, true, &page_cache_);
+  InsertWithoutEviction({ 1, 0, 0 }, 0, false, &page_cache_);
+  VirtualTextureTileScheduler scheduler(num_pages_x_, num_pages_y_,
+                                        VirtualTextureTileScheduler::Options());
+  scheduler.AddFeedback({ 0, 0, 0 });
+  for (int i = 0; i < 3; ++i) {
+    scheduler.AddFeedback({ 0, 1, 0 });
+  }
+  scheduler.AddFeedback({ 0, 0, 1 });
+  scheduler.AddFeedback({ 0, 0, 1 });
+  const std::vector<VirtualPageId> pages = scheduler.Schedule(1, &page_cache_);
+  ASSERT_EQ(pages.size(), 3);
+  EXPECT_EQ(pages[0], (VirtualPageId{ 0, 1, 0 }));
+  EXPECT_EQ(pages[1], (VirtualPageId{ 0, 0, 1 }));
+  EXPECT_EQ(pages[2], (VirtualPageId{ 0, 0, 0 }));
+}
+
+TEST_F(VirtualTextureTileSchedulerTest, LimitsTheRequestsPerFrame) {
+  VirtualTextureTileScheduler::Options options;
+  options.max_requests_per_frame = 2;
+  VirtualTextureTileScheduler scheduler(num_pages_x_, num_pages_y_, options);
+  scheduler.AddFeedback({ 0, 3, 3 });
+  const std::vector<VirtualPageId> first_pages =
+      scheduler.Schedule(1, &page_cache_);
+  ASSERT_EQ(first_pages.size(), 2);
+  EXPECT_EQ(first_pages[0].level, 2);
+  EXPECT_EQ(first_pages[1].level, 1);
+  EXPECT_EQ(scheduler.num_pages_in_flight(), 2);
+  // The pages in flight are not requested again.
+  scheduler.AddFeedback({ 0, 3, 3 });
+  const std::vector<VirtualPageId> second_pages =
+      scheduler.Schedule(2, &page_cache_);
+  ASSERT_EQ(second_pages.size(), 1);
+  EXPECT_EQ(second_pages[0], (VirtualPageId{ 0, 3, 3 }));
+}
+
+TEST_F(VirtualTextureTileSchedulerTest, LimitsThePagesInFlight) {
+  VirtualTextureTileScheduler::Options options;
+  options.max_pages_in_flight = 1;
+  VirtualTextureTileScheduler scheduler(num_pages_x_, num_pages_y_, options);
+  scheduler.AddFeedback({ 0, 0, 0 });
+  ASSERT_EQ(scheduler.Schedule(1, &page_cache_).size(), 1);
+  scheduler.AddFeedback({ 0, 0, 0 });
+  EXPECT_TRUE(scheduler.Schedule(2, &page_cache_).empty());
+  // A dropped page can be requested again.
+  scheduler.OnPageLoaded({ 2, 0, 0 });
+  scheduler.AddFeedback({ 0, 0, 0 });
+  const std::vector<VirtualPageId> pages = scheduler.Schedule(3, &page_cache_);
+  ASSERT_EQ(pages.size(), 1);
+  EXPECT_EQ(pages[0], (VirtualPageId{ 2, 0, 0 }));
+}
+
+TEST_F(VirtualTextureTileSchedulerTest, TouchesResidentPages) {
+  VirtualTexturePageCache page_cache(2);
+  const VirtualPageId coarse_page = { 1, 0, 0 };
+  InsertWithoutEviction({ 2, 0, 0 }, 1, true, &page_cache);
+  InsertWithoutEviction(coarse_page, 1, false, &page_cache);
+  VirtualTextureTileScheduler scheduler(num_pages_x_, num_pages_y_,
+                                        VirtualTextureTileScheduler::Options());
+  scheduler.AddFeedback({ 0, 0, 0 });
+  const std::vector<VirtualPageId> pages = scheduler.Schedule(7, &page_cache);
+  ASSERT_EQ(pages.size(), 1);
+  EXPECT_EQ(pages[0], (VirtualPageId{ 0, 0, 0 }));
+  // The resident ancestor is used in frame 7, so it cannot be evicted.
+  VirtualPageId evicted_page;
+  bool evicted;
+  EXPECT_EQ(page_cache.Insert(pages[0], 7, false, &evicted_page, &evicted),
+            -1);
+}
+
+// Expects the entry of the page to point to the slot of the level.
+void ExpectEntry(const VirtualTexturePageTable& page_table,
+                 const VirtualPageId& page,
+                 const int num_slots_per_side,
+                 const int slot,
+                 const int level) {
+  const unsigned char* entry = page_table.entry(page);
+  EXPECT_EQ(entry[0] + entry[1] * num_slots_per_side, slot)
+      << "page " << page.level << " " << page.x << " " << page.y;
+  EXPECT_EQ(entry[2], level)
+      << "page " << page.level << " " << page.x << " " << page.y;
+  EXPECT_EQ(entry[3], 255);
+}
+
+TEST(VirtualTexturePageTableTest, FallsBackToTheClosestResidentAncestor) {
+  const std::vector<int> num_pages = { 4, 2, 1 };
+  constexpr int kNumSlotsPerSide = 4;
+  VirtualTexturePageCache page_cache(kNumSlotsPerSide * kNumSlotsPerSide);
+  const int coarsest_slot =
+      InsertWithoutEviction({ 2, 0, 0 }, 1, true, &page_cache);
+  const int parent_slot =
+      InsertWithoutEviction({ 1, 1, 0 }, 1, false, &page_cache);
+  const int page_slot =
+      InsertWithoutEviction({ 0, 3, 1 }, 1, false, &page_cache);
+  VirtualTexturePageTable page_table(num_pages, num_pages, kNumSlotsPerSide);
+  EXPECT_EQ(page_table.width(), 4);
+  EXPECT_EQ(page_table.num_rows(), 7);
+  EXPECT_EQ(page_table.level_rows(), (std::vector<int>{ 0, 4, 6 }));
+  page_table.Rebuild(page_cache);
+  // Resident pages point to themselves.
+  ExpectEntry(page_table, { 2, 0, 0 }, kNumSlotsPerSide, coarsest_slot, 2);
+  ExpectEntry(page_table, { 1, 1, 0 }, kNumSlotsPerSide, parent_slot, 1);
+  ExpectEntry(page_table, { 0, 3, 1 }, kNumSlotsPerSide, page_slot, 0);
+  // Missing pages point to their parent, or further up.
+  ExpectEntry(page_table, { 0, 2, 0 }, kNumSlotsPerSide, parent_slot, 1);
+  ExpectEntry(page_table, { 0, 0, 0 }, kNumSlotsPerSide, coarsest_slot, 2);
+  ExpectEntry(page_table, { 1, 0, 1 }, kNumSlotsPerSide, coarsest_slot, 2);
+  ExpectEntry(page_table, { 0, 1, 3 }, kNumSlotsPerSide, coarsest_slot, 2);
+}
+
+TEST(VirtualTexturePageTableTest, FallsBackAfterEviction) {
+  const std::vector<int> num_pages = { 2, 1 };
+  VirtualTexturePageCache page_cache(2);
+  const int coarsest_slot =
+      InsertWithoutEviction({ 1, 0, 0 }, 1, true, &page_cache);
+  const int slot = InsertWithoutEviction({ 0, 0, 0 }, 1, false, &page_cache);
+  VirtualTexturePageTable page_table(num_pages, num_pages, 2);
+  page_table.Rebuild(page_cache);
+  ExpectEntry(page_table, { 0, 0, 0 }, 2, slot, 0);
+  VirtualPageId evicted_page;
+  bool evicted;
+  EXPECT_EQ(page_cache.Insert({ 0, 1, 0 }, 2, false, &evicted_page, &evicted),
+            slot);
+  page_table.Rebuild(page_cache);
+  ExpectEntry(page_table, { 0, 0, 0 }, 2, coarsest_slot, 1);
+  ExpectEntry(page_table, { 0, 1, 0 }, 2, slot, 0);
+}
+
+TEST(VirtualTexturePageTableTest, ClampsTheParentsOfOddLevels) {
+  // Levels of 3x3 and 1x1 pages: the pages of the last row and column have
+  // no parent of their own.
+  const std::vector<int> num_pages = { 3, 1 };
+  VirtualTexturePageCache page_cache(4);
+  const int coarsest_slot =
+      InsertWithoutEviction({ 1, 0, 0 }, 1, true, &page_cache);
+  VirtualTexturePageTable page_table(num_pages, num_pages, 2);
+  page_table.Rebuild(page_cache);
+  ExpectEntry(page_table, { 0, 2, 2 }, 2, coarsest_slot, 1);
+  ExpectEntry(page_table, { 0, 2, 0 }, 2, coarsest_slot, 1);
+}
+
+TEST(VirtualTexturePageTableTest, UpdateMatchesRebuild) {
+  // Odd levels, so the clamped parents are covered too.
+  const std::vector<int> num_pages = { 5, 3, 2, 1 };
+  VirtualTexturePageCache page_cache(6);
+  InsertWithoutEviction({ 3, 0, 0 }, 1, true, &page_cache);
+  VirtualTexturePageTable page_table(num_pages, num_pages, 3);
+  VirtualTexturePageTable rebuilt_page_table(num_pages, num_pages, 3);
+  page_table.Rebuild(page_cache);
+  const VirtualPageId pages[] = {
+    { 2, 1, 1 }, { 1, 2, 2 }, { 0, 4, 4 }, { 1, 0, 1 }, { 0, 1, 3 },
+    { 2, 0, 0 }, { 0, 2, 2 }, { 1, 2, 0 }, { 0, 4, 0 }
+  };
+  int frame = 2;
+  for (const VirtualPageId& page : pages) {
+    VirtualPageId evicted_page;
+    bool evicted;
+    ASSERT_GE(page_cache.Insert(page, frame++, false, &evicted_page, &evicted),
+              0);
+    if (evicted) {
+      page_table.Update(page_cache, evicted_page);
+    }
+    page_table.Update(page_cache, page);
+    rebuilt_page_table.Rebuild(page_cache);
+    EXPECT_TRUE(std::equal(
+        page_table.data(),
+        page_table.data() + 4 * page_table.width() * page_table.num_rows(),
+        rebuilt_page_table.data()))
+        << "page " << page.level << " " << page.x << " " << page.y;
+  }
+}
+
+TEST(VirtualTexturePageTableTest, UpdateOnlyDirtiesTheRowsOfThePage) {
+  const std::vector<int> num_pages = { 8, 4, 2, 1 };
+  VirtualTexturePageCache page_cache(4);
+  InsertWithoutEviction({ 3, 0, 0 }, 1, true, &page_cache);
+  VirtualTexturePageTable page_table(num_pages, num_pages, 2);
+  EXPECT_TRUE(page_table.dirty_rows().empty());
+  page_table.Rebuild(page_cache);
+  std::vector<VirtualTexturePageTable::RowRange> dirty_rows =
+      page_table.dirty_rows();
+  ASSERT_EQ(dirty_rows.size(), 1u);
+  EXPECT_EQ(dirty_rows[0].begin, 0);
+  EXPECT_EQ(dirty_rows[0].end, 15);
+  page_table.ClearDirtyRows();
+  EXPECT_TRUE(page_table.dirty_rows().empty());
+  // The page covers rows 2 and 3 of level 0, which start at row 0, and row
+  // 1 of level 1, which starts at row 8.
+  InsertWithoutEviction({ 1, 0, 1 }, 2, false, &page_cache);
+  page_table.Update(page_cache, { 1, 0, 1 });
+  dirty_rows = page_table.dirty_rows();
+  ASSERT_EQ(dirty_rows.size(), 2u);
+  EXPECT_EQ(dirty_rows[0].begin, 2);
+  EXPECT_EQ(dirty_rows[0].end, 4);
+  EXPECT_EQ(dirty_rows[1].begin, 9);
+  EXPECT_EQ(dirty_rows[1].end, 10);
+}
+
+}  // namespace
+}  // namespace wvu